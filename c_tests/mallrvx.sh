@@ -2,10 +2,10 @@
 
 includes="-I../gnu11rv-arm/include -I../gnu11rv-arm/include/c++/11 -I../gnu11rv-arm/include/c++/11/riscv64-linux-gnu"
 
-for arg in tcmp t e printint sieve simple tmuldiv tpi ts tarray tbits trw trw2 tmmap tstr \
+for arg in tcmp t e printint sieve simple tmuldiv tpi ts tarray tbits trw trw2 tmmap tmmapf tstr \
            tdir fileops ttime tm glob tap tsimplef tphi tf ttt td terrno t_setjmp tex \
            tprintf pis mm tao ttypes nantst sleeptm tatomic lenum tregex trename \
-           nqueens ff an ba tgets fopentst targs na termiosf wumpus taux;
+           nqueens ff an ba tgets fopentst targs na termiosf wumpus taux tthread;
 do
     echo $arg
     for optflag in 0 1 2 3 fast;
@@ -21,6 +21,14 @@ do
     done
 done
 
+# the vector test needs the V extension
+
+for optflag in 0 1 2 3 fast;
+do
+    mkdir bin"$optflag" 2>/dev/null
+    /usr/riscv64/riscv64-linux-gnu-g++-11 tvec.c -o bin"$optflag"/tvec -O"$optflag" $includes -march=rv64gcv -mabi=lp64d -latomic -static -fsigned-char -Wno-format -Wno-format-security &
+done
+
 # build assembly tests
 
 /usr/riscv64/riscv64-linux-gnu-g++-11 tins.s -o tins -mcmodel=medany -mabi=lp64d -march=rv64imadcv -latomic -static
@@ -1,9 +1,9 @@
 #!/bin/bash
 
-for arg in tcmp t e printint sieve simple tmuldiv tpi ts tarray tbits trw trw2 tmmap tstr \
+for arg in tcmp t e printint sieve simple tmuldiv tpi ts tarray tbits trw trw2 tmmap tmmapf tstr \
            tdir fileops ttime tm glob tap tsimplef tphi tf ttt td terrno t_setjmp tex \
            tprintf pis mm tao ttypes nantst sleeptm tatomic lenum tregex trename \
-           nqueens ff an ba tgets fopentst targs na termiosf wumpus taux;
+           nqueens ff an ba tgets fopentst targs na termiosf wumpus taux tthread;
 do
     echo $arg
     for optflag in 0 1 2 3 fast;
@@ -3,6 +3,8 @@
 #include <atomic>
 #include <cassert>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 template <class T> void validate( std::atomic<T> & a )
 {
@@ -48,6 +50,62 @@ template <class T> void validate( std::atomic<T> & a )
     assert( result );
 } // validate
 
+// many threads update the same values at once. amo instructions, lr/sc loops, and futex-based locks must all agree.
+
+const int stress_threads = 8;
+const uint64_t stress_loops = 20000;
+
+std::atomic<uint64_t> stress_sum( 0 );
+std::atomic<uint64_t> stress_cas( 0 );
+std::atomic<int32_t> stress_max( INT32_MIN );
+std::atomic<uint8_t> stress_small( 0 );
+std::mutex stress_mtx;
+uint64_t stress_locked = 0;
+
+void stress_worker( int t )
+{
+    for ( uint64_t i = 0; i < stress_loops; i++ )
+    {
+        stress_sum.fetch_add( i, std::memory_order_relaxed );
+
+        uint64_t old = stress_cas.load( std::memory_order_relaxed );
+        while ( !stress_cas.compare_exchange_weak( old, old + t + 1, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+            continue;
+
+        int32_t v = (int32_t) ( t * stress_loops + i );
+        int32_t prev = stress_max.load();
+        while ( prev < v && !stress_max.compare_exchange_weak( prev, v ) )
+            continue;
+
+        stress_small++; // 8-bit atomics are lr/sc loops on a masked word
+
+        std::lock_guard<std::mutex> lock( stress_mtx );
+        stress_locked += 2;
+    }
+} //stress_worker
+
+void stress()
+{
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < stress_threads; t++ )
+        threads.push_back( std::thread( stress_worker, t ) );
+
+    for ( int t = 0; t < stress_threads; t++ )
+        threads[ t ].join();
+
+    uint64_t total = stress_threads * stress_loops;
+    if ( stress_sum != stress_threads * ( stress_loops * ( stress_loops - 1 ) / 2 ) )
+        printf( "stress sum is wrong: %llu\n", (unsigned long long) stress_sum.load() );
+    if ( stress_cas != stress_loops * ( stress_threads * ( stress_threads + 1 ) / 2 ) )
+        printf( "stress compare exchange sum is wrong: %llu\n", (unsigned long long) stress_cas.load() );
+    if ( stress_max != (int32_t) ( total - 1 ) )
+        printf( "stress max is wrong: %d\n", (int) stress_max.load() );
+    if ( stress_small != (uint8_t) total )
+        printf( "stress 8-bit sum is wrong: %u\n", (unsigned) stress_small.load() );
+    if ( stress_locked != 2 * total )
+        printf( "stress locked sum is wrong: %llu\n", (unsigned long long) stress_locked );
+} //stress
+
 int main( int argc, char * argv[] )
 {
     std::atomic<int8_t> i8( 0 );
@@ -67,7 +125,7 @@ int main( int argc, char * argv[] )
     std::atomic<uint64_t> ui64( 0 );
     validate( ui64 );
 
-    // armos only has one core and supports one thread. but code will uses mutexes so validate they don't fail
+    // armos only has one core and supports one thread. but code will uses mutexes so validate they don't fail. rvos runs threads on harts
     
     std::mutex mtx;
     mtx.lock();
@@ -76,6 +134,10 @@ int main( int argc, char * argv[] )
     assert( true );
     mtx.unlock();
 
+#ifdef __riscv
+    stress();
+#endif
+
     printf( "test atomic completed with great success\n" );
     return 0;
 } //main
\ No newline at end of file
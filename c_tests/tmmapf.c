@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+// file-backed mmap: private copies, MAP_SHARED write-through, msync, and mprotect of shared mappings
+
+const char * filename = "tmmapf.dat";
+const size_t page = 4096;
+const size_t file_size = 2 * page + 1000; // the last page is partly past the end of the file
+
+uint8_t expected( size_t offset ) { return (uint8_t) ( offset % 251 ); }
+
+void fail( const char * what )
+{
+    printf( "%s failed, errno %d\n", what, errno );
+    unlink( filename );
+    exit( 1 );
+} //fail
+
+uint8_t file_byte( int fd, size_t offset )
+{
+    uint8_t b = 0;
+    if ( 1 != pread( fd, &b, 1, offset ) )
+        fail( "pread" );
+    return b;
+} //file_byte
+
+int main( int argc, char * argv[] )
+{
+    int fd = open( filename, O_CREAT | O_TRUNC | O_RDWR, 0600 );
+    if ( fd < 0 )
+        fail( "open" );
+
+    static uint8_t data[ file_size ];
+    for ( size_t i = 0; i < file_size; i++ )
+        data[ i ] = expected( i );
+    if ( file_size != write( fd, data, file_size ) )
+        fail( "write" );
+
+    // private: the file's contents, zeros past its end, and writes that don't reach the file
+
+    uint8_t * p = (uint8_t *) mmap( 0, 4 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+    if ( MAP_FAILED == p )
+        fail( "private mmap" );
+
+    size_t mismatches = 0;
+    for ( size_t i = 0; i < file_size; i++ )
+        if ( p[ i ] != expected( i ) )
+            mismatches++;
+    for ( size_t i = file_size; i < 3 * page; i++ )
+        if ( 0 != p[ i ] )
+            mismatches++;
+    printf( "private mapping: %zu mismatches\n", mismatches );
+
+    p[ 10 ] = 99;
+    printf( "private write: mapping %d, file %d\n", p[ 10 ], file_byte( fd, 10 ) );
+    munmap( p, 4 * page );
+
+    // shared and writable at an offset: writes go through to the file, and msync flushes them
+
+    uint8_t * s = (uint8_t *) mmap( 0, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, page );
+    if ( MAP_FAILED == s )
+        fail( "shared mmap" );
+
+    printf( "shared mapping starts with %d\n", s[ 0 ] );
+    s[ 20 ] = 200;
+    int result = msync( s, page, MS_SYNC );
+    printf( "msync: %d, file %d\n", result, file_byte( fd, page + 20 ) );
+    result = msync( s + 1, page, MS_SYNC );
+    printf( "msync of an unaligned address: %d, errno %d\n", result, errno );
+    munmap( s, page );
+
+    // shared and read-only, then made writable with mprotect
+
+    uint8_t * r = (uint8_t *) mmap( 0, page, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( MAP_FAILED == r )
+        fail( "read-only mmap" );
+
+    result = mprotect( r, page, PROT_READ | PROT_WRITE );
+    printf( "mprotect to writable: %d\n", result );
+    r[ 30 ] = 123;
+    result = msync( r, page, MS_SYNC );
+    printf( "write after mprotect: msync %d, file %d\n", result, file_byte( fd, 30 ) );
+    printf( "mprotect to read-only: %d\n", mprotect( r, page, PROT_READ ) );
+    printf( "mprotect of an unaligned address: %d, errno %d\n", mprotect( r + 1, page, PROT_READ ), errno );
+    munmap( r, page );
+    close( fd );
+
+    // a file opened read-only can't be made writable through a shared mapping
+
+    fd = open( filename, O_RDONLY );
+    if ( fd < 0 )
+        fail( "open read-only" );
+
+    r = (uint8_t *) mmap( 0, page, PROT_READ, MAP_SHARED, fd, 0 );
+    if ( MAP_FAILED == r )
+        fail( "mmap of read-only file" );
+
+    printf( "read-only file mapping: %d %d\n", r[ 30 ], r[ 31 ] );
+    result = mprotect( r, page, PROT_READ | PROT_WRITE );
+    printf( "mprotect of read-only file to writable: %d, errno %d\n", result, errno );
+    result = (int) ( MAP_FAILED == mmap( 0, page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) );
+    printf( "writable shared mmap of read-only file fails: %d, errno %d\n", result, errno );
+    munmap( r, page );
+    close( fd );
+
+    unlink( filename );
+    printf( "file mmap test completed with great success\n" );
+    return 0;
+} //main
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <vector>
+
+// each thread computes a slice of the work into its own slot, so this works before atomics and futexes are shared across harts
+
+const int thread_count = 8;
+const uint64_t per_thread = 1000000;
+
+struct ThreadResult
+{
+    uint64_t sum;
+    long tid;
+};
+
+static ThreadResult results[ thread_count ];
+
+void worker( int t )
+{
+    uint64_t sum = 0;
+    uint64_t start = t * per_thread;
+    for ( uint64_t i = start; i < start + per_thread; i++ )
+        sum += i;
+
+    results[ t ].sum = sum;
+    results[ t ].tid = syscall( SYS_gettid );
+} //worker
+
+int main( int argc, char * argv[] )
+{
+    std::vector<std::thread> threads;
+    for ( int t = 0; t < thread_count; t++ )
+        threads.push_back( std::thread( worker, t ) );
+
+    for ( int t = 0; t < thread_count; t++ )
+        threads[ t ].join();
+
+    uint64_t n = thread_count * per_thread;
+    uint64_t sum = 0;
+    long me = syscall( SYS_gettid );
+    if ( me != getpid() )
+        printf( "the main thread's tid %ld isn't the pid %ld\n", me, (long) getpid() );
+
+    for ( int t = 0; t < thread_count; t++ )
+    {
+        sum += results[ t ].sum;
+        if ( results[ t ].tid == me )
+            printf( "thread %d has the main thread's tid %ld\n", t, me );
+        for ( int o = 0; o < t; o++ )
+            if ( results[ o ].tid == results[ t ].tid )
+                printf( "threads %d and %d have the same tid %ld\n", o, t, results[ t ].tid );
+    }
+
+    if ( sum != ( n * ( n - 1 ) / 2 ) )
+        printf( "sum %llu isn't the expected %llu\n", (unsigned long long) sum, (unsigned long long) ( n * ( n - 1 ) / 2 ) );
+
+    printf( "test threads completed with great success\n" );
+    return 0;
+} //main
@@ -0,0 +1,993 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+
+// RVV instructions whose results are exactly specified but easy to get wrong: the vfrec7 and vfrsqrt7 7-bit
+// estimates, including subnormals and special values, and vsmul's rounding and saturation in each vxrm mode.
+// Then short instruction sequences for the rest of the extension at several SEW and LMUL settings, with and
+// without masking. Build with -march=rv64gcv. Inline assembly keeps the test independent of the compiler's
+// intrinsics version.
+
+#define FP_UNARY( op, sew, in, out, n ) \
+    asm volatile( "vsetvli t0, %2, e" #sew ", m2, ta, ma\n" \
+                  "vle" #sew ".v v2, (%0)\n" \
+                  #op ".v v6, v2\n" \
+                  "vse" #sew ".v v6, (%1)\n" \
+                  : : "r" ( in ), "r" ( out ), "r" ( n ) : "t0", "v2", "v3", "v6", "v7", "memory" )
+
+#define VSMUL( sew, a, b, out, n, vxrm, sat ) \
+    asm volatile( "csrw vxrm, %5\n" \
+                  "csrw vxsat, zero\n" \
+                  "vsetvli t0, %4, e" #sew ", m2, ta, ma\n" \
+                  "vle" #sew ".v v2, (%1)\n" \
+                  "vle" #sew ".v v4, (%2)\n" \
+                  "vsmul.vv v6, v2, v4\n" \
+                  "vse" #sew ".v v6, (%3)\n" \
+                  "csrr %0, vxsat\n" \
+                  : "=r" ( sat ) : "r" ( a ), "r" ( b ), "r" ( out ), "r" ( n ), "r" ( vxrm ) : "t0", "v2", "v3", "v4", "v5", "v6", "v7", "memory" )
+
+const char * rounding_modes[] = { "rnu", "rne", "rdn", "rod" };
+
+void show_double_estimates()
+{
+    double rec_in[] = { 1.0, 3.0, -0.7, 1e-310, 2.2250738585072014e-308, 1e308, INFINITY, -0.0, NAN, 5e-324, 1.5e-308, 0.6e-308 };
+    double rsqrt_in[] = { 4.0, 2.0, 0.3, 5e-324, INFINITY, -1.0, 0.0, -0.0, 1e-310, NAN, -INFINITY, 1e300 };
+    const size_t n = sizeof( rec_in ) / sizeof( rec_in[ 0 ] );
+    uint64_t out[ n ];
+
+    FP_UNARY( vfrec7, 64, rec_in, out, n );
+    printf( "vfrec7 e64:" );
+    for ( size_t i = 0; i < n; i++ )
+        printf( " %016llx", (unsigned long long) out[ i ] );
+    printf( "\n" );
+
+    FP_UNARY( vfrsqrt7, 64, rsqrt_in, out, n );
+    printf( "vfrsqrt7 e64:" );
+    for ( size_t i = 0; i < n; i++ )
+        printf( " %016llx", (unsigned long long) out[ i ] );
+    printf( "\n" );
+} //show_double_estimates
+
+void show_float_estimates()
+{
+    float rec_in[] = { 1.0f, 3.0f, 1e-39f, 1e38f, -5.5f, 3e38f, INFINITY, 0.0f };
+    float rsqrt_in[] = { 0.25f, 10.0f, 1e-40f, -2.0f, INFINITY, 0.0f, 7e37f, 0.001f };
+    const size_t n = sizeof( rec_in ) / sizeof( rec_in[ 0 ] );
+    uint32_t out[ n ];
+
+    FP_UNARY( vfrec7, 32, rec_in, out, n );
+    printf( "vfrec7 e32:" );
+    for ( size_t i = 0; i < n; i++ )
+        printf( " %08x", out[ i ] );
+    printf( "\n" );
+
+    FP_UNARY( vfrsqrt7, 32, rsqrt_in, out, n );
+    printf( "vfrsqrt7 e32:" );
+    for ( size_t i = 0; i < n; i++ )
+        printf( " %08x", out[ i ] );
+    printf( "\n" );
+} //show_float_estimates
+
+// the most negative value squared saturates. the others round in the low bits per vxrm
+
+template < typename T > void show_vsmul( int sew )
+{
+    const T tmin = (T) ( (uint64_t) 1 << ( sew - 1 ) );
+    const T tmax = (T) ( tmin - 1 );
+    T a[] = { tmin, tmin, tmax, (T) ( tmax / 3 ), (T) -( tmax / 5 ), (T) ( (T) 1 << ( sew - 2 ) ), 3, -1 };
+    T b[] = { tmin, tmax, tmax, (T) ( tmax / 7 ), (T) ( tmax / 2 ), (T) ( (T) 1 << ( sew - 2 ) ), 5, 1 };
+    const size_t n = sizeof( a ) / sizeof( a[ 0 ] );
+    T out[ n ];
+
+    for ( uint64_t vxrm = 0; vxrm < 4; vxrm++ )
+    {
+        uint64_t sat = 0;
+        if ( 8 == sew )
+            VSMUL( 8, a, b, out, n, vxrm, sat );
+        else if ( 16 == sew )
+            VSMUL( 16, a, b, out, n, vxrm, sat );
+        else if ( 32 == sew )
+            VSMUL( 32, a, b, out, n, vxrm, sat );
+        else
+            VSMUL( 64, a, b, out, n, vxrm, sat );
+
+        printf( "vsmul e%d %s:", sew, rounding_modes[ vxrm ] );
+        for ( size_t i = 0; i < n; i++ )
+            printf( " %lld", (long long) out[ i ] );
+        printf( ", vxsat %llu\n", (unsigned long long) sat );
+    }
+} //show_vsmul
+
+// Each test below runs a sequence with a0 = in1, a1 = in2, a2 = out, a3 = mask, a4 = avl, and a5 = a scalar,
+// then prints vl and the start of out. Sequences set vtype with tu, mu so tail and masked-off elements keep
+// out's prior contents, and avl is either at most vlmax or at least twice it so vl is the same on any
+// implementation with VLEN 512. Elements are loaded into v8 (the destination), v16, and v24, and v0 is the mask.
+
+static uint8_t in1[ 1024 ] __attribute__( ( aligned( 64 ) ) );
+static uint8_t in2[ 1024 ] __attribute__( ( aligned( 64 ) ) );
+static uint8_t out[ 1024 ] __attribute__( ( aligned( 64 ) ) );
+static uint8_t mask[ 64 ] __attribute__( ( aligned( 64 ) ) );
+
+enum data_kind { ints, doubles, floats };
+
+// ints has zero divisors, the most negative values, and -1 divisors at each sew. the values in in1 are exact
+// in float and double and so are their sums, so reductions don't depend on the order of additions. in2 has
+// special values and ones that overflow or round when converted
+
+void reset( data_kind kind )
+{
+    for ( size_t i = 0; i < sizeof( out ); i++ )
+        out[ i ] = (uint8_t) ( i * 3 + 0x80 );
+    for ( size_t i = 0; i < sizeof( mask ); i++ )
+        mask[ i ] = (uint8_t) ( ( i * 0x3b ) ^ 0xb5 );
+
+    if ( ints == kind )
+    {
+        for ( size_t i = 0; i < sizeof( in1 ); i++ )
+        {
+            in1[ i ] = (uint8_t) ( i * 29 + 7 );
+            in2[ i ] = (uint8_t) ( ( i * 113 ) ^ 0x5a );
+        }
+        memset( in2 + 16, 0, 8 );
+        memset( in1 + 24, 0, 7 );
+        in1[ 31 ] = 0x80;
+        memset( in2 + 24, 0xff, 8 );
+    }
+    else if ( doubles == kind )
+    {
+        double * a = (double *) in1;
+        double * b = (double *) in2;
+        for ( int i = 0; i < (int) ( sizeof( in1 ) / sizeof( double ) ); i++ )
+        {
+            a[ i ] = ( ( i * 7 ) % 19 - 9 ) * 0.625;
+            b[ i ] = ( ( i * 5 ) % 13 - 6 ) * 1.25 + 0.5;
+        }
+        a[ 5 ] = -0.0;
+        b[ 3 ] = NAN;
+        b[ 7 ] = INFINITY;
+        b[ 9 ] = -3e9;
+        b[ 10 ] = 3e9;
+        b[ 11 ] = 1e-30;
+        b[ 12 ] = 1e300;
+        b[ 13 ] = 0.1;
+    }
+    else
+    {
+        float * a = (float *) in1;
+        float * b = (float *) in2;
+        for ( int i = 0; i < (int) ( sizeof( in1 ) / sizeof( float ) ); i++ )
+        {
+            a[ i ] = ( ( i * 7 ) % 19 - 9 ) * 0.625f;
+            b[ i ] = ( ( i * 5 ) % 13 - 6 ) * 1.25f + 0.5f;
+        }
+        a[ 5 ] = -0.0f;
+        b[ 3 ] = NAN;
+        b[ 7 ] = INFINITY;
+        b[ 9 ] = -3e9f;
+        b[ 10 ] = 70000.5f;
+        b[ 11 ] = 1e-40f;
+        b[ 12 ] = -INFINITY;
+        b[ 13 ] = 0.1f;
+    }
+} //reset
+
+void show( const char * name, uint64_t vl, size_t bytes )
+{
+    printf( "%s: vl %llu,", name, (unsigned long long) vl );
+    for ( size_t i = 0; i < bytes; i++ )
+        printf( "%s%02x", ( 0 == ( i % 8 ) ) ? " " : "", out[ i ] );
+    printf( "\n" );
+} //show
+
+#define VECTOR_CLOBBERS "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7", "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15", \
+                        "v16", "v17", "v18", "v19", "v20", "v21", "v22", "v23", "v24", "v25", "v26", "v27", "v28", "v29", "v30", "v31"
+
+#define VTEST( name, kind, avl, scalar, bytes, code ) \
+    { \
+        reset( kind ); \
+        register uint8_t * a0 asm( "a0" ) = in1; \
+        register uint8_t * a1 asm( "a1" ) = in2; \
+        register uint8_t * a2 asm( "a2" ) = out; \
+        register uint8_t * a3 asm( "a3" ) = mask; \
+        register uint64_t a4 asm( "a4" ) = avl; \
+        register uint64_t a5 asm( "a5" ) = scalar; \
+        uint64_t vl; \
+        asm volatile( code "csrr %0, vl\n" \
+                      : "=&r" ( vl ) : "r" ( a0 ), "r" ( a1 ), "r" ( a2 ), "r" ( a3 ), "r" ( a4 ), "r" ( a5 ) \
+                      : "t0", "t1", "t2", "ft0", "memory", VECTOR_CLOBBERS ); \
+        show( name, vl, bytes ); \
+    }
+
+#define VSET( sew, lmul ) "vsetvli t0, a4, e" #sew ", " #lmul ", tu, mu\n"
+
+// op reads v16 (in1) and v24 (in2) with the given element widths and writes v8, which starts as out
+
+#define VOP( sew, lmul, deew, eew2, eew1, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #deew ".v v8, (a2)\n" \
+    "vle" #eew2 ".v v16, (a0)\n" \
+    "vle" #eew1 ".v v24, (a1)\n" \
+    op "\n" \
+    "vse" #deew ".v v8, (a2)\n"
+
+#define VV( sew, lmul, op ) VOP( sew, lmul, sew, sew, sew, op )
+#define VW( sew, wsew, lmul, op ) VOP( sew, lmul, wsew, sew, sew, op )
+#define VWW( sew, wsew, lmul, op ) VOP( sew, lmul, wsew, wsew, sew, op )
+#define VN( sew, wsew, lmul, op ) VOP( sew, lmul, sew, wsew, sew, op )
+
+// narrowing conversions of the special values in in2
+
+#define VNB( sew, wsew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #sew ".v v8, (a2)\n" \
+    "vle" #wsew ".v v16, (a1)\n" \
+    op "\n" \
+    "vse" #sew ".v v8, (a2)\n"
+
+// the result is a mask in v8
+
+#define VM( sew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vlm.v v8, (a2)\n" \
+    "vle" #sew ".v v16, (a0)\n" \
+    "vle" #sew ".v v24, (a1)\n" \
+    op "\n" \
+    "vsm.v v8, (a2)\n"
+
+// fixed-point ops with rounding mode vxrm. vxsat is stored in out[ 0 ] and the elements follow it
+
+#define VX( sew, lmul, deew, eew2, vxrm, op ) \
+    "csrwi vxrm, " #vxrm "\n" \
+    "csrwi vxsat, 0\n" \
+    VSET( sew, lmul ) \
+    "addi t2, a2, 8\n" \
+    "vlm.v v0, (a3)\n" \
+    "vle" #deew ".v v8, (t2)\n" \
+    "vle" #eew2 ".v v16, (a0)\n" \
+    "vle" #sew ".v v24, (a1)\n" \
+    op "\n" \
+    "vse" #deew ".v v8, (t2)\n" \
+    "csrr t1, vxsat\n" \
+    "sd t1, 0(a2)\n"
+
+// permutations read source elements past vl, so whole register groups are loaded
+
+#define VP( sew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #sew ".v v8, (a2)\n" \
+    "vl8re8.v v16, (a0)\n" \
+    "vl8re8.v v24, (a1)\n" \
+    op "\n" \
+    "vse" #sew ".v v8, (a2)\n"
+
+// VLD loads into v8, which starts as out. VST stores v8, which starts as in1
+
+#define VLD( sew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #sew ".v v8, (a2)\n" \
+    op "\n" \
+    "vse" #sew ".v v8, (a2)\n"
+
+#define VST( sew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #sew ".v v8, (a0)\n" \
+    op "\n"
+
+// a scalar result in t1
+
+#define VS( sew, lmul, op ) \
+    VSET( sew, lmul ) \
+    "vlm.v v0, (a3)\n" \
+    "vle" #sew ".v v16, (a0)\n" \
+    op "\n" \
+    "sd t1, 0(a2)\n"
+
+// vsetvli and friends store the vl they return and vtype
+
+#define VCFG( code ) code "csrr t1, vtype\n" "sd t0, 0(a2)\n" "sd t1, 8(a2)\n"
+
+// vsetvli, vsetivli, and vsetvl including unsupported settings, which set vill and vl 0
+
+void show_configuration()
+{
+    VTEST( "vsetvli e8 m1", ints, 37, 0, 24, VCFG( VSET( 8, m1 ) ) );
+    VTEST( "vsetvli e8 m8", ints, 5000, 0, 24, VCFG( VSET( 8, m8 ) ) );
+    VTEST( "vsetvli e16 mf4", ints, 3, 0, 24, VCFG( VSET( 16, mf4 ) ) );
+    VTEST( "vsetvli e32 mf2 avl 0", ints, 0, 0, 24, VCFG( VSET( 32, mf2 ) ) );
+    VTEST( "vsetvli e64 m2", ints, 16, 0, 24, VCFG( VSET( 64, m2 ) ) );
+    VTEST( "vsetvli e8 mf8", ints, 100, 0, 24, VCFG( VSET( 8, mf8 ) ) );
+    VTEST( "vsetvli e64 mf2 is unsupported", ints, 5, 0, 24, VCFG( VSET( 64, mf2 ) ) );
+    VTEST( "vsetvli ta ma", ints, 20, 0, 24, VCFG( "vsetvli t0, a4, e32, m4, ta, ma\n" ) );
+    VTEST( "vsetvli with avl zero", ints, 5, 0, 24, VCFG( "vsetvli t0, zero, e16, m4, tu, mu\n" ) );
+    VTEST( "vsetvli keeps vl", ints, 20, 0, 24, VCFG( VSET( 16, m4 ) "vsetvli zero, zero, e32, m8, tu, mu\n" ) );
+    VTEST( "vsetivli", ints, 0, 0, 24, VCFG( "vsetivli t0, 9, e32, m1, tu, mu\n" ) );
+    VTEST( "vsetivli 0", ints, 0, 0, 24, VCFG( "vsetivli t0, 0, e8, m1, tu, mu\n" ) );
+    VTEST( "vsetvl", ints, 37, 0xdb, 24, VCFG( "vsetvl t0, a4, a5\n" ) );
+    VTEST( "vsetvl reserved lmul", ints, 37, 0x4, 24, VCFG( "vsetvl t0, a4, a5\n" ) );
+    VTEST( "vsetvl reserved sew", ints, 37, 0x20, 24, VCFG( "vsetvl t0, a4, a5\n" ) );
+    VTEST( "vsetvl reserved bits", ints, 37, 0x100, 24, VCFG( "vsetvl t0, a4, a5\n" ) );
+    VTEST( "vlenb", ints, 0, 0, 24, VCFG( VSET( 8, m1 ) "csrr t0, vlenb\n" ) );
+} //show_configuration
+
+// unit-stride, strided, indexed, segment, whole register, mask, and fault-only-first loads and stores
+
+void show_loads_and_stores()
+{
+    VTEST( "vle8.v e8 m2 masked", ints, 77, 0, 88, VLD( 8, m2, "vle8.v v8, (a0), v0.t" ) );
+    VTEST( "vle16.v e16 m1 masked", ints, 21, 0, 48, VLD( 16, m1, "vle16.v v8, (a0), v0.t" ) );
+    VTEST( "vle32.v e32 mf2", ints, 100, 0, 40, VLD( 32, mf2, "vle32.v v8, (a0)" ) );
+    VTEST( "vle64.v e64 m8 masked", ints, 37, 0, 200, VLD( 64, m8, "vle64.v v8, (a0), v0.t" ) );
+    VTEST( "vle32ff.v e32 m2 masked", ints, 21, 0, 80, VLD( 32, m2, "vle32ff.v v8, (a0), v0.t" ) );
+    VTEST( "vse8.v e8 m1 masked", ints, 37, 0, 48, VST( 8, m1, "vse8.v v8, (a2), v0.t" ) );
+    VTEST( "vse16.v e16 m4 masked", ints, 50, 0, 112, VST( 16, m4, "vse16.v v8, (a2), v0.t" ) );
+    VTEST( "vse64.v e64 m1 masked", ints, 100, 0, 72, VST( 64, m1, "vse64.v v8, (a2), v0.t" ) );
+    VTEST( "vlse32.v e32 m1 masked", ints, 11, 12, 56, VLD( 32, m1, "vlse32.v v8, (a0), a5, v0.t" ) );
+    VTEST( "vlse64.v e64 m2", ints, 13, (uint64_t) -24, 112, "addi t2, a0, 512\n" VLD( 64, m2, "vlse64.v v8, (t2), a5" ) );
+    VTEST( "vlse16.v e16 mf2 masked", ints, 100, 0, 40, VLD( 16, mf2, "vlse16.v v8, (a0), zero, v0.t" ) );
+    VTEST( "vsse32.v e32 m1 masked", ints, 11, 12, 136, VST( 32, m1, "vsse32.v v8, (a2), a5, v0.t" ) );
+    VTEST( "vsse16.v e16 m2", ints, 21, (uint64_t) -6, 200, "addi t2, a2, 240\n" VST( 16, m2, "vsse16.v v8, (t2), a5" ) );
+    VTEST( "vluxei8.v e32 m4 masked", ints, 21, 0, 80,
+           "vsetvli t0, a4, e8, m1, tu, mu\n" "vle8.v v24, (a1)\n" "vand.vi v24, v24, -4\n" VLD( 32, m4, "vluxei8.v v8, (a0), v24, v0.t" ) );
+    VTEST( "vloxei16.v e64 m2 masked", ints, 13, 1016, 104,
+           "vsetvli t0, a4, e16, mf2, tu, mu\n" "vle16.v v24, (a1)\n" "vand.vx v24, v24, a5\n"
+           VLD( 64, m2, "vloxei16.v v8, (a0), v24, v0.t" ) );
+    VTEST( "vluxei64.v e8 mf2", ints, 21, 1023, 32,
+           "vsetvli t0, a4, e64, m4, tu, mu\n" "vle64.v v24, (a1)\n" "vand.vx v24, v24, a5\n" VLD( 8, mf2, "vluxei64.v v8, (a0), v24" ) );
+    VTEST( "vloxei32.v e16 m1 masked", ints, 32, 1022, 64,
+           "vsetvli t0, a4, e32, m2, tu, mu\n" "vle32.v v24, (a1)\n" "vand.vx v24, v24, a5\n"
+           VLD( 16, m1, "vloxei32.v v8, (a0), v24, v0.t" ) );
+    VTEST( "vsoxei16.v e32 m2 masked", ints, 21, 0, 96,
+           "vsetvli t0, a4, e16, m1, tu, mu\n" "addi t1, t0, -1\n" "vid.v v24\n" "vrsub.vx v24, v24, t1\n" "vsll.vi v24, v24, 2\n"
+           VST( 32, m2, "vsoxei16.v v8, (a2), v24, v0.t" ) );
+    VTEST( "vsuxei8.v e64 m4", ints, 13, 0, 112,
+           "vsetvli t0, a4, e8, mf2, tu, mu\n" "addi t1, t0, -1\n" "vid.v v24\n" "vrsub.vx v24, v24, t1\n" "vsll.vi v24, v24, 3\n"
+           VST( 64, m4, "vsuxei8.v v8, (a2), v24" ) );
+    VTEST( "vlseg3e16.v e16 m2 masked", ints, 21, 0, 176,
+           VSET( 16, m2 ) "vlm.v v0, (a3)\n" "addi t1, a2, 64\n" "addi t2, a2, 128\n" "vle16.v v8, (a2)\n" "vle16.v v10, (t1)\n"
+           "vle16.v v12, (t2)\n" "vlseg3e16.v v8, (a0), v0.t\n" "vse16.v v8, (a2)\n" "vse16.v v10, (t1)\n" "vse16.v v12, (t2)\n" );
+    VTEST( "vlseg2e64.v e64 m1", ints, 100, 0, 136,
+           VSET( 64, m1 ) "addi t1, a2, 64\n" "vlseg2e64.v v8, (a0)\n" "vse64.v v8, (a2)\n" "vse64.v v9, (t1)\n" );
+    VTEST( "vlsseg2e32.v e32 mf2 masked", ints, 100, 20, 104,
+           VSET( 32, mf2 ) "vlm.v v0, (a3)\n" "addi t1, a2, 64\n" "vle32.v v8, (a2)\n" "vle32.v v9, (t1)\n"
+           "vlsseg2e32.v v8, (a0), a5, v0.t\n" "vse32.v v8, (a2)\n" "vse32.v v9, (t1)\n" );
+    VTEST( "vsseg4e8.v e8 m1 masked", ints, 21, 0, 80, VSET( 8, m1 ) "vlm.v v0, (a3)\n" "vl4re8.v v8, (a0)\n" "vsseg4e8.v v8, (a2), v0.t\n" );
+    VTEST( "vssseg2e16.v e16 m2", ints, 13, 40, 200, VSET( 16, m2 ) "vl4re8.v v8, (a0)\n" "vssseg2e16.v v8, (a2), a5\n" );
+    VTEST( "vluxseg2ei8.v e32 m1 masked", ints, 11, 0, 120,
+           "vsetvli t0, a4, e8, mf4, tu, mu\n" "vle8.v v24, (a1)\n" "vand.vi v24, v24, -4\n" VSET( 32, m1 ) "vlm.v v0, (a3)\n"
+           "addi t1, a2, 64\n" "vle32.v v8, (a2)\n" "vle32.v v9, (t1)\n" "vluxseg2ei8.v v8, (a0), v24, v0.t\n" "vse32.v v8, (a2)\n"
+           "vse32.v v9, (t1)\n" );
+    VTEST( "vl2re32.v and vs2r.v", ints, 3, 0, 136, VSET( 8, m1 ) "vl2re32.v v8, (a0)\n" "vs2r.v v8, (a2)\n" );
+    VTEST( "vl4re8.v and vs4r.v", ints, 3, 0, 200, VSET( 64, m1 ) "vl4re8.v v8, (a1)\n" "vs4r.v v8, (a2)\n" );
+    VTEST( "vl1re64.v and vs1r.v", ints, 3, 0, 72, VSET( 16, m8 ) "vl1re64.v v8, (a0)\n" "vs1r.v v8, (a2)\n" );
+    VTEST( "vlm.v and vsm.v", ints, 37, 0, 16, VSET( 8, m1 ) "vlm.v v8, (a0)\n" "vsm.v v8, (a2)\n" );
+    VTEST( "vlm.v and vsm.v e64 m8", ints, 19, 0, 16, VSET( 64, m8 ) "vlm.v v8, (a0)\n" "vsm.v v8, (a2)\n" );
+} //show_loads_and_stores
+
+// integer arithmetic at each sew in .vv, .vx, and .vi forms, including division by zero and overflow
+
+void show_integer()
+{
+    VTEST( "vadd.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vadd.vv v8, v16, v24" ) );
+    VTEST( "vadd.vx e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vadd.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vadd.vi e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vadd.vi v8, v16, -7" ) );
+    VTEST( "vsub.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vsub.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsub.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vsub.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vrsub.vx e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vrsub.vx v8, v16, a5" ) );
+    VTEST( "vrsub.vi e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vrsub.vi v8, v16, 11, v0.t" ) );
+    VTEST( "vminu.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vminu.vv v8, v16, v24" ) );
+    VTEST( "vminu.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vminu.vx v8, v16, a5" ) );
+    VTEST( "vmin.vv e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vmin.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmin.vx e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmin.vx v8, v16, a5" ) );
+    VTEST( "vmaxu.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vmaxu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmaxu.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vmaxu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmax.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vmax.vv v8, v16, v24" ) );
+    VTEST( "vmax.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmax.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vand.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vand.vv v8, v16, v24" ) );
+    VTEST( "vand.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vand.vx v8, v16, a5" ) );
+    VTEST( "vand.vi e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vand.vi v8, v16, -7, v0.t" ) );
+    VTEST( "vor.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vor.vv v8, v16, v24" ) );
+    VTEST( "vor.vx e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vor.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vor.vi e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vor.vi v8, v16, 9, v0.t" ) );
+    VTEST( "vxor.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vxor.vv v8, v16, v24" ) );
+    VTEST( "vxor.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vxor.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vxor.vi e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vxor.vi v8, v16, -1" ) );
+    VTEST( "vsll.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vsll.vv v8, v16, v24" ) );
+    VTEST( "vsll.vx e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vsll.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vsll.vi e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vsll.vi v8, v16, 5" ) );
+    VTEST( "vsrl.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vsrl.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsrl.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vsrl.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vsrl.vi e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vsrl.vi v8, v16, 3" ) );
+    VTEST( "vsra.vv e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vsra.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsra.vx e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vsra.vx v8, v16, a5" ) );
+    VTEST( "vsra.vi e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vsra.vi v8, v16, 7" ) );
+    VTEST( "vmul.vv e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vmul.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmul.vx e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmul.vx v8, v16, a5" ) );
+    VTEST( "vmulh.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vmulh.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmulh.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vmulh.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmulhu.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vmulhu.vv v8, v16, v24" ) );
+    VTEST( "vmulhu.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmulhu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmulhsu.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vmulhsu.vv v8, v16, v24" ) );
+    VTEST( "vmulhsu.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vmulhsu.vx v8, v16, a5" ) );
+    VTEST( "vdivu.vv e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vdivu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vdivu.vx e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vdivu.vx v8, v16, a5" ) );
+    VTEST( "vdiv.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vdiv.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vdiv.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vdiv.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vremu.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vremu.vv v8, v16, v24" ) );
+    VTEST( "vremu.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vremu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vrem.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vrem.vv v8, v16, v24" ) );
+    VTEST( "vrem.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vrem.vx v8, v16, a5" ) );
+    VTEST( "vdiv.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vdiv.vv v8, v16, v24" ) );
+    VTEST( "vrem.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vrem.vv v8, v16, v24" ) );
+    VTEST( "vdivu.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vdivu.vv v8, v16, v24" ) );
+    VTEST( "vremu.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vremu.vv v8, v16, v24" ) );
+    VTEST( "vdiv.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vdiv.vv v8, v16, v24" ) );
+    VTEST( "vrem.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vrem.vv v8, v16, v24" ) );
+    VTEST( "vdivu.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vdivu.vv v8, v16, v24" ) );
+    VTEST( "vremu.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vremu.vv v8, v16, v24" ) );
+    VTEST( "vdiv.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vdiv.vv v8, v16, v24" ) );
+    VTEST( "vrem.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vrem.vv v8, v16, v24" ) );
+    VTEST( "vdivu.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vdivu.vv v8, v16, v24" ) );
+    VTEST( "vremu.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vremu.vv v8, v16, v24" ) );
+    VTEST( "vdiv.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vdiv.vv v8, v16, v24" ) );
+    VTEST( "vrem.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vrem.vv v8, v16, v24" ) );
+    VTEST( "vdivu.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vdivu.vv v8, v16, v24" ) );
+    VTEST( "vremu.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vremu.vv v8, v16, v24" ) );
+    VTEST( "vmacc.vv e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vmacc.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vmacc.vx e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmacc.vx v8, a5, v16" ) );
+    VTEST( "vnmsac.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vnmsac.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vnmsac.vx e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vnmsac.vx v8, a5, v16, v0.t" ) );
+    VTEST( "vmadd.vv e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vmadd.vv v8, v24, v16" ) );
+    VTEST( "vmadd.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmadd.vx v8, a5, v16, v0.t" ) );
+    VTEST( "vnmsub.vv e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vnmsub.vv v8, v24, v16" ) );
+    VTEST( "vnmsub.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vnmsub.vx v8, a5, v16" ) );
+    VTEST( "vadc.vvm e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vadc.vvm v8, v16, v24, v0" ) );
+    VTEST( "vadc.vxm e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vadc.vxm v8, v16, a5, v0" ) );
+    VTEST( "vadc.vim e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vadc.vim v8, v16, -7, v0" ) );
+    VTEST( "vsbc.vvm e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vsbc.vvm v8, v16, v24, v0" ) );
+    VTEST( "vsbc.vxm e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vsbc.vxm v8, v16, a5, v0" ) );
+    VTEST( "vmerge.vvm e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmerge.vvm v8, v16, v24, v0" ) );
+    VTEST( "vmerge.vxm e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vmerge.vxm v8, v16, a5, v0" ) );
+    VTEST( "vmerge.vim e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vmerge.vim v8, v16, 13, v0" ) );
+    VTEST( "vmv.v.v e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VV( 16, m2, "vmv.v.v v8, v24" ) );
+    VTEST( "vmv.v.x e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vmv.v.x v8, a5" ) );
+    VTEST( "vmv.v.i e64 m4", ints, 13, (uint64_t) -7116713809613245305, 112, VV( 64, m4, "vmv.v.i v8, -9" ) );
+    VTEST( "vadd.vv e8 m1 masked", ints, 37, (uint64_t) -7116713809613245305, 48, VV( 8, m1, "vadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vadd.vv e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vadd.vv e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vadd.vv e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmul.vx e8 m8 masked", ints, 300, (uint64_t) -7116713809613245305, 200, VV( 8, m8, "vmul.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmul.vx e16 mf4 masked", ints, 100, (uint64_t) -7116713809613245305, 24, VV( 16, mf4, "vmul.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmul.vx e32 m8 masked", ints, 100, (uint64_t) -7116713809613245305, 200, VV( 32, m8, "vmul.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmul.vx e64 m1 masked", ints, 8, (uint64_t) -7116713809613245305, 72, VV( 64, m1, "vmul.vx v8, v16, a5, v0.t" ) );
+} //show_integer
+
+// compares and carry-outs, which write masks
+
+void show_compares()
+{
+    VTEST( "vmadc.vvm e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmadc.vvm v8, v16, v24, v0" ) );
+    VTEST( "vmadc.vv e16 m2", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmadc.vv v8, v16, v24" ) );
+    VTEST( "vmadc.vxm e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmadc.vxm v8, v16, a5, v0" ) );
+    VTEST( "vmadc.vim e64 m4", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmadc.vim v8, v16, -7, v0" ) );
+    VTEST( "vmadc.vi e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmadc.vi v8, v16, 15" ) );
+    VTEST( "vmsbc.vvm e16 m2", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmsbc.vvm v8, v16, v24, v0" ) );
+    VTEST( "vmsbc.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmsbc.vv v8, v16, v24" ) );
+    VTEST( "vmsbc.vxm e64 m4", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmsbc.vxm v8, v16, a5, v0" ) );
+    VTEST( "vmsbc.vx e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsbc.vx v8, v16, a5" ) );
+    VTEST( "vmseq.vv e16 m2", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmseq.vv v8, v16, v24" ) );
+    VTEST( "vmseq.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmseq.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmseq.vi e64 m4", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmseq.vi v8, v16, -7" ) );
+    VTEST( "vmsne.vv e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsne.vv v8, v16, v24" ) );
+    VTEST( "vmsne.vx e16 m2 masked", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmsne.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmsne.vi e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmsne.vi v8, v16, 5" ) );
+    VTEST( "vmsltu.vv e64 m4 masked", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmsltu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmsltu.vx e8 m1 masked", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsltu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmslt.vv e16 m2", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmslt.vv v8, v16, v24" ) );
+    VTEST( "vmslt.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmslt.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmsleu.vv e64 m4", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmsleu.vv v8, v16, v24" ) );
+    VTEST( "vmsleu.vx e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsleu.vx v8, v16, a5" ) );
+    VTEST( "vmsleu.vi e16 m2 masked", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmsleu.vi v8, v16, -3, v0.t" ) );
+    VTEST( "vmsle.vv e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmsle.vv v8, v16, v24" ) );
+    VTEST( "vmsle.vx e64 m4 masked", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmsle.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vmsle.vi e8 m1 masked", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsle.vi v8, v16, 0, v0.t" ) );
+    VTEST( "vmsgtu.vx e16 m2", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmsgtu.vx v8, v16, a5" ) );
+    VTEST( "vmsgtu.vi e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmsgtu.vi v8, v16, 9, v0.t" ) );
+    VTEST( "vmsgt.vx e64 m4", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmsgt.vx v8, v16, a5" ) );
+    VTEST( "vmsgt.vi e8 m1", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmsgt.vi v8, v16, -2" ) );
+    VTEST( "vmseq.vv e8 m1 masked same", ints, 40, (uint64_t) -7116713809613245305, 16, VM( 8, m1, "vmseq.vv v8, v16, v16, v0.t" ) );
+    VTEST( "vmseq.vv e16 m2 masked same", ints, 24, (uint64_t) -7116713809613245305, 16, VM( 16, m2, "vmseq.vv v8, v16, v16, v0.t" ) );
+    VTEST( "vmseq.vv e32 mf2 masked same", ints, 100, (uint64_t) -7116713809613245305, 16, VM( 32, mf2, "vmseq.vv v8, v16, v16, v0.t" ) );
+    VTEST( "vmseq.vv e64 m4 masked same", ints, 16, (uint64_t) -7116713809613245305, 16, VM( 64, m4, "vmseq.vv v8, v16, v16, v0.t" ) );
+} //show_compares
+
+// saturating, averaging, and scaling ops in each rounding mode
+
+void show_fixed_point()
+{
+    VTEST( "vsaddu.vv e16 m2 masked rnu", ints, 21, (uint64_t) -7116713809613245305, 56, VX( 16, m2, 16, 16, 0, "vsaddu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsaddu.vx e32 mf2 rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vsaddu.vx v8, v16, a5" ) );
+    VTEST( "vsaddu.vi e64 m4 masked rdn", ints, 13, (uint64_t) -7116713809613245305, 112, VX( 64, m4, 64, 64, 2, "vsaddu.vi v8, v16, -7, v0.t" ) );
+    VTEST( "vsadd.vv e8 m1 masked rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vsadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsadd.vx e16 m2 rnu", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 0, "vsadd.vx v8, v16, a5" ) );
+    VTEST( "vsadd.vi e32 mf2 masked rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vsadd.vi v8, v16, 15, v0.t" ) );
+    VTEST( "vssubu.vv e64 m4 rdn", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 2, "vssubu.vv v8, v16, v24" ) );
+    VTEST( "vssubu.vx e8 m1 rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vssubu.vx v8, v16, a5" ) );
+    VTEST( "vssub.vv e16 m2 masked rnu", ints, 21, (uint64_t) -7116713809613245305, 56, VX( 16, m2, 16, 16, 0, "vssub.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vssub.vx e32 mf2 rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vssub.vx v8, v16, a5" ) );
+    VTEST( "vaaddu.vv e64 m4 masked rdn", ints, 13, (uint64_t) -7116713809613245305, 112, VX( 64, m4, 64, 64, 2, "vaaddu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vaaddu.vx e8 m1 masked rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vaaddu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vaadd.vv e16 m2 rnu", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 0, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vx e32 mf2 masked rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vaadd.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vasubu.vv e64 m4 rdn", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 2, "vasubu.vv v8, v16, v24" ) );
+    VTEST( "vasubu.vx e8 m1 rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vasubu.vx v8, v16, a5" ) );
+    VTEST( "vasub.vv e16 m2 masked rnu", ints, 21, (uint64_t) -7116713809613245305, 56, VX( 16, m2, 16, 16, 0, "vasub.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vasub.vx e32 mf2 rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vasub.vx v8, v16, a5" ) );
+    VTEST( "vsmul.vv e64 m4 masked rdn", ints, 13, (uint64_t) -7116713809613245305, 112, VX( 64, m4, 64, 64, 2, "vsmul.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vsmul.vx e8 m1 masked rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vsmul.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vssrl.vv e16 m2 rnu", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 0, "vssrl.vv v8, v16, v24" ) );
+    VTEST( "vssrl.vx e32 mf2 masked rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vssrl.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vssrl.vi e64 m4 rdn", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 2, "vssrl.vi v8, v16, 3" ) );
+    VTEST( "vssra.vv e8 m1 rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vssra.vv v8, v16, v24" ) );
+    VTEST( "vssra.vx e16 m2 masked rnu", ints, 21, (uint64_t) -7116713809613245305, 56, VX( 16, m2, 16, 16, 0, "vssra.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vssra.vi e32 mf2 rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vssra.vi v8, v16, 9" ) );
+    VTEST( "vaadd.vv e8 m1 rnu", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 0, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e8 m1 rne", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 1, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e8 m1 rdn", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 2, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e8 m1 rod", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 8, 3, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e16 m2 rnu", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 0, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e16 m2 rne", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 1, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e16 m2 rdn", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 2, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e16 m2 rod", ints, 21, (uint64_t) -7116713809613245305, 64, VX( 16, m2, 16, 16, 3, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e32 mf2 rnu", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 0, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e32 mf2 rne", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 1, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e32 mf2 rdn", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 2, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e32 mf2 rod", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 32, mf2, 32, 32, 3, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e64 m4 rnu", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 0, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e64 m4 rne", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 1, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e64 m4 rdn", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 2, "vaadd.vv v8, v16, v24" ) );
+    VTEST( "vaadd.vv e64 m4 rod", ints, 13, (uint64_t) -7116713809613245305, 120, VX( 64, m4, 64, 64, 3, "vaadd.vv v8, v16, v24" ) );
+} //show_fixed_point
+
+// widening and narrowing integer ops, and zero and sign extension
+
+void show_widening_and_narrowing()
+{
+    VTEST( "vwaddu.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwaddu.vv v8, v16, v24" ) );
+    VTEST( "vwaddu.vx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwaddu.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vwaddu.wv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VWW( 32, 64, m2, "vwaddu.wv v8, v16, v24" ) );
+    VTEST( "vwaddu.wx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VWW( 8, 16, m1, "vwaddu.wx v8, v16, a5" ) );
+    VTEST( "vwadd.vv e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwadd.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vwadd.vx e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwadd.vx v8, v16, a5" ) );
+    VTEST( "vwadd.wv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VWW( 8, 16, m1, "vwadd.wv v8, v16, v24" ) );
+    VTEST( "vwadd.wx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VWW( 16, 32, mf2, "vwadd.wx v8, v16, a5, v0.t" ) );
+    VTEST( "vwsubu.vv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwsubu.vv v8, v16, v24" ) );
+    VTEST( "vwsubu.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwsubu.vx v8, v16, a5" ) );
+    VTEST( "vwsubu.wv e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VWW( 16, 32, mf2, "vwsubu.wv v8, v16, v24, v0.t" ) );
+    VTEST( "vwsubu.wx e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VWW( 32, 64, m2, "vwsubu.wx v8, v16, a5" ) );
+    VTEST( "vwsub.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwsub.vv v8, v16, v24" ) );
+    VTEST( "vwsub.vx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwsub.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vwsub.wv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VWW( 32, 64, m2, "vwsub.wv v8, v16, v24" ) );
+    VTEST( "vwsub.wx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VWW( 8, 16, m1, "vwsub.wx v8, v16, a5" ) );
+    VTEST( "vwmulu.vv e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwmulu.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vwmulu.vx e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwmulu.vx v8, v16, a5" ) );
+    VTEST( "vwmul.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwmul.vv v8, v16, v24" ) );
+    VTEST( "vwmul.vx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwmul.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vwmulsu.vv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwmulsu.vv v8, v16, v24" ) );
+    VTEST( "vwmulsu.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwmulsu.vx v8, v16, a5" ) );
+    VTEST( "vwmaccu.vv e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwmaccu.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vwmaccu.vx e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwmaccu.vx v8, a5, v16" ) );
+    VTEST( "vwmacc.vv e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwmacc.vv v8, v24, v16" ) );
+    VTEST( "vwmacc.vx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwmacc.vx v8, a5, v16, v0.t" ) );
+    VTEST( "vwmaccsu.vv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 112, VW( 32, 64, m2, "vwmaccsu.vv v8, v24, v16" ) );
+    VTEST( "vwmaccsu.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 88, VW( 8, 16, m1, "vwmaccsu.vx v8, a5, v16" ) );
+    VTEST( "vwmaccus.vx e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 72, VW( 16, 32, mf2, "vwmaccus.vx v8, a5, v16, v0.t" ) );
+    VTEST( "vzext.vf2 e16 m2 masked", ints, 21, (uint64_t) -7116713809613245305, 48, VV( 16, m2, "vzext.vf2 v8, v16, v0.t" ) );
+    VTEST( "vzext.vf4 e32 m1", ints, 11, (uint64_t) -7116713809613245305, 56, VV( 32, m1, "vzext.vf4 v8, v16" ) );
+    VTEST( "vzext.vf8 e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VV( 64, m4, "vzext.vf8 v8, v16, v0.t" ) );
+    VTEST( "vsext.vf2 e64 m1", ints, 100, (uint64_t) -7116713809613245305, 72, VV( 64, m1, "vsext.vf2 v8, v16" ) );
+    VTEST( "vsext.vf4 e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VV( 32, mf2, "vsext.vf4 v8, v16, v0.t" ) );
+    VTEST( "vsext.vf8 e64 m8", ints, 37, (uint64_t) -7116713809613245305, 200, VV( 64, m8, "vsext.vf8 v8, v16" ) );
+    VTEST( "vnsrl.wv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 64, VN( 32, 64, m2, "vnsrl.wv v8, v16, v24" ) );
+    VTEST( "vnsrl.wx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VN( 8, 16, m1, "vnsrl.wx v8, v16, a5" ) );
+    VTEST( "vnsrl.wi e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VN( 16, 32, mf2, "vnsrl.wi v8, v16, 3, v0.t" ) );
+    VTEST( "vnsra.wv e32 m2", ints, 13, (uint64_t) -7116713809613245305, 64, VN( 32, 64, m2, "vnsra.wv v8, v16, v24" ) );
+    VTEST( "vnsra.wx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VN( 8, 16, m1, "vnsra.wx v8, v16, a5" ) );
+    VTEST( "vnsra.wi e16 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VN( 16, 32, mf2, "vnsra.wi v8, v16, 13, v0.t" ) );
+    VTEST( "vnclipu.wv e32 m2 rdn", ints, 13, (uint64_t) -7116713809613245305, 72, VX( 32, m2, 32, 64, 2, "vnclipu.wv v8, v16, v24" ) );
+    VTEST( "vnclipu.wv e8 m1 rnu", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 16, 0, "vnclipu.wv v8, v16, v24" ) );
+    VTEST( "vnclipu.wx e16 mf2 masked rnu", ints, 100, (uint64_t) -7116713809613245305, 48,
+           VX( 16, mf2, 16, 32, 0, "vnclipu.wx v8, v16, a5, v0.t" ) );
+    VTEST( "vnclipu.wx e32 m2 rdn", ints, 13, (uint64_t) -7116713809613245305, 72, VX( 32, m2, 32, 64, 2, "vnclipu.wx v8, v16, a5" ) );
+    VTEST( "vnclipu.wi e8 m1 rdn", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 16, 2, "vnclipu.wi v8, v16, 2" ) );
+    VTEST( "vnclipu.wi e16 mf2 masked rnu", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 16, mf2, 16, 32, 0, "vnclipu.wi v8, v16, 2, v0.t" ) );
+    VTEST( "vnclip.wv e32 m2 rnu", ints, 13, (uint64_t) -7116713809613245305, 72, VX( 32, m2, 32, 64, 0, "vnclip.wv v8, v16, v24" ) );
+    VTEST( "vnclip.wv e8 m1 rdn", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 16, 2, "vnclip.wv v8, v16, v24" ) );
+    VTEST( "vnclip.wx e16 mf2 masked rdn", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 16, mf2, 16, 32, 2, "vnclip.wx v8, v16, a5, v0.t" ) );
+    VTEST( "vnclip.wx e32 m2 rnu", ints, 13, (uint64_t) -7116713809613245305, 72, VX( 32, m2, 32, 64, 0, "vnclip.wx v8, v16, a5" ) );
+    VTEST( "vnclip.wi e8 m1 rnu", ints, 37, (uint64_t) -7116713809613245305, 56, VX( 8, m1, 8, 16, 0, "vnclip.wi v8, v16, 5" ) );
+    VTEST( "vnclip.wi e16 mf2 masked rdn", ints, 100, (uint64_t) -7116713809613245305, 48, VX( 16, mf2, 16, 32, 2, "vnclip.wi v8, v16, 5, v0.t" ) );
+} //show_widening_and_narrowing
+
+// integer and floating point reductions. v24 element 0 is the starting value
+
+void show_reductions()
+{
+    VTEST( "vredsum.vs e32 m2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vredsum.vs v8, v16, v24" ) );
+    VTEST( "vredsum.vs e64 m8 masked", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 64, m8, "vredsum.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredand.vs e8 m1", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 8, m1, "vredand.vs v8, v16, v24" ) );
+    VTEST( "vredand.vs e16 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 16, VV( 16, m4, "vredand.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredor.vs e32 m2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vredor.vs v8, v16, v24" ) );
+    VTEST( "vredor.vs e64 m8 masked", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 64, m8, "vredor.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredxor.vs e8 m1", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 8, m1, "vredxor.vs v8, v16, v24" ) );
+    VTEST( "vredxor.vs e16 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 16, VV( 16, m4, "vredxor.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredminu.vs e32 m2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vredminu.vs v8, v16, v24" ) );
+    VTEST( "vredminu.vs e64 m8 masked", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 64, m8, "vredminu.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredmin.vs e8 m1", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 8, m1, "vredmin.vs v8, v16, v24" ) );
+    VTEST( "vredmin.vs e16 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 16, VV( 16, m4, "vredmin.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredmaxu.vs e32 m2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vredmaxu.vs v8, v16, v24" ) );
+    VTEST( "vredmaxu.vs e64 m8 masked", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 64, m8, "vredmaxu.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vredmax.vs e8 m1", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 8, m1, "vredmax.vs v8, v16, v24" ) );
+    VTEST( "vredmax.vs e16 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 16, VV( 16, m4, "vredmax.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vwredsumu.vs e8 m2", ints, 77, (uint64_t) -7116713809613245305, 16, VV( 8, m2, "vwredsumu.vs v8, v16, v24" ) );
+    VTEST( "vwredsum.vs e16 m1 masked", ints, 21, (uint64_t) -7116713809613245305, 16, VV( 16, m1, "vwredsum.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vwredsumu.vs e32 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 16, VV( 32, m4, "vwredsumu.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vwredsum.vs e8 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 8, mf2, "vwredsum.vs v8, v16, v24" ) );
+    VTEST( "vfredusum.vs e64 m2", doubles, 13, (uint64_t) -7116713809613245305, 16, VV( 64, m2, "vfredusum.vs v8, v16, v24" ) );
+    VTEST( "vfredosum.vs e64 m4 masked", doubles, 29, (uint64_t) -7116713809613245305, 16, VV( 64, m4, "vfredosum.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vfredosum.vs e32 m1", floats, 11, (uint64_t) -7116713809613245305, 16, VV( 32, m1, "vfredosum.vs v8, v16, v24" ) );
+    VTEST( "vfredusum.vs e32 m8 masked", floats, 200, (uint64_t) -7116713809613245305, 16, VV( 32, m8, "vfredusum.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vfredmin.vs e64 m1", doubles, 8, (uint64_t) -7116713809613245305, 16, VV( 64, m1, "vfredmin.vs v8, v16, v24" ) );
+    VTEST( "vfredmin.vs e32 m2 masked", floats, 21, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vfredmin.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vfredmax.vs e64 m2 masked", doubles, 16, (uint64_t) -7116713809613245305, 16, VV( 64, m2, "vfredmax.vs v8, v16, v24, v0.t" ) );
+    VTEST( "vfredmax.vs e32 mf2", floats, 100, (uint64_t) -7116713809613245305, 16, VV( 32, mf2, "vfredmax.vs v8, v16, v24" ) );
+    VTEST( "vfwredusum.vs e32 m1", floats, 11, (uint64_t) -7116713809613245305, 16, VV( 32, m1, "vfwredusum.vs v8, v16, v24" ) );
+    VTEST( "vfwredosum.vs e32 m2 masked", floats, 21, (uint64_t) -7116713809613245305, 16, VV( 32, m2, "vfwredosum.vs v8, v16, v24, v0.t" ) );
+} //show_reductions
+
+// floating point arithmetic, fused multiply-adds, and moves
+
+void show_float()
+{
+    VTEST( "vfadd.vv e32 mf2", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfadd.vv v8, v16, v24" ) );
+    VTEST( "vfadd.vf e64 m8 masked", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfadd.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfsub.vv e64 m2 masked", doubles, 13, 0x4004000000000000, 104, VV( 64, m2, "vfsub.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfsub.vf e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfsub.vf v8, v16, ft0" ) );
+    VTEST( "vfrsub.vf e32 mf2 masked", floats, 100, 0x40200000, 40, VV( 32, mf2, "fmv.w.x ft0, a5\n" "vfrsub.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfmul.vv e64 m8", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "vfmul.vv v8, v16, v24" ) );
+    VTEST( "vfmul.vf e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfmul.vf v8, v16, ft0" ) );
+    VTEST( "vfdiv.vv e32 m1 masked", floats, 11, 0x40200000, 56, VV( 32, m1, "vfdiv.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfdiv.vf e32 mf2", floats, 100, 0x40200000, 40, VV( 32, mf2, "fmv.w.x ft0, a5\n" "vfdiv.vf v8, v16, ft0" ) );
+    VTEST( "vfrdiv.vf e64 m8 masked", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfrdiv.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfmin.vv e64 m2 masked", doubles, 13, 0x4004000000000000, 104, VV( 64, m2, "vfmin.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfmin.vf e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmin.vf v8, v16, ft0" ) );
+    VTEST( "vfmax.vv e32 mf2 masked", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfmax.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfmax.vf e64 m8", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfmax.vf v8, v16, ft0" ) );
+    VTEST( "vfsgnj.vv e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "vfsgnj.vv v8, v16, v24" ) );
+    VTEST( "vfsgnj.vf e32 m1 masked", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfsgnj.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfsgnjn.vv e32 mf2", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfsgnjn.vv v8, v16, v24" ) );
+    VTEST( "vfsgnjn.vf e64 m8 masked", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfsgnjn.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfsgnjx.vv e64 m2 masked", doubles, 13, 0x4004000000000000, 104, VV( 64, m2, "vfsgnjx.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfsgnjx.vf e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfsgnjx.vf v8, v16, ft0" ) );
+    VTEST( "vfsqrt.v e32 mf2 masked", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfsqrt.v v8, v16, v0.t" ) );
+    VTEST( "vfclass.v e64 m8", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "vfclass.v v8, v16" ) );
+    VTEST( "vfdiv.vf e64 m2 by zero", doubles, 13, 0, 112, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfdiv.vf v8, v16, ft0" ) );
+    VTEST( "vfrdiv.vf e64 m2 by zero", doubles, 13, 0, 112, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfrdiv.vf v8, v16, ft0" ) );
+    VTEST( "vfsqrt.v e64 m2 specials", doubles, 13, 0, 112, VV( 64, m2, "vfsqrt.v v8, v24" ) );
+    VTEST( "vfclass.v e64 m2 specials", doubles, 13, 0, 112, VV( 64, m2, "vfclass.v v8, v24" ) );
+    VTEST( "vfdiv.vf e32 m1 by zero", floats, 11, 0, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfdiv.vf v8, v16, ft0" ) );
+    VTEST( "vfrdiv.vf e32 m1 by zero", floats, 11, 0, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfrdiv.vf v8, v16, ft0" ) );
+    VTEST( "vfsqrt.v e32 m1 specials", floats, 11, 0, 56, VV( 32, m1, "vfsqrt.v v8, v24" ) );
+    VTEST( "vfclass.v e32 m1 specials", floats, 11, 0, 56, VV( 32, m1, "vfclass.v v8, v24" ) );
+    VTEST( "vfmacc.vv e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "vfmacc.vv v8, v24, v16" ) );
+    VTEST( "vfmacc.vf e32 m1 masked", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmacc.vf v8, ft0, v16, v0.t" ) );
+    VTEST( "vfnmacc.vv e32 mf2", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfnmacc.vv v8, v24, v16" ) );
+    VTEST( "vfnmacc.vf e64 m8 masked", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfnmacc.vf v8, ft0, v16, v0.t" ) );
+    VTEST( "vfmsac.vv e64 m2 masked", doubles, 13, 0x4004000000000000, 104, VV( 64, m2, "vfmsac.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfmsac.vf e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmsac.vf v8, ft0, v16" ) );
+    VTEST( "vfnmsac.vv e32 mf2 masked", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfnmsac.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfnmsac.vf e64 m8", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfnmsac.vf v8, ft0, v16" ) );
+    VTEST( "vfmadd.vv e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "vfmadd.vv v8, v24, v16" ) );
+    VTEST( "vfmadd.vf e32 m1 masked", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmadd.vf v8, ft0, v16, v0.t" ) );
+    VTEST( "vfnmadd.vv e32 mf2", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfnmadd.vv v8, v24, v16" ) );
+    VTEST( "vfnmadd.vf e64 m8 masked", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfnmadd.vf v8, ft0, v16, v0.t" ) );
+    VTEST( "vfmsub.vv e64 m2 masked", doubles, 13, 0x4004000000000000, 104, VV( 64, m2, "vfmsub.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfmsub.vf e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmsub.vf v8, ft0, v16" ) );
+    VTEST( "vfnmsub.vv e32 mf2 masked", floats, 100, 0x40200000, 40, VV( 32, mf2, "vfnmsub.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfnmsub.vf e64 m8", doubles, 37, 0x4004000000000000, 200, VV( 64, m8, "fmv.d.x ft0, a5\n" "vfnmsub.vf v8, ft0, v16" ) );
+    VTEST( "vfmerge.vfm e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfmerge.vfm v8, v16, ft0, v0" ) );
+    VTEST( "vfmerge.vfm e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmerge.vfm v8, v16, ft0, v0" ) );
+    VTEST( "vfmv.v.f e64 m2", doubles, 13, 0x4004000000000000, 112, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfmv.v.f v8, ft0" ) );
+    VTEST( "vfmv.v.f e32 m1", floats, 11, 0x40200000, 56, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmv.v.f v8, ft0" ) );
+    VTEST( "vfmv.s.f e64 m2", doubles, 13, 0x4004000000000000, 16, VV( 64, m2, "fmv.d.x ft0, a5\n" "vfmv.s.f v8, ft0" ) );
+    VTEST( "vfmv.s.f e32 m1", floats, 11, 0x40200000, 16, VV( 32, m1, "fmv.w.x ft0, a5\n" "vfmv.s.f v8, ft0" ) );
+    VTEST( "vfslide1up.vf e64 m2 masked", doubles, 13, 0x4004000000000000, 104,
+           VP( 64, m2, "fmv.d.x ft0, a5\n" "vfslide1up.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfslide1up.vf e32 m1 masked", floats, 11, 0x40200000, 56, VP( 32, m1, "fmv.w.x ft0, a5\n" "vfslide1up.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfslide1down.vf e64 m2", doubles, 13, 0x4004000000000000, 112, VP( 64, m2, "fmv.d.x ft0, a5\n" "vfslide1down.vf v8, v16, ft0" ) );
+    VTEST( "vfslide1down.vf e32 m1", floats, 11, 0x40200000, 56, VP( 32, m1, "fmv.w.x ft0, a5\n" "vfslide1down.vf v8, v16, ft0" ) );
+    VTEST( "vfmv.f.s e64 m1", doubles, 5, 0, 16, VSET( 64, m1 ) "vle64.v v16, (a0)\n" "vfmv.f.s ft0, v16\n" "fsd ft0, 0(a2)\n" );
+    VTEST( "vfmv.f.s e32 mf2", floats, 5, 0, 16, VSET( 32, mf2 ) "vle32.v v16, (a0)\n" "vfmv.f.s ft0, v16\n" "fsw ft0, 0(a2)\n" );
+} //show_float
+
+// floating point compares. in2 has a NaN and an infinity
+
+void show_float_compares()
+{
+    VTEST( "vmfeq.vv e64 m2", doubles, 16, 0x4004000000000000, 16, VM( 64, m2, "vmfeq.vv v8, v16, v24" ) );
+    VTEST( "vmfeq.vv e32 m1 masked", floats, 16, 0x40200000, 16, VM( 32, m1, "vmfeq.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmfeq.vf e32 mf2", floats, 100, 0x40200000, 16, VM( 32, mf2, "fmv.w.x ft0, a5\n" "vmfeq.vf v8, v16, ft0" ) );
+    VTEST( "vmfeq.vf e64 m8 masked", doubles, 40, 0x4004000000000000, 16, VM( 64, m8, "fmv.d.x ft0, a5\n" "vmfeq.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vmfne.vv e64 m2", doubles, 16, 0x4004000000000000, 16, VM( 64, m2, "vmfne.vv v8, v16, v24" ) );
+    VTEST( "vmfne.vv e32 m1 masked", floats, 16, 0x40200000, 16, VM( 32, m1, "vmfne.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmfne.vf e32 mf2", floats, 100, 0x40200000, 16, VM( 32, mf2, "fmv.w.x ft0, a5\n" "vmfne.vf v8, v16, ft0" ) );
+    VTEST( "vmfne.vf e64 m8 masked", doubles, 40, 0x4004000000000000, 16, VM( 64, m8, "fmv.d.x ft0, a5\n" "vmfne.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vmflt.vv e64 m2", doubles, 16, 0x4004000000000000, 16, VM( 64, m2, "vmflt.vv v8, v16, v24" ) );
+    VTEST( "vmflt.vv e32 m1 masked", floats, 16, 0x40200000, 16, VM( 32, m1, "vmflt.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmflt.vf e32 mf2", floats, 100, 0x40200000, 16, VM( 32, mf2, "fmv.w.x ft0, a5\n" "vmflt.vf v8, v16, ft0" ) );
+    VTEST( "vmflt.vf e64 m8 masked", doubles, 40, 0x4004000000000000, 16, VM( 64, m8, "fmv.d.x ft0, a5\n" "vmflt.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vmfle.vv e64 m2", doubles, 16, 0x4004000000000000, 16, VM( 64, m2, "vmfle.vv v8, v16, v24" ) );
+    VTEST( "vmfle.vv e32 m1 masked", floats, 16, 0x40200000, 16, VM( 32, m1, "vmfle.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vmfle.vf e32 mf2", floats, 100, 0x40200000, 16, VM( 32, mf2, "fmv.w.x ft0, a5\n" "vmfle.vf v8, v16, ft0" ) );
+    VTEST( "vmfle.vf e64 m8 masked", doubles, 40, 0x4004000000000000, 16, VM( 64, m8, "fmv.d.x ft0, a5\n" "vmfle.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vmfgt.vf e64 m2", doubles, 16, 0x4004000000000000, 16, VM( 64, m2, "fmv.d.x ft0, a5\n" "vmfgt.vf v8, v16, ft0" ) );
+    VTEST( "vmfgt.vf e32 m1 masked", floats, 16, 0x40200000, 16, VM( 32, m1, "fmv.w.x ft0, a5\n" "vmfgt.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vmfge.vf e32 mf2", floats, 100, 0x40200000, 16, VM( 32, mf2, "fmv.w.x ft0, a5\n" "vmfge.vf v8, v16, ft0" ) );
+    VTEST( "vmfge.vf e64 m8 masked", doubles, 40, 0x4004000000000000, 16, VM( 64, m8, "fmv.d.x ft0, a5\n" "vmfge.vf v8, v16, ft0, v0.t" ) );
+} //show_float_compares
+
+// conversions between floating point and integers, including rounding ties and out of range values
+
+void show_float_conversions()
+{
+    VTEST( "vfcvt.xu.f.v e64 m2", doubles, 13, 0, 112, VV( 64, m2, "vfcvt.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.x.f.v e64 m2 masked", doubles, 13, 0, 104, VV( 64, m2, "vfcvt.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.rtz.xu.f.v e64 m2", doubles, 13, 0, 112, VV( 64, m2, "vfcvt.rtz.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.rtz.x.f.v e64 m2 masked", doubles, 13, 0, 104, VV( 64, m2, "vfcvt.rtz.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.f.xu.v e64 m2", ints, 13, 0, 112, VV( 64, m2, "vfcvt.f.xu.v v8, v16" ) );
+    VTEST( "vfcvt.f.x.v e64 m2 masked", ints, 13, 0, 104, VV( 64, m2, "vfcvt.f.x.v v8, v16, v0.t" ) );
+    VTEST( "vfcvt.xu.f.v e32 m1", floats, 11, 0, 56, VV( 32, m1, "vfcvt.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.x.f.v e32 m1 masked", floats, 11, 0, 56, VV( 32, m1, "vfcvt.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.rtz.xu.f.v e32 m1", floats, 11, 0, 56, VV( 32, m1, "vfcvt.rtz.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.rtz.x.f.v e32 m1 masked", floats, 11, 0, 56, VV( 32, m1, "vfcvt.rtz.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.f.xu.v e32 m1", ints, 11, 0, 56, VV( 32, m1, "vfcvt.f.xu.v v8, v16" ) );
+    VTEST( "vfcvt.f.x.v e32 m1 masked", ints, 11, 0, 56, VV( 32, m1, "vfcvt.f.x.v v8, v16, v0.t" ) );
+    VTEST( "vfcvt.xu.f.v e32 mf2", floats, 100, 0, 40, VV( 32, mf2, "vfcvt.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.x.f.v e32 mf2 masked", floats, 100, 0, 40, VV( 32, mf2, "vfcvt.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.rtz.xu.f.v e32 mf2", floats, 100, 0, 40, VV( 32, mf2, "vfcvt.rtz.xu.f.v v8, v24" ) );
+    VTEST( "vfcvt.rtz.x.f.v e32 mf2 masked", floats, 100, 0, 40, VV( 32, mf2, "vfcvt.rtz.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfcvt.f.xu.v e32 mf2", ints, 100, 0, 40, VV( 32, mf2, "vfcvt.f.xu.v v8, v16" ) );
+    VTEST( "vfcvt.f.x.v e32 mf2 masked", ints, 100, 0, 40, VV( 32, mf2, "vfcvt.f.x.v v8, v16, v0.t" ) );
+    VTEST( "vfwcvt.f.f.v e32 m1", floats, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.f.f.v v8, v24" ) );
+    VTEST( "vfwcvt.xu.f.v e32 m1 masked", floats, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.xu.f.v v8, v24, v0.t" ) );
+    VTEST( "vfwcvt.x.f.v e32 m1", floats, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.x.f.v v8, v24" ) );
+    VTEST( "vfwcvt.rtz.xu.f.v e32 m1 masked", floats, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.rtz.xu.f.v v8, v24, v0.t" ) );
+    VTEST( "vfwcvt.rtz.x.f.v e32 m1", floats, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.rtz.x.f.v v8, v24" ) );
+    VTEST( "vfwcvt.f.xu.v e32 m1 masked", ints, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.f.xu.v v8, v16, v0.t" ) );
+    VTEST( "vfwcvt.f.x.v e32 m1", ints, 11, 0, 96, VW( 32, 64, m1, "vfwcvt.f.x.v v8, v16" ) );
+    VTEST( "vfwcvt.f.f.v e32 mf2 masked", floats, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.f.f.v v8, v24, v0.t" ) );
+    VTEST( "vfwcvt.xu.f.v e32 mf2", floats, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.xu.f.v v8, v24" ) );
+    VTEST( "vfwcvt.x.f.v e32 mf2 masked", floats, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfwcvt.rtz.xu.f.v e32 mf2", floats, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.rtz.xu.f.v v8, v24" ) );
+    VTEST( "vfwcvt.rtz.x.f.v e32 mf2 masked", floats, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.rtz.x.f.v v8, v24, v0.t" ) );
+    VTEST( "vfwcvt.f.xu.v e32 mf2", ints, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.f.xu.v v8, v16" ) );
+    VTEST( "vfwcvt.f.x.v e32 mf2 masked", ints, 100, 0, 72, VW( 32, 64, mf2, "vfwcvt.f.x.v v8, v16, v0.t" ) );
+    VTEST( "vfwcvt.f.xu.v e16 m1 masked", ints, 37, 0, 120, VW( 16, 32, m1, "vfwcvt.f.xu.v v8, v16, v0.t" ) );
+    VTEST( "vfwcvt.f.x.v e16 m1 masked", ints, 37, 0, 120, VW( 16, 32, m1, "vfwcvt.f.x.v v8, v16, v0.t" ) );
+    VTEST( "vfncvt.f.f.w e32 m1", doubles, 11, 0, 56, VNB( 32, 64, m1, "vfncvt.f.f.w v8, v16" ) );
+    VTEST( "vfncvt.xu.f.w e32 m1 masked", doubles, 11, 0, 56, VNB( 32, 64, m1, "vfncvt.xu.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.x.f.w e32 m1", doubles, 11, 0, 56, VNB( 32, 64, m1, "vfncvt.x.f.w v8, v16" ) );
+    VTEST( "vfncvt.rtz.xu.f.w e32 m1 masked", doubles, 11, 0, 56, VNB( 32, 64, m1, "vfncvt.rtz.xu.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.rtz.x.f.w e32 m1", doubles, 11, 0, 56, VNB( 32, 64, m1, "vfncvt.rtz.x.f.w v8, v16" ) );
+    VTEST( "vfncvt.f.xu.w e32 m1 masked", ints, 11, 0, 56, VN( 32, 64, m1, "vfncvt.f.xu.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.f.x.w e32 m1", ints, 11, 0, 56, VN( 32, 64, m1, "vfncvt.f.x.w v8, v16" ) );
+    VTEST( "vfncvt.f.f.w e32 mf2 masked", doubles, 100, 0, 40, VNB( 32, 64, mf2, "vfncvt.f.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.xu.f.w e32 mf2", doubles, 100, 0, 40, VNB( 32, 64, mf2, "vfncvt.xu.f.w v8, v16" ) );
+    VTEST( "vfncvt.x.f.w e32 mf2 masked", doubles, 100, 0, 40, VNB( 32, 64, mf2, "vfncvt.x.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.rtz.xu.f.w e32 mf2", doubles, 100, 0, 40, VNB( 32, 64, mf2, "vfncvt.rtz.xu.f.w v8, v16" ) );
+    VTEST( "vfncvt.rtz.x.f.w e32 mf2 masked", doubles, 100, 0, 40, VNB( 32, 64, mf2, "vfncvt.rtz.x.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.f.xu.w e32 mf2", ints, 100, 0, 40, VN( 32, 64, mf2, "vfncvt.f.xu.w v8, v16" ) );
+    VTEST( "vfncvt.f.x.w e32 mf2 masked", ints, 100, 0, 40, VN( 32, 64, mf2, "vfncvt.f.x.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.xu.f.w e16 m1", floats, 29, 0, 72, VNB( 16, 32, m1, "vfncvt.xu.f.w v8, v16" ) );
+    VTEST( "vfncvt.x.f.w e16 m1 masked", floats, 29, 0, 64, VNB( 16, 32, m1, "vfncvt.x.f.w v8, v16, v0.t" ) );
+    VTEST( "vfncvt.rtz.xu.f.w e16 m1", floats, 29, 0, 72, VNB( 16, 32, m1, "vfncvt.rtz.xu.f.w v8, v16" ) );
+    VTEST( "vfncvt.rtz.x.f.w e16 m1 masked", floats, 29, 0, 64, VNB( 16, 32, m1, "vfncvt.rtz.x.f.w v8, v16, v0.t" ) );
+} //show_float_conversions
+
+// widening floating point arithmetic from float to double
+
+void show_float_widening()
+{
+    VTEST( "vfwadd.vv e32 m1", floats, 11, 0x40200000, 96, VW( 32, 64, m1, "vfwadd.vv v8, v16, v24" ) );
+    VTEST( "vfwadd.vf e32 mf2 masked", floats, 100, 0x40200000, 72, VW( 32, 64, mf2, "fmv.w.x ft0, a5\n" "vfwadd.vf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfwadd.wv e32 m4", floats, 37, 0x40200000, 200, VWW( 32, 64, m4, "vfwadd.wv v8, v16, v24" ) );
+    VTEST( "vfwadd.wf e32 m1", floats, 11, 0x40200000, 96, VWW( 32, 64, m1, "fmv.w.x ft0, a5\n" "vfwadd.wf v8, v16, ft0" ) );
+    VTEST( "vfwsub.vv e32 mf2 masked", floats, 100, 0x40200000, 72, VW( 32, 64, mf2, "vfwsub.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vfwsub.vf e32 m4", floats, 37, 0x40200000, 200, VW( 32, 64, m4, "fmv.w.x ft0, a5\n" "vfwsub.vf v8, v16, ft0" ) );
+    VTEST( "vfwsub.wv e32 m1", floats, 11, 0x40200000, 96, VWW( 32, 64, m1, "vfwsub.wv v8, v16, v24" ) );
+    VTEST( "vfwsub.wf e32 mf2 masked", floats, 100, 0x40200000, 72, VWW( 32, 64, mf2, "fmv.w.x ft0, a5\n" "vfwsub.wf v8, v16, ft0, v0.t" ) );
+    VTEST( "vfwmul.vv e32 m4", floats, 37, 0x40200000, 200, VW( 32, 64, m4, "vfwmul.vv v8, v16, v24" ) );
+    VTEST( "vfwmul.vf e32 m1", floats, 11, 0x40200000, 96, VW( 32, 64, m1, "fmv.w.x ft0, a5\n" "vfwmul.vf v8, v16, ft0" ) );
+    VTEST( "vfwmacc.vv e32 mf2 masked", floats, 100, 0x40200000, 72, VW( 32, 64, mf2, "vfwmacc.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfwmacc.vf e32 m4", floats, 37, 0x40200000, 200, VW( 32, 64, m4, "fmv.w.x ft0, a5\n" "vfwmacc.vf v8, ft0, v16" ) );
+    VTEST( "vfwnmacc.vv e32 m1", floats, 11, 0x40200000, 96, VW( 32, 64, m1, "vfwnmacc.vv v8, v24, v16" ) );
+    VTEST( "vfwnmacc.vf e32 mf2 masked", floats, 100, 0x40200000, 72, VW( 32, 64, mf2, "fmv.w.x ft0, a5\n" "vfwnmacc.vf v8, ft0, v16, v0.t" ) );
+    VTEST( "vfwmsac.vv e32 m4", floats, 37, 0x40200000, 200, VW( 32, 64, m4, "vfwmsac.vv v8, v24, v16" ) );
+    VTEST( "vfwmsac.vf e32 m1", floats, 11, 0x40200000, 96, VW( 32, 64, m1, "fmv.w.x ft0, a5\n" "vfwmsac.vf v8, ft0, v16" ) );
+    VTEST( "vfwnmsac.vv e32 mf2 masked", floats, 100, 0x40200000, 72, VW( 32, 64, mf2, "vfwnmsac.vv v8, v24, v16, v0.t" ) );
+    VTEST( "vfwnmsac.vf e32 m4", floats, 37, 0x40200000, 200, VW( 32, 64, m4, "fmv.w.x ft0, a5\n" "vfwnmsac.vf v8, ft0, v16" ) );
+} //show_float_widening
+
+// mask logical ops, vcpop, vfirst, vmsbf and friends, viota, vid, and moves to and from element 0
+
+void show_masks()
+{
+    VTEST( "vmand.mm e8 m1", ints, 40, 0, 16, VM( 8, m1, "vmand.mm v8, v16, v24" ) );
+    VTEST( "vmnand.mm e16 m2", ints, 24, 0, 16, VM( 16, m2, "vmnand.mm v8, v16, v24" ) );
+    VTEST( "vmandn.mm e32 mf2", ints, 100, 0, 16, VM( 32, mf2, "vmandn.mm v8, v16, v24" ) );
+    VTEST( "vmxor.mm e64 m4", ints, 16, 0, 16, VM( 64, m4, "vmxor.mm v8, v16, v24" ) );
+    VTEST( "vmor.mm e8 m1", ints, 40, 0, 16, VM( 8, m1, "vmor.mm v8, v16, v24" ) );
+    VTEST( "vmnor.mm e16 m2", ints, 24, 0, 16, VM( 16, m2, "vmnor.mm v8, v16, v24" ) );
+    VTEST( "vmorn.mm e32 mf2", ints, 100, 0, 16, VM( 32, mf2, "vmorn.mm v8, v16, v24" ) );
+    VTEST( "vmxnor.mm e64 m4", ints, 16, 0, 16, VM( 64, m4, "vmxnor.mm v8, v16, v24" ) );
+    VTEST( "vcpop.m e8 m1", ints, 37, 0, 16, VS( 8, m1, "vcpop.m t1, v16" ) );
+    VTEST( "vcpop.m e8 m1 masked", ints, 37, 0, 16, VS( 8, m1, "vcpop.m t1, v16, v0.t" ) );
+    VTEST( "vfirst.m e8 m1", ints, 37, 0, 16, VS( 8, m1, "vfirst.m t1, v16" ) );
+    VTEST( "vfirst.m e8 m1 masked", ints, 37, 0, 16, VS( 8, m1, "vfirst.m t1, v16, v0.t" ) );
+    VTEST( "vcpop.m e32 m8", ints, 100, 0, 16, VS( 32, m8, "vcpop.m t1, v16" ) );
+    VTEST( "vcpop.m e32 m8 masked", ints, 100, 0, 16, VS( 32, m8, "vcpop.m t1, v16, v0.t" ) );
+    VTEST( "vfirst.m e32 m8", ints, 100, 0, 16, VS( 32, m8, "vfirst.m t1, v16" ) );
+    VTEST( "vfirst.m e32 m8 masked", ints, 100, 0, 16, VS( 32, m8, "vfirst.m t1, v16, v0.t" ) );
+    VTEST( "vcpop.m e16 mf2", ints, 100, 0, 16, VS( 16, mf2, "vcpop.m t1, v16" ) );
+    VTEST( "vcpop.m e16 mf2 masked", ints, 100, 0, 16, VS( 16, mf2, "vcpop.m t1, v16, v0.t" ) );
+    VTEST( "vfirst.m e16 mf2", ints, 100, 0, 16, VS( 16, mf2, "vfirst.m t1, v16" ) );
+    VTEST( "vfirst.m e16 mf2 masked", ints, 100, 0, 16, VS( 16, mf2, "vfirst.m t1, v16, v0.t" ) );
+    VTEST( "vfirst.m of no bits", ints, 37, 0, 16, VS( 8, m1, "vmxor.mm v16, v16, v16\n" "vfirst.m t1, v16" ) );
+    VTEST( "vmsbf.m e8 m1", ints, 40, 0, 16, VM( 8, m1, "vmsbf.m v8, v16" ) );
+    VTEST( "vmsbf.m e16 m2 masked", ints, 24, 0, 16, VM( 16, m2, "vmsbf.m v8, v16, v0.t" ) );
+    VTEST( "vmsif.m e32 mf2", ints, 100, 0, 16, VM( 32, mf2, "vmsif.m v8, v16" ) );
+    VTEST( "vmsif.m e64 m4 masked", ints, 16, 0, 16, VM( 64, m4, "vmsif.m v8, v16, v0.t" ) );
+    VTEST( "vmsof.m e8 m1", ints, 40, 0, 16, VM( 8, m1, "vmsof.m v8, v16" ) );
+    VTEST( "vmsof.m e16 m2 masked", ints, 24, 0, 16, VM( 16, m2, "vmsof.m v8, v16, v0.t" ) );
+    VTEST( "viota.m e8 m1 masked", ints, 37, 0, 48, VV( 8, m1, "viota.m v8, v16, v0.t" ) );
+    VTEST( "vid.v e8 m1", ints, 37, 0, 48, VV( 8, m1, "vid.v v8" ) );
+    VTEST( "viota.m e16 m2", ints, 21, 0, 56, VV( 16, m2, "viota.m v8, v16" ) );
+    VTEST( "vid.v e16 m2 masked", ints, 21, 0, 48, VV( 16, m2, "vid.v v8, v0.t" ) );
+    VTEST( "viota.m e32 mf2 masked", ints, 100, 0, 40, VV( 32, mf2, "viota.m v8, v16, v0.t" ) );
+    VTEST( "vid.v e32 mf2", ints, 100, 0, 40, VV( 32, mf2, "vid.v v8" ) );
+    VTEST( "viota.m e64 m4", ints, 13, 0, 112, VV( 64, m4, "viota.m v8, v16" ) );
+    VTEST( "vid.v e64 m4 masked", ints, 13, 0, 104, VV( 64, m4, "vid.v v8, v0.t" ) );
+    VTEST( "vmv.x.s e8 m1", ints, 5, 0, 16, VSET( 8, m1 ) "vl8re8.v v16, (a0)\n" "vmv.x.s t1, v16\n" "sd t1, 0(a2)\n" );
+    VTEST( "vmv.s.x e8 m1", ints, 37, (uint64_t) -7116713809613245305, 16, VV( 8, m1, "vmv.s.x v8, a5" ) );
+    VTEST( "vmv.x.s e16 m2", ints, 5, 0, 16, VSET( 16, m2 ) "vl8re8.v v16, (a0)\n" "vmv.x.s t1, v16\n" "sd t1, 0(a2)\n" );
+    VTEST( "vmv.s.x e16 m2", ints, 21, (uint64_t) -7116713809613245305, 16, VV( 16, m2, "vmv.s.x v8, a5" ) );
+    VTEST( "vmv.x.s e32 mf2", ints, 5, 0, 16, VSET( 32, mf2 ) "vl8re8.v v16, (a0)\n" "vmv.x.s t1, v16\n" "sd t1, 0(a2)\n" );
+    VTEST( "vmv.s.x e32 mf2", ints, 100, (uint64_t) -7116713809613245305, 16, VV( 32, mf2, "vmv.s.x v8, a5" ) );
+    VTEST( "vmv.x.s e64 m4", ints, 5, 0, 16, VSET( 64, m4 ) "vl8re8.v v16, (a0)\n" "vmv.x.s t1, v16\n" "sd t1, 0(a2)\n" );
+    VTEST( "vmv.s.x e64 m4", ints, 13, (uint64_t) -7116713809613245305, 16, VV( 64, m4, "vmv.s.x v8, a5" ) );
+    VTEST( "vmv.s.x with vl 0", ints, 0, (uint64_t) -7116713809613245305, 16, VV( 32, m1, "vmv.s.x v8, a5" ) );
+} //show_masks
+
+// slides, gathers including out of range indexes, compress, and whole register moves
+
+void show_permutations()
+{
+    VTEST( "vslideup.vx e32 mf2", ints, 100, 3, 40, VP( 32, mf2, "vslideup.vx v8, v16, a5" ) );
+    VTEST( "vslideup.vx e64 m4", ints, 13, 3, 112, VP( 64, m4, "vslideup.vx v8, v16, a5" ) );
+    VTEST( "vslideup.vx e8 m8 masked", ints, 300, 1000, 16, VP( 8, m8, "vslideup.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslideup.vx e32 m4 masked", ints, 50, 1000, 16, VP( 32, m4, "vslideup.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslideup.vi e8 m1 masked", ints, 37, 0, 48, VP( 8, m1, "vslideup.vi v8, v16, 5, v0.t" ) );
+    VTEST( "vslideup.vi e16 m2 masked", ints, 21, 0, 48, VP( 16, m2, "vslideup.vi v8, v16, 5, v0.t" ) );
+    VTEST( "vslidedown.vx e32 mf2 masked", ints, 100, 3, 40, VP( 32, mf2, "vslidedown.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslidedown.vx e64 m4 masked", ints, 13, 3, 104, VP( 64, m4, "vslidedown.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslidedown.vx e8 m8", ints, 300, 1000, 200, VP( 8, m8, "vslidedown.vx v8, v16, a5" ) );
+    VTEST( "vslidedown.vx e32 m4", ints, 50, 1000, 200, VP( 32, m4, "vslidedown.vx v8, v16, a5" ) );
+    VTEST( "vslidedown.vi e8 m1", ints, 37, 0, 48, VP( 8, m1, "vslidedown.vi v8, v16, 7" ) );
+    VTEST( "vslidedown.vi e16 m2", ints, 21, 0, 56, VP( 16, m2, "vslidedown.vi v8, v16, 7" ) );
+    VTEST( "vslidedown.vx e32 mf2", ints, 100, 9, 40, VP( 32, mf2, "vslidedown.vx v8, v16, a5" ) );
+    VTEST( "vslidedown.vx e64 m4", ints, 13, 9, 112, VP( 64, m4, "vslidedown.vx v8, v16, a5" ) );
+    VTEST( "vslide1up.vx e8 m8 masked", ints, 300, (uint64_t) -7116713809613245305, 200, VP( 8, m8, "vslide1up.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslide1up.vx e32 m4 masked", ints, 50, (uint64_t) -7116713809613245305, 200, VP( 32, m4, "vslide1up.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslide1down.vx e8 m1", ints, 37, (uint64_t) -7116713809613245305, 48, VP( 8, m1, "vslide1down.vx v8, v16, a5" ) );
+    VTEST( "vslide1down.vx e16 m2", ints, 21, (uint64_t) -7116713809613245305, 56, VP( 16, m2, "vslide1down.vx v8, v16, a5" ) );
+    VTEST( "vslide1down.vx e32 mf2 masked", ints, 100, (uint64_t) -7116713809613245305, 40, VP( 32, mf2, "vslide1down.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslide1down.vx e64 m4 masked", ints, 13, (uint64_t) -7116713809613245305, 104, VP( 64, m4, "vslide1down.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vslideup.vx e8 m8", ints, 300, 200, 200, VP( 8, m8, "vslideup.vx v8, v16, a5" ) );
+    VTEST( "vslideup.vx e32 m4", ints, 50, 200, 16, VP( 32, m4, "vslideup.vx v8, v16, a5" ) );
+    VTEST( "vrgather.vv e8 m1", ints, 37, 0, 48, VP( 8, m1, "vrgather.vv v8, v16, v24" ) );
+    VTEST( "vrgather.vv e16 m2", ints, 21, 0, 56, VP( 16, m2, "vrgather.vv v8, v16, v24" ) );
+    VTEST( "vrgather.vv e32 mf2 masked", ints, 100, 0, 40, VP( 32, mf2, "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e64 m4 masked", ints, 13, 0, 104, VP( 64, m4, "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vx e8 m8", ints, 300, 3, 200, VP( 8, m8, "vrgather.vx v8, v16, a5" ) );
+    VTEST( "vrgather.vx e32 m4", ints, 50, 3, 200, VP( 32, m4, "vrgather.vx v8, v16, a5" ) );
+    VTEST( "vrgather.vx e8 m1 masked", ints, 37, 1000, 48, VP( 8, m1, "vrgather.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vrgather.vx e16 m2 masked", ints, 21, 1000, 48, VP( 16, m2, "vrgather.vx v8, v16, a5, v0.t" ) );
+    VTEST( "vrgather.vi e32 mf2 masked", ints, 100, 0, 40, VP( 32, mf2, "vrgather.vi v8, v16, 7, v0.t" ) );
+    VTEST( "vrgather.vi e64 m4 masked", ints, 13, 0, 104, VP( 64, m4, "vrgather.vi v8, v16, 7, v0.t" ) );
+    VTEST( "vrgather.vi e8 m8", ints, 300, 0, 200, VP( 8, m8, "vrgather.vi v8, v16, 31" ) );
+    VTEST( "vrgather.vi e32 m4", ints, 50, 0, 200, VP( 32, m4, "vrgather.vi v8, v16, 31" ) );
+    VTEST( "vrgather.vv e8 m1 masked in range", ints, 37, 0, 48, VP( 8, m1, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e16 m2 masked in range", ints, 21, 0, 48, VP( 16, m2, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e32 mf2 masked in range", ints, 100, 0, 40, VP( 32, mf2, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e64 m4 masked in range", ints, 13, 0, 104, VP( 64, m4, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e8 m8 masked in range", ints, 300, 0, 200, VP( 8, m8, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgather.vv e32 m4 masked in range", ints, 50, 0, 200, VP( 32, m4, "vand.vi v24, v24, 15\n" "vrgather.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgatherei16.vv e32 m2 masked", ints, 21, 0, 80,
+           VP( 32, m2, "vsetvli t1, a4, e16, m1, tu, mu\n" "vand.vi v24, v24, 15\n" "vsetvli t0, a4, e32, m2, tu, mu\n" "vrgatherei16.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgatherei16.vv e8 m1 masked", ints, 37, 0, 48,
+           VP( 8, m1, "vsetvli t1, a4, e16, m2, tu, mu\n" "vand.vi v24, v24, 15\n" "vsetvli t0, a4, e8, m1, tu, mu\n" "vrgatherei16.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vrgatherei16.vv e64 m4 masked", ints, 13, 0, 104,
+           VP( 64, m4, "vsetvli t1, a4, e16, m1, tu, mu\n" "vand.vi v24, v24, 15\n" "vsetvli t0, a4, e64, m4, tu, mu\n" "vrgatherei16.vv v8, v16, v24, v0.t" ) );
+    VTEST( "vcompress.vm e8 m1", ints, 37, 0, 32, VP( 8, m1, "vcompress.vm v8, v16, v0" ) );
+    VTEST( "vcompress.vm e32 m4", ints, 50, 0, 104, VP( 32, m4, "vcompress.vm v8, v16, v0" ) );
+    VTEST( "vcompress.vm e64 m1", ints, 100, 0, 48, VP( 64, m1, "vcompress.vm v8, v16, v0" ) );
+    VTEST( "vcompress.vm e16 mf2", ints, 100, 0, 32, VP( 16, mf2, "vcompress.vm v8, v16, v0" ) );
+    VTEST( "vcompress.vm e16 m1 by v24", ints, 21, 0, 32, VP( 16, m1, "vcompress.vm v8, v16, v24" ) );
+    VTEST( "vmv1r.v", ints, 3, 0, 72, VSET( 16, m1 ) "vl8re8.v v16, (a0)\n" "vl8re8.v v8, (a2)\n" "vmv1r.v v8, v16\n" "vs8r.v v8, (a2)\n" );
+    VTEST( "vmv2r.v", ints, 3, 0, 136, VSET( 16, m1 ) "vl8re8.v v16, (a0)\n" "vl8re8.v v8, (a2)\n" "vmv2r.v v8, v16\n" "vs8r.v v8, (a2)\n" );
+    VTEST( "vmv4r.v", ints, 3, 0, 200, VSET( 16, m1 ) "vl8re8.v v16, (a0)\n" "vl8re8.v v8, (a2)\n" "vmv4r.v v8, v16\n" "vs8r.v v8, (a2)\n" );
+    VTEST( "vmv8r.v", ints, 3, 0, 200, VSET( 16, m1 ) "vl8re8.v v16, (a0)\n" "vl8re8.v v8, (a2)\n" "vmv8r.v v8, v16\n" "vs8r.v v8, (a2)\n" );
+} //show_permutations
+
+// a fault-only-first load that reaches an unmapped page stops there rather than faulting. where it stops
+// before the page is up to the implementation, so just check that the elements it claims to load are right
+
+void show_fault_only_first()
+{
+    const size_t page = 4096;
+    uint8_t * p = (uint8_t *) mmap( 0, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    if ( MAP_FAILED == p )
+    {
+        printf( "mmap failed\n" );
+        return;
+    }
+
+    munmap( p + page, page );
+    uint32_t * edge = (uint32_t *) ( p + page - 8 );
+    edge[ 0 ] = 0x12345678;
+    edge[ 1 ] = 0x9abcdef0;
+    uint32_t result[ 8 ] = { 0 };
+    uint64_t vl;
+    asm volatile( "vsetvli t0, %2, e32, m1, tu, mu\n"
+                  "vle32ff.v v8, (%1)\n"
+                  "csrr %0, vl\n"
+                  "vse32.v v8, (%3)\n"
+                  : "=&r" ( vl ) : "r" ( edge ), "r" ( 8 ), "r" ( result ) : "t0", "v8", "memory" );
+
+    bool loaded = ( 0x12345678 == result[ 0 ] ) && ( vl < 2 || 0x9abcdef0 == result[ 1 ] );
+    printf( "vle32ff.v at an unmapped page: vl in range %d, loaded %d\n", ( vl >= 1 && vl <= 8 ), loaded );
+    munmap( p, page );
+} //show_fault_only_first
+
+int main( int argc, char * argv[] )
+{
+    show_double_estimates();
+    show_float_estimates();
+    show_vsmul< int8_t >( 8 );
+    show_vsmul< int16_t >( 16 );
+    show_vsmul< int32_t >( 32 );
+    show_vsmul< int64_t >( 64 );
+    show_configuration();
+    show_loads_and_stores();
+    show_integer();
+    show_compares();
+    show_fixed_point();
+    show_widening_and_narrowing();
+    show_reductions();
+    show_float();
+    show_float_compares();
+    show_float_conversions();
+    show_float_widening();
+    show_masks();
+    show_permutations();
+    show_fault_only_first();
+    printf( "vector test completed with great success\n" );
+    return 0;
+} //main
@@ -1,228 +1,288 @@
 #pragma once
 
-#include <stdint.h>
+// CMMap hands out page-aligned ranges of an emulated app's mmap region. It tracks the free ranges rather than the
+// allocations, both by address (to coalesce neighbors and find what overlaps a range) and by size (to find the
+// smallest range that fits), so allocate, free, and resize are O(log n) in the number of free ranges. Like Linux,
+// adjacent allocations aren't distinguished, so munmap and MAP_FIXED can punch holes anywhere in the region.
+// Free ranges are always zero: freed memory goes back to the host, so allocations don't need to be cleared.
 
-struct MMapEntry
-{
-    uint64_t address;
-    uint64_t length;
-};
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <djl_vmem.hxx>
 
 class CMMap
 {
     private:
-        vector<MMapEntry> entries; // sorted by address
+        std::map<uint64_t, uint64_t> free_by_address;              // address -> length. coalesced, so never adjacent
+        std::set<std::pair<uint64_t, uint64_t>> free_by_size;      // { length, address } of the same ranges
         uint64_t base;
         uint64_t length;
         uint64_t peak;
-        uint8_t * pmem;
+        uint64_t in_use;
+        CVirtualMemory * pvm;
+        uint64_t vm_base;                                          // the address of byte 0 of pvm
 
-        size_t binary_search( uint64_t key )
+        void add_free( uint64_t a, uint64_t l )
         {
-            if ( 0 == entries.size() )
-               return (size_t) -1;
-            
-            size_t low = 0;
-            size_t high = entries.size() - 1;
-            while ( low <= high )
+            free_by_address[ a ] = l;
+            free_by_size.insert( std::make_pair( l, a ) );
+        } //add_free
+
+        std::map<uint64_t, uint64_t>::iterator remove_free( std::map<uint64_t, uint64_t>::iterator it )
+        {
+            free_by_size.erase( std::make_pair( it->second, it->first ) );
+            return free_by_address.erase( it );
+        } //remove_free
+
+        // the first free range that ends after address a, or end()
+
+        std::map<uint64_t, uint64_t>::iterator first_free_ending_after( uint64_t a )
+        {
+            std::map<uint64_t, uint64_t>::iterator it = free_by_address.upper_bound( a );
+            if ( it != free_by_address.begin() )
             {
-                size_t mid = low + ( ( high - low ) / 2 );
-                if ( entries[ mid ].address == key )
-                    return mid;
-                if ( key < entries[ mid ].address )
-                    high = mid - 1;
-                else
-                    low = mid + 1;
+                std::map<uint64_t, uint64_t>::iterator prev = it;
+                prev--;
+                if ( ( prev->first + prev->second ) > a )
+                    return prev;
             }
-            return (size_t) -1;
-        } //binary_search
+            return it;
+        } //first_free_ending_after
 
-        void zero_entry( size_t i )
+        bool in_region( uint64_t a, uint64_t l )
         {
-            memset( pmem + entries[ i ].address, 0, entries[ i ].length );
-        } //zero_entry
+            return ( a >= base && l <= length && ( a - base ) <= ( length - l ) );
+        } //in_region
 
-        void validate()
+        // true if none of a .. a + l - 1 is free
+
+        bool is_allocated( uint64_t a, uint64_t l )
         {
-#ifndef NDEBUG
-            for ( size_t i = 0; i < entries.size(); i++ )
+            if ( !in_region( a, l ) )
+                return false;
+
+            std::map<uint64_t, uint64_t>::iterator it = first_free_ending_after( a );
+            return ( it == free_by_address.end() || it->first >= ( a + l ) );
+        } //is_allocated
+
+        // true if all of a .. a + l - 1 is free
+
+        bool is_free( uint64_t a, uint64_t l )
+        {
+            std::map<uint64_t, uint64_t>::iterator it = first_free_ending_after( a );
+            return ( it != free_by_address.end() && it->first <= a && ( it->first + it->second ) >= ( a + l ) );
+        } //is_free
+
+        // mark a range allocated. Parts of it may already be allocated
+
+        void take( uint64_t a, uint64_t l )
+        {
+            uint64_t past = a + l;
+            std::map<uint64_t, uint64_t>::iterator it = first_free_ending_after( a );
+
+            while ( it != free_by_address.end() && it->first < past )
+            {
+                uint64_t start = it->first;
+                uint64_t end = start + it->second;
+                it = remove_free( it );
+                in_use += ( ( end < past ) ? end : past ) - ( ( start > a ) ? start : a );
+
+                if ( start < a )
+                    add_free( start, a - start );
+                if ( end > past )
+                    add_free( past, end - past );
+            }
+
+            if ( ( past - base ) > peak )
+                peak = past - base;
+        } //take
+
+        // mark a range free. Parts of it may already be free
+
+        void give( uint64_t a, uint64_t l )
+        {
+            uint64_t start = a;
+            uint64_t past = a + l;
+            in_use -= l;
+
+            std::map<uint64_t, uint64_t>::iterator it = free_by_address.upper_bound( a );
+            if ( it != free_by_address.begin() )
             {
-                MMapEntry & entry = entries[ i ];
-                if ( i < ( entries.size() - 1 ) )
+                std::map<uint64_t, uint64_t>::iterator prev = it;
+                prev--;
+                uint64_t prev_past = prev->first + prev->second;
+                if ( prev_past >= a )
                 {
-                    assert( entry.address < entries[ i + 1 ].address );
-                    assert( ( entry.address + entry.length ) <= entries[ i + 1 ].address );
+                    in_use += ( ( prev_past < past ) ? prev_past : past ) - a; // already free
+                    start = prev->first;
+                    if ( prev_past > past )
+                        past = prev_past;
+                    remove_free( prev );
                 }
-                else
-                    assert( ( entry.address + entry.length ) <= ( base + length ) );
             }
+
+            while ( it != free_by_address.end() && it->first <= past )
+            {
+                uint64_t it_past = it->first + it->second;
+                if ( it->first < ( a + l ) )
+                    in_use += ( ( it_past < ( a + l ) ) ? it_past : ( a + l ) ) - it->first; // already free
+                if ( it_past > past )
+                    past = it_past;
+                it = remove_free( it );
+            }
+
+            add_free( start, past - start );
+        } //give
+
+        uint8_t * host_address( uint64_t a )
+        {
+            return pvm->data() + ( a - vm_base );
+        } //host_address
+
+        void zero_range( uint64_t a, uint64_t l )
+        {
+            pvm->discard( (size_t) ( a - vm_base ), (size_t) l );
+        } //zero_range
+
+        void validate()
+        {
+#ifndef NDEBUG
+            assert( free_by_address.size() == free_by_size.size() );
+            uint64_t free_bytes = 0;
+            uint64_t prev_past = 0;
+            for ( std::map<uint64_t, uint64_t>::iterator it = free_by_address.begin(); it != free_by_address.end(); it++ )
+            {
+                assert( 0 != it->second );
+                assert( in_region( it->first, it->second ) );
+                assert( it == free_by_address.begin() || it->first > prev_past ); // coalesced
+                assert( free_by_size.count( std::make_pair( it->second, it->first ) ) );
+                prev_past = it->first + it->second;
+                free_bytes += it->second;
+            }
+            assert( ( free_bytes + in_use ) == length );
 #endif
         } //validate
 
     public:
-        CMMap() : base( 0 ), length( 0 ), peak( 0 ), pmem( 0 ) {}
+        CMMap() : base( 0 ), length( 0 ), peak( 0 ), in_use( 0 ), pvm( 0 ), vm_base( 0 ) {}
         ~CMMap() { validate(); }
         uint64_t peak_usage() { return peak; }
-        size_t count() { return entries.size(); }
+        uint64_t bytes_in_use() { return in_use; }
 
-        void initialize( uint64_t b, uint64_t l, uint8_t * p )
+        // the region is b .. b + l - 1 within vm, whose first byte has address vbase. It must be zero-filled
+
+        void initialize( uint64_t b, uint64_t l, CVirtualMemory & vm, uint64_t vbase )
         {
             base = b;
             length = l;
-            pmem = p;
+            pvm = &vm;
+            vm_base = vbase;
+            peak = 0;
+            in_use = 0;
+            free_by_address.clear();
+            free_by_size.clear();
+            if ( 0 != length )
+                add_free( base, length );
         } //initialize
 
         void trace_allocations()
         {
-            if ( entries.size() )
+            if ( in_use )
             {
-                uint64_t beyond = 0;
-                tracer.Trace( "  app has %zu mmap allocations. address, size:\n", entries.size() );
-                uint64_t total = 0;
-                for ( size_t i = 0; i < entries.size(); i++ )
+                // allocations are the gaps between free ranges. Adjacent allocations show as one
+
+                tracer.Trace( "  app has %llu bytes of mmap allocations. address, size:\n", in_use );
+                uint64_t a = base;
+                size_t i = 0;
+                for ( std::map<uint64_t, uint64_t>::iterator it = free_by_address.begin(); ; it++ )
                 {
-                    MMapEntry & entry = entries[ i ];
-                    tracer.Trace( "    %zu: %llx - %llx, length %llu == %llx\n", i, entry.address, entry.address + entry.length - 1, entry.length, entry.length );
-                    total += entry.length;
-                    beyond = entry.address + entry.length;
+                    uint64_t next_free = ( it == free_by_address.end() ) ? ( base + length ) : it->first;
+                    if ( next_free > a )
+                        tracer.Trace( "    %zu: %llx - %llx, length %llu == %llx\n", i++, a, next_free - 1, next_free - a, next_free - a );
+                    if ( it == free_by_address.end() )
+                        break;
+                    a = it->first + it->second;
                 }
-                tracer.Trace( "    total memory in use: %llu bytes spanning %llu bytes\n", total, beyond - base );
+                tracer.Trace( "    total memory in use: %llu bytes, %zu free ranges\n", in_use, free_by_address.size() );
             }
         } //trace_allocations
 
+        // bytes of a .. a + l - 1 that aren't allocated, so a caller can tell how much MAP_FIXED would add
+
+        uint64_t free_bytes_in( uint64_t a, uint64_t l )
+        {
+            uint64_t total = 0;
+            uint64_t past = a + l;
+            for ( std::map<uint64_t, uint64_t>::iterator it = first_free_ending_after( a ); it != free_by_address.end() && it->first < past; it++ )
+            {
+                uint64_t it_past = it->first + it->second;
+                total += ( ( it_past < past ) ? it_past : past ) - ( ( it->first > a ) ? it->first : a );
+            }
+            return total;
+        } //free_bytes_in
+
+        // MAP_FIXED: the app gets exactly the requested range, replacing whatever was mapped there
+
         uint64_t allocate_fixed( uint64_t address, uint64_t l )
         {
-            size_t match = binary_search( address );
-            if ( -1 == match )
-                tracer.Trace( "attempt to mmap allocate a fixed entry that's not in the allocation list address %#llx len %#llx\n", address, l );
-            
+            if ( 0 != ( address & 0xfff ) || !in_region( address, l ) )
+            {
+                tracer.Trace( "  fixed mmap request %#llx len %#llx is outside the mmap region %#llx len %#llx\n", address, l, base, length );
+                return 0;
+            }
+
+            zero_range( address, l ); // parts of it may have been allocated
+            take( address, l );
+            validate();
             return address;
         } //allocate_fixed
 
         uint64_t allocate( uint64_t ahint, uint64_t l, bool fixed )
         {
             assert( 0 == ( l & 0xfff ) );
-            trace_allocations();
+            if ( 0 == l )
+                return 0;
 
             if ( fixed )
                 return allocate_fixed( ahint, l );
 
-            if ( 0 == entries.size() )
-            {
-                tracer.Trace( "  adding a first mmap entry, l %llu, length %llu\n", l, length );
-                if ( l > length )
-                {
-                    tracer.Trace( "  mmap alloc request %llu larger than reserved size %llu\n", l, length );
-                    return 0;
-                }
+            uint64_t result = 0;
 
-                tracer.Trace( "  in mmap allocate, base %#lx\n", base );
+            // like Linux, use the hint if that range is free
 
-                MMapEntry entry = { base, l };
-                entries.push_back( entry );
-                zero_entry( 0 );
-                peak = l;
-                trace_allocations();
-                validate();
-                return base;
-            }
+            if ( 0 != ahint && 0 == ( ahint & 0xfff ) && in_region( ahint, l ) && is_free( ahint, l ) )
+                result = ahint;
             else
             {
-                // first look for a gap large enough to work whose address >= the address hint
+                // otherwise the smallest free range that fits, and the lowest address among those that size
 
-                for ( size_t i = 0; i < entries.size() - 1; i++ )
+                std::set<std::pair<uint64_t, uint64_t>>::iterator fit = free_by_size.lower_bound( std::make_pair( l, (uint64_t) 0 ) );
+                if ( fit == free_by_size.end() )
                 {
-                    MMapEntry & entry = entries[ i ];
-
-                    uint64_t gapSize = entries[ i + 1 ].address  - ( entry.address + entry.length );
-                    if ( ( gapSize >= l ) && ( ( entry.address + entry.length ) >= ahint ) )
-                    {
-                        uint64_t result = entry.address + entry.length;
-                        MMapEntry newEntry = { result, l };
-                        entries.insert( i + 1 + entries.begin(), newEntry );
-                        tracer.Trace( "  inserted in the gap, result %llx\n", result );
-                        zero_entry( i + 1 );
-                        trace_allocations();
-                        validate();
-                        return result;
-                    }
-                }
-
-                // add a new entry at the end if space is available
-
-                tracer.Trace( "  no sufficient gap found; adding a subsequent mmap entry\n" );
-
-                MMapEntry & entry = entries[ entries.size() - 1 ];
-                uint64_t free_offset = entry.address + entry.length;
-
-                if ( l < ( length - ( free_offset - base ) ) )
-                {
-                    MMapEntry newentry = { free_offset, l };
-                    entries.push_back( newentry );
-                    zero_entry( entries.size() - 1 );
-                    trace_allocations();
-                    validate();
-                    peak = ( free_offset - base + l );
-                    return free_offset;
+                    tracer.Trace( "  mmap alloc request %llu can't be met\n", l );
+                    return 0;
                 }
+                result = fit->second;
             }
 
-            tracer.Trace( "  mmap alloc request %llu can't be met\n", l );
-            return 0;
+            take( result, l );
+            validate();
+            return result;
         } //allocate
 
+        // munmap. Any part of the range may be allocated; the rest is ignored, as on Linux
+
         bool free( uint64_t a, uint64_t l )
         {
-            trace_allocations();
-            size_t match = binary_search( a );
-            if ( -1 != match )
+            if ( 0 == l || 0 != ( a & 0xfff ) || !in_region( a, l ) )
             {
-                if ( l < entries[ match ].length )
-                {
-                    entries[ match ].address += l;
-                    entries[ match ].length -= l;
-                }
-                else
-                    entries.erase( entries.begin() + match );
-            }
-            else // may be punching a hole in the middle of an allocation
-            {
-                bool found = false;
-
-                // slow search to find possible allocation containing requested area to free
-
-                for ( int i = ( (int) entries.size() ) - 1; i >= 0; i-- )
-                {
-                    MMapEntry & entry = entries[ i ];
-                    uint64_t past = entry.address + entry.length;
-                    if ( ( entry.address < a ) && ( a < past ) && ( ( a + l ) <= past ) )
-                    {
-                        // make the existing entry shorter
-
-                        found = true;
-                        uint64_t original_length = entry.length;
-                        entry.length = a - entry.address;
-
-                        // if anything remains allocated after the free, create a new entry for it
-
-                        if ( ( a + l ) < past )
-                        {
-                            MMapEntry new_entry = { a + l, original_length - l - entry.length };
-                            entries.insert( entries.begin() + i + 1, new_entry );
-                        }
-                        
-                        break;
-                    }
-                }
-
-                if ( !found )
-                {
-                    tracer.Trace( "  munmap/free can't find entry %llu == %#llx to free\n", a, a );
-                    return false;
-                }
+                tracer.Trace( "  munmap/free range %#llx len %#llx isn't in the mmap region\n", a, l );
+                return false;
             }
 
-            trace_allocations();
+            zero_range( a, l );
+            give( a, l );
             validate();
             return true;
         } //free
@@ -230,85 +290,55 @@ class CMMap
         uint64_t resize( uint64_t a, uint64_t old_l, uint64_t new_l, bool may_move )
         {
             assert( 0 == ( new_l & 0xfff ) );
-            trace_allocations();
-            size_t match = binary_search( a );
-            if ( -1 != match )
+            if ( 0 == old_l || 0 == new_l || !is_allocated( a, old_l ) )
             {
-                if ( new_l <= old_l )
+                tracer.Trace( "  mremap/resize can't find allocation %#llx len %#llx to resize\n", a, old_l );
+                return 0;
+            }
+
+            if ( new_l <= old_l )
+            {
+                tracer.Trace( "  mremap/resize entry size shrunk\n" );
+                if ( new_l < old_l )
                 {
-                    tracer.Trace( "  mremap/resize entry size shrunk\n" );
-                    entries[ match ].length = new_l;
-                    validate();
-                    return entries[ match ].address;
+                    zero_range( a + new_l, old_l - new_l );
+                    give( a + new_l, old_l - new_l );
                 }
+                validate();
+                return a;
+            }
 
-                // check if it can be extended in place
+            // check if it can be extended in place
 
-                if ( ( ( match == ( entries.size() - 1 ) ) && ( ( entries[ match ].address + new_l ) <= length ) ) ||
-                       ( ( entries[ match ].address + new_l ) < entries[ match + 1 ].address ) )
-                {
-                    tracer.Trace( "  mremap extending entry %zu in place from size %llu to %llu\n", match, old_l, new_l );
-                    entries[ match ].length = new_l;
-                    validate();
-                    return a;
-                }
+            uint64_t grow = new_l - old_l;
+            if ( in_region( a + old_l, grow ) && is_free( a + old_l, grow ) )
+            {
+                tracer.Trace( "  mremap extending %#llx in place from size %llu to %llu\n", a, old_l, new_l );
+                take( a + old_l, grow );
+                validate();
+                return a;
+            }
 
-                if ( may_move )
-                {
-                    // first look for a gap large enough to work
-    
-                    for ( size_t i = 0; i < entries.size() - 1; i++ )
-                    {
-                        MMapEntry & entry = entries[ i ];
-    
-                        uint64_t gapSize = entries[ i + 1 ].address  - ( entry.address + entry.length );
-                        if ( gapSize >= new_l )
-                        {
-                            uint64_t result = entry.address + entry.length;
-                            MMapEntry newEntry = { result, new_l };
-                            tracer.Trace( "  mremap inserted in gap pmem %p, dst %#llx, src %#llx, old len %lld new len %lld\n",
-                                          pmem, newEntry.address, entries[ match ].address, entries[ match ].length, new_l );
-                            memcpy( pmem + newEntry.address, pmem + entries[ match ].address, entries[ match ].length );
-                            memset( pmem + newEntry.address + entries[ match ].length, 0, new_l - entries[ match ].length );
-                            entries.insert( i + 1 + entries.begin(), newEntry );
-                            match = binary_search( a ); // it may have moved after the insert
-                            entries.erase( entries.begin() + match );
-                            trace_allocations();
-                            validate();
-                            return result;
-                        }
-                    }
-
-                    // create a new entry at the end and memcpy the old to the new
-
-                    MMapEntry & lastEntry = entries[ entries.size() - 1 ];
-                    uint64_t free_offset = lastEntry.address + lastEntry.length;
-
-                    if ( new_l < ( length - ( free_offset - base ) ) )
-                    {
-                        tracer.Trace( "  free_offset %llx, new_l %llx\n", free_offset, new_l );
-                        MMapEntry newEntry = { free_offset, new_l };
-                        entries.push_back( newEntry );
-                        tracer.Trace( "  mremap added at end pmem %p, dst %#llx, src %#llx, old len %lld\n",
-                                      pmem, newEntry.address, entries[ match ].address, entries[ match ].length );
-                        memcpy( pmem + newEntry.address, pmem + entries[ match ].address, entries[ match ].length );
-                        memset( pmem + newEntry.address + entries[ match ].length, 0, new_l - entries[ match ].length );
-                        entries.erase( entries.begin() + match );
-                        trace_allocations();
-                        validate();
-                        peak = ( free_offset - base + new_l );
-                        return free_offset;
-                    }
-
-                    tracer.Trace( "  insufficient RAM left, so giving up on resize\n" );
-                }
-                else
-                    tracer.Trace( "  can't move the address, so giving up on resize\n" );
+            if ( !may_move )
+            {
+                tracer.Trace( "  can't move the address, so giving up on resize\n" );
+                return 0;
+            }
+
+            std::set<std::pair<uint64_t, uint64_t>>::iterator fit = free_by_size.lower_bound( std::make_pair( new_l, (uint64_t) 0 ) );
+            if ( fit == free_by_size.end() )
+            {
+                tracer.Trace( "  insufficient RAM left, so giving up on resize\n" );
+                return 0;
             }
-            else
-                tracer.Trace( "  mremap/resize can't find entry %llu to resize\n", a );
 
-            return 0;
+            uint64_t result = fit->second;
+            tracer.Trace( "  mremap moving dst %#llx, src %#llx, old len %lld new len %lld\n", result, a, old_l, new_l );
+            take( result, new_l );
+            memcpy( host_address( result ), host_address( a ), old_l );
+            zero_range( a, old_l );
+            give( a, old_l );
+            validate();
+            return result;
         } //resize
 };
-
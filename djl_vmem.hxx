@@ -0,0 +1,571 @@
+#pragma once
+
+// CVirtualMemory is a zero-filled byte buffer used like vector<uint8_t> for an emulator's RAM. The address space is
+// reserved from the OS up front but pages don't cost anything until they're touched, so a big heap reservation
+// doesn't slow startup or use RAM the app never references.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <map>
+#include <errno.h>
+
+#if defined( _WIN32 )
+    #include <windows.h>
+#elif defined( __linux__ ) || defined( __APPLE__ )
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <vector>
+    #define DJL_VMEM_MMAP
+#endif
+
+class CVirtualMemory
+{
+    private:
+        uint8_t * pmem;
+        size_t cb;
+        bool mapped;               // from mmap or VirtualAlloc rather than calloc
+        size_t guard_low;          // inaccessible bytes reserved below and above future allocations
+        size_t guard_high;
+        size_t low;                // and for the current allocation
+        size_t high;
+        size_t discarded;          // bytes given back to the OS by discard
+
+        struct FileMapping
+        {
+            size_t length;
+            bool shared;           // MAP_SHARED, so writes go to the file and the pages may be read-only
+            bool writable;         // false for shared mappings without PROT_WRITE, whose pages are read-only
+        };
+
+        std::map<size_t, FileMapping> files; // ranges from map_file by offset
+
+        // the first file mapping that ends after offset, or files.end()
+
+        std::map<size_t, FileMapping>::iterator first_file_ending_after( size_t offset )
+        {
+            std::map<size_t, FileMapping>::iterator it = files.upper_bound( offset );
+            if ( it != files.begin() )
+            {
+                std::map<size_t, FileMapping>::iterator prev = it;
+                prev--;
+                if ( prev->first + prev->second.length > offset )
+                    return prev;
+            }
+            return it;
+        } //first_file_ending_after
+
+        bool files_overlap( size_t start, size_t end )
+        {
+            std::map<size_t, FileMapping>::iterator it = first_file_ending_after( start );
+            return ( it != files.end() && it->first < end );
+        } //files_overlap
+
+        bool in_shared_file( size_t offset )
+        {
+            std::map<size_t, FileMapping>::iterator it = first_file_ending_after( offset );
+            return ( it != files.end() && it->first <= offset && it->second.shared );
+        } //in_shared_file
+
+        // drop start .. end - 1 from the file mappings, keeping the parts of them outside that range
+
+        void forget_files( size_t start, size_t end )
+        {
+            std::map<size_t, FileMapping>::iterator it = first_file_ending_after( start );
+            while ( it != files.end() && it->first < end )
+            {
+                size_t first = it->first;
+                FileMapping fm = it->second;
+                it = files.erase( it );
+
+                if ( first < start )
+                {
+                    FileMapping before = { start - first, fm.shared, fm.writable };
+                    files[ first ] = before;
+                }
+
+                if ( first + fm.length > end )
+                {
+                    FileMapping after = { first + fm.length - end, fm.shared, fm.writable };
+                    files[ end ] = after;
+                    break;
+                }
+            }
+        } //forget_files
+
+        // split the file mapping that spans offset, if there is one, into two that meet at offset
+
+        void split_file( size_t offset )
+        {
+            std::map<size_t, FileMapping>::iterator it = first_file_ending_after( offset );
+            if ( it != files.end() && it->first < offset )
+            {
+                FileMapping after = { it->first + it->second.length - offset, it->second.shared, it->second.writable };
+                it->second.length = offset - it->first;
+                files[ offset ] = after;
+            }
+        } //split_file
+
+        uint8_t * allocate( size_t len, bool & was_mapped, size_t & was_low, size_t & was_high )
+        {
+            was_mapped = false;
+            was_low = 0;
+            was_high = 0;
+            if ( 0 == len )
+                return 0;
+
+#if defined( _WIN32 )
+            void * p = VirtualAlloc( 0, len, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE ); // committed pages are zeroed on first touch
+            if ( p )
+            {
+                was_mapped = true;
+                return (uint8_t *) p;
+            }
+#elif defined( DJL_VMEM_MMAP )
+            // reserve the guards and the buffer as inaccessible, then open up the buffer
+
+            uint8_t * p = (uint8_t *) mmap( 0, guard_low + len + guard_high, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+            if ( MAP_FAILED != (void *) p )
+            {
+                if ( 0 == mprotect( p + guard_low, len, PROT_READ | PROT_WRITE ) )
+                {
+                    was_mapped = true;
+                    was_low = guard_low;
+                    was_high = guard_high;
+                    return p + guard_low;
+                }
+
+                munmap( p, guard_low + len + guard_high );
+            }
+#endif
+            return (uint8_t *) calloc( len, 1 ); // embedded targets without virtual memory
+        } //allocate
+
+        static void release( uint8_t * p, size_t len, bool was_mapped, size_t was_low, size_t was_high )
+        {
+            if ( 0 == p )
+                return;
+
+#if defined( _WIN32 )
+            if ( was_mapped )
+            {
+                VirtualFree( p, 0, MEM_RELEASE );
+                return;
+            }
+#elif defined( DJL_VMEM_MMAP )
+            if ( was_mapped )
+            {
+                munmap( p - was_low, was_low + len + was_high );
+                return;
+            }
+#endif
+            free( p );
+        } //release
+
+        CVirtualMemory( const CVirtualMemory & );
+        CVirtualMemory & operator = ( const CVirtualMemory & );
+
+    public:
+        CVirtualMemory() : pmem( 0 ), cb( 0 ), mapped( false ), guard_low( 0 ), guard_high( 0 ), low( 0 ), high( 0 ), discarded( 0 ) {}
+        ~CVirtualMemory() { release( pmem, cb, mapped, low, high ); }
+
+        // Reserve inaccessible guard regions below and above the buffer for later allocations so stray references near
+        // it fault rather than touch other memory. Hosts without mmap ignore this.
+
+        void set_guards( size_t below, size_t above )
+        {
+            size_t page = page_size();
+            guard_low = ( below + page - 1 ) & ~( page - 1 );
+            guard_high = ( above + page - 1 ) & ~( page - 1 );
+        } //set_guards
+
+        // true if p is in the buffer or its guard regions
+
+        bool guards_contain( const void * p ) const
+        {
+            return ( mapped && ( (const uint8_t *) p >= pmem - low ) && ( (const uint8_t *) p < pmem + cb + high ) );
+        } //guards_contain
+
+        // make whole pages within the buffer inaccessible, e.g. to catch a stack overflowing into the heap
+
+        bool protect( size_t offset, size_t len )
+        {
+#if defined( DJL_VMEM_MMAP )
+            size_t page = page_size();
+            if ( !mapped || 0 != ( offset % page ) || 0 != ( len % page ) || offset + len > cb )
+                return false;
+
+            return ( 0 == mprotect( pmem + offset, len, PROT_NONE ) );
+#else
+            return false;
+#endif
+        } //protect
+
+        uint8_t * data() { return pmem; }
+        const uint8_t * data() const { return pmem; }
+        size_t size() const { return cb; }
+
+        // like vector::resize: existing bytes are kept up to the smaller size and new bytes are 0.
+        // The buffer moves, so pointers into it are invalid afterwards. throws bad_alloc on failure
+
+        void resize( size_t len )
+        {
+            if ( len == cb )
+                return;
+
+            bool new_mapped = false;
+            size_t new_low = 0, new_high = 0;
+            uint8_t * pnew = allocate( len, new_mapped, new_low, new_high );
+            if ( 0 == pnew && 0 != len )
+                throw std::bad_alloc();
+
+            if ( 0 != cb && 0 != len )
+                memcpy( pnew, pmem, ( len < cb ) ? len : cb );
+
+            release( pmem, cb, mapped, low, high );
+            files.clear(); // the copy is private memory
+            pmem = pnew;
+            cb = len;
+            mapped = new_mapped;
+            low = new_low;
+            high = new_high;
+        } //resize
+
+        // Reserve len bytes at host address == address, so an emulator can use guest addresses as host pointers. Only
+        // for an empty buffer, and without guards. Returns false and leaves the buffer empty if the range isn't available
+
+        bool reserve_at( uint64_t address, size_t len )
+        {
+#if defined( DJL_VMEM_MMAP ) && ( UINTPTR_MAX == UINT64_MAX )
+            if ( 0 != cb || 0 == len || 0 != ( address % page_size() ) )
+                return false;
+
+    #ifdef MAP_FIXED_NOREPLACE
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE; // fails rather than replacing mappings
+    #else
+            int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE; // address is just a hint
+    #endif
+            void * p = mmap( (void *) (uintptr_t) address, len, PROT_READ | PROT_WRITE, flags, -1, 0 );
+            if ( MAP_FAILED == p )
+                return false;
+
+            if ( (uintptr_t) p != address ) // older kernels treat MAP_FIXED_NOREPLACE as a hint
+            {
+                munmap( p, len );
+                return false;
+            }
+
+            pmem = (uint8_t *) p;
+            cb = len;
+            mapped = true;
+            low = 0;
+            high = 0;
+            return true;
+#else
+            return false;
+#endif
+        } //reserve_at
+
+        // Zero len bytes at offset. Whole pages in the range go back to the OS, which hands out zero-filled pages if they
+        // are touched again, so memory an app frees stops counting against the host's RSS. Pages mapped from files
+        // become private zero-filled pages again. Returns the bytes given back to the OS
+
+        size_t discard( size_t offset, size_t len )
+        {
+            if ( offset >= cb )
+                return 0;
+
+            if ( len > cb - offset )
+                len = cb - offset;
+
+            size_t page = page_size();
+            size_t start = ( offset + page - 1 ) & ~( page - 1 );
+            size_t end = ( offset + len ) & ~( page - 1 );
+            bool released = false;
+
+            if ( mapped && end > start )
+            {
+#if defined( _WIN32 )
+                if ( VirtualFree( pmem + start, end - start, MEM_DECOMMIT ) )
+                {
+                    if ( !VirtualAlloc( pmem + start, end - start, MEM_COMMIT, PAGE_READWRITE ) )
+                        throw std::bad_alloc();
+                    released = true;
+                }
+#elif defined( DJL_VMEM_MMAP )
+    #ifdef __APPLE__
+                bool replace = true; // MADV_DONTNEED on macOS may leave the old contents
+    #else
+                bool replace = files_overlap( start, end ); // MADV_DONTNEED would bring back the file's contents
+    #endif
+                if ( replace )
+                {
+                    released = ( MAP_FAILED != mmap( pmem + start, end - start, PROT_READ | PROT_WRITE,
+                                                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0 ) );
+                    if ( released )
+                        forget_files( start, end );
+                }
+                else // MADV_FREE would let the kernel keep the old contents, so the pages would still need to be zeroed
+                    released = ( 0 == madvise( pmem + start, end - start, MADV_DONTNEED ) );
+#endif
+            }
+
+            if ( !released )
+            {
+                start = offset;
+                end = offset;
+            }
+
+            // partial pages at either end. Parts of pages still shared with a file belong to the file, not the app
+
+            if ( start > offset && !in_shared_file( offset ) )
+                memset( pmem + offset, 0, start - offset );
+            if ( offset + len > end && !in_shared_file( end ) )
+                memset( pmem + end, 0, offset + len - end );
+
+            if ( !released )
+                return 0;
+
+            discarded += end - start;
+            return end - start;
+        } //discard
+
+        size_t discarded_bytes() const { return discarded; }
+
+        static size_t page_size()
+        {
+#if defined( DJL_VMEM_MMAP )
+            return (size_t) sysconf( _SC_PAGESIZE );
+#else
+            return 4096;
+#endif
+        } //page_size
+
+        // Replace len bytes at offset with a mapping of the file at file_offset, so the bytes aren't copied and pages are
+        // shared with other processes through the page cache. Private mappings are copy-on-write. Shared mappings write
+        // through to the file, and are read-only unless writable. offset, file_offset, and len must be multiples of
+        // page_size(), and the file must extend into the last page. Returns false if the caller must read the data instead
+
+        bool map_file( size_t offset, int fd, uint64_t file_offset, size_t len, bool shared = false, bool writable = true )
+        {
+#if defined( DJL_VMEM_MMAP )
+            if ( !mapped || fd < 0 || 0 == len || offset + len > cb )
+                return false;
+
+            size_t page = page_size();
+            if ( 0 != ( offset % page ) || 0 != ( file_offset % page ) || 0 != ( len % page ) )
+                return false;
+
+            struct stat st;
+            if ( 0 != fstat( fd, &st ) || (uint64_t) st.st_size + page - 1 < file_offset + len ) // pages past EOF would fault
+                return false;
+
+            int prot = ( shared && !writable ) ? PROT_READ : ( PROT_READ | PROT_WRITE );
+            void * p = mmap( pmem + offset, len, prot, ( shared ? MAP_SHARED : MAP_PRIVATE ) | MAP_FIXED, fd, (off_t) file_offset );
+            if ( MAP_FAILED != p )
+            {
+                forget_files( offset, offset + len );
+                FileMapping fm = { len, shared, !shared || writable };
+                files[ offset ] = fm;
+                return true;
+            }
+
+            // the range may have been unmapped by the failed call, so put back zero-filled pages
+            int err = errno;
+            mmap( pmem + offset, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0 );
+            forget_files( offset, offset + len );
+            errno = err;
+            return false;
+#else
+            return false;
+#endif
+        } //map_file
+
+        // true if any of the range is mapped from a file
+
+        bool is_file_mapped( size_t offset, size_t len )
+        {
+            return files_overlap( offset, offset + len );
+        } //is_file_mapped
+
+        // true if any of the range is a shared file mapping without write access, where stores would fault
+
+        bool is_read_only( size_t offset, size_t len )
+        {
+            std::map<size_t, FileMapping>::iterator it = first_file_ending_after( offset );
+            for ( ; it != files.end() && it->first < offset + len; it++ )
+                if ( !it->second.writable )
+                    return true;
+
+            return false;
+        } //is_read_only
+
+        // mprotect: shared file mappings in the range become writable or read-only. The rest of the buffer, including
+        // private file mappings, stays readable and writable. Returns false with errno set if the OS refuses, e.g.
+        // EACCES when the file was opened read-only
+
+        bool protect_files( size_t offset, size_t len, bool writable )
+        {
+#if defined( DJL_VMEM_MMAP )
+            if ( offset > cb || len > cb - offset )
+            {
+                errno = ENOMEM;
+                return false;
+            }
+
+            size_t page = page_size();
+            size_t start = offset & ~( page - 1 );
+            size_t end = ( offset + len + page - 1 ) & ~( page - 1 );
+            split_file( start );
+            split_file( end );
+
+            for ( std::map<size_t, FileMapping>::iterator it = files.lower_bound( start ); it != files.end() && it->first < end; it++ )
+            {
+                if ( !it->second.shared || it->second.writable == writable )
+                    continue;
+
+                if ( 0 != mprotect( pmem + it->first, it->second.length, writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ ) )
+                    return false;
+
+                it->second.writable = writable;
+            }
+#endif
+            return true;
+        } //protect_files
+
+        // msync: write changed pages of shared file mappings in the range back to their files. Private memory needs
+        // nothing. Returns false with errno set on failure
+
+        bool sync( size_t offset, size_t len, bool wait )
+        {
+#if defined( DJL_VMEM_MMAP )
+            if ( offset > cb || len > cb - offset )
+            {
+                errno = ENOMEM;
+                return false;
+            }
+
+            size_t page = page_size();
+            size_t start = offset & ~( page - 1 );
+            size_t end = offset + len;
+
+            for ( std::map<size_t, FileMapping>::iterator it = first_file_ending_after( start ); it != files.end() && it->first < end; it++ )
+            {
+                if ( !it->second.shared )
+                    continue;
+
+                size_t a = ( it->first > start ) ? it->first : start;
+                size_t past = ( ( it->first + it->second.length ) < end ) ? ( it->first + it->second.length ) : end;
+                if ( 0 != msync( pmem + a, past - a, wait ? MS_SYNC : MS_ASYNC ) )
+                    return false;
+            }
+#endif
+            return true;
+        } //sync
+
+        // Ask the OS to back the whole 2 MB pages in the range with transparent huge pages, so apps that touch a lot of
+        // RAM take fewer TLB misses. Each huge page is committed when it's first touched. Returns the bytes advised
+
+        size_t advise_huge_pages( size_t offset, size_t len )
+        {
+#if defined( __linux__ ) && defined( MADV_HUGEPAGE )
+            const uintptr_t huge = 2 * 1024 * 1024;
+            if ( !mapped || offset >= cb )
+                return 0;
+
+            if ( len > cb - offset )
+                len = cb - offset;
+
+            uintptr_t start = ( (uintptr_t) pmem + offset + huge - 1 ) & ~( huge - 1 );
+            uintptr_t end = ( (uintptr_t) pmem + offset + len ) & ~( huge - 1 );
+            if ( end <= start || 0 != madvise( (void *) start, end - start, MADV_HUGEPAGE ) )
+                return 0;
+
+            return end - start;
+#else
+            return 0;
+#endif
+        } //advise_huge_pages
+
+        // sum a "name: N kB" field of /proc/self/smaps across the mappings that overlap the buffer, in bytes
+
+        size_t smaps_bytes( const char * field ) const
+        {
+#if defined( __linux__ )
+            FILE * fp = fopen( "/proc/self/smaps", "r" );
+            if ( 0 == fp )
+                return 0;
+
+            unsigned long long start = (uintptr_t) pmem, end = (uintptr_t) pmem + cb;
+            unsigned long long low, high, kb;
+            bool inside = false;
+            size_t total = 0;
+            size_t field_len = strlen( field );
+            char line[ 256 ];
+
+            while ( fgets( line, sizeof( line ), fp ) )
+            {
+                if ( 2 == sscanf( line, "%llx-%llx ", &low, &high ) ) // the header line of a mapping
+                    inside = ( low < end && high > start );
+                else if ( inside && 0 == strncmp( line, field, field_len ) && ':' == line[ field_len ] &&
+                          1 == sscanf( line + field_len + 1, "%llu kB", &kb ) )
+                    total += (size_t) kb * 1024;
+            }
+
+            fclose( fp );
+            return total;
+#else
+            return 0;
+#endif
+        } //smaps_bytes
+
+        // bytes of the buffer currently backed by huge pages, or 0 if the OS can't tell
+
+        size_t huge_page_bytes() const
+        {
+            return smaps_bytes( "AnonHugePages" );
+        } //huge_page_bytes
+
+        // bytes of the buffer in pages the app has touched and are still resident, or 0 if the OS can't tell
+
+        size_t resident_bytes() const
+        {
+#if defined( __linux__ )
+            if ( !mapped )
+                return 0;
+
+            return smaps_bytes( "Rss" ); // mincore would take a while for sparse terabyte buffers
+#elif defined( DJL_VMEM_MMAP )
+            if ( !mapped )
+                return 0;
+
+            size_t page = page_size();
+            size_t pages = ( cb + page - 1 ) / page;
+            const size_t chunk = 4096; // pages checked per mincore call
+    #ifdef __APPLE__
+            std::vector<char> vec( chunk );
+    #else
+            std::vector<unsigned char> vec( chunk );
+    #endif
+            size_t resident = 0;
+
+            for ( size_t p = 0; p < pages; p += chunk )
+            {
+                size_t count = ( pages - p < chunk ) ? pages - p : chunk;
+                if ( 0 != mincore( pmem + p * page, count * page, vec.data() ) )
+                    return 0;
+
+                for ( size_t i = 0; i < count; i++ )
+                    if ( vec[ i ] & 1 )
+                        resident++;
+            }
+
+            return resident * page;
+#else
+            return 0;
+#endif
+        } //resident_bytes
+};
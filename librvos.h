@@ -0,0 +1,88 @@
+#pragma once
+
+// librvos: run RISC-V 64 Linux apps inside another app rather than in an rvos process.
+// Build librvos.a with mlib.sh (rvos.cxx and riscv.cxx with RVOS_LIBRARY defined, which leaves out main).
+//
+// Usage:
+//     rvos_vm * vm = rvos_create_vm( 1024 * 1024, 1024 * 1024, 128 * 1024 );
+//     rvos_set_args( vm, argc, argv );                  // optional; before rvos_load_elf
+//     rvos_set_env( vm, envc, envp );                   // optional; before rvos_load_elf
+//     rvos_load_elf( vm, image, image_len, "app" );     // a statically-linked elf already in host memory
+//     while ( rvos_budget_exhausted == rvos_run( vm, 1000000 ) )
+//         ;
+//     rvos_destroy_vm( vm );
+//
+// Each vm has its own memory, registers, heaps, and files, so different host threads can run different vms at once.
+// Calls for one vm must not overlap. Threads the guest creates with clone run on their own host threads until the vm
+// is destroyed. Errors that would make rvos print and exit (bad images, hard terminations) end just that vm.
+// That includes faults on the inaccessible guard pages around guest memory and below the stack: librvos installs
+// SIGSEGV and SIGBUS handlers for them and passes other faults to the handlers the host app had installed before.
+//
+// Some things belong to the host process and are shared with the host app and every vm:
+//   - the working directory. Relative paths resolve against it, and chdir fails with EPERM.
+//   - the file descriptor table. Files a vm opens are host descriptors, and 0, 1, and 2 are the host's.
+//   - the rvos.log tracer.
+// A vm can't fork or exec: fork, process clones, and execve fail with ENOSYS, so system() and posix_spawn fail.
+//
+// librvos_test.cxx (built and run by mlib.sh) is a small example of the API.
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct rvos_vm;
+
+enum rvos_status
+{
+    rvos_budget_exhausted = 0,   // the instruction budget ran out. call rvos_run again to continue
+    rvos_exited = 1,             // the app called exit or exit_group. rvos_exit_code has the result
+    rvos_error = 2,              // the image couldn't load or the app made a fatal error. see rvos_error_message
+};
+
+// Called for each system call before rvos emulates it. args are a0..a5. Return true if the call was handled and
+// *result should be returned to the app in a0 (a negative errno for failures), or false to let rvos emulate it.
+// Guest threads make calls on their own host threads, so hooks for apps that use threads must be thread-safe.
+
+typedef bool ( * rvos_syscall_hook )( void * context, uint64_t syscall_id, const uint64_t args[ 6 ], int64_t * result );
+
+// heap_bytes, mmap_bytes, and stack_bytes are the RAM for brk, mmap, and the stack. 0 uses the rvos defaults,
+// which on 64-bit Linux and macOS hosts are large reservations that only use RAM as the app touches it.
+rvos_vm * rvos_create_vm( uint64_t heap_bytes, uint64_t mmap_bytes, uint64_t stack_bytes );
+void rvos_destroy_vm( rvos_vm * vm );
+
+// the app's RLIMIT_AS hard limit: brk, mmap, and mremap fail with ENOMEM past it. 0 means no limit
+void rvos_set_memory_limit( rvos_vm * vm, uint64_t bytes );
+
+// argv[ 0 ] for the app is the name passed to rvos_load_elf. These are argv[ 1 ] onward
+bool rvos_set_args( rvos_vm * vm, int argc, const char * const * argv );
+
+// name=value strings. OS=RVOS is always set
+bool rvos_set_env( rvos_vm * vm, int envc, const char * const * envp );
+
+// copies the segments of an elf image into the vm, then sets up the stack, argv, and the environment for _start
+bool rvos_load_elf( rvos_vm * vm, const void * image, size_t image_len, const char * name );
+
+void rvos_set_syscall_hook( rvos_vm * vm, rvos_syscall_hook hook, void * context );
+
+// runs the app's main thread for about max_instructions (it stops at the end of a basic block). 0 means no limit
+rvos_status rvos_run( rvos_vm * vm, uint64_t max_instructions );
+
+uint64_t rvos_instructions( rvos_vm * vm );           // executed by the main thread across all rvos_run calls
+int rvos_exit_code( rvos_vm * vm );
+const char * rvos_error_message( rvos_vm * vm );      // "" if there is no error
+
+// registers of the main thread. x0..x31 are 0..31, f0..f31 are the raw bits of the floating point registers
+uint64_t rvos_get_reg( rvos_vm * vm, size_t reg );
+void rvos_set_reg( rvos_vm * vm, size_t reg, uint64_t value );
+uint64_t rvos_get_freg( rvos_vm * vm, size_t reg );
+void rvos_set_freg( rvos_vm * vm, size_t reg, uint64_t value );
+uint64_t rvos_get_pc( rvos_vm * vm );
+void rvos_set_pc( rvos_vm * vm, uint64_t pc );
+
+// host pointer to len bytes of guest memory at address, or 0 if any of the range is outside the vm or in the
+// stack's guard page. rvos_write_memory also fails for files the app mapped shared without PROT_WRITE; writes through
+// rvos_memory's pointer to those pages fault in the host.
+// The pointer is good until the vm is destroyed. Call rvos_code_written after changing code the app may have run
+void * rvos_memory( rvos_vm * vm, uint64_t address, size_t len );
+bool rvos_read_memory( rvos_vm * vm, uint64_t address, void * buffer, size_t len );
+bool rvos_write_memory( rvos_vm * vm, uint64_t address, const void * buffer, size_t len );
+void rvos_code_written( rvos_vm * vm );
@@ -0,0 +1,246 @@
+// smoke test and example for librvos. mlib.sh builds and runs it after building librvos.a.
+// It builds tiny elf images in memory, runs one a budget at a time, handles one system call with a hook,
+// and checks that a vm can't change the host's working directory and that a stack overflow ends just its vm,
+// as does a bad pointer passed to a system call while another guest thread is making system calls.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <librvos.h>
+
+using namespace std;
+
+static const uint64_t hooked_syscall = 500;    // not a Linux system call, so only the hook knows it
+static const uint64_t load_address = 0x10000;
+static const size_t code_offset = 0x80;        // after the 64-byte elf header and one 56-byte program header
+
+// rv64i instruction encodings
+
+static uint32_t i_type( int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode )
+{
+    return ( (uint32_t) ( imm & 0xfff ) << 20 ) | ( rs1 << 15 ) | ( funct3 << 12 ) | ( rd << 7 ) | opcode;
+} //i_type
+
+static uint32_t addi( uint32_t rd, uint32_t rs1, int32_t imm ) { return i_type( imm, rs1, 0, rd, 0x13 ); }
+static uint32_t add( uint32_t rd, uint32_t rs1, uint32_t rs2 ) { return ( rs2 << 20 ) | ( rs1 << 15 ) | ( rd << 7 ) | 0x33; }
+static uint32_t auipc( uint32_t rd ) { return ( rd << 7 ) | 0x17; }
+static uint32_t lui( uint32_t rd, uint32_t imm20 ) { return ( imm20 << 12 ) | ( rd << 7 ) | 0x37; }
+static uint32_t ecall() { return 0x73; }
+
+static uint32_t sd( uint32_t rs2, uint32_t rs1, int32_t imm )
+{
+    uint32_t o = (uint32_t) imm;
+    return ( ( ( o >> 5 ) & 0x7f ) << 25 ) | ( rs2 << 20 ) | ( rs1 << 15 ) | ( 3 << 12 ) | ( ( o & 0x1f ) << 7 ) | 0x23;
+} //sd
+
+static uint32_t bne( uint32_t rs1, uint32_t rs2, int32_t offset )
+{
+    uint32_t o = (uint32_t) offset;
+    return ( ( ( o >> 12 ) & 1 ) << 31 ) | ( ( ( o >> 5 ) & 0x3f ) << 25 ) | ( rs2 << 20 ) | ( rs1 << 15 ) | ( 1 << 12 ) |
+           ( ( ( o >> 1 ) & 0xf ) << 8 ) | ( ( ( o >> 11 ) & 1 ) << 7 ) | 0x63;
+} //bne
+
+enum { zero = 0, sp = 2, t0 = 5, t1 = 6, s0 = 8, a0 = 10, a1 = 11, a2 = 12, a3 = 13, a4 = 14, a7 = 17 };
+
+// a static rv64 elf with one loadable segment holding the headers, code, and data
+
+static vector<uint8_t> build_image( const vector<uint32_t> & code, const void * data, size_t data_len )
+{
+    size_t code_bytes = code.size() * sizeof( uint32_t );
+    vector<uint8_t> image( code_offset + code_bytes + data_len, 0 );
+    memcpy( image.data() + code_offset, code.data(), code_bytes );
+    memcpy( image.data() + code_offset + code_bytes, data, data_len );
+
+    uint8_t * h = image.data();
+    const uint8_t ident[] = { 0x7f, 'E', 'L', 'F', 2, 1, 1 };  // 64-bit, little endian, version 1
+    memcpy( h, ident, sizeof( ident ) );
+    uint16_t type = 2, machine = 0xf3, header_size = 64, ph_size = 56, ph_count = 1;
+    uint32_t version = 1;
+    uint64_t entry = load_address + code_offset, ph_offset = 64;
+    memcpy( h + 16, &type, 2 );
+    memcpy( h + 18, &machine, 2 );
+    memcpy( h + 20, &version, 4 );
+    memcpy( h + 24, &entry, 8 );
+    memcpy( h + 32, &ph_offset, 8 );
+    memcpy( h + 52, &header_size, 2 );
+    memcpy( h + 54, &ph_size, 2 );
+    memcpy( h + 56, &ph_count, 2 );
+
+    uint8_t * ph = h + ph_offset;
+    uint32_t ph_type = 1, ph_flags = 7; // PT_LOAD, rwx
+    uint64_t offset = 0, size = image.size(), alignment = 0x1000;
+    memcpy( ph, &ph_type, 4 );
+    memcpy( ph + 4, &ph_flags, 4 );
+    memcpy( ph + 8, &offset, 8 );
+    memcpy( ph + 16, &load_address, 8 );      // virtual address
+    memcpy( ph + 24, &load_address, 8 );      // physical address
+    memcpy( ph + 32, &size, 8 );              // file size
+    memcpy( ph + 40, &size, 8 );              // memory size
+    memcpy( ph + 48, &alignment, 8 );
+    return image;
+} //build_image
+
+static vector<uint8_t> build_smoke_image()
+{
+    vector<uint32_t> code;
+    code.push_back( addi( a0, zero, 1 ) );                 // hooked_syscall( 1, 2, 3 ) returns 123
+    code.push_back( addi( a1, zero, 2 ) );
+    code.push_back( addi( a2, zero, 3 ) );
+    code.push_back( addi( a7, zero, (int32_t) hooked_syscall ) );
+    code.push_back( ecall() );
+    code.push_back( addi( s0, a0, 0 ) );
+    size_t auipc_index = code.size();
+    code.push_back( auipc( a0 ) );                         // chdir( "/" ) fails with -EPERM == -1
+    code.push_back( 0 );                                   // addi a0, a0, offset of the string. filled in below
+    code.push_back( addi( a7, zero, 49 ) );
+    code.push_back( ecall() );
+    code.push_back( add( s0, s0, a0 ) );
+    code.push_back( addi( t0, zero, 1000 ) );              // a loop so the app takes a few budgets
+    code.push_back( addi( t0, t0, -1 ) );
+    code.push_back( bne( t0, zero, -4 ) );
+    code.push_back( addi( a0, s0, -80 ) );                 // exit( 123 - 1 - 80 ) == exit( 42 )
+    code.push_back( addi( a7, zero, 93 ) );
+    code.push_back( ecall() );
+    code[ auipc_index + 1 ] = addi( a0, a0, (int32_t) ( ( code.size() - auipc_index ) * 4 ) );
+
+    const char root[] = "/";
+    return build_image( code, root, sizeof( root ) );
+} //build_smoke_image
+
+static vector<uint8_t> build_overflow_image()
+{
+    vector<uint32_t> code;
+    code.push_back( addi( sp, sp, -2048 ) );               // push until the stack runs into its guard page
+    code.push_back( sd( zero, sp, 0 ) );
+    code.push_back( bne( sp, zero, -8 ) );
+    return build_image( code, "", 0 );
+} //build_overflow_image
+
+static vector<uint8_t> build_threaded_fault_image()
+{
+    vector<uint32_t> code;
+    size_t auipc_index = code.size();
+    code.push_back( auipc( a1 ) );                         // the child's stack is the data after the code
+    code.push_back( lui( t1, 1 ) );
+    code.push_back( add( a1, a1, t1 ) );
+    code.push_back( 0 );                                   // addi a1, a1, offset of the data. filled in below
+    code.push_back( lui( a0, 0x51 ) );                     // clone( CLONE_VM | FS | FILES | SIGHAND | THREAD | SYSVSEM )
+    code.push_back( addi( a0, a0, -0x100 ) );
+    code.push_back( addi( a2, zero, 0 ) );
+    code.push_back( addi( a3, zero, 0 ) );
+    code.push_back( addi( a4, zero, 0 ) );
+    code.push_back( addi( a7, zero, 220 ) );
+    code.push_back( ecall() );
+    code.push_back( bne( a0, zero, 16 ) );
+    code.push_back( addi( a7, zero, 172 ) );               // the child calls getpid forever. See slow_getpid_hook
+    code.push_back( ecall() );
+    code.push_back( bne( a7, zero, -4 ) );
+    code.push_back( lui( t0, 0x100 ) );                    // the parent gives the child time to start
+    code.push_back( addi( t0, t0, -1 ) );
+    code.push_back( bne( t0, zero, -4 ) );
+    code.push_back( addi( a0, zero, 0 ) );                 // clock_gettime( CLOCK_REALTIME, NULL ) writes to address 0
+    code.push_back( addi( a1, zero, 0 ) );
+    code.push_back( addi( a7, zero, 113 ) );
+    code.push_back( ecall() );
+    code.push_back( addi( a7, zero, 93 ) );                // not reached
+    code.push_back( ecall() );
+    code[ auipc_index + 3 ] = addi( a1, a1, (int32_t) ( ( code.size() - auipc_index ) * 4 ) );
+
+    static const uint8_t stack[ 4096 ] = {};
+    return build_image( code, stack, sizeof( stack ) );
+} //build_threaded_fault_image
+
+static bool hook( void * context, uint64_t syscall_id, const uint64_t args[ 6 ], int64_t * result )
+{
+    if ( hooked_syscall != syscall_id )
+        return false;
+
+    ( * (int *) context )++;
+    *result = (int64_t) ( args[ 0 ] * 100 + args[ 1 ] * 10 + args[ 2 ] );
+    return true;
+} //hook
+
+// holds the child thread's first getpid until the main thread has faulted, so it then needs svc_mutex
+
+static bool slow_getpid_hook( void * context, uint64_t syscall_id, const uint64_t args[ 6 ], int64_t * result )
+{
+    if ( 172 == syscall_id && 0 == ( * (int *) context )++ )
+        this_thread::sleep_for( chrono::milliseconds( 200 ) );
+    return false;
+} //slow_getpid_hook
+
+int main()
+{
+    vector<uint8_t> image = build_smoke_image();
+    int hook_calls = 0;
+    int failures = 0;
+
+    rvos_vm * vm = rvos_create_vm( 0, 0, 0 );
+    rvos_set_syscall_hook( vm, hook, &hook_calls );
+    if ( !rvos_load_elf( vm, image.data(), image.size(), "smoke" ) )
+    {
+        printf( "rvos_load_elf failed: %s\n", rvos_error_message( vm ) );
+        return 1;
+    }
+
+    int budgets = 0;
+    rvos_status status;
+    while ( rvos_budget_exhausted == ( status = rvos_run( vm, 500 ) ) )
+        budgets++;
+
+    printf( "status %d, exit code %d, hook calls %d, budgets %d, instructions %llu\n", status, rvos_exit_code( vm ),
+            hook_calls, budgets, (unsigned long long) rvos_instructions( vm ) );
+
+    if ( rvos_exited != status || 42 != rvos_exit_code( vm ) || 1 != hook_calls || budgets < 2 )
+        failures++;
+
+    char code[ 4 ];
+    if ( !rvos_read_memory( vm, load_address, code, sizeof( code ) ) || memcmp( code, "\x7f" "ELF", 4 ) )
+        failures++;
+    rvos_destroy_vm( vm );
+
+    // bad images end just the vm
+
+    vm = rvos_create_vm( 0, 0, 0 );
+    if ( rvos_load_elf( vm, "junk", 4, "junk" ) || 0 == rvos_error_message( vm )[ 0 ] )
+        failures++;
+    rvos_destroy_vm( vm );
+
+    // so does a stack overflow, and the host can't read the guard page the app ran into
+
+    image = build_overflow_image();
+    vm = rvos_create_vm( 0, 0, 64 * 1024 );
+    if ( !rvos_load_elf( vm, image.data(), image.size(), "overflow" ) )
+        failures++;
+    else
+    {
+        status = rvos_run( vm, 0 );
+        printf( "overflow status %d: %s\n", status, rvos_error_message( vm ) );
+        if ( rvos_error != status || !strstr( rvos_error_message( vm ), "guard page" ) ||
+             0 != rvos_memory( vm, rvos_get_reg( vm, sp ), 8 ) )
+            failures++;
+    }
+    rvos_destroy_vm( vm );
+
+    // a fault in a system call ends the vm without leaving its locks held, so the other thread and the destroy finish
+
+    image = build_threaded_fault_image();
+    vm = rvos_create_vm( 0, 0, 0 );
+    int getpid_calls = 0;
+    rvos_set_syscall_hook( vm, slow_getpid_hook, &getpid_calls );
+    if ( !rvos_load_elf( vm, image.data(), image.size(), "threaded fault" ) )
+        failures++;
+    else
+    {
+        status = rvos_run( vm, 0 );
+        printf( "threaded fault status %d: %s\n", status, rvos_error_message( vm ) );
+        if ( rvos_error != status )
+            failures++;
+    }
+    rvos_destroy_vm( vm );
+
+    printf( "librvos smoke test %s\n", failures ? "failed" : "passed" );
+    return failures ? 1 : 0;
+} //main
@@ -114,7 +114,9 @@
 #define SYS_clone 220
 #define SYS_mmap 222
 #define SYS_mprotect 226
+#define SYS_msync 227
 #define SYS_madvise 233
+#define SYS_riscv_hwprobe 258 // riscv only
 #define SYS_riscv_flush_icache 259 // not in docs; may be riscv only
 #define SYS_wait4 260
 #define SYS_prlimit64 261
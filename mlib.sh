@@ -0,0 +1,9 @@
+# builds librvos.a for apps that run RISC-V guests in-process. See librvos.h
+# release flags like mr.sh: no debug checks, the JIT on, and guard pages catch stack overflows
+g++ -DRVOS -DRVOS_LIBRARY -O3 -D NDEBUG -fno-builtin -I . -c rvos.cxx -o librvos_rvos.o
+g++ -DRVOS -DRVOS_LIBRARY -O3 -D NDEBUG -fno-builtin -I . -c riscv.cxx -o librvos_riscv.o
+ar rcs librvos.a librvos_rvos.o librvos_riscv.o
+
+# build and run the smoke test, which is also an example of the API
+g++ -O3 -D NDEBUG -I . librvos_test.cxx librvos.a -o librvos_test -lpthread
+./librvos_test
@@ -2,6 +2,7 @@
     This is a simplistic 64-bit RISC-V emulator.
     Only physical memory is supported.
     The core set of instructions "rv64imadfc" are implemented: integer, multiply/divide, atomic, double, float, compressed
+    Also the V vector extension and the Zba, Zbb, Zbs, and Zicond bit-manipulation extensions.
     I tested with a variety of Rust, C, and C++ apps compiled with four different versions of g++ (each exposed different bugs)
     I also tested with the BASIC test suite for my compiler BA, which targets risc-v.
     It's slightly faster than the 400Mhz K210 processor on my AMD 5950x machine.
@@ -25,6 +26,7 @@
 #include <assert.h>
 #include <math.h>
 #include <chrono>
+#include <type_traits>
 
 #include <djl_128.hxx>
 #include <djltrace.hxx>
@@ -43,10 +45,63 @@ using namespace std::chrono;
 
 #define USE_RVCTABLE 1
 
+// set to 1 to dispatch each instruction's handler with a computed goto at the end of the prior handler.
+// This gives the host's branch predictor one indirect jump per handler instead of one shared jump.
+// MSVC doesn't support labels as values, so it always uses a switch statement.
+
+#ifndef USE_THREADED_DISPATCH
+    #if defined( __GNUC__ ) || defined( __clang__ )
+        #define USE_THREADED_DISPATCH 1
+    #else
+        #define USE_THREADED_DISPATCH 0
+    #endif
+#endif
+
+// set to 1 to translate hot basic blocks to x86-64 code. Only on Linux x86-64 release builds;
+// debug builds interpret everything so memory references are checked.
+
+#ifndef USE_JIT
+    #if defined( __x86_64__ ) && defined( __linux__ ) && defined( NDEBUG )
+        #define USE_JIT 1
+    #else
+        #define USE_JIT 0
+    #endif
+#endif
+
+// set to 1 to save decoded blocks and their translations to a file at app exit so later runs of the same
+// executable start warm. The file is memory-mapped when loaded, so this requires mmap.
+
+#ifndef USE_TRANSLATION_CACHE
+    #if defined( __linux__ ) || defined( __APPLE__ )
+        #define USE_TRANSLATION_CACHE 1
+    #else
+        #define USE_TRANSLATION_CACHE 0
+    #endif
+#endif
+
+#if USE_JIT || USE_TRANSLATION_CACHE
+    #include <sys/mman.h>
+#endif
+
+#if USE_TRANSLATION_CACHE
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+#endif
+
 static const uint64_t g_ui64_NAN = 0x7ff8000000000000;
 
 #define MY_NAN ( * (double *) & g_ui64_NAN )
 
+// MY_NAN's pointer cast breaks strict aliasing, which g++ warns about for each instantiation of the templates using it
+
+template < typename F > static inline F canonical_nan()
+{
+    double d;
+    memcpy( &d, &g_ui64_NAN, sizeof( d ) );
+    return (F) d;
+} //canonical_nan
+
 // these instruction types are mostly just useful for debugging
 
 const uint8_t IllType = 0;
@@ -66,22 +121,25 @@ static const char instruction_types[] =
     '!', 'U', 'J', 'I', 'B', 'S', 'R', 'C', 'r', 's', 'c',
 };
 
-static uint32_t g_State = 0;
+// each hart checks its state at the start of every block. Other threads set bits to stop a hart or flush its blocks.
 
 const uint32_t stateTraceInstructions = 1;
 const uint32_t stateEndEmulation = 2;
+const uint32_t stateFlushInstructionCache = 4;
 
 bool RiscV::trace_instructions( bool t )
 {
-    bool prev = ( 0 != ( g_State & stateTraceInstructions ) );
+    bool prev = ( 0 != ( state & stateTraceInstructions ) );
     if ( t )
-        g_State |= stateTraceInstructions;
+        state |= stateTraceInstructions;
     else
-        g_State &= ~stateTraceInstructions;
+        state &= ~stateTraceInstructions;
     return prev;
 } //trace_instructions
 
-void RiscV::end_emulation() { g_State |= stateEndEmulation; }
+bool RiscV::tracing_instructions() { return ( 0 != ( state & stateTraceInstructions ) ); }
+void RiscV::end_emulation() { state |= stateEndEmulation; }
+void RiscV::request_flush_instruction_cache() { state |= stateFlushInstructionCache; }
 
 // for the 32 opcode_types ( ( opcode >> 2 ) & 0x1f )
 
@@ -173,7 +231,7 @@ double round_double_from_double( double d, uint64_t rm )
         return d;
 
     if ( rm_RNE == rm )
-        return round( d );
+        return rint( d ); // the host rounds to nearest, ties to even. round() ties away from zero
     if ( rm_RTZ == rm )
         return trunc( d );
     if ( rm_RDN == rm )
@@ -190,8 +248,8 @@ template <typename T> T round_int_from_double( double d, uint64_t rm ) // works
 
     d = round_double_from_double( d, rm );
 
-    if ( isnan( d ) || isinf( d ) )
-        return std::numeric_limits<T>::max();
+    if ( isnan( d ) )
+        return std::numeric_limits<T>::max(); // infinities saturate below like other out of range values
 
     if ( d > (double) std::numeric_limits<T>::max() )
         return std::numeric_limits<T>::max();
@@ -250,7 +308,7 @@ static bool g_failOnUncompressError = true;
 
     #include "rvctable.txt"
     
-    uint32_t RiscV::uncompress_rvc( uint16_t x )
+    uint32_t RiscV::uncompress_rvc( uint16_t x, bool trace )
     {
         uint32_t op32 = rvc_lookup[ x ];
         if ( 0 == op32 )
@@ -315,7 +373,7 @@ static uint32_t compose_B( uint32_t funct3, uint32_t rs1, uint32_t rs2, uint32_t
     return ( funct3 << 12 ) | ( rs1 << 15 ) | ( rs2 << 20 ) | offset | ( opcode_type << 2 ) | 3;
 } //compose_B
 
-uint32_t RiscV::uncompress_rvc( uint16_t x )
+uint32_t RiscV::uncompress_rvc( uint16_t x, bool trace )
 {
     uint32_t op32 = 0;
     uint16_t op2 = x & 3;
@@ -323,7 +381,7 @@ uint32_t RiscV::uncompress_rvc( uint16_t x )
     uint16_t p_funct3 = ( x >> 13 ) & 0x7;   // p_ for prime -- the compressed version
     uint16_t bit12 = ( x >> 12 ) & 1;
 
-    if ( g_State & stateTraceInstructions )
+    if ( trace )
         tracer.Trace( "rvc op %04x op2 %d funct3 %d bit12 %d\n", x, op2, p_funct3, bit12 );
 
     /*
@@ -801,6 +859,12 @@ double do_fmax( double a, double b )
 #pragma GCC diagnostic ignored "-Wformat="
 #endif
 
+void RiscV::trace_vector( const char * kind )
+{
+    tracer.Trace( "%s funct3 %llx, funct6 %llx, vd %llu, rs1 %llu, vs2 %llu, vm %llu  # vl %llu, vtype %llx\n", kind, ( op >> 12 ) & 7,
+                  op >> 26, ( op >> 7 ) & 0x1f, ( op >> 15 ) & 0x1f, ( op >> 20 ) & 0x1f, ( op >> 25 ) & 1, vl, vtype );
+} //trace_vector
+
 void RiscV::trace_state()
 {
     uint8_t optype = riscv_types[ opcode_type ];
@@ -832,11 +896,17 @@ void RiscV::trace_state()
 
     tracer.Trace( "pc %8llx %s%s op %8llx %sra:%llx sp:%llx => ", pc, symbol_name, symbol_offset, op, reg_string, regs[ ra ], regs[ sp ] );
 
+    if ( trace_bitmanip() )
+        return;
+
     switch ( optype )
     {
         case IllType:
         {
-            tracer.Trace( "illegal optype!\n" );
+            if ( 0x15 == opcode_type )
+                trace_vector( "vector" );
+            else
+                tracer.Trace( "illegal optype!\n" );
             break;
         }
         case UType:
@@ -878,6 +948,8 @@ void RiscV::trace_state()
                     tracer.Trace( "flw %s, %lld(%s)  # %.2f\n", freg_name( rd ), i_imm, reg_name( rs1 ), getfloat( i_imm + regs[ rs1 ] ) );
                 else if ( 3 == funct3 )
                     tracer.Trace( "fld %s, %lld(%s)  # %.2lf\n", freg_name( rd ), i_imm, reg_name( rs1 ), getdouble( i_imm + regs[ rs1 ] ) );
+                else
+                    trace_vector( "vector load" );
             }
             else if ( 3 == opcode_type )
             {
@@ -1002,6 +1074,8 @@ void RiscV::trace_state()
                         tracer.Trace( "csrrs %s, mie, %s  # machine interrupt-enable\n", reg_name( rd ), reg_name( rs1 ) );
                     else if ( 0x305 == csr )
                         tracer.Trace( "csrrs %s, mtvec, %s  # machine trap-handler base addess\n", reg_name( rd ), reg_name( rs1 ) );
+                    else if ( 0x301 == csr )
+                        tracer.Trace( "csrrs %s, misa, %s  # machine isa\n", reg_name( rd ), reg_name( rs1 ) );
                     else if ( 0x306 == csr )
                         tracer.Trace( "csrrs %s, mcounteren, %s  # machine counter enable\n", reg_name( rd ), reg_name( rs1 ) );
                     else if ( 0x340 == csr )
@@ -1066,6 +1140,8 @@ void RiscV::trace_state()
                     tracer.Trace( "fsw %s, %lld(%s)  # %.2f\n", freg_name( rs2 ), s_imm, reg_name( rs1 ), fregs[ rs2 ].f );
                 else if ( 3 == funct3 )
                     tracer.Trace( "fsd %s, %lld(%s), # %.2lf\n", freg_name( rs2 ), s_imm, reg_name( rs1 ), fregs[ rs2 ].d );
+                else
+                    trace_vector( "vector store" );
             }
             break;
         }
@@ -1622,1328 +1698,3903 @@ void RiscV::unhandled()
     emulator_hard_termination( *this, "opcode not handled:", op );
 } //unhandled
 
-uint64_t RiscV::run()
+// Zbb's counting and byte-reversal instructions map to single host instructions via compiler intrinsics
+
+#if defined( _MSC_VER ) && !defined( __clang__ )
+
+#include <intrin.h>
+
+static inline uint64_t bit_clz( uint64_t x ) { unsigned long i; return _BitScanReverse64( &i, x ) ? ( 63 - i ) : 64; }
+static inline uint64_t bit_ctz( uint64_t x ) { unsigned long i; return _BitScanForward64( &i, x ) ? i : 64; }
+static inline uint64_t bit_bswap( uint64_t x ) { return _byteswap_uint64( x ); }
+#if defined( _M_ARM64 )
+static inline uint64_t bit_cpop( uint64_t x ) { return _CountOneBits64( x ); }
+#else
+static inline uint64_t bit_cpop( uint64_t x ) { return __popcnt64( x ); }
+#endif
+
+#else
+
+static inline uint64_t bit_clz( uint64_t x ) { return ( 0 == x ) ? 64 : __builtin_clzll( x ); }
+static inline uint64_t bit_ctz( uint64_t x ) { return ( 0 == x ) ? 64 : __builtin_ctzll( x ); }
+static inline uint64_t bit_cpop( uint64_t x ) { return __builtin_popcountll( x ); }
+static inline uint64_t bit_bswap( uint64_t x ) { return __builtin_bswap64( x ); }
+
+#endif
+
+static inline uint64_t bit_rol( uint64_t x, uint64_t n ) { n &= 63; return ( 0 == n ) ? x : ( ( x << n ) | ( x >> ( 64 - n ) ) ); }
+static inline uint64_t bit_ror( uint64_t x, uint64_t n ) { n &= 63; return ( 0 == n ) ? x : ( ( x >> n ) | ( x << ( 64 - n ) ) ); }
+static inline uint32_t bit_rolw( uint32_t x, uint64_t n ) { n &= 31; return ( 0 == n ) ? x : ( ( x << n ) | ( x >> ( 32 - n ) ) ); }
+static inline uint32_t bit_rorw( uint32_t x, uint64_t n ) { n &= 31; return ( 0 == n ) ? x : ( ( x >> n ) | ( x << ( 32 - n ) ) ); }
+
+static inline uint64_t bit_orc_b( uint64_t x )
 {
-    uint64_t cycles = 0;
+    // each byte becomes 0xff if any of its bits are set: set each byte's high bit if the byte is non-zero, then spread it
 
-    for ( ;; )
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7f;
+    uint64_t high = ( ( ( x & low7 ) + low7 ) | x ) & ~low7;
+    return ( high >> 7 ) * 0xff;
+} //bit_orc_b
+
+// AMOs and LR/SC act on guest memory with host atomics because other harts may be running on other host threads.
+// std::atomic<T> has the same size and representation as T here, so it's overlaid on memory like C++20's atomic_ref.
+
+static_assert( sizeof( std::atomic<uint32_t> ) == sizeof( uint32_t ) && sizeof( std::atomic<uint64_t> ) == sizeof( uint64_t ), "atomics must overlay memory" );
+
+template <typename T> static inline std::atomic<T> & atomic_at( void * p ) { return * (std::atomic<T> *) p; }
+
+static inline std::memory_order amo_order( uint64_t funct7 ) // aq is bit 1 and rl is bit 0. both is sequentially consistent
+{
+    static const std::memory_order orders[ 4 ] = { std::memory_order_relaxed, std::memory_order_release, std::memory_order_acquire, std::memory_order_seq_cst };
+    return orders[ funct7 & 3 ];
+} //amo_order
+
+static inline std::memory_order lr_order( uint64_t funct7 ) // a load can't be a C++ release, so rl alone or with aq is sequentially consistent
+{
+    static const std::memory_order orders[ 4 ] = { std::memory_order_relaxed, std::memory_order_seq_cst, std::memory_order_acquire, std::memory_order_seq_cst };
+    return orders[ funct7 & 3 ];
+} //lr_order
+
+#ifdef TARGET_BIG_ENDIAN
+static inline uint32_t guest_bytes( uint32_t x ) { return flip_endian32( x ); } // memory is little-endian
+static inline uint64_t guest_bytes( uint64_t x ) { return flip_endian64( x ); }
+#else
+static inline uint32_t guest_bytes( uint32_t x ) { return x; }
+static inline uint64_t guest_bytes( uint64_t x ) { return x; }
+#endif
+
+template <typename T, typename F> static inline T amo_update( void * p, std::memory_order mo, F f ) // returns the prior value
+{
+    std::atomic<T> & a = atomic_at<T>( p );
+    T old = a.load( std::memory_order_relaxed );
+    while ( !a.compare_exchange_weak( old, guest_bytes( (T) f( guest_bytes( old ) ) ), mo, std::memory_order_relaxed ) )
+        continue;
+    return guest_bytes( old );
+} //amo_update
+
+#ifdef TARGET_BIG_ENDIAN
+template <typename T> static inline T amo_add( void * p, T v, std::memory_order mo ) { return amo_update<T>( p, mo, [v]( T x ) { return x + v; } ); }
+template <typename T> static inline T amo_swap( void * p, T v, std::memory_order mo ) { return amo_update<T>( p, mo, [v]( T x ) { return v; } ); }
+template <typename T> static inline T amo_xor( void * p, T v, std::memory_order mo ) { return amo_update<T>( p, mo, [v]( T x ) { return x ^ v; } ); }
+template <typename T> static inline T amo_or( void * p, T v, std::memory_order mo ) { return amo_update<T>( p, mo, [v]( T x ) { return x | v; } ); }
+template <typename T> static inline T amo_and( void * p, T v, std::memory_order mo ) { return amo_update<T>( p, mo, [v]( T x ) { return x & v; } ); }
+#else
+template <typename T> static inline T amo_add( void * p, T v, std::memory_order mo ) { return atomic_at<T>( p ).fetch_add( v, mo ); }
+template <typename T> static inline T amo_swap( void * p, T v, std::memory_order mo ) { return atomic_at<T>( p ).exchange( v, mo ); }
+template <typename T> static inline T amo_xor( void * p, T v, std::memory_order mo ) { return atomic_at<T>( p ).fetch_xor( v, mo ); }
+template <typename T> static inline T amo_or( void * p, T v, std::memory_order mo ) { return atomic_at<T>( p ).fetch_or( v, mo ); }
+template <typename T> static inline T amo_and( void * p, T v, std::memory_order mo ) { return atomic_at<T>( p ).fetch_and( v, mo ); }
+#endif
+
+// LR/SC reservations. Each 64-byte line of host memory hashes to a version that sc and the AMOs advance when they
+// write. sc succeeds only if it can advance the version lr saw and memory still holds the value lr loaded. A plain store
+// that writes back the value lr loaded isn't detected; that's the usual ABA limit of reservations in software.
+
+const size_t reservation_lines = 4096;
+static std::atomic<uint64_t> g_line_versions[ reservation_lines ];
+
+static inline std::atomic<uint64_t> & line_version( const void * p ) // host addresses, so separate vms don't collide
+{
+    return g_line_versions[ ( (uintptr_t) p >> 6 ) & ( reservation_lines - 1 ) ];
+} //line_version
+
+// handlers for instructions decoded and cached by predecode(). The uncommon instructions are h_general and
+// are executed by execute_general(). Some handlers are contiguous in funct3 or rs2 order so predecode can compute them.
+// h_general and the handlers from h_beq on end basic blocks. h_block_end isn't an instruction; it continues
+// to the next block when a block reaches max_block_length or the end of memory without a branch.
+
+enum riscv_handler : uint8_t
+{
+    h_general, h_nop,
+    h_lb, h_lh, h_lw, h_ld, h_lbu, h_lhu, h_lwu,                                           // funct3 order
+    h_flw, h_fld,
+    h_addi, h_slli, h_slti, h_sltiu, h_xori, h_srli, h_ori, h_andi, h_srai,                // funct3 order, then srai
+    h_auipc, h_lui,
+    h_addiw, h_slliw, h_srliw, h_sraiw,
+    h_sb, h_sh, h_sw, h_sd,                                                                // funct3 order
+    h_fsw, h_fsd,
+    h_add, h_sll, h_slt, h_sltu, h_xor, h_srl, h_or, h_and,                                // funct3 order
+    h_mul, h_mulh, h_mulhsu, h_mulhu, h_div, h_divu, h_rem, h_remu,                        // funct3 order
+    h_sub, h_sra,
+    h_addw, h_sllw, h_srlw, h_subw, h_sraw,
+    h_mulw, h_divw, h_divuw, h_remw, h_remuw,
+    h_fmadd_s, h_fmadd_d, h_fmsub_s, h_fmsub_d, h_fnmsub_s, h_fnmsub_d, h_fnmadd_s, h_fnmadd_d, // opcode_type then fmt order
+    h_fadd_s, h_fadd_d, h_fsub_s, h_fsub_d, h_fmul_s, h_fmul_d, h_fdiv_s, h_fdiv_d,        // funct7 order
+    h_fsgnj_s, h_fsgnjn_s, h_fsgnjx_s, h_fsgnj_d, h_fsgnjn_d, h_fsgnjx_d,                  // funct3 order
+    h_fmin_s, h_fmax_s, h_fmin_d, h_fmax_d,                                                // funct3 order
+    h_fcvt_s_d, h_fcvt_d_s, h_fsqrt_s, h_fsqrt_d,
+    h_fle_s, h_flt_s, h_feq_s, h_fle_d, h_flt_d, h_feq_d,                                  // funct3 order
+    h_fcvt_w_s, h_fcvt_wu_s, h_fcvt_l_s, h_fcvt_lu_s, h_fcvt_w_d, h_fcvt_wu_d, h_fcvt_l_d, h_fcvt_lu_d, // rs2 order
+    h_fcvt_s_w, h_fcvt_s_wu, h_fcvt_s_l, h_fcvt_s_lu, h_fcvt_d_w, h_fcvt_d_wu, h_fcvt_d_l, h_fcvt_d_lu, // rs2 order
+    h_fmv_x_w, h_fmv_x_d, h_fmv_w_x, h_fmv_d_x,
+    h_sh1add, h_sh2add, h_sh3add, h_add_uw, h_sh1add_uw, h_sh2add_uw, h_sh3add_uw,         // Zba, Zbb, Zbs, and Zicond. rd, rs1, rs2
+    h_andn, h_orn, h_xnor, h_min, h_minu, h_max, h_maxu, h_rol, h_ror, h_rolw, h_rorw,
+    h_bclr, h_bset, h_binv, h_bext, h_czero_eqz, h_czero_nez,
+    h_clz, h_ctz, h_cpop, h_clzw, h_ctzw, h_cpopw, h_sext_b, h_sext_h, h_zext_h, h_rev8, h_orc_b, // rd, rs1
+    h_slli_uw, h_rori, h_roriw, h_bclri, h_bseti, h_binvi, h_bexti,                        // rd, rs1, imm
+    h_vector,                                                                              // all of RVV, in execute_vector()
+    h_beq, h_bne, h_blt, h_bge, h_bltu, h_bgeu,                                            // funct3 order, skipping 2 and 3
+    h_jalr, h_jal, h_block_end,
+    h_lui_addi, h_lui_addiw, h_auipc_jalr, h_auipc_ld, h_slli_srli,                       // fused pairs of instructions
+    h_slt_branch, h_sltu_branch, h_slti_branch, h_sltiu_branch,
+    h_count,
+};
+
+// forms of fused instructions counted in fused_counts
+
+enum riscv_fused_form { fused_lui_addi, fused_auipc_jalr, fused_auipc_ld, fused_slli_srli, fused_compare_branch };
+
+static const char * fused_form_names[] = { "lui+addi", "auipc+jalr", "auipc+ld", "slli+srli", "compare+branch" };
+
+const char * RiscV::fused_form_name( size_t form )
+{
+    static_assert( ( sizeof( fused_form_names ) / sizeof( fused_form_names[ 0 ] ) ) == RiscV::fused_forms, "fused_form_names must match fused_forms" );
+    return ( form < fused_forms ) ? fused_form_names[ form ] : "";
+} //fused_form_name
+
+static bool ends_block( uint8_t handler ) { return ( h_general == handler || handler >= h_beq ); }
+
+// returns the handler that executes a and b together, or a's handler if they can't be fused.
+// The second instruction of each pair reads the register written by the first.
+
+static uint8_t fused_handler( const RiscVDecoded & a, const RiscVDecoded & b )
+{
+    bool reads_a = ( b.rs1 == a.rd );
+
+    switch ( a.handler )
     {
-        #ifndef NDEBUG
-            if ( 0 != regs[ 0 ] )
-                emulator_hard_termination( *this, "zero register isn't 0:", regs[ zero ] );
-            if ( regs[ sp ] <= ( stack_top - stack_size ) )
-                emulator_hard_termination( *this, "stack pointer is below stack memory:", regs[ sp ] );
-            if ( regs[ sp ] > stack_top )
-                emulator_hard_termination( *this, "stack pointer is above the top of its starting point:", regs[ sp ] );
-            if ( pc < base )
-                emulator_hard_termination( *this, "pc is lower than memory:", pc );
-            if ( pc >= ( base + mem_size - stack_size ) )
-                emulator_hard_termination( *this, "pc is higher than it should be:", pc );
-            if ( 0 != ( regs[ sp ] & 0xf ) ) // by convention, risc-v stacks are 16-byte aligned
-                emulator_hard_termination( *this, "the stack pointer isn't 16-byte aligned:", regs[ sp ] );
-            //memset( &op, 0xff, offsetof( RiscV, past_decoded_data ) - offsetof( RiscV, op ) ); // to help debug broken decoding
-        #endif
-
-        uint64_t pcnext = decode();   // 18% of runtime
-
-        if ( 0 != g_State )           // 1.1% of runtime
-        {
-            if ( g_State & stateEndEmulation )
-            {
-                g_State &= ~stateEndEmulation;
-                break;
-            }
+        case h_lui:
+        {
+            if ( reads_a && h_addi == b.handler )
+                return h_lui_addi;
+            if ( reads_a && h_addiw == b.handler )
+                return h_lui_addiw;
+            break;
+        }
+        case h_auipc:
+        {
+            if ( reads_a && h_jalr == b.handler )
+                return h_auipc_jalr;
+            if ( reads_a && h_ld == b.handler )
+                return h_auipc_ld;
+            break;
+        }
+        case h_slli:
+        {
+            if ( reads_a && h_srli == b.handler )
+                return h_slli_srli;
+            break;
+        }
+        case h_slt: case h_sltu: case h_slti: case h_sltiu:
+        {
+            // beqz and bnez of the comparison result
 
-            if ( ( g_State & stateTraceInstructions ) && tracer.IsEnabled() )
-                trace_state();
+            if ( ( h_beq == b.handler || h_bne == b.handler ) && ( ( reads_a && 0 == b.rs2 ) || ( 0 == b.rs1 && b.rs2 == a.rd ) ) )
+                return ( h_slt == a.handler ) ? h_slt_branch : ( h_sltu == a.handler ) ? h_sltu_branch :
+                       ( h_slti == a.handler ) ? h_slti_branch : h_sltiu_branch;
+            break;
         }
+        default:
+            break;
+    }
+
+    return a.handler;
+} //fused_handler
 
-        cycles++;
+// returns the handler for a Zba, Zbb, Zbs, or Zicond instruction or h_general if op isn't one of them.
+// These share opcodes with the base integer instructions and differ in funct7 or the top of the immediate.
 
-        switch( opcode_type )         // 18.5% of runtime setting up for the jump table
+static uint8_t bitmanip_handler( uint32_t op )
+{
+    uint32_t opcode_type = ( 0x1f & ( op >> 2 ) );
+    uint32_t funct3 = ( op >> 12 ) & 7;
+    uint32_t funct7 = ( op >> 25 );
+    uint32_t top6 = ( op >> 26 );
+    uint32_t rs2 = ( op >> 20 ) & 0x1f;
+
+    if ( 3 != ( op & 3 ) )
+        return h_general;
+
+    if ( 4 == opcode_type ) // OP-IMM
+    {
+        if ( 1 == funct3 )
         {
-            case 0:
-            {
-                assert_type( IType );
-                decode_I();
-                if ( 0 == rd )
-                    break;
-    
-                if ( 0 == funct3 ) // lb rd, imm(rs1)
-                    regs[ rd ] = (int8_t) getui8( regs[ rs1 ] + i_imm ); // sign extend
-                else if ( 1 == funct3 ) // lh rd, imm(rs1)
-                    regs[ rd ] = (int16_t) getui16( regs[ rs1 ] + i_imm ); // sign extend
-                else if ( 2 == funct3 ) // lw rd, imm(rs1)
-                    regs[ rd ] = (int32_t) getui32( regs[ rs1 ] + i_imm ); // sign extend
-                else if ( 3 == funct3 ) // ld rd, imm(rs1)
-                    regs[ rd ] = getui64( regs[ rs1 ] + i_imm );
-                else if ( 4 == funct3 ) // lbu rd, imm(rs1)
-                    regs[ rd ] = getui8( regs[ rs1 ] + i_imm );
-                else if ( 5 == funct3 ) // lhu rd, imm(rs1)
-                    regs[ rd ] = getui16( regs[ rs1 ] + i_imm );
-                else if ( 6 == funct3 ) // lwu rd, imm(rs1)
-                    regs[ rd ] = getui32( regs[ rs1 ] + i_imm );
-                else
-                    unhandled();
-                break;
-            }
-            case 1:
+            if ( 0x30 == funct7 )
             {
-                assert_type( IType );
-                decode_I();
-    
-                if ( 2 == funct3 ) // flw rd, i_imm(rs1)
-                    fregs[ rd ].f = getfloat( regs[ rs1 ] + i_imm );
-                else if ( 3 == funct3 ) // fld rd, i_imm(rs1)
-                    fregs[ rd ].d = getdouble( regs[ rs1 ] + i_imm );
-                else
-                    unhandled();
-                break;
+                if ( rs2 <= 2 )
+                    return (uint8_t) ( h_clz + rs2 );
+                if ( 4 == rs2 || 5 == rs2 )
+                    return (uint8_t) ( h_sext_b + rs2 - 4 );
             }
-#if USE_DJL_RISCV_EXTENSIONS
-            case 2: // risc-v extension cmvxx conditional move
-            {
-                assert_type( CType );
-                decode_C();
-    
-                if ( 0 == rd )
-                    break;
-    
-                // cmvXX are risc-v extension conditional-move instructions. They yield about 1% faster perf for some benchmarks
-                // cmvXX rd, rs1, rc1, rc2  -- if ( rc1 XX rc2 ) rd = rs1
-                // 31: 1 if rc2 is an immediate value (signed/unsigned depending on the compare) or 0 if a register
-                // 30: 1 if rs1 is an immediate value (always signed) or 0 if a register
-                // 29-25: rc1
-                // 24-20: rc2
-                // 19-15: rs1
-                // 14-12: funct3 XX comparison 0 = eq, 1 = ne, 4 = lt, 5 = ge, 6 = ltu, 7 = geu
-                // 11-7:  rd
-                // 6-2:   2 (opcode type cmv)
-                // 1-0:   3 (4-byte instruction)
+            else if ( 0x12 == top6 )
+                return h_bclri;
+            else if ( 0x0a == top6 )
+                return h_bseti;
+            else if ( 0x1a == top6 )
+                return h_binvi;
+        }
+        else if ( 5 == funct3 )
+        {
+            if ( 0x18 == top6 )
+                return h_rori;
+            if ( 0x12 == top6 )
+                return h_bexti;
+            if ( 0x287 == ( op >> 20 ) )
+                return h_orc_b;
+            if ( 0x6b8 == ( op >> 20 ) )
+                return h_rev8;
+        }
+    }
+    else if ( 6 == opcode_type ) // OP-IMM-32
+    {
+        if ( 1 == funct3 )
+        {
+            if ( 0x30 == funct7 && rs2 <= 2 )
+                return (uint8_t) ( h_clzw + rs2 );
+            if ( 2 == top6 )
+                return h_slli_uw;
+        }
+        else if ( 5 == funct3 && 0x30 == funct7 )
+            return h_roriw;
+    }
+    else if ( 0xc == opcode_type ) // OP
+    {
+        switch ( funct7 )
+        {
+            case 0x05: return ( funct3 >= 4 ) ? (uint8_t) ( h_min + funct3 - 4 ) : (uint8_t) h_general;
+            case 0x07: return ( 5 == funct3 ) ? h_czero_eqz : ( 7 == funct3 ) ? h_czero_nez : h_general;
+            case 0x10: return ( 0 != funct3 && 0 == ( funct3 & 1 ) ) ? (uint8_t) ( h_sh1add + ( funct3 / 2 ) - 1 ) : (uint8_t) h_general;
+            case 0x14: return ( 1 == funct3 ) ? h_bset : h_general;
+            case 0x20: return ( 4 == funct3 ) ? h_xnor : ( 6 == funct3 ) ? h_orn : ( 7 == funct3 ) ? h_andn : h_general;
+            case 0x24: return ( 1 == funct3 ) ? h_bclr : ( 5 == funct3 ) ? h_bext : h_general;
+            case 0x30: return ( 1 == funct3 ) ? h_rol : ( 5 == funct3 ) ? h_ror : h_general;
+            case 0x34: return ( 1 == funct3 ) ? h_binv : h_general;
+            default: break;
+        }
+    }
+    else if ( 0xe == opcode_type ) // OP-32
+    {
+        switch ( funct7 )
+        {
+            case 0x04: return ( 0 == funct3 ) ? h_add_uw : ( 4 == funct3 && 0 == rs2 ) ? h_zext_h : h_general;
+            case 0x10: return ( 0 != funct3 && 0 == ( funct3 & 1 ) ) ? (uint8_t) ( h_sh1add_uw + ( funct3 / 2 ) - 1 ) : (uint8_t) h_general;
+            case 0x30: return ( 1 == funct3 ) ? h_rolw : ( 5 == funct3 ) ? h_rorw : h_general;
+            default: break;
+        }
+    }
 
-                uint64_t source = ( 0 == ( c_imm_flags & 1 ) ) ? regs[ rs1 ] : sign_extend( rs1, 4 );
-                uint64_t cmp_right = ( 0 == ( c_imm_flags & 2 ) ) ? regs[ c_rc2 ] : ( 6 == funct3 || 7 == funct3 ) ? c_rc2 : sign_extend( c_rc2, 4 );
+    return h_general;
+} //bitmanip_handler
 
-                if ( 0 == funct3 ) // cmveq
-                {
-                    if ( regs[ c_rc1 ] == cmp_right )
-                        regs[ rd ] = source;
-                }
-                else if ( 1 == funct3 ) // cmvne
-                {
-                    if ( regs[ c_rc1 ] != cmp_right )
-                        regs[ rd ] = source;
-                }
-                else if ( 4 == funct3 ) // cmvlt
-                {
-                    if ( (int64_t) regs[ c_rc1 ] < (int64_t) cmp_right )
-                        regs[ rd ] = source;
-                }
-                else if ( 5 == funct3 ) // cmvge
-                {
-                    if ( (int64_t) regs[ c_rc1 ] >= (int64_t) cmp_right )
-                        regs[ rd ] = source;
-                }
-                else if ( 6 == funct3 ) // cmvltu
-                {
-                    if ( regs[ c_rc1 ] >= cmp_right )
-                        regs[ rd ] = source;
-                }
-                else if ( 7 == funct3 ) // cmvgtu
-                {
-                    if ( regs[ c_rc1 ] >= cmp_right )
-                        regs[ rd ] = source;
-                }
-                else
-                    unhandled();
-                
-                break;
-            }
-#else
-            case 2: // risc-v extension instructions.
-            {
-                // The rust compiler's libc I'm using uses these extension instructions in tcache_init.part.0, called by __malloc.
-                // I think these are the T-Head / Alibaba extensions:
-                //   0x01a0000b: th.sync.i. all instructions retire prior to this one and the instruction pipeline is flushed.
-                //       https://github.com/T-head-Semi/thead-extension-spec/blob/master/xtheadsync/sync_i.adoc
-                //   0x024xx00b: th.dcache.isw. invalidate D-cache by set/way
-                //       https://github.com/T-head-Semi/thead-extension-spec/blob/master/xtheadcmo/dcache_isw.adoc
-                // There is no pipelining or caching in the emulator, so just ignore them.
+static const char * bitmanip_names[] =
+{
+    "sh1add", "sh2add", "sh3add", "add.uw", "sh1add.uw", "sh2add.uw", "sh3add.uw",
+    "andn", "orn", "xnor", "min", "minu", "max", "maxu", "rol", "ror", "rolw", "rorw",
+    "bclr", "bset", "binv", "bext", "czero.eqz", "czero.nez",
+    "clz", "ctz", "cpop", "clzw", "ctzw", "cpopw", "sext.b", "sext.h", "zext.h", "rev8", "orc.b",
+    "slli.uw", "rori", "roriw", "bclri", "bseti", "binvi", "bexti",
+};
 
-                if ( 0x01a0000b == op ) // th.sync.i
-                    break;
+bool RiscV::trace_bitmanip()
+{
+    static_assert( ( sizeof( bitmanip_names ) / sizeof( bitmanip_names[ 0 ] ) ) == ( h_vector - h_sh1add ), "bitmanip_names must match the handlers" );
 
-                if ( ( 0x02400000 == ( op & 0xfff00000 ) ) && ( 0 == ( op & 0x7ff0 ) ) ) // th.dcache.isw rs1
-                    break;
+    uint8_t h = bitmanip_handler( (uint32_t) op );
+    if ( h_general == h )
+        return false;
+
+    uint64_t r = ( op >> 7 ) & 0x1f;
+    uint64_t r1 = ( op >> 15 ) & 0x1f;
+    uint64_t r2 = ( op >> 20 ) & 0x1f;
+    const char * name = bitmanip_names[ h - h_sh1add ];
+
+    if ( h < h_clz )
+        tracer.Trace( "%s %s, %s, %s  # %llx, %llx\n", name, reg_name( r ), reg_name( r1 ), reg_name( r2 ), regs[ r1 ], regs[ r2 ] );
+    else if ( h < h_slli_uw )
+        tracer.Trace( "%s %s, %s  # %llx\n", name, reg_name( r ), reg_name( r1 ), regs[ r1 ] );
+    else
+        tracer.Trace( "%s %s, %s, %llu  # %llx\n", name, reg_name( r ), reg_name( r1 ), ( op >> 20 ) & ( ( h_roriw == h ) ? 0x1f : 0x3f ), regs[ r1 ] );
 
-                // I can't figure out what these extension instructions are supposed to do, but g++ emits them,
-                // gdb shows them as injected data instead of instructions, and real risc-v CPUs execute them.
+    return true;
+} //trace_bitmanip
 
-                //if ( ( 0x3023318b == op ) || ( 0x0785310b ) == op )
-                //    break;
+void RiscV::flush_instruction_cache()
+{
+    block_count = 0;
+    block_op_count = 0;
+    memset( block_hash, 0, block_hash_entries * sizeof( RiscVBlock * ) );
+    block_generation++;
+    jit_arena_used = 0;
 
-                // crash on anything else so it can be debugged
+    for ( size_t i = 0; i < return_stack_entries; i++ )
+        return_stack[ i ].caller = 0;   // the callers are gone
+} //flush_instruction_cache
 
-                unhandled();
-                break;
+void RiscV::predecode( RiscVDecoded & d, uint64_t address )
+{
+    op = getui32( address );
+    d.size = 4;
+
+    if ( 3 != ( op & 0x3 ) )
+    {
+        op = uncompress_rvc( (uint16_t) ( op & 0xffff ), tracing_instructions() );
+        d.size = 2;
+    }
+
+    opcode_type = ( 0x1f & ( op >> 2 ) );
+    d.pc = address;
+    d.op = (uint32_t) op;
+    d.handler = h_general;
+    d.imm = 0;
+    d.rd = d.rs1 = d.rs2 = d.rs3 = 0;
+
+    switch( opcode_type )
+    {
+        case 0:
+        {
+            decode_I();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.imm = i_imm;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else if ( 7 != funct3 )
+                d.handler = (uint8_t) ( h_lb + funct3 );
+            break;
+        }
+        case 1:
+        {
+            decode_I();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.imm = i_imm;
+            if ( 2 == funct3 )
+                d.handler = h_flw;
+            else if ( 3 == funct3 )
+                d.handler = h_fld;
+            else if ( 0 == funct3 || funct3 >= 5 )
+                d.handler = h_vector;
+            break;
+        }
+        case 4:
+        {
+            decode_I();
+            decode_I_shift();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.imm = i_imm;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else if ( h_general != ( d.handler = bitmanip_handler( (uint32_t) op ) ) )
+                d.imm = i_shamt6;
+            else if ( 1 == funct3 )
+            {
+                d.imm = i_shamt6;
+                if ( 0 == ( op >> 26 ) )
+                    d.handler = h_slli;
             }
-#endif
-            case 3:
+            else if ( 5 == funct3 )
             {
-                assert_type( IType );
-                decode_I();
-    
-                if ( 0 == funct3 || 1 == funct3 ) // fence or fence.i
-                {
-                    // fence -- do nothing
-                }
-                else
-                    unhandled();
-                break;
+                d.imm = i_shamt6;
+                if ( 0 == ( op >> 26 ) )
+                    d.handler = h_srli;
+                else if ( 0x10 == ( op >> 26 ) )
+                    d.handler = h_srai;
             }
-            case 4:
+            else
+                d.handler = (uint8_t) ( h_addi + funct3 );
+            break;
+        }
+        case 5: // auipc
+        case 0xd: // lui
+        {
+            decode_U();
+            d.rd = (uint8_t) rd;
+            d.imm = u_imm << 12;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else
+                d.handler = ( 5 == opcode_type ) ? h_auipc : h_lui;
+            break;
+        }
+        case 6:
+        {
+            decode_I();
+            decode_I_shift();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.imm = i_shamt5;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else if ( 0 == funct3 )
             {
-                assert_type( IType );
-                decode_I();
-                if ( 0 == rd )
-                    break;
-
-                if ( 0 == funct3 ) // addi rd, rs1, imm
-                    regs[ rd ] =  i_imm + regs[ rs1 ];
-                else if ( 1 == funct3 ) // slli rd, rs1, imm
-                {
-                    decode_I_shift();
-                    regs[ rd ] =  regs[ rs1 ] << i_shamt6;
-                }
-                else if ( 2 == funct3 ) // slti rd, rs1, imm
-                    regs[ rd ] = ( (int64_t) regs[ rs1 ] < i_imm );
-                else if ( 3 == funct3 ) // sltiu rd, rs1, imm
-                    regs[ rd ] = ( regs[ rs1 ] < (uint64_t) i_imm ); // treat the sign-extended immediate as an unsigned quantity, not the non-sign-extended i_imm_u
-                else if ( 4 == funct3 ) // xori rd, rs1, imm
-                    regs[ rd ] =  i_imm ^ regs[ rs1 ];
-                else if ( 5 == funct3 )
-                {
-                    decode_I_shift();
-                    if ( 0 == i_top2 ) // srli rd, rs1, i_shamt
-                        regs[ rd ] = ( regs[ rs1 ] >> i_shamt6 );
-                    else if ( 1 == i_top2 ) // srai rd, rs1, i_shamt
-                    {
-                        // The old g++ for RISC-V doesn't sign extend on right shifts for signed integers.
-                        // The new g++ does for amd64 code gen. work around this.
-    
-                        uint64_t result = regs[ rs1 ] >> i_shamt6;
-                        regs[ rd ] = sign_extend( result, 63 - i_shamt6 );
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 6 == funct3 ) // ori rd, rs1, imm
-                    regs[ rd ] =  i_imm | regs[ rs1 ];
-                else if ( 7 == funct3 ) // andi rd, rs1, imm
-                    regs[ rd ] =  i_imm & regs[ rs1 ];
-                else
-                    unhandled();
-                break;
+                d.imm = i_imm;
+                d.handler = h_addiw;
             }
-            case 5:
+            else if ( h_general != ( d.handler = bitmanip_handler( (uint32_t) op ) ) )
             {
-                assert_type( UType );
-                decode_U();
-                if ( 0 == rd )
-                    break;
-    
-                regs[ rd ] = pc + ( u_imm << 12 ); // auipc imm.    rd <= pc + ( imm << 12 )
-                break;
+                if ( h_slli_uw == d.handler )
+                    d.imm = i_shamt6;
             }
-            case 6:
+            else if ( 1 == funct3 && 0 == ( op >> 25 ) )
+                d.handler = h_slliw;
+            else if ( 5 == funct3 && 0 == ( op >> 25 ) )
+                d.handler = h_srliw;
+            else if ( 5 == funct3 && 0x20 == ( op >> 25 ) )
+                d.handler = h_sraiw;
+            break;
+        }
+        case 8:
+        {
+            decode_S();
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            d.imm = s_imm;
+            if ( funct3 <= 3 )
+                d.handler = (uint8_t) ( h_sb + funct3 );
+            break;
+        }
+        case 9:
+        {
+            decode_S();
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            d.imm = s_imm;
+            if ( 2 == funct3 )
+                d.handler = h_fsw;
+            else if ( 3 == funct3 )
+                d.handler = h_fsd;
+            else if ( 0 == funct3 || funct3 >= 5 )
+                d.handler = h_vector;
+            break;
+        }
+        case 0x15:
+        {
+            d.handler = h_vector;
+            break;
+        }
+        case 0xc:
+        {
+            decode_R();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else if ( 0 == funct7 )
+                d.handler = (uint8_t) ( h_add + funct3 );
+            else if ( 1 == funct7 )
+                d.handler = (uint8_t) ( h_mul + funct3 );
+            else if ( 0x20 == funct7 && 0 == funct3 )
+                d.handler = h_sub;
+            else if ( 0x20 == funct7 && 5 == funct3 )
+                d.handler = h_sra;
+            else
+                d.handler = bitmanip_handler( (uint32_t) op );
+            break;
+        }
+        case 0xe:
+        {
+            decode_R();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            if ( 0 == rd )
+                d.handler = h_nop;
+            else if ( 0 == funct7 )
             {
-                assert_type( IType );
-                decode_I();
-                decode_I_shift();
-                if ( 0 == rd )
-                    break;
-    
-                if ( 0 == funct3 ) // addiw rd, rs1, i_imm  (sign-extend both i_imm and rd)
-                {
-                    int32_t val = 0xffffffff & regs[ rs1 ];
-                    int32_t imm = (int32_t) i_imm;
-                    int32_t result = val + imm;
-                    regs[ rd ] = result;
-                }
+                if ( 0 == funct3 )
+                    d.handler = h_addw;
                 else if ( 1 == funct3 )
-                {
-                    // 5, not 6 per https://riscv.org/wp-content/uploads/2019/06/riscv-spec.pdf
-                    if ( 0 == i_top2 )
-                    {
-                        uint32_t val = (uint32_t) regs[ rs1 ];
-                        uint32_t result = val << i_shamt5;
-                        uint64_t result64 = (int32_t) result;
-                        regs[ rd ] = result64;  // slliw rd, rs1, i_shamt5
-                    }
-                    else
-                        unhandled();
-                }
+                    d.handler = h_sllw;
                 else if ( 5 == funct3 )
-                {
-                    if ( 0 == i_top2 )
-                        regs[ rd ] = ( ( 0xffffffff & regs[ rs1 ] ) >> i_shamt5 ); // srliw rd, rs1, i_imm
-                    else if ( 1 == i_top2 )
-                    {
-                        // the old g++ compiler that targets RISC-V doesn't sign-extend right shifts on signed numbers.
-                        // msvc and the g++ compiler that targets AMD64 both do sign-extend right shifts on signed numbers
-                        // work around this by manually sign extending the result.
-    
-                        uint32_t t = regs[ rs1 ] & 0xffffffff;
-                        uint64_t result = sign_extend( t >> i_shamt5, 31 - i_shamt5 );
-                        regs[ rd ] = result; // sraiw rd, rs1, i_imm
-                    }
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-                break;
+                    d.handler = h_srlw;
             }
-            case 8:
+            else if ( 1 == funct7 )
             {
-                assert_type( SType );
-                decode_S();
-    
-                if ( 0 == funct3 ) // sb   rs2, imm(rs1)
-                    setui8( regs[ rs1 ] + s_imm, (uint8_t) regs[ rs2 ] );
-                else if ( 1 == funct3 ) // sh   rs2, imm(rs1)
-                    setui16( regs[ rs1 ] + s_imm, (uint16_t) regs[ rs2 ] );
-                else if ( 2 == funct3 ) // sw   rs2, imm(rs1)
-                    setui32( regs[ rs1 ] + s_imm, (uint32_t) regs[ rs2 ] );
-                else if ( 3 == funct3 ) // sd   rs2, imm(rs1)
-                    setui64( regs[ rs1 ] + s_imm, regs[ rs2 ] );
-                else
-                    unhandled();
-                break;
+                if ( 0 == funct3 )
+                    d.handler = h_mulw;
+                else if ( funct3 >= 4 )
+                    d.handler = (uint8_t) ( h_divw + funct3 - 4 );
             }
-            case 9:
+            else if ( 0x20 == funct7 )
             {
-                assert_type( SType );
-                decode_S();
-    
-                if ( 2 == funct3 ) // fsw   rs2, imm(rs1)
-                    setfloat( regs[ rs1 ] + s_imm, fregs[ rs2 ].f );
-                else if ( 3 == funct3 ) // fsd  rs2, imm(rs1)
-                    setdouble( regs[ rs1 ] + s_imm, fregs[ rs2 ].d );
-                else
-                    unhandled();
-                break;
-            }
-#if USE_DJL_RISCV_EXTENSIONS
-            case 0xa:
-            {
-                assert_type( RType );
-                decode_R();
-
-                // conditional return. If the condition is true, jump to the address in rreturn (typically ra)
-                // jrXX rleft, rright, rreturn
-                // if ( rleft XX rright ) pc = rreturn
-                // R-type instruction
-                //    rs1 -- rleft
-                //    rs2 -- rright
-                //    rd -- typically ra
-                //    funct3 -- 0 = eq, 1 = ne, 4 = lt, 5 = ge, 6 = ltu, 7 = gtu
-                //    funct7 -- 0
-                //    opcode -- lower 7 bits 0x2b. opcode type -- 0xa
-
-                if ( 0 == funct7 )
-                {
-                    if ( 0 == funct3 ) // jreq
-                    {
-                        if ( regs[ rs1 ] == regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else if ( 1 == funct3 ) // jrne
-                    {
-                        if ( regs[ rs1 ] != regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else if ( 4 == funct3 ) // jrlt
-                    {
-                        if ( (int64_t) regs[ rs1 ] < (int64_t) regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else if ( 5 == funct3 ) // jrge
-                    {
-                        if ( (int64_t) regs[ rs1 ] >= (int64_t) regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else if ( 6 == funct3 ) // jrltu
-                    {
-                        if ( regs[ rs1 ] < regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else if ( 7 == funct3 ) // jrgtu
-                    {
-                        if ( regs[ rs1 ] > regs[ rs2 ] )
-                            pcnext = regs[ rd ];
-                    }
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-                
-                break;
+                if ( 0 == funct3 )
+                    d.handler = h_subw;
+                else if ( 5 == funct3 )
+                    d.handler = h_sraw;
             }
-#endif
-            case 0xb:
+            else
+                d.handler = bitmanip_handler( (uint32_t) op );
+            break;
+        }
+        case 0x10: case 0x11: case 0x12: case 0x13: // fmadd, fmsub, fnmsub, fnmadd
+        {
+            decode_R();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            d.rs3 = (uint8_t) ( ( funct7 >> 2 ) & 0x1f );
+            uint64_t fmt = ( funct7 & 3 );
+            if ( fmt <= 1 )
+                d.handler = (uint8_t) ( h_fmadd_s + ( opcode_type - 0x10 ) * 2 + fmt );
+            break;
+        }
+        case 0x14:
+        {
+            decode_R();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            d.imm = funct3; // rounding mode for fcvt
+
+            if ( funct7 <= 0xd && 0 == ( funct7 & 2 ) )
+                d.handler = (uint8_t) ( h_fadd_s + ( ( funct7 >> 2 ) * 2 ) + ( funct7 & 1 ) );
+            else if ( 0x10 == funct7 || 0x11 == funct7 )
             {
-                assert_type( RType );
-                decode_R();
-    
-                uint32_t top5 = (uint32_t) ( funct7 >> 2 );
-
-                // with just one hart in this emulator, these can be ignored
-                //bool aq = ( 0 != ( 2 & funct7 ) );
-                //bool rl = ( 0 != ( 1 & funct7 ) );
-    
-                if ( 0 == top5 )
-                {
-                    if ( 2 == funct3 ) // amoadd.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], (uint32_t) ( regs[ rs2 ] + memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amoadd.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], regs[ rs2 ] + memval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 1 == top5 )
-                {
-                    if ( 2 == funct3 ) // amoswap.w rd, rs2, (rs1)
-                    {
-                        uint64_t memval = (int32_t) getui32( regs[ rs1 ] );
-                        uint32_t regval = (uint32_t) regs[ rs2 ];
-                        setui32( regs[ rs1 ], regval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else if ( 3 == funct3 ) // amoswap.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        uint64_t regval = regs[ rs2 ];
-                        setui64( regs[ rs1 ], regval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 2 == top5 )
-                {
-                    if ( 2 == funct3 ) // lr.w rd, (rs1)
-                    {
-                        int32_t memval = (int32_t) getui32( regs[ rs1 ] );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else if ( 3 == funct3 ) // lr.d rd, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 3 == top5 )
-                {
-                    if ( 2 == funct3 ) // sc.w rd, rs2, (rs1)
-                    {
-                        setui32( regs[ rs1 ], (uint32_t) regs[ rs2 ] );
-                        if ( 0 != rd )
-                            regs[ rd ] = 0;
-                    }
-                    else if ( 3 == funct3 ) // sc.d rd, rs2, (rs1)
-                    {
-                        setui64( regs[ rs1 ], regs[ rs2 ] );
-                        if ( 0 != rd )
-                            regs[ rd ] = 0;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 4 == top5 )
-                {
-                    if ( 2 == funct3 ) // amoxor.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], (uint32_t) ( regs[ rs2 ] ^ memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amoxor.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], regs[ rs2 ] ^ memval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 8 == top5 )
-                {
-                    if ( 2 == funct3 ) // amoor.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], (uint32_t) ( regs[ rs2 ] | memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amoor.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], regs[ rs2 ] | memval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0xc == top5 )
-                {
-                    if ( 2 == funct3 ) // amoand.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], regs[ rs2 ] & memval );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amoand.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], regs[ rs2 ] & memval );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x10 == top5 )
-                {
-                    if ( 2 == funct3 ) // amomin.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], get_min( (int32_t) regs[ rs2 ], (int32_t) memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amomin.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], get_min( (int64_t) regs[ rs2 ], (int64_t) memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x14 == top5 )
-                {
-                    if ( 2 == funct3 ) // amomax.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], get_max( (int32_t) regs[ rs2 ], (int32_t) memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval;
-                    }
-                    else if ( 3 == funct3 ) // amomax.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], get_max( (int64_t) regs[ rs2 ], (int64_t) memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x18 == top5 )
-                {
-                    if ( 2 == funct3 ) // amominu.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], get_min( (uint32_t) regs[ rs2 ], memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval; // AMOs always sign-extend value placed in rd
-                    }
-                    else if ( 3 == funct3 ) // amominu.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], get_min( regs[ rs2 ], memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x1c == top5 )
-                {
-                    if ( 2 == funct3 ) // amomaxu.w rd, rs2, (rs1)
-                    {
-                        uint32_t memval = getui32( regs[ rs1 ] );
-                        setui32( regs[ rs1 ], get_max( (uint32_t) regs[ rs2 ], memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = (int32_t) memval; // AMOs always sign-extend value placed in rd
-                    }
-                    else if ( 3 == funct3 ) // amomaxu.d rd, rs2, (rs1)
-                    {
-                        uint64_t memval = getui64( regs[ rs1 ] );
-                        setui64( regs[ rs1 ], get_max( regs[ rs2 ], memval ) );
-                        if ( 0 != rd )
-                            regs[ rd ] = memval;
-                    }
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-    
-                break;
+                if ( funct3 <= 2 )
+                    d.handler = (uint8_t) ( h_fsgnj_s + ( ( funct7 & 1 ) * 3 ) + funct3 );
             }
-            case 0xc:
+            else if ( 0x14 == funct7 || 0x15 == funct7 )
             {
-                assert_type( RType );
-                decode_R();
-    
-                if ( 0 == rd )
-                    break;
-    
-                if ( 0 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        regs[ rd ] = regs[ rs1 ] + regs[ rs2 ]; // add rd, rs1, rs2
-                    else if ( 1 == funct3 )
-                        //  n.b. the risc-v spec says lower 5 bits of rs2. Gnu floating point code assumes lower 6 bits.
-                        regs[ rd ] = ( regs[ rs1 ] << ( regs[ rs2 ] & 0x3f ) ); // sll rd, rs1, rs2  // slr rd, rs1, rs2
-                    else if ( 2 == funct3 )
-                        regs[ rd ] = ( (int64_t) regs[ rs1 ] < (int64_t) regs[ rs2 ] ); // slt rd, rs1, rs2
-                    else if ( 3 == funct3 )
-                        regs[ rd ] = ( regs[ rs1 ] < regs[ rs2 ] ); // sltu rd, rs1, rs2
-                    else if ( 4 == funct3 )
-                        regs[ rd ] = ( regs[ rs1 ] ^ regs[ rs2 ] ); // xor rd, rs1, rs2
-                    else if ( 5 == funct3 )
-                        //  n.b. the risc-v spec says lower 5 bits of rs2. Gnu floating point code assumes lower 6 bits.
-                        regs[ rd ] = ( regs[ rs1 ] >> ( regs[ rs2 ] & 0x3f ) ); // slr rd, rs1, rs2
-                    else if ( 6 == funct3 )
-                        regs[ rd ] = regs[ rs1 ] | regs[ rs2 ]; // or rd, rs1, rs2
-                    else if ( 7 == funct3 )
-                        regs[ rd ] = regs[ rs1 ] & regs[ rs2 ]; // and rd, rs1, rs2
-                    else
-                        unhandled();
-                }
-                else if ( 1 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        regs[ rd ] = regs[ rs1 ] * regs[ rs2 ]; // mul rd, rs1, rs2
-                    else if ( 1 == funct3 ) // mulh rd, rs1, rs2     signed * signed
-                    {
-                        int64_t high;
-                        CMultiply128::mul_s64_s64( regs[ rs1 ], regs[ rs2 ], &high );
-                        regs[ rd ] = high;
-                    }
-                    else if ( 2 == funct3 ) // mulhsu rd, rs1, rs2    signed rs1 * unsigned rs2
-                    {
-                        int64_t reg1 = regs[ rs1 ];
-                        bool negative = ( reg1 < 0 );
-                        uint64_t high;
-                        CMultiply128::mul_u64_u64( regs[ rs1 ], regs[ rs2 ], &high );
-                        int64_t result = (int64_t) high;
-                        if ( negative )
-                            result = -result;
-                        regs[ rd ] = result;
-                    }
-                    else if ( 3 == funct3 ) // mulhu rd, rs1, rs2    unsigned * unsigned
-                    {
-                        uint64_t high;
-                        CMultiply128::mul_u64_u64( regs[ rs1 ], regs[ rs2 ], &high );
-                        regs[ rd ] = high;
-                    }
-                    else if ( 4 == funct3 )
-                        regs[ rd ] = ( 0 == regs[ rs2 ] ) ? 0 : (int64_t) regs[ rs1 ] / (int64_t) regs[ rs2 ]; // div rd, rs1, rs2
-                    else if ( 5 == funct3 )
-                        regs[ rd ] = ( 0 == regs[ rs2 ] ) ? 0 : regs[ rs1 ] / regs[ rs2 ]; // udiv rd, rs1, rs2
-                    else if ( 6 == funct3 )
-                        regs[ rd ] = ( 0 == regs[ rs2 ] ) ? 0 : (int64_t) regs[ rs1 ] % (int64_t) regs[ rs2 ]; // rem rd, rs1, rs2
-                    else if ( 7 == funct3 )
-                         regs[ rd ] = ( 0 == regs[ rs2 ] ) ? 0 : regs[ rs1 ] % regs[ rs2 ]; // remu rd, rs1, rs2
-                    else
-                        unhandled();
-                }
-                else if ( 0x20 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        regs[ rd ] = regs[ rs1 ] - regs[ rs2 ]; // sub rd, rs1, rs2
-                    else if ( 5 == funct3 )
-                    {
-                        uint64_t shift = ( 0x3f & regs[ rs2 ] );
-                        uint64_t result = regs[ rs1 ] >> shift;
-                        regs[ rd ] = sign_extend( result, 63 - shift ); // sra rd, rs1, rs2
-                    }
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-                break;
+                if ( funct3 <= 1 )
+                    d.handler = (uint8_t) ( h_fmin_s + ( ( funct7 & 1 ) * 2 ) + funct3 );
             }
-            case 0xd: // lui rd, uimm
+            else if ( 0x20 == funct7 && 1 == rs2 )
+                d.handler = h_fcvt_s_d;
+            else if ( 0x21 == funct7 && 0 == rs2 )
+                d.handler = h_fcvt_d_s;
+            else if ( 0x2c == funct7 && 0 == rs2 )
+                d.handler = h_fsqrt_s;
+            else if ( 0x2d == funct7 && 0 == rs2 )
+                d.handler = h_fsqrt_d;
+            else if ( 0x50 == funct7 || 0x51 == funct7 )
             {
-                assert_type( UType );
-                decode_U();
-                if ( 0 == rd )
-                    break;
-                regs[ rd ] = ( u_imm << 12 );
-                break;
+                if ( funct3 <= 2 )
+                    d.handler = ( 0 == rd ) ? (uint8_t) h_nop : (uint8_t) ( h_fle_s + ( ( funct7 & 1 ) * 3 ) + funct3 );
             }
-            case 0xe:
+            else if ( 0x60 == funct7 || 0x61 == funct7 )
             {
-                assert_type( RType );
-                decode_R();
-                if ( 0 == rd )
-                    break;
-    
-                if ( 0 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                    {
-                        int32_t val = (int32_t) ( 0xffffffff & regs[ rs1 ] ) + (int32_t) ( 0xffffffff & regs[ rs2 ] );
-                        regs[ rd ] = val; // addw rd, rs1, rs2
-                    }
-                    else if ( 1 == funct3 )
-                    {
-                        uint32_t val = (uint32_t) regs[ rs1 ];
-                        uint32_t amount = 0x1f & regs[ rs2 ];
-                        uint32_t result = val << amount;
-                        uint64_t result64 = (int32_t) result;
-                        regs[ rd ] = result64; // sllw rd, rs1, rs2
-                    }
-                    else if ( 5 == funct3 )
-                        regs[ rd ] = ( 0xffffffff & regs[ rs1 ] ) >> ( 0x1f & regs[ rs2 ] ); // srlw rd, rs1, rs2
-                    else
-                        unhandled();
-                }
-                else if ( 1 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                    {
-                        int32_t x = (int32_t) ( ( 0xffffffff & regs[ rs1 ] ) * ( 0xffffffff & regs[ rs2 ] ) );
-                        uint64_t ext = x;
-                        regs[ rd ] = ext; // mulw rd, rs1, rs2
-                    }
-                    else if ( 4 == funct3 )
-                    {
-                        int32_t val1 = (int32_t) ( 0xffffffff & regs[ rs1 ] );
-                        int32_t val2 = (int32_t) ( 0xffffffff & regs[ rs2 ] );
-                        regs[ rd ] = ( 0 == val2 ) ? 0 : val1 / val2; // divw rd, rs1, rs2
-                    }
-                    else if ( 5 == funct3 )
-                    {
-                        uint32_t val1 = ( 0xffffffff & regs[ rs1 ] );
-                        uint32_t val2 = ( 0xffffffff & regs[ rs2 ] );
-                        regs[ rd ] = ( 0 == val2 ) ? 0 : val1 / val2; // divuw rd, rs1, rs2
-                    }
-                    else if ( 6 == funct3 )
-                    {
-                        int32_t val1 = (int32_t) ( 0xffffffff & regs[ rs1 ] );
-                        int32_t val2 = (int32_t) ( 0xffffffff & regs[ rs2 ] );
-                        regs[ rd ] = ( 0 == val2 ) ? 0 : ( val1 % val2 ); // remw rd, rs1, rs2
-                    }
-                    else if ( 7 == funct3 )
-                    {
-                        uint32_t val1 = ( 0xffffffff & regs[ rs1 ] );
-                        uint32_t val2 = ( 0xffffffff & regs[ rs2 ] );
-                        regs[ rd ] = ( 0 == val2 ) ? 0 : ( val1 % val2 ); // remuw rd, rs1, rs2
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x20 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        regs[ rd ] = (int64_t) ( (int32_t) ( 0xffffffff & regs[ rs1 ] ) - (int32_t) ( 0xffffffff & regs[ rs2 ] ) ); // subw rd, rs1, rs2
-                    else if ( 5 == funct3 )
-                    {
-                        uint64_t shift = ( 0x1f & regs[ rs2 ] );
-                        uint64_t result = ( 0xffffffff & regs[ rs1 ] ) >> shift;
-                        result = sign_extend( result, 31 - shift );
-                        regs[ rd ] = result; // sraw rd, rs1, rs2
-                    }
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-                break;
+                if ( rs2 <= 3 )
+                    d.handler = ( 0 == rd ) ? (uint8_t) h_nop : (uint8_t) ( h_fcvt_w_s + ( ( funct7 & 1 ) * 4 ) + rs2 );
             }
-            case 0x10:
+            else if ( 0x68 == funct7 || 0x69 == funct7 )
             {
-                assert_type( RType );
-                decode_R();
-    
-                uint32_t rs3 = ( ( funct7 >> 2 ) & 0x1f );
-                uint32_t fmt = ( funct7 & 3 );
-    
-                if ( 0 == fmt )
-                    fregs[ rd ].f = (float) do_fadd( do_fmul( fregs[ rs1 ].f, fregs[ rs2 ].f ), fregs[ rs3 ].f ); // fmadd.s frd, frs1, frs2, frs3
-                else if ( 1 == fmt )
-                    fregs[ rd ].d = do_fadd( do_fmul( fregs[ rs1 ].d, fregs[ rs2 ].d ), fregs[ rs3 ].d ); // fmadd.d frd, frs1, frs2, frs3
-                else
-                    unhandled();
-                break;
+                if ( rs2 <= 3 )
+                    d.handler = (uint8_t) ( h_fcvt_s_w + ( ( funct7 & 1 ) * 4 ) + rs2 );
             }
-            case 0x11:
-            {
-                assert_type( RType );
-                decode_R();
-    
-                uint32_t rs3 = ( ( funct7 >> 2 ) & 0x1f );
-                uint32_t fmt = ( funct7 & 3 );
-    
-                if ( 0 == fmt )
-                    fregs[ rd ].f = (float) do_fsub( do_fmul( fregs[ rs1 ].f, fregs[ rs2 ].f ), fregs[ rs3 ].f ); // fmsub.s frd, frs1, frs2, frs3
-                else if ( 1 == fmt )
-                    fregs[ rd ].d = do_fsub( do_fmul( fregs[ rs1 ].d, fregs[ rs2 ].d ), fregs[ rs3 ].d ); // fmsub.d frd, frs1, frs2, frs3
-                else
-                    unhandled();
-                break;
+            else if ( ( 0x70 == funct7 || 0x71 == funct7 ) && 0 == rs2 && 0 == funct3 )
+                d.handler = ( 0 == rd ) ? h_nop : ( 0x70 == funct7 ) ? h_fmv_x_w : h_fmv_x_d;
+            else if ( 0x78 == funct7 && 0 == rs2 && 0 == funct3 )
+                d.handler = h_fmv_w_x;
+            else if ( 0x79 == funct7 && 0 == rs2 && 0 == funct3 )
+                d.handler = h_fmv_d_x;
+            break;
+        }
+        case 0x18:
+        {
+            decode_B();
+            d.rs1 = (uint8_t) rs1;
+            d.rs2 = (uint8_t) rs2;
+            d.imm = b_imm;
+            if ( funct3 <= 1 )
+                d.handler = (uint8_t) ( h_beq + funct3 );
+            else if ( funct3 >= 4 )
+                d.handler = (uint8_t) ( h_blt + funct3 - 4 );
+            break;
+        }
+        case 0x19:
+        {
+            decode_I();
+            d.rd = (uint8_t) rd;
+            d.rs1 = (uint8_t) rs1;
+            d.imm = i_imm;
+            if ( 0 == funct3 )
+                d.handler = h_jalr;
+            break;
+        }
+        case 0x1b:
+        {
+            decode_J();
+            d.rd = (uint8_t) rd;
+            d.imm = (int64_t) j_imm_u;
+            d.handler = h_jal;
+            break;
+        }
+        default:
+            break; // everything else is executed by execute_general()
+    }
+} //predecode
+
+RiscVBlock * RiscV::build_block( uint64_t address )
+{
+    if ( ( max_blocks == block_count ) || ( ( block_op_count + max_block_length + 1 ) > max_block_ops ) )
+    {
+        tracer.Trace( "block cache is full; flushing it\n" );
+        flush_instruction_cache();
+    }
+
+    RiscVBlock * b = & blocks[ block_count++ ];
+    b->pc = address;
+    b->ops = & block_ops[ block_op_count ];
+    b->next[ 0 ] = 0;
+    b->next[ 1 ] = 0;
+    b->jit_code = 0;
+    b->jit_ops = 0;
+    b->executions = 0;
+    b->jit_bytes = 0;
+
+    // decode ahead until an instruction that ends the block. Don't read beyond the end of memory.
+
+    uint64_t end_of_memory = base + mem_size;
+    size_t count = 0;
+    uint8_t handler;
+
+    do
+    {
+        RiscVDecoded & d = b->ops[ count++ ];
+        predecode( d, address );
+        d.unfused = d.handler;
+        address += d.size;
+        handler = d.handler;
+    } while ( !ends_block( handler ) && ( count < max_block_length ) && ( ( address + 4 ) <= end_of_memory ) );
+
+    b->count = count;
+
+    if ( !ends_block( handler ) )
+    {
+        RiscVDecoded & d = b->ops[ count++ ];
+        memset( & d, 0, sizeof( d ) );
+        d.pc = address;
+        d.handler = h_block_end;
+        d.unfused = h_block_end;
+    }
+
+    // fuse pairs of instructions. The second instruction of a pair keeps its own handler so execution can
+    // start there after a partially translated block, and tracing runs each instruction unfused.
+
+    for ( size_t i = 0; ( i + 1 ) < b->count; i++ )
+    {
+        b->ops[ i ].handler = fused_handler( b->ops[ i ], b->ops[ i + 1 ] );
+        if ( b->ops[ i ].handler != b->ops[ i ].unfused )
+            i++;
+    }
+
+    block_op_count += count;
+    block_hash[ ( b->pc >> 1 ) & ( block_hash_entries - 1 ) ] = b;
+    return b;
+} //build_block
+
+RiscVBlock * RiscV::find_block( uint64_t address )
+{
+    RiscVBlock * b = block_hash[ ( address >> 1 ) & ( block_hash_entries - 1 ) ];
+    if ( ( 0 != b ) && ( address == b->pc ) )
+        return b;
+
+    return build_block( address );
+} //find_block
+
+#if USE_JIT
+
+// Translation of hot blocks to x86-64 code. Only the leading instructions of a block that are handled here are
+// translated and the interpreter executes the rest. If the whole block is translated including a conditional
+// branch or jal at the end, the code returns which successor to follow: 0 for fall through or 1 for taken.
+// Otherwise it returns jit_partial. The most-used guest registers in a block are kept in host registers.
+// rdi points at regs, rsi is membase, and rax, rcx, and rdx are scratch.
+
+typedef uint64_t ( * jit_function )( uint64_t * regs, uint8_t * membase );
+
+static const uint64_t jit_partial = 2;
+
+static const uint32_t jit_threshold = 32;              // block executions before translation
+static const size_t jit_arena_size = 4 * 1024 * 1024;  // bytes of host code
+static const size_t jit_max_block_bytes = 4096;        // worst case for a block of max_block_length instructions
+
+enum x64_reg { x_rax, x_rcx, x_rdx, x_rbx, x_rsp, x_rbp, x_rsi, x_rdi, x_r8, x_r9, x_r10, x_r11, x_r12, x_r13, x_r14, x_r15 };
+
+// host registers available to cache guest registers, in the order they are assigned. The last 6 are callee-saved.
+
+static const uint8_t jit_cache_regs[] = { x_r8, x_r9, x_r10, x_r11, x_rbx, x_rbp, x_r12, x_r13, x_r14, x_r15 };
+static const size_t jit_first_saved_reg = 4;
+
+struct x64_emitter
+{
+    uint8_t * p;
+    uint8_t host[ 32 ];  // host register caching each guest register or 0xff if not cached
+
+    void b( uint8_t x ) { *p++ = x; }
+    void d32( uint32_t x ) { memcpy( p, & x, 4 ); p += 4; }
+
+    void rex( bool w, uint8_t reg, uint8_t rm, bool force = false )
+    {
+        uint8_t r = 0x40 | ( w ? 8 : 0 ) | ( ( reg & 8 ) ? 4 : 0 ) | ( ( rm & 8 ) ? 1 : 0 );
+        if ( force || 0x40 != r )
+            b( r );
+    } //rex
+
+    void rr( uint8_t opcode, uint8_t reg, uint8_t rm, bool w = true ) // opcode with a register-direct modrm
+    {
+        rex( w, reg, rm );
+        b( opcode );
+        b( (uint8_t) ( 0xc0 | ( ( reg & 7 ) << 3 ) | ( rm & 7 ) ) );
+    } //rr
+
+    void regs_mem( uint8_t opcode, uint8_t reg, uint64_t guest ) // opcode reg, [ rdi + guest * 8 ]
+    {
+        rex( true, reg, x_rdi );
+        b( opcode );
+        b( (uint8_t) ( 0x80 | ( ( reg & 7 ) << 3 ) | x_rdi ) );
+        d32( (uint32_t) ( guest * 8 ) );
+    } //regs_mem
+
+    void guest_mem( uint8_t reg, int64_t imm ) // modrm and sib for [ rsi + rax + imm32 ]
+    {
+        b( (uint8_t) ( 0x84 | ( ( reg & 7 ) << 3 ) ) );
+        b( (uint8_t) ( ( x_rax << 3 ) | x_rsi ) );
+        d32( (uint32_t) imm );
+    } //guest_mem
+
+    void load( uint8_t h, uint64_t g ) // host register h = guest register g
+    {
+        if ( 0 == g )
+            rr( 0x31, h, h, false ); // xor h32, h32
+        else if ( 0xff != host[ g ] )
+            rr( 0x89, host[ g ], h ); // mov h, cached
+        else
+            regs_mem( 0x8b, h, g ); // mov h, [ rdi + g * 8 ]
+    } //load
+
+    void store( uint64_t g, uint8_t h ) // guest register g = host register h
+    {
+        if ( 0xff != host[ g ] )
+            rr( 0x89, h, host[ g ] ); // mov cached, h
+        else
+            regs_mem( 0x89, h, g ); // mov [ rdi + g * 8 ], h
+    } //store
+
+    void alu_imm( uint8_t ext, uint8_t h, int64_t imm, bool w = true ) // add/or/and/sub/xor/cmp h, imm32
+    {
+        rex( w, 0, h );
+        b( 0x81 );
+        b( (uint8_t) ( 0xc0 | ( ext << 3 ) | ( h & 7 ) ) );
+        d32( (uint32_t) imm );
+    } //alu_imm
+
+    void shift_imm( uint8_t ext, uint8_t h, int64_t imm, bool w = true ) // shl/shr/sar h, imm8
+    {
+        rex( w, 0, h );
+        b( 0xc1 );
+        b( (uint8_t) ( 0xc0 | ( ext << 3 ) | ( h & 7 ) ) );
+        b( (uint8_t) imm );
+    } //shift_imm
+
+    void shift_cl( uint8_t ext, uint8_t h, bool w = true ) // shl/shr/sar h, cl
+    {
+        rex( w, 0, h );
+        b( 0xd3 );
+        b( (uint8_t) ( 0xc0 | ( ext << 3 ) | ( h & 7 ) ) );
+    } //shift_cl
+
+    void movsxd_rax_eax() { b( 0x48 ); b( 0x63 ); b( 0xc0 ); }
+
+    void setcc_rax( uint8_t cc ) // setcc al, movzx eax, al
+    {
+        b( 0x0f ); b( cc ); b( 0xc0 );
+        b( 0x0f ); b( 0xb6 ); b( 0xc0 );
+    } //setcc_rax
+
+    void mov_imm64( uint8_t h, uint64_t imm )
+    {
+        if ( (int64_t) imm == (int64_t) (int32_t) imm )
+        {
+            rex( true, 0, h );
+            b( 0xc7 );
+            b( (uint8_t) ( 0xc0 | ( h & 7 ) ) );
+            d32( (uint32_t) imm );
+        }
+        else
+        {
+            rex( true, 0, h );
+            b( (uint8_t) ( 0xb8 | ( h & 7 ) ) );
+            memcpy( p, & imm, 8 );
+            p += 8;
+        }
+    } //mov_imm64
+
+    // rax = rax op rcx for div/divu/rem/remu and their 32-bit w forms. Divide by zero yields 0 like the interpreter.
+
+    void divide( bool is_signed, bool remainder, bool w )
+    {
+        rr( 0x85, x_rcx, x_rcx, w );               // test rcx, rcx
+        b( 0x75 ); b( 6 );                          // jnz do_divide
+        rr( 0x31, x_rax, x_rax, false );            // xor eax, eax
+        rr( 0x31, x_rdx, x_rdx, false );            // xor edx, edx
+        b( 0xeb );                                  // jmp done
+        uint8_t * jump_offset = p++;
+        if ( is_signed )                            // do_divide:
+        {
+            if ( w )
+                b( 0x48 );
+            b( 0x99 );                              // cqo or cdq
+        }
+        else
+            rr( 0x31, x_rdx, x_rdx, false );        // xor edx, edx
+        rr( 0xf7, is_signed ? 7 : 6, x_rcx, w );    // idiv or div rcx
+        * jump_offset = (uint8_t) ( p - jump_offset - 1 );
+        if ( remainder )                            // done:
+            rr( 0x89, x_rdx, x_rax, w );            // mov rax, rdx
+    } //divide
+};
+
+// The arena is never writable and executable at once, so an emulator bug can't overwrite host code that runs. The pages
+// a block will be emitted into are made writable just for the emit, then executable again.
+
+static bool jit_protect( uint8_t * p, size_t len, bool writable )
+{
+    const uintptr_t page = 4096;
+    uintptr_t start = (uintptr_t) p & ~( page - 1 );
+    uintptr_t end = ( (uintptr_t) p + len + page - 1 ) & ~( page - 1 );
+    return 0 == mprotect( (void *) start, end - start, PROT_READ | ( writable ? PROT_WRITE : PROT_EXEC ) );
+} //jit_protect
+
+static bool jit_handles( uint8_t handler )
+{
+    return ( ( handler >= h_nop && handler <= h_lwu ) || ( handler >= h_addi && handler <= h_sd ) ||
+             ( handler >= h_add && handler <= h_remuw && h_mulhsu != handler ) );
+} //jit_handles
+
+void RiscV::jit_block( RiscVBlock & b )
+{
+    if ( 0 == jit_arena )
+    {
+        if ( jit_unavailable )
+            return;
+
+        void * arena = mmap( 0, jit_arena_size, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if ( MAP_FAILED == arena )
+        {
+            tracer.Trace( "can't allocate executable memory; blocks won't be translated\n" );
+            jit_unavailable = true;
+            return;
+        }
+        jit_arena = (uint8_t *) arena;
+    }
+
+    if ( ( jit_arena_used + jit_max_block_bytes ) > jit_arena_size )
+        return;
+
+    size_t n = 0;
+    while ( n < b.count && jit_handles( b.ops[ n ].unfused ) )
+        n++;
+
+    // the block's last op is a branch, jump, system instruction, or h_block_end
+
+    const RiscVDecoded & last = b.ops[ n ];
+    bool translate_last = ( n >= ( b.count - 1 ) ) &&
+                          ( ( last.unfused >= h_beq && last.unfused <= h_bgeu ) || h_jal == last.unfused || h_block_end == last.unfused );
+
+    if ( ( n + translate_last ) < 2 )
+        return;
+
+    // cache the most-used guest registers in host registers. load those read before written, store those written
+
+    uint32_t uses[ 32 ];
+    bool written[ 32 ], live_in[ 32 ];
+    memset( uses, 0, sizeof( uses ) );
+    memset( written, 0, sizeof( written ) );
+    memset( live_in, 0, sizeof( live_in ) );
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        const RiscVDecoded & d = b.ops[ i ];
+        if ( h_nop == d.unfused )
+            continue;
+
+        uint8_t sources[ 2 ] = { d.rs1, d.rs2 };
+        size_t source_count = ( h_lui == d.unfused || h_auipc == d.unfused ) ? 0 :
+                              ( ( d.unfused >= h_sb && d.unfused <= h_sd ) || d.unfused >= h_add ) ? 2 : 1;
+        for ( size_t s = 0; s < source_count; s++ )
+        {
+            uses[ sources[ s ] ]++;
+            if ( !written[ sources[ s ] ] )
+                live_in[ sources[ s ] ] = true;
+        }
+
+        if ( d.unfused < h_sb || d.unfused > h_sd )
+        {
+            uses[ d.rd ]++;
+            written[ d.rd ] = true;
+        }
+    }
+
+    if ( translate_last && h_jal != last.unfused && h_block_end != last.unfused )
+    {
+        uses[ last.rs1 ]++;
+        uses[ last.rs2 ]++;
+        if ( !written[ last.rs1 ] )
+            live_in[ last.rs1 ] = true;
+        if ( !written[ last.rs2 ] )
+            live_in[ last.rs2 ] = true;
+    }
+
+    x64_emitter e;
+    memset( e.host, 0xff, sizeof( e.host ) );
+    size_t cached = 0;
+    uses[ 0 ] = 0;
+
+    while ( cached < _countof( jit_cache_regs ) )
+    {
+        size_t best = 0;
+        for ( size_t r = 1; r < 32; r++ )
+            if ( uses[ r ] > uses[ best ] )
+                best = r;
+        if ( 0 == best )
+            break;
+        e.host[ best ] = jit_cache_regs[ cached++ ];
+        uses[ best ] = 0;
+    }
+
+    uint8_t * start = jit_arena + jit_arena_used;
+    if ( !jit_protect( start, jit_max_block_bytes, true ) )
+        return;
+    e.p = start;
+
+    for ( size_t c = jit_first_saved_reg; c < cached; c++ )
+    {
+        e.rex( false, 0, jit_cache_regs[ c ] );
+        e.b( (uint8_t) ( 0x50 | ( jit_cache_regs[ c ] & 7 ) ) ); // push
+    }
+
+    for ( size_t r = 1; r < 32; r++ )
+        if ( 0xff != e.host[ r ] && live_in[ r ] )
+            e.regs_mem( 0x8b, e.host[ r ], r );
+
+    for ( size_t i = 0; i < n; i++ )
+    {
+        const RiscVDecoded & d = b.ops[ i ];
+        uint8_t h = d.unfused;
+
+        if ( h_nop == h )
+            continue;
+
+        if ( h_lui == h || h_auipc == h )
+        {
+            e.mov_imm64( x_rax, ( h_lui == h ) ? d.imm : d.pc + d.imm );
+            e.store( d.rd, x_rax );
+            continue;
+        }
+
+        e.load( x_rax, d.rs1 );
+
+        if ( h >= h_lb && h <= h_lwu )
+        {
+            static const uint8_t load_ops[][ 3 ] = // rex.w, opcode bytes: lb lh lw ld lbu lhu lwu
+            {
+                { 1, 0x0f, 0xbe }, { 1, 0x0f, 0xbf }, { 1, 0x63, 0 }, { 1, 0x8b, 0 }, { 0, 0x0f, 0xb6 }, { 0, 0x0f, 0xb7 }, { 0, 0x8b, 0 },
+            };
+            const uint8_t * lop = load_ops[ h - h_lb ];
+            if ( lop[ 0 ] )
+                e.b( 0x48 );
+            e.b( lop[ 1 ] );
+            if ( 0 != lop[ 2 ] )
+                e.b( lop[ 2 ] );
+            e.guest_mem( x_rax, d.imm );
+            e.store( d.rd, x_rax );
+            continue;
+        }
+
+        if ( h >= h_sb && h <= h_sd )
+        {
+            e.load( x_rdx, d.rs2 );
+            if ( h_sh == h )
+                e.b( 0x66 );
+            else if ( h_sd == h )
+                e.b( 0x48 );
+            e.b( ( h_sb == h ) ? 0x88 : 0x89 );
+            e.guest_mem( x_rdx, d.imm );
+            continue;
+        }
+
+        if ( h >= h_add )
+            e.load( x_rcx, d.rs2 );
+
+        switch( h )
+        {
+            case h_addi: e.alu_imm( 0, x_rax, d.imm ); break;
+            case h_slti: e.alu_imm( 7, x_rax, d.imm ); e.setcc_rax( 0x9c ); break;
+            case h_sltiu: e.alu_imm( 7, x_rax, d.imm ); e.setcc_rax( 0x92 ); break;
+            case h_xori: e.alu_imm( 6, x_rax, d.imm ); break;
+            case h_ori: e.alu_imm( 1, x_rax, d.imm ); break;
+            case h_andi: e.alu_imm( 4, x_rax, d.imm ); break;
+            case h_slli: e.shift_imm( 4, x_rax, d.imm ); break;
+            case h_srli: e.shift_imm( 5, x_rax, d.imm ); break;
+            case h_srai: e.shift_imm( 7, x_rax, d.imm ); break;
+            case h_addiw: e.alu_imm( 0, x_rax, d.imm, false ); e.movsxd_rax_eax(); break;
+            case h_slliw: e.shift_imm( 4, x_rax, d.imm, false ); e.movsxd_rax_eax(); break;
+            case h_srliw: e.shift_imm( 5, x_rax, d.imm, false ); break; // zero-extended like the interpreter
+            case h_sraiw: e.shift_imm( 7, x_rax, d.imm, false ); e.movsxd_rax_eax(); break;
+            case h_add: e.rr( 0x01, x_rcx, x_rax ); break;
+            case h_sub: e.rr( 0x29, x_rcx, x_rax ); break;
+            case h_xor: e.rr( 0x31, x_rcx, x_rax ); break;
+            case h_or: e.rr( 0x09, x_rcx, x_rax ); break;
+            case h_and: e.rr( 0x21, x_rcx, x_rax ); break;
+            case h_slt: e.rr( 0x39, x_rcx, x_rax ); e.setcc_rax( 0x9c ); break;
+            case h_sltu: e.rr( 0x39, x_rcx, x_rax ); e.setcc_rax( 0x92 ); break;
+            case h_sll: e.shift_cl( 4, x_rax ); break;
+            case h_srl: e.shift_cl( 5, x_rax ); break;
+            case h_sra: e.shift_cl( 7, x_rax ); break;
+            case h_mul: e.b( 0x48 ); e.b( 0x0f ); e.b( 0xaf ); e.b( 0xc1 ); break; // imul rax, rcx
+            case h_mulh: e.rr( 0xf7, 5, x_rcx ); e.rr( 0x89, x_rdx, x_rax ); break; // imul rcx; mov rax, rdx
+            case h_mulhu: e.rr( 0xf7, 4, x_rcx ); e.rr( 0x89, x_rdx, x_rax ); break; // mul rcx; mov rax, rdx
+            case h_div: e.divide( true, false, true ); break;
+            case h_divu: e.divide( false, false, true ); break;
+            case h_rem: e.divide( true, true, true ); break;
+            case h_remu: e.divide( false, true, true ); break;
+            case h_addw: e.rr( 0x01, x_rcx, x_rax, false ); e.movsxd_rax_eax(); break;
+            case h_subw: e.rr( 0x29, x_rcx, x_rax, false ); e.movsxd_rax_eax(); break;
+            case h_sllw: e.shift_cl( 4, x_rax, false ); e.movsxd_rax_eax(); break;
+            case h_srlw: e.shift_cl( 5, x_rax, false ); break; // zero-extended like the interpreter
+            case h_sraw: e.shift_cl( 7, x_rax, false ); e.movsxd_rax_eax(); break;
+            case h_mulw: e.b( 0x0f ); e.b( 0xaf ); e.b( 0xc1 ); e.movsxd_rax_eax(); break; // imul eax, ecx
+            case h_divw: e.divide( true, false, false ); e.movsxd_rax_eax(); break;
+            case h_divuw: e.divide( false, false, false ); break;
+            case h_remw: e.divide( true, true, false ); e.movsxd_rax_eax(); break;
+            case h_remuw: e.divide( false, true, false ); break;
+            default: assert( false ); break;
+        }
+
+        e.store( d.rd, x_rax );
+    }
+
+    // eax is the return value. The register write-back and pops below don't change it.
+
+    if ( !translate_last )
+        e.mov_imm64( x_rax, jit_partial );
+    else if ( h_block_end == last.unfused )
+        e.rr( 0x31, x_rax, x_rax, false );
+    else if ( h_jal == last.unfused )
+    {
+        if ( 0 != last.rd )
+        {
+            e.mov_imm64( x_rax, last.pc + last.size );
+            e.regs_mem( 0x89, x_rax, last.rd );
+            if ( 0xff != e.host[ last.rd ] )
+                e.rr( 0x89, x_rax, e.host[ last.rd ] );
+        }
+        e.mov_imm64( x_rax, 1 );
+    }
+    else
+    {
+        static const uint8_t setcc[] = { 0x94, 0x95, 0, 0, 0x9c, 0x9d, 0x92, 0x93 }; // beq bne (unused) blt bge bltu bgeu
+        e.load( x_rax, last.rs1 );
+        e.load( x_rcx, last.rs2 );
+        e.rr( 0x39, x_rcx, x_rax ); // cmp rax, rcx
+        e.setcc_rax( setcc[ ( last.unfused - h_beq ) + ( ( last.unfused >= h_blt ) ? 2 : 0 ) ] );
+    }
+
+    for ( size_t r = 1; r < 32; r++ )
+        if ( 0xff != e.host[ r ] && written[ r ] )
+            e.regs_mem( 0x89, e.host[ r ], r );
+
+    for ( size_t c = cached; c > jit_first_saved_reg; c-- )
+    {
+        e.rex( false, 0, jit_cache_regs[ c - 1 ] );
+        e.b( (uint8_t) ( 0x58 | ( jit_cache_regs[ c - 1 ] & 7 ) ) ); // pop
+    }
+
+    e.b( 0xc3 ); // ret
+
+    assert( (size_t) ( e.p - start ) <= jit_max_block_bytes );
+    if ( !jit_protect( start, jit_max_block_bytes, false ) ) // earlier blocks in the pages can't run either
+        emulator_hard_termination( *this, "can't make translated code executable again, errno", errno );
+
+    jit_arena_used += ( e.p - start + 15 ) & ~15;
+    b.jit_code = start;
+    b.jit_ops = (uint32_t) n;
+    b.jit_bytes = (uint32_t) ( e.p - start );
+} //jit_block
+
+void RiscV::free_jit()
+{
+    if ( 0 != jit_arena )
+        munmap( jit_arena, jit_arena_size );
+    jit_arena = 0;
+} //free_jit
+
+#else
+
+void RiscV::jit_block( RiscVBlock & b ) {}
+void RiscV::free_jit() {}
+
+#endif // USE_JIT
+
+uint64_t RiscV::hash_bytes( const void * p, size_t len, uint64_t h )
+{
+    // FNV-1a, but 8 bytes at a time with a shift to mix the high bits back down
+
+    const uint8_t * pb = (const uint8_t *) p;
+    const uint64_t prime = 0x100000001b3;
+
+    while ( len >= 8 )
+    {
+        uint64_t x;
+        memcpy( & x, pb, 8 );
+        h = ( h ^ x ) * prime;
+        h ^= ( h >> 29 );
+        pb += 8;
+        len -= 8;
+    }
+
+    while ( 0 != len-- )
+        h = ( h ^ *pb++ ) * prime;
+
+    return h;
+} //hash_bytes
+
+uint64_t RiscV::block_code_hash( const RiscVBlock & b )
+{
+    const RiscVDecoded & last = b.ops[ b.count - 1 ];
+    return hash_bytes( getmem( b.pc ), (size_t) ( last.pc + last.size - b.pc ) );
+} //block_code_hash
+
+#if USE_TRANSLATION_CACHE
+
+// A translation cache file has a header, a record for each block, then the host code for translated blocks.
+// The file is keyed by a hash of the app's loaded elf segments. Each block also has a hash of its instruction
+// bytes so blocks that don't match what's in memory now are skipped. The build hash changes with each build
+// of the emulator, so files written by other builds are ignored, as are files that fail the checksum.
+// Translated code doesn't reference host addresses, so it runs in place from the read-only mapping.
+// Neither hash is a secret, so the checks can't tell who wrote a file. Since the file's host code gets run, files
+// must belong to this user and not be writable by anyone else, and aren't followed through symbolic links.
+
+static const uint64_t translation_cache_magic = 0x68636163736f7672; // "rvoscach"
+static const uint32_t translation_cache_version = 1;
+static const size_t translation_cache_code_alignment = 16;
+
+struct TranslationCacheHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t block_count;
+    uint64_t build;          // hash of this emulator build and its decoded instruction layout
+    uint64_t image_hash;     // hash of the app's loaded elf segments
+    uint64_t file_size;
+    uint64_t checksum;       // hash of everything after the header
+};
+
+struct TranslationCacheBlock
+{
+    uint64_t pc;
+    uint64_t code_hash;      // hash of the block's instruction bytes
+    uint64_t jit_offset;     // from the start of the file or 0 if not translated
+    uint32_t count;
+    uint32_t executions;
+    uint32_t jit_ops;
+    uint32_t jit_bytes;
+};
+
+static uint64_t translation_cache_build()
+{
+    static const char build[] = __DATE__ " " __TIME__;
+    uint64_t layout[] = { h_count, sizeof( RiscVDecoded ), USE_JIT };
+    return RiscV::hash_bytes( layout, sizeof( layout ), RiscV::hash_bytes( build, sizeof( build ) ) );
+} //translation_cache_build
+
+void RiscV::unmap_translation_cache()
+{
+    if ( 0 != cache_file )
+        munmap( cache_file, cache_file_size );
+    cache_file = 0;
+} //unmap_translation_cache
+
+size_t RiscV::load_translation_cache( const char * path, uint64_t image_hash )
+{
+    int fd = open( path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC );
+    if ( -1 == fd )
+    {
+        tracer.Trace( "translation cache %s doesn't exist yet or is a symbolic link, errno %d\n", path, errno );
+        return 0;
+    }
+
+    struct stat st;
+    if ( ( 0 != fstat( fd, & st ) ) || !S_ISREG( st.st_mode ) || ( st.st_uid != geteuid() ) || ( 0 != ( st.st_mode & ( S_IWGRP | S_IWOTH ) ) ) )
+    {
+        tracer.Trace( "translation cache %s isn't a file owned and only writable by this user; ignoring it\n", path );
+        close( fd );
+        return 0;
+    }
+
+    void * p = MAP_FAILED;
+    if ( st.st_size >= (off_t) sizeof( TranslationCacheHeader ) )
+        p = mmap( 0, (size_t) st.st_size, PROT_READ | ( USE_JIT ? PROT_EXEC : 0 ), MAP_PRIVATE, fd, 0 );
+    close( fd );
+
+    if ( MAP_FAILED == p )
+    {
+        tracer.Trace( "can't map translation cache %s\n", path );
+        return 0;
+    }
+
+    const uint8_t * file = (const uint8_t *) p;
+    size_t file_size = (size_t) st.st_size;
+    const TranslationCacheHeader & h = * (const TranslationCacheHeader *) file;
+    const TranslationCacheBlock * records = (const TranslationCacheBlock *) ( file + sizeof( h ) );
+    size_t code_start = sizeof( h ) + (size_t) h.block_count * sizeof( TranslationCacheBlock );
+
+    if ( ( translation_cache_magic != h.magic ) || ( translation_cache_version != h.version ) || ( translation_cache_build() != h.build ) ||
+         ( image_hash != h.image_hash ) || ( file_size != h.file_size ) || ( code_start > file_size ) ||
+         ( hash_bytes( file + sizeof( h ), file_size - sizeof( h ) ) != h.checksum ) )
+    {
+        tracer.Trace( "translation cache %s is stale or corrupt; ignoring it\n", path );
+        munmap( p, file_size );
+        return 0;
+    }
+
+    cache_file = p;
+    cache_file_size = file_size;
+
+    for ( uint32_t i = 0; i < h.block_count; i++ )
+    {
+        const TranslationCacheBlock & r = records[ i ];
+
+        if ( ( max_blocks == block_count ) || ( ( block_op_count + max_block_length + 1 ) > max_block_ops ) )
+            break;
+
+        if ( ( r.pc < base ) || ( ( r.pc + 4 ) > ( base + mem_size ) ) || ( 0 != ( r.pc & 1 ) ) )
+            continue;
+
+        RiscVBlock * & slot = block_hash[ ( r.pc >> 1 ) & ( block_hash_entries - 1 ) ];
+        RiscVBlock * prior = slot;
+        if ( ( 0 != prior ) && ( r.pc == prior->pc ) )
+            continue;
+
+        // decode the block from memory and make sure it's the same code as when the file was written
+
+        RiscVBlock * b = build_block( r.pc );
+        if ( ( r.count != b->count ) || ( r.code_hash != block_code_hash( *b ) ) )
+        {
+            tracer.Trace( "translation cache block at %llx doesn't match memory; skipping it\n", r.pc );
+            slot = prior;
+            block_count--;
+            block_op_count = b->ops - block_ops;
+            continue;
+        }
+
+        b->executions = r.executions;
+        cache_blocks_loaded++;
+
+#if USE_JIT
+        if ( ( 0 != r.jit_offset ) && ( r.jit_ops <= b->count ) && ( r.jit_offset >= code_start ) &&
+             ( r.jit_bytes <= jit_max_block_bytes ) && ( ( r.jit_offset + r.jit_bytes ) <= file_size ) )
+        {
+            b->jit_code = (void *) ( file + r.jit_offset );
+            b->jit_ops = r.jit_ops;
+            b->jit_bytes = r.jit_bytes;
+            cache_jit_loaded++;
+        }
+#endif
+    }
+
+    tracer.Trace( "loaded %zu blocks and %zu translations from translation cache %s\n", cache_blocks_loaded, cache_jit_loaded, path );
+    return cache_blocks_loaded;
+} //load_translation_cache
+
+bool RiscV::save_translation_cache( const char * path, uint64_t image_hash )
+{
+    size_t translated = 0;
+    for ( size_t i = 0; i < block_count; i++ )
+        if ( 0 != blocks[ i ].jit_code )
+            translated++;
+
+    if ( ( block_count <= cache_blocks_loaded ) && ( translated <= cache_jit_loaded ) )
+    {
+        tracer.Trace( "translation cache %s is up to date\n", path );
+        return true;
+    }
+
+    size_t code_start = sizeof( TranslationCacheHeader ) + block_count * sizeof( TranslationCacheBlock );
+    code_start = ( code_start + translation_cache_code_alignment - 1 ) & ~( translation_cache_code_alignment - 1 );
+    size_t file_size = code_start;
+    for ( size_t i = 0; i < block_count; i++ )
+        if ( 0 != blocks[ i ].jit_code )
+            file_size += ( blocks[ i ].jit_bytes + translation_cache_code_alignment - 1 ) & ~( translation_cache_code_alignment - 1 );
+
+    vector<uint8_t> file( file_size, 0 );
+    TranslationCacheHeader & h = * (TranslationCacheHeader *) file.data();
+    TranslationCacheBlock * records = (TranslationCacheBlock *) ( file.data() + sizeof( h ) );
+    size_t code_offset = code_start;
+
+    for ( size_t i = 0; i < block_count; i++ )
+    {
+        const RiscVBlock & b = blocks[ i ];
+        TranslationCacheBlock & r = records[ i ];
+        r.pc = b.pc;
+        r.code_hash = block_code_hash( b );
+        r.count = (uint32_t) b.count;
+        r.executions = b.executions;
+
+        if ( 0 != b.jit_code )
+        {
+            memcpy( file.data() + code_offset, b.jit_code, b.jit_bytes );
+            r.jit_offset = code_offset;
+            r.jit_ops = b.jit_ops;
+            r.jit_bytes = b.jit_bytes;
+            code_offset += ( b.jit_bytes + translation_cache_code_alignment - 1 ) & ~( translation_cache_code_alignment - 1 );
+        }
+    }
+
+    h.magic = translation_cache_magic;
+    h.version = translation_cache_version;
+    h.block_count = (uint32_t) block_count;
+    h.build = translation_cache_build();
+    h.image_hash = image_hash;
+    h.file_size = file_size;
+    h.checksum = hash_bytes( file.data() + sizeof( h ), file_size - sizeof( h ) );
+
+    // write to a temporary file then rename it so other instances of the emulator never see a partial file.
+    // mkstemp creates a new file readable only by this user, so an existing file or link can't be written through
+
+    char acTemp[ 1024 ];
+    snprintf( acTemp, sizeof( acTemp ), "%s.XXXXXX", path );
+    int fd = mkstemp( acTemp );
+    FILE * fp = ( -1 == fd ) ? 0 : fdopen( fd, "wb" );
+    if ( !fp )
+    {
+        tracer.Trace( "can't create translation cache file %s, errno %d\n", acTemp, errno );
+        if ( -1 != fd )
+        {
+            close( fd );
+            remove( acTemp );
+        }
+        return false;
+    }
+
+    bool ok = ( 1 == fwrite( file.data(), file_size, 1, fp ) );
+    ok = ( 0 == fclose( fp ) ) && ok;
+    if ( ok )
+        ok = ( 0 == rename( acTemp, path ) );
+
+    if ( !ok )
+        remove( acTemp );
+
+    tracer.Trace( "saved %zu blocks and %zu translations to translation cache %s: %s\n", block_count, translated, path, ok ? "ok" : "failed" );
+    return ok;
+} //save_translation_cache
+
+#else
+
+size_t RiscV::load_translation_cache( const char * path, uint64_t image_hash ) { return 0; }
+bool RiscV::save_translation_cache( const char * path, uint64_t image_hash ) { return false; }
+void RiscV::unmap_translation_cache() {}
+
+#endif // USE_TRANSLATION_CACHE
+
+
+void RiscV::execute_general( uint64_t & pcnext, uint64_t cycles )
+{
+    // instructions that aren't common enough to have a handler in run()
+
+    switch( opcode_type )
+    {
+#if USE_DJL_RISCV_EXTENSIONS
+        case 2: // risc-v extension cmvxx conditional move
+        {
+            assert_type( CType );
+            decode_C();
+
+            if ( 0 == rd )
+                break;
+
+            // cmvXX are risc-v extension conditional-move instructions. They yield about 1% faster perf for some benchmarks
+            // cmvXX rd, rs1, rc1, rc2  -- if ( rc1 XX rc2 ) rd = rs1
+            // 31: 1 if rc2 is an immediate value (signed/unsigned depending on the compare) or 0 if a register
+            // 30: 1 if rs1 is an immediate value (always signed) or 0 if a register
+            // 29-25: rc1
+            // 24-20: rc2
+            // 19-15: rs1
+            // 14-12: funct3 XX comparison 0 = eq, 1 = ne, 4 = lt, 5 = ge, 6 = ltu, 7 = geu
+            // 11-7:  rd
+            // 6-2:   2 (opcode type cmv)
+            // 1-0:   3 (4-byte instruction)
+
+            uint64_t source = ( 0 == ( c_imm_flags & 1 ) ) ? regs[ rs1 ] : sign_extend( rs1, 4 );
+            uint64_t cmp_right = ( 0 == ( c_imm_flags & 2 ) ) ? regs[ c_rc2 ] : ( 6 == funct3 || 7 == funct3 ) ? c_rc2 : sign_extend( c_rc2, 4 );
+
+            if ( 0 == funct3 ) // cmveq
+            {
+                if ( regs[ c_rc1 ] == cmp_right )
+                    regs[ rd ] = source;
+            }
+            else if ( 1 == funct3 ) // cmvne
+            {
+                if ( regs[ c_rc1 ] != cmp_right )
+                    regs[ rd ] = source;
+            }
+            else if ( 4 == funct3 ) // cmvlt
+            {
+                if ( (int64_t) regs[ c_rc1 ] < (int64_t) cmp_right )
+                    regs[ rd ] = source;
+            }
+            else if ( 5 == funct3 ) // cmvge
+            {
+                if ( (int64_t) regs[ c_rc1 ] >= (int64_t) cmp_right )
+                    regs[ rd ] = source;
+            }
+            else if ( 6 == funct3 ) // cmvltu
+            {
+                if ( regs[ c_rc1 ] >= cmp_right )
+                    regs[ rd ] = source;
+            }
+            else if ( 7 == funct3 ) // cmvgtu
+            {
+                if ( regs[ c_rc1 ] >= cmp_right )
+                    regs[ rd ] = source;
+            }
+            else
+                unhandled();
+            
+            break;
+        }
+#else
+        case 2: // risc-v extension instructions.
+        {
+            // The rust compiler's libc I'm using uses these extension instructions in tcache_init.part.0, called by __malloc.
+            // I think these are the T-Head / Alibaba extensions:
+            //   0x01a0000b: th.sync.i. all instructions retire prior to this one and the instruction pipeline is flushed.
+            //       https://github.com/T-head-Semi/thead-extension-spec/blob/master/xtheadsync/sync_i.adoc
+            //   0x024xx00b: th.dcache.isw. invalidate D-cache by set/way
+            //       https://github.com/T-head-Semi/thead-extension-spec/blob/master/xtheadcmo/dcache_isw.adoc
+            // There is no pipelining or data caching in the emulator. th.sync.i is treated like fence.i.
+
+            if ( 0x01a0000b == op ) // th.sync.i
+            {
+                flush_instruction_cache();
+                break;
+            }
+
+            if ( ( 0x02400000 == ( op & 0xfff00000 ) ) && ( 0 == ( op & 0x7ff0 ) ) ) // th.dcache.isw rs1
+                break;
+
+            // I can't figure out what these extension instructions are supposed to do, but g++ emits them,
+            // gdb shows them as injected data instead of instructions, and real risc-v CPUs execute them.
+
+            //if ( ( 0x3023318b == op ) || ( 0x0785310b ) == op )
+            //    break;
+
+            // crash on anything else so it can be debugged
+
+            unhandled();
+            break;
+        }
+#endif
+        case 3:
+        {
+            assert_type( IType );
+            decode_I();
+
+            if ( 0 == funct3 ) // fence
+                std::atomic_thread_fence( std::memory_order_seq_cst ); // other harts may be running on other host cores
+            else if ( 1 == funct3 ) // fence.i
+                flush_instruction_cache(); // code may have been written, so cached decoded instructions may be stale
+            else
+                unhandled();
+            break;
+        }
+#if USE_DJL_RISCV_EXTENSIONS
+        case 0xa:
+        {
+            assert_type( RType );
+            decode_R();
+
+            // conditional return. If the condition is true, jump to the address in rreturn (typically ra)
+            // jrXX rleft, rright, rreturn
+            // if ( rleft XX rright ) pc = rreturn
+            // R-type instruction
+            //    rs1 -- rleft
+            //    rs2 -- rright
+            //    rd -- typically ra
+            //    funct3 -- 0 = eq, 1 = ne, 4 = lt, 5 = ge, 6 = ltu, 7 = gtu
+            //    funct7 -- 0
+            //    opcode -- lower 7 bits 0x2b. opcode type -- 0xa
+
+            if ( 0 == funct7 )
+            {
+                if ( 0 == funct3 ) // jreq
+                {
+                    if ( regs[ rs1 ] == regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else if ( 1 == funct3 ) // jrne
+                {
+                    if ( regs[ rs1 ] != regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else if ( 4 == funct3 ) // jrlt
+                {
+                    if ( (int64_t) regs[ rs1 ] < (int64_t) regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else if ( 5 == funct3 ) // jrge
+                {
+                    if ( (int64_t) regs[ rs1 ] >= (int64_t) regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else if ( 6 == funct3 ) // jrltu
+                {
+                    if ( regs[ rs1 ] < regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else if ( 7 == funct3 ) // jrgtu
+                {
+                    if ( regs[ rs1 ] > regs[ rs2 ] )
+                        pcnext = regs[ rd ];
+                }
+                else
+                    unhandled();
+            }
+            else
+                unhandled();
+            
+            break;
+        }
+#endif
+        case 0xb:
+        {
+            assert_type( RType );
+            decode_R();
+
+            uint32_t top5 = (uint32_t) ( funct7 >> 2 );
+            std::memory_order mo = amo_order( funct7 );
+            uint64_t address = regs[ rs1 ];
+
+            if ( 2 != funct3 && 3 != funct3 )
+                unhandled();
+            if ( 0 != ( address & ( ( 2 == funct3 ) ? 3 : 7 ) ) )
+                emulator_hard_termination( *this, "atomic memory operation address isn't naturally aligned:", address );
+
+            uint8_t * p = getmem( address );
+            uint64_t result;
+
+            if ( 2 == top5 ) // lr.w and lr.d rd, (rs1)
+            {
+                reservation_version = line_version( p ).load( std::memory_order_seq_cst );
+                if ( 2 == funct3 )
+                    reservation_value = guest_bytes( atomic_at<uint32_t>( p ).load( lr_order( funct7 ) ) );
+                else
+                    reservation_value = guest_bytes( atomic_at<uint64_t>( p ).load( lr_order( funct7 ) ) );
+                reservation_address = address;
+                result = ( 2 == funct3 ) ? (uint64_t) (int64_t) (int32_t) reservation_value : reservation_value;
+            }
+            else if ( 3 == top5 ) // sc.w and sc.d rd, rs2, (rs1). rd is 0 on success
+            {
+                result = 1;
+                uint64_t version = reservation_version;
+                if ( ( address == reservation_address ) && line_version( p ).compare_exchange_strong( version, version + 1, std::memory_order_seq_cst ) )
+                {
+                    bool stored;
+                    if ( 2 == funct3 )
+                    {
+                        uint32_t expected = guest_bytes( (uint32_t) reservation_value );
+                        stored = atomic_at<uint32_t>( p ).compare_exchange_strong( expected, guest_bytes( (uint32_t) regs[ rs2 ] ), mo, std::memory_order_relaxed );
+                    }
+                    else
+                    {
+                        uint64_t expected = guest_bytes( reservation_value );
+                        stored = atomic_at<uint64_t>( p ).compare_exchange_strong( expected, guest_bytes( regs[ rs2 ] ), mo, std::memory_order_relaxed );
+                    }
+                    result = stored ? 0 : 1;
+                }
+                reservation_address = ~(uint64_t) 0; // sc always clears the reservation
+            }
+            else if ( 2 == funct3 )
+            {
+                uint32_t v = (uint32_t) regs[ rs2 ];
+                uint32_t memval;
+
+                switch ( top5 )
+                {
+                    case 0: memval = amo_add<uint32_t>( p, v, mo ); break;     // amoadd.w rd, rs2, (rs1)
+                    case 1: memval = amo_swap<uint32_t>( p, v, mo ); break;    // amoswap.w
+                    case 4: memval = amo_xor<uint32_t>( p, v, mo ); break;     // amoxor.w
+                    case 8: memval = amo_or<uint32_t>( p, v, mo ); break;      // amoor.w
+                    case 0xc: memval = amo_and<uint32_t>( p, v, mo ); break;   // amoand.w
+                    case 0x10: memval = amo_update<uint32_t>( p, mo, [v]( uint32_t x ) { return get_min( (int32_t) v, (int32_t) x ); } ); break; // amomin.w
+                    case 0x14: memval = amo_update<uint32_t>( p, mo, [v]( uint32_t x ) { return get_max( (int32_t) v, (int32_t) x ); } ); break; // amomax.w
+                    case 0x18: memval = amo_update<uint32_t>( p, mo, [v]( uint32_t x ) { return get_min( v, x ); } ); break; // amominu.w
+                    case 0x1c: memval = amo_update<uint32_t>( p, mo, [v]( uint32_t x ) { return get_max( v, x ); } ); break; // amomaxu.w
+                    default: { unhandled(); memval = 0; }
+                }
+
+                line_version( p ).fetch_add( 1, std::memory_order_relaxed ); // break reservations on this line
+                result = (uint64_t) (int64_t) (int32_t) memval; // AMOs always sign-extend value placed in rd
+            }
+            else
+            {
+                uint64_t v = regs[ rs2 ];
+
+                switch ( top5 )
+                {
+                    case 0: result = amo_add<uint64_t>( p, v, mo ); break;     // amoadd.d rd, rs2, (rs1)
+                    case 1: result = amo_swap<uint64_t>( p, v, mo ); break;    // amoswap.d
+                    case 4: result = amo_xor<uint64_t>( p, v, mo ); break;     // amoxor.d
+                    case 8: result = amo_or<uint64_t>( p, v, mo ); break;      // amoor.d
+                    case 0xc: result = amo_and<uint64_t>( p, v, mo ); break;   // amoand.d
+                    case 0x10: result = amo_update<uint64_t>( p, mo, [v]( uint64_t x ) { return get_min( (int64_t) v, (int64_t) x ); } ); break; // amomin.d
+                    case 0x14: result = amo_update<uint64_t>( p, mo, [v]( uint64_t x ) { return get_max( (int64_t) v, (int64_t) x ); } ); break; // amomax.d
+                    case 0x18: result = amo_update<uint64_t>( p, mo, [v]( uint64_t x ) { return get_min( v, x ); } ); break; // amominu.d
+                    case 0x1c: result = amo_update<uint64_t>( p, mo, [v]( uint64_t x ) { return get_max( v, x ); } ); break; // amomaxu.d
+                    default: { unhandled(); result = 0; }
+                }
+
+                line_version( p ).fetch_add( 1, std::memory_order_relaxed );
+            }
+
+            if ( 0 != rd )
+                regs[ rd ] = result;
+            break;
+        }
+        case 0x14: // all but fclass are handled in run()
+        {
+            assert_type( RType );
+            decode_R();
+
+            if ( 0x70 == funct7 && 0 == rs2 && 1 == funct3 ) // fclass.s
+            {
+                // rd bit Meaning
+                // 0 rs1 is - infinity
+                // 1 rs1 is a negative normal number.
+                // 2 rs1 is a negative subnormal number.
+                // 3 rs1 is -0
+                // 4 rs1 is +0
+                // 5 rs1 is a positive subnormal number.
+                // 6 rs1 is a positive normal number.
+                // 7 rs1 is + infinity
+                // 8 rs1 is a signaling NaN.
+                // 9 rs1 is a quiet NaN
+
+                uint64_t result = 0;
+                float f = fregs[ rs1 ].f;
+                if ( isnan( f ) )
+                {
+                    #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
+                    if ( issignaling( f ) )
+                        result = 0x100;
+                    else
+                    #endif
+                        result = 0x200;
+                }
+                #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
+                else if ( issubnormal( f ) )
+                {
+                    if ( f >= 0.0 )
+                        result = 0x20;
+                    else
+                        result = 4;
+                }
+                #endif
+                else if ( !isfinite( f ) )
+                {
+                    if ( f >= 0.0 )
+                        result = 0x80;
+                    else
+                        result = 1;
+                }
+                else
+                {
+                    if ( f >= 0.0 )
+                        result = 0x40;
+                    else
+                        result = 2;
+                }
+                if ( 0 != rd )
+                    regs[ rd ] = result;
+            }
+            else if ( 0x71 == funct7 && 0 == rs2 && 1 == funct3 ) // fclass.d
+            {
+                uint64_t result = 0;
+                double d = fregs[ rs1 ].d;
+                if ( isnan( d ) )
+                {
+                    #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
+                    if ( issignaling( d ) )
+                        result = 0x100;
+                    else
+                    #endif
+                        result = 0x200;
+                }
+                #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
+                else if ( issubnormal( d ) )
+                {
+                    if ( d >= 0.0 )
+                        result = 0x20;
+                    else
+                        result = 4;
+                }
+                #endif
+                else if ( !isfinite( d ) )
+                {
+                    if ( d >= 0.0 )
+                        result = 0x80;
+                    else
+                        result = 1;
+                }
+                else
+                {
+                    if ( d >= 0.0 )
+                        result = 0x40;
+                    else
+                        result = 2;
+                }
+                if ( 0 != rd )
+                    regs[ rd ] = result;
+            }
+            else
+                unhandled();
+            break;
+        }
+        case 0x1c:
+        {
+            assert_type( IType );
+            decode_I();
+            uint64_t csr = i_imm_u;
+            uint64_t value = 0;
+
+            // funct3
+            //    000  system (ecall / ebreak)
+            //    001  csrrw write csr
+            //    010  csrrs read csr
+            //    011  csrrc clear bits in csr
+            //    101  csrrwi write csr immediate
+            //    110  csrrsi set bits in csr immediate
+            //    111  csrrci clear bits in csr immediate
+
+            if ( 0 == funct3 ) // system
+            {
+                if ( 0x73 == op )
+                    emulator_invoke_svc( *this ); // ecall. don't route through mtvec as a simplification
+                else if ( 0x100073 == op )
+                {
+                    // ebreak.  Ignore for now
+                }
+                else
+                    unhandled();
+            }
+            else if ( 1 == funct3 ) // csrrw. csr write
+            {
+                if ( 0x1 == csr )
+                    regs[ rd ] = 0; // csrrw   rd, fflags, rs1.  read fp exception flags. 0 means all clear
+                else if ( 0x2 == csr )
+                    regs[ rd ] = 0; // csrrw   rd, frm, rs1.  read rounding mode. 0 means nearest
+                else if ( 0xc00 == csr ) // csrrw rd, cycle, rs1
+                {
+                    if ( 0 != rd )
+                        regs[ rd ] = 1000 * clock(); // fake microseconds
+                }
+                else if ( access_vector_csr( csr, value = regs[ rs1 ], true ) )
+                {
+                    if ( 0 != rd )
+                        regs[ rd ] = value;
+                }
+                else
+                {
+                    tracer.Trace( "attempt to read csr %x\n", csr );
+                    unhandled();
+                }
+            }
+            else if ( 2 == funct3 ) // csrrs. csr read
+            {
+                if ( 0 == rd )
+                    break;
+
+                if ( 0x1 == csr )
+                    regs[ rd ] = 0; // csrrs   rd, fflags, rs1.  read fp exception flags. 0 means all clear
+                else if ( 0x2 == csr )
+                    regs[ rd ] = 0; // csrrs   rd, frm, rs1.  read rounding mode. 0 means nearest
+                else if ( 0x301 == csr ) // csrrs rd, misa, rs1. the base isa and single-letter extensions
+                    regs[ rd ] = csr_misa;
+                else if ( 0xb00 == csr ) // csrrs rd, mcycle, rs1. rdmcycle
+                    regs[ rd ] = cycles;
+                else if ( 0xb02 == csr ) // csrrs rd, minstret, rs1. rdminstret
+                    regs[ rd ] = cycles; // assumes one cycle per instruction
+                else if ( 0xc00 == csr ) // csrrs rd, cycle, rs1. rdcycle
+                    regs[ rd ] = cycles;
+                else if ( 0xc01 == csr ) // csrrs rd, time, rs1. rdtime
+                {
+                    system_clock::duration d = system_clock::now().time_since_epoch();
+                    regs[ rd ] = duration_cast<nanoseconds>( d ).count();
+                }
+                else if ( 0xc02 == csr ) // csrrs rd, instret, rs1. rdinstret
+                    regs[ rd ] = cycles; // assumes one cycle per instruction
+                else if ( 0xf11 == csr ) // mvendorid vendor
+                    regs[ rd ] = 0xbeabad00bee;
+                else if ( 0xf12 == csr ) // marchid architecture
+                    regs[ rd ] = 0xbeabad00bee;
+                else if ( 0xf13 == csr ) // mimpid implementation
+                    regs[ rd ] = 0xbeabad00bee;
+                else if ( 0xf14 == csr ) // mhardid
+                    regs[ rd ] = 0; // only one hart is supported and one must have id 0
+                else if ( access_vector_csr( csr, value, false ) )
+                    regs[ rd ] = value;
+                else
+                {
+                    tracer.Trace( "attempt to read csr %x\n", csr );
+                    unhandled();
+                }
+            }
+            else if ( 5 == funct3 ) // csrrwi. write csr immediate
+            {
+                if ( access_vector_csr( csr, value = rs1, true ) )
+                {
+                    if ( 0 != rd )
+                        regs[ rd ] = value;
+                }
+                else
+                {
+                    tracer.Trace( "attempt to write csr %x\n", csr );
+                    unhandled();
+                }
+            }
+            else if ( 6 == funct3 ) // csrrsi. set bits in csr immediate
+            {
+                if ( 1 == csr )
+                {
+                    // csrrsi rd, fflags, rs1 --- set fp csr flags like rounding mode (ignore). also, return the flags
+
+                    if ( 0 != rd )
+                        regs[ rd ] = 0;
+                }
+                else
+                {
+                    tracer.Trace( "attempt to set bits in csr %x\n", csr );
+                    unhandled();
+                }
+            }
+            else
+                unhandled();
+            break;
+        }
+        default:
+        {
+            decode_R(); // for unhandled() to show
+            decode_I();
+            decode_S();
+            decode_U();
+            unhandled();
+        }
+    } // switch( opcode_type )
+} //execute_general
+
+// RVV 1.0 vector extension with VLEN 512 and ELEN 64. Element loops are written so the host compiler turns them
+// into SSE/AVX2 or NEON code, and unmasked unit-stride loads and stores are a single memcpy. Tail and inactive
+// elements are always left undisturbed, which is legal for both the agnostic and undisturbed policies.
+
+template < typename T > struct vector_wider { typedef T type; }; // 64-bit elements have no wider type
+template <> struct vector_wider< uint8_t > { typedef uint16_t type; };
+template <> struct vector_wider< uint16_t > { typedef uint32_t type; };
+template <> struct vector_wider< uint32_t > { typedef uint64_t type; };
+
+static inline bool vector_mask_bit( const uint8_t * v, uint64_t i )
+{
+    return 0 != ( ( v[ i >> 3 ] >> ( i & 7 ) ) & 1 );
+} //vector_mask_bit
+
+static inline void vector_set_mask_bit( uint8_t * v, uint64_t i, bool x )
+{
+    uint8_t m = (uint8_t) ( 1 << ( i & 7 ) );
+    if ( x )
+        v[ i >> 3 ] |= m;
+    else
+        v[ i >> 3 ] &= (uint8_t) ~m;
+} //vector_set_mask_bit
+
+static inline uint64_t vector_sew_bytes( uint64_t vtype )
+{
+    return (uint64_t) 1 << ( ( vtype >> 3 ) & 7 );
+} //vector_sew_bytes
+
+static inline uint64_t vector_vlmax( uint64_t vtype )
+{
+    uint64_t elements = RiscV::vlenb >> ( ( vtype >> 3 ) & 7 ); // elements per register
+    uint64_t lmul = vtype & 7;
+    return ( lmul < 4 ) ? ( elements << lmul ) : ( elements >> ( 8 - lmul ) );
+} //vector_vlmax
+
+static inline uint64_t vector_round_increment( uint64_t v, uint64_t shift, uint64_t vxrm )
+{
+    // the amount to add to v >> shift to round it per the fixed-point rounding mode
+
+    if ( 0 == shift )
+        return 0;
+
+    uint64_t half = ( v >> ( shift - 1 ) ) & 1;
+    bool rest = ( 0 != ( v & ( ( (uint64_t) 1 << ( shift - 1 ) ) - 1 ) ) );
+    uint64_t lsb = ( v >> shift ) & 1;
+
+    if ( 0 == vxrm ) // rnu: round to nearest up
+        return half;
+    if ( 1 == vxrm ) // rne: round to nearest even
+        return half & ( ( rest ? 1 : 0 ) | lsb );
+    if ( 2 == vxrm ) // rdn: truncate
+        return 0;
+    return ( 0 == lsb && ( half || rest ) ) ? 1 : 0; // rod: jam into the low bit
+} //vector_round_increment
+
+template < typename F > static inline F vector_canonical( F f )
+{
+    return ( f != f ) ? canonical_nan< F >() : f; // RISC-V never returns a negative or payload-carrying NAN
+} //vector_canonical
+
+template < typename F > static F vector_fmin( F a, F b )
+{
+    if ( isnan( a ) )
+        return isnan( b ) ? canonical_nan< F >() : b;
+    if ( isnan( b ) )
+        return a;
+    if ( ( 0 == a ) && ( 0 == b ) )
+        return signbit( a ) ? a : b;
+    return ( a < b ) ? a : b;
+} //vector_fmin
+
+template < typename F > static F vector_fmax( F a, F b )
+{
+    if ( isnan( a ) )
+        return isnan( b ) ? canonical_nan< F >() : b;
+    if ( isnan( b ) )
+        return a;
+    if ( ( 0 == a ) && ( 0 == b ) )
+        return signbit( a ) ? b : a;
+    return ( a > b ) ? a : b;
+} //vector_fmax
+
+template < typename F, typename T > static T vector_fclass( F f, T bits )
+{
+    bool negative = signbit( f );
+    switch ( fpclassify( f ) )
+    {
+        case FP_INFINITE: return negative ? 1 : 0x80;
+        case FP_NORMAL: return negative ? 2 : 0x40;
+        case FP_SUBNORMAL: return negative ? 4 : 0x20;
+        case FP_ZERO: return negative ? 8 : 0x10;
+        default:
+        {
+            T quiet = (T) 1 << ( ( 4 == sizeof( F ) ) ? 22 : 51 );
+            return ( bits & quiet ) ? 0x200 : 0x100;
+        }
+    }
+} //vector_fclass
+
+// vfrec7 and vfrsqrt7 return the spec's 7-bit estimates from these tables so results match hardware bit for bit.
+// They work on the raw bits of 32 or 64-bit floats. rvos always rounds to nearest, so a reciprocal that overflows is
+// infinity, and it doesn't track fflags, so no exception flags are raised.
+
+static const uint8_t vector_rec7_table[ 128 ] =
+{
+    127, 125, 123, 121, 119, 117, 116, 114, 112, 110, 109, 107, 105, 104, 102, 100,
+    99, 97, 96, 94, 93, 91, 90, 88, 87, 85, 84, 83, 81, 80, 79, 77,
+    76, 75, 74, 72, 71, 70, 69, 68, 66, 65, 64, 63, 62, 61, 60, 59,
+    58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47, 46, 45, 44, 43,
+    42, 41, 40, 40, 39, 38, 37, 36, 35, 35, 34, 33, 32, 31, 31, 30,
+    29, 28, 28, 27, 26, 25, 25, 24, 23, 23, 22, 21, 21, 20, 19, 19,
+    18, 17, 17, 16, 15, 15, 14, 14, 13, 12, 12, 11, 11, 10, 9, 9,
+    8, 8, 7, 7, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0,
+};
+
+static const uint8_t vector_rsqrt7_table[ 128 ] = // indexed by the exponent's low bit and the 6 high significand bits
+{
+    52, 51, 50, 48, 47, 46, 44, 43, 42, 41, 40, 39, 38, 36, 35, 34,
+    33, 32, 31, 30, 30, 29, 28, 27, 26, 25, 24, 23, 23, 22, 21, 20,
+    19, 19, 18, 17, 16, 16, 15, 14, 14, 13, 12, 12, 11, 10, 10, 9,
+    9, 8, 7, 7, 6, 6, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0,
+    127, 125, 123, 121, 119, 118, 116, 114, 113, 111, 109, 108, 106, 105, 103, 102,
+    100, 99, 97, 96, 95, 93, 92, 91, 90, 88, 87, 86, 85, 84, 83, 82,
+    80, 79, 78, 77, 76, 75, 74, 73, 72, 71, 70, 70, 69, 68, 67, 66,
+    65, 64, 63, 63, 62, 61, 60, 59, 59, 58, 57, 56, 56, 55, 54, 53,
+};
+
+template < typename T > struct vector_float_bits
+{
+    static const uint64_t sig_bits = ( 4 == sizeof( T ) ) ? 23 : 52;
+    static const uint64_t exp_max = ( 4 == sizeof( T ) ) ? 0xff : 0x7ff;
+    static const uint64_t bias = exp_max >> 1;
+    static const uint64_t sig_mask = ( (uint64_t) 1 << sig_bits ) - 1;
+    static const T sign = (T) ( (T) 1 << ( 8 * sizeof( T ) - 1 ) );
+    static const T infinity = (T) ( exp_max << sig_bits );
+    static const T nan = (T) ( ( exp_max << sig_bits ) | ( (uint64_t) 1 << ( sig_bits - 1 ) ) );
+
+    // subnormals become a negative or zero exponent and a significand with the leading 1 shifted out
+    static void normalize( int64_t & exp, uint64_t & sig )
+    {
+        while ( 0 == ( sig & ( (uint64_t) 1 << ( sig_bits - 1 ) ) ) )
+        {
+            exp--;
+            sig <<= 1;
+        }
+        sig = ( sig << 1 ) & sig_mask;
+    }
+};
+
+template < typename T > static T vector_frec7( T x )
+{
+    typedef vector_float_bits< T > FB;
+    T sign = x & FB::sign;
+    int64_t exp = (int64_t) ( ( x >> FB::sig_bits ) & FB::exp_max );
+    uint64_t sig = (uint64_t) x & FB::sig_mask;
+
+    if ( FB::exp_max == (uint64_t) exp )
+        return sig ? (T) FB::nan : sign;                         // 1 / infinity is 0
+    if ( 0 == exp )
+    {
+        if ( 0 == ( sig >> ( FB::sig_bits - 2 ) ) )           // zero or a subnormal small enough to overflow
+            return sign | FB::infinity;
+        FB::normalize( exp, sig );
+    }
+
+    int64_t out_exp = (int64_t) ( 2 * FB::bias ) - 1 - exp;
+    uint64_t out_sig = (uint64_t) vector_rec7_table[ sig >> ( FB::sig_bits - 7 ) ] << ( FB::sig_bits - 7 );
+    if ( out_exp <= 0 )                                      // the reciprocal of a large number is subnormal
+    {
+        out_sig = ( out_sig | ( (uint64_t) 1 << FB::sig_bits ) ) >> ( 1 - out_exp );
+        out_exp = 0;
+    }
+    return sign | (T) ( (uint64_t) out_exp << FB::sig_bits ) | (T) out_sig;
+} //vector_frec7
+
+template < typename T > static T vector_frsqrt7( T x )
+{
+    typedef vector_float_bits< T > FB;
+    T sign = x & FB::sign;
+    int64_t exp = (int64_t) ( ( x >> FB::sig_bits ) & FB::exp_max );
+    uint64_t sig = (uint64_t) x & FB::sig_mask;
+
+    if ( 0 == exp && 0 == sig )
+        return sign | FB::infinity;
+    if ( sign || ( FB::exp_max == (uint64_t) exp && sig ) )  // negative numbers and NANs
+        return FB::nan;
+    if ( FB::exp_max == (uint64_t) exp )
+        return 0;                                            // 1 / sqrt( infinity ) is 0
+    if ( 0 == exp )
+        FB::normalize( exp, sig );
+
+    uint64_t index = ( (uint64_t) ( exp & 1 ) << 6 ) | ( sig >> ( FB::sig_bits - 6 ) );
+    int64_t out_exp = ( (int64_t) ( 3 * FB::bias ) - 1 - exp ) / 2;
+    uint64_t out_sig = (uint64_t) vector_rsqrt7_table[ index ] << ( FB::sig_bits - 7 );
+    return (T) ( ( (uint64_t) out_exp << FB::sig_bits ) | out_sig );
+} //vector_frsqrt7
+
+template < typename T, typename U > static void vector_extend( T * d, const uint8_t * source, bool sign, bool vm, const uint8_t * mask, uint64_t start, uint64_t vl )
+{
+    typedef typename std::make_signed< T >::type S;
+    typedef typename std::make_signed< U >::type SU;
+    const U * s = (const U *) source;
+
+    for ( uint64_t i = start; i < vl; i++ )
+        if ( vm || vector_mask_bit( mask, i ) )
+            d[ i ] = sign ? (T) (S) (SU) s[ i ] : (T) s[ i ];
+} //vector_extend
+
+void RiscV::vector_check_group( uint64_t reg, uint64_t bytes )
+{
+    // the spec requires register groups to be aligned. this just keeps them within the register file
+
+    if ( ( reg * vlenb + bytes ) > sizeof( vregs ) )
+        unhandled();
+} //vector_check_group
+
+void RiscV::vector_set_type( uint64_t avl, uint64_t new_vtype )
+{
+    uint64_t vsew = ( new_vtype >> 3 ) & 7;
+    uint64_t vlmul = new_vtype & 7;
+
+    // sew can't exceed ELEN or lmul * ELEN for fractional lmul. lmul 4 and the high bits are reserved
+
+    if ( ( vsew > 3 ) || ( 4 == vlmul ) || ( 0 != ( new_vtype >> 8 ) ) || ( ( vlmul > 4 ) && ( vsew > ( vlmul - 5 ) ) ) )
+    {
+        vtype = (uint64_t) 1 << 63;
+        vl = 0;
+    }
+    else
+    {
+        vtype = new_vtype;
+        vl = get_min( avl, vector_vlmax( new_vtype ) );
+    }
+    vstart = 0;
+} //vector_set_type
+
+template < typename T > void RiscV::vector_memory_eew( bool store )
+{
+    // T is the width encoded in the instruction. It's the data width except for indexed forms, where it's the index width
+
+    uint64_t nf = ( op >> 29 ) + 1; // fields per segment
+    uint64_t mop = ( op >> 26 ) & 3;
+    bool vm = ( 0 != ( ( op >> 25 ) & 1 ) );
+    uint64_t address = regs[ rs1 ];
+
+    if ( 0 != ( ( op >> 28 ) & 1 ) ) // mew. element widths > 64 are reserved
+        unhandled();
+
+    if ( 0 == mop && 8 == rs2 ) // vl<nf>r.v and vs<nf>r.v whole registers. these ignore vtype and vl
+    {
+        if ( ( 0 != ( nf & ( nf - 1 ) ) ) || ( 0 != ( rd & ( nf - 1 ) ) ) )
+            unhandled();
+
+        if ( store )
+            memcpy( getmem( address ), vregs[ rd ], nf * vlenb );
+        else
+            memcpy( vregs[ rd ], getmem( address ), nf * vlenb );
+        return;
+    }
+
+    if ( 0 != ( vtype >> 63 ) )
+        unhandled();
+
+    if ( 0 == mop && 0xb == rs2 ) // vlm.v and vsm.v masks
+    {
+        if ( store )
+            memcpy( getmem( address ), vregs[ rd ], ( vl + 7 ) / 8 );
+        else
+            memcpy( vregs[ rd ], getmem( address ), ( vl + 7 ) / 8 );
+        return;
+    }
+
+    bool fault_only_first = ( 0 == mop && 0x10 == rs2 && !store ); // vle<eew>ff.v
+    if ( 0 == mop && 0 != rs2 && !fault_only_first )
+        unhandled();
+
+    bool indexed = ( 0 != ( mop & 1 ) );
+    uint64_t data_bytes = indexed ? vector_sew_bytes( vtype ) : sizeof( T );
+    uint64_t field_bytes = get_max( data_bytes * vector_vlmax( vtype ), (uint64_t) vlenb ); // each field is at least one register
+    if ( nf * field_bytes > 8 * vlenb )
+        unhandled();
+    vector_check_group( rd, nf * field_bytes );
+    if ( indexed )
+        vector_check_group( rs2, sizeof( T ) * vector_vlmax( vtype ) );
+
+    int64_t stride = ( 2 == mop ) ? (int64_t) regs[ rs2 ] : (int64_t) ( nf * data_bytes );
+    uint8_t * reg = vregs[ rd ];
+
+#ifndef TARGET_BIG_ENDIAN
+    if ( !indexed && vm && 1 == nf && (uint64_t) stride == data_bytes && vstart < vl )
+    {
+        uint64_t len = ( vl - vstart ) * data_bytes;
+        uint64_t start = address + vstart * data_bytes;
+        if ( !fault_only_first || ( is_address_valid( start ) && is_address_valid( start + len - 1 ) ) )
+        {
+            if ( store )
+                memcpy( getmem( start ), reg + vstart * data_bytes, len );
+            else
+                memcpy( reg + vstart * data_bytes, getmem( start ), len );
+            return;
+        }
+    }
+#endif
+
+    const T * index = (const T *) vregs[ rs2 ];
+
+    for ( uint64_t i = vstart; i < vl; i++ )
+    {
+        if ( !vm && !vector_mask_bit( vregs[ 0 ], i ) )
+            continue;
+
+        for ( uint64_t f = 0; f < nf; f++ )
+        {
+            uint64_t ea = ( indexed ? ( address + (uint64_t) index[ i ] ) : ( address + i * stride ) ) + f * data_bytes;
+            uint8_t * e = reg + f * field_bytes + i * data_bytes;
+
+            if ( fault_only_first && i > 0 && !( is_address_valid( ea ) && is_address_valid( ea + data_bytes - 1 ) ) )
+            {
+                vl = i; // trim vl rather than fault on an element after the first
+                return;
+            }
+
+            if ( store )
+            {
+                if ( 1 == data_bytes )
+                    setui8( ea, * e );
+                else if ( 2 == data_bytes )
+                    setui16( ea, * (uint16_t *) e );
+                else if ( 4 == data_bytes )
+                    setui32( ea, * (uint32_t *) e );
+                else
+                    setui64( ea, * (uint64_t *) e );
+            }
+            else
+            {
+                if ( 1 == data_bytes )
+                    * e = getui8( ea );
+                else if ( 2 == data_bytes )
+                    * (uint16_t *) e = getui16( ea );
+                else if ( 4 == data_bytes )
+                    * (uint32_t *) e = getui32( ea );
+                else
+                    * (uint64_t *) e = getui64( ea );
+            }
+        }
+    }
+} //vector_memory_eew
+
+void RiscV::vector_memory( bool store )
+{
+    switch ( funct3 )
+    {
+        case 0: vector_memory_eew< uint8_t >( store ); break;
+        case 5: vector_memory_eew< uint16_t >( store ); break;
+        case 6: vector_memory_eew< uint32_t >( store ); break;
+        case 7: vector_memory_eew< uint64_t >( store ); break;
+        default: unhandled();
+    }
+} //vector_memory
+
+// loops over the active elements. inactive and tail elements are left undisturbed
+
+#define VECTOR_LOOP( body ) \
+{ \
+    if ( vm ) \
+    { \
+        for ( uint64_t i = vstart; i < vl; i++ ) \
+            { body; } \
+    } \
+    else \
+    { \
+        for ( uint64_t i = vstart; i < vl; i++ ) \
+            if ( vector_mask_bit( vregs[ 0 ], i ) ) \
+                { body; } \
+    } \
+}
+
+// A is the vs2 element, B is the vs1 element or the scalar, and stmt assigns the result R
+
+#define VECTOR_BODY( stmt ) \
+{ \
+    if ( vv ) \
+        VECTOR_LOOP( T A = a[ i ]; T B = b[ i ]; T R; stmt; d[ i ] = R ) \
+    else \
+        VECTOR_LOOP( T A = a[ i ]; T B = x; T R; stmt; d[ i ] = R ) \
+}
+
+#define VECTOR_OP( expr ) VECTOR_BODY( R = (T) ( expr ) )
+
+// like VECTOR_BODY for instructions that write a mask. stmt assigns the bool R
+
+#define VECTOR_COMPARE( stmt ) \
+{ \
+    uint8_t m[ vlenb ]; \
+    memcpy( m, vregs[ rd ], vlenb ); \
+    if ( vv ) \
+        VECTOR_LOOP( T A = a[ i ]; T B = b[ i ]; bool R; stmt; vector_set_mask_bit( m, i, R ) ) \
+    else \
+        VECTOR_LOOP( T A = a[ i ]; T B = x; bool R; stmt; vector_set_mask_bit( m, i, R ) ) \
+    memcpy( vregs[ rd ], m, vlenb ); \
+}
+
+// widening forms. WA is the vs2 element, which is already wide for the .w forms, and WB is the vs1 element or the scalar
+
+#define VECTOR_WIDE_BODY( wide_a, sign_a, sign_b, stmt ) \
+{ \
+    if ( sizeof( W ) == sizeof( T ) ) \
+        unhandled(); \
+    W * dw = (W *) vregs[ rd ]; \
+    const W * aw = (const W *) vregs[ rs2 ]; \
+    if ( vv ) \
+        VECTOR_LOOP( W WA = ( wide_a ) ? aw[ i ] : ( sign_a ) ? (W) (SW) (S) a[ i ] : (W) a[ i ]; W WB = ( sign_b ) ? (W) (SW) (S) b[ i ] : (W) b[ i ]; W R; stmt; dw[ i ] = R ) \
+    else \
+        VECTOR_LOOP( W WA = ( wide_a ) ? aw[ i ] : ( sign_a ) ? (W) (SW) (S) a[ i ] : (W) a[ i ]; W WB = ( sign_b ) ? (W) (SW) (S) x : (W) x; W R; stmt; dw[ i ] = R ) \
+}
+
+// slides and gathers read from a copy of vs2 since vd may overlap it
+
+#define VECTOR_SOURCE_COPY() \
+    T source[ 8 * vlenb / sizeof( T ) ]; \
+    memcpy( source, vregs[ rs2 ], vlmax * sizeof( T ) );
+
+template < typename T > void RiscV::vector_opi( uint64_t funct6, bool vm )
+{
+    typedef typename std::make_signed< T >::type S;
+    typedef typename vector_wider< T >::type W;
+    typedef typename std::make_signed< W >::type SW;
+    const uint64_t bits = 8 * sizeof( T );
+    const uint64_t vlmax = vector_vlmax( vtype );
+    const T smin = (T) ( (T) 1 << ( bits - 1 ) );
+    const T smax = (T) ( smin - 1 );
+
+    T * d = (T *) vregs[ rd ];
+    const T * a = (const T *) vregs[ rs2 ];
+    const T * b = (const T *) vregs[ rs1 ];
+    bool vv = ( 0 == funct3 );
+    bool unsigned_imm = ( ( funct6 >= 0x0c && funct6 <= 0x0f ) || ( funct6 >= 0x25 ) ); // gathers, slides, and shifts
+    uint64_t scalar = ( 4 == funct3 ) ? regs[ rs1 ] : unsigned_imm ? rs1 : (uint64_t) sign_extend( rs1, 4 );
+    T x = (T) scalar;
+
+    bool mask_result = ( ( funct6 >= 0x18 && funct6 <= 0x1f ) || 0x11 == funct6 || 0x13 == funct6 );
+    bool reduction = ( 0x30 == funct6 || 0x31 == funct6 );
+    if ( !mask_result && !reduction )
+        vector_check_group( rd, vlmax * sizeof( T ) );
+    vector_check_group( rs2, vlmax * ( ( funct6 >= 0x2c && funct6 <= 0x2f ) ? sizeof( W ) : sizeof( T ) ) );
+    if ( vv && !reduction )
+        vector_check_group( rs1, vlmax * ( ( 0x0e == funct6 ) ? 2 : sizeof( T ) ) );
+
+    switch ( funct6 )
+    {
+        case 0x00: VECTOR_OP( A + B ); break;                                        // vadd
+        case 0x02: VECTOR_OP( A - B ); break;                                        // vsub
+        case 0x03: VECTOR_OP( B - A ); break;                                        // vrsub
+        case 0x04: VECTOR_OP( ( A < B ) ? A : B ); break;                            // vminu
+        case 0x05: VECTOR_OP( ( (S) A < (S) B ) ? A : B ); break;                    // vmin
+        case 0x06: VECTOR_OP( ( A > B ) ? A : B ); break;                            // vmaxu
+        case 0x07: VECTOR_OP( ( (S) A > (S) B ) ? A : B ); break;                    // vmax
+        case 0x09: VECTOR_OP( A & B ); break;                                        // vand
+        case 0x0a: VECTOR_OP( A | B ); break;                                        // vor
+        case 0x0b: VECTOR_OP( A ^ B ); break;                                        // vxor
+        case 0x0c:                                                                   // vrgather
+        {
+            VECTOR_SOURCE_COPY();
+            if ( vv )
+                VECTOR_LOOP( d[ i ] = ( b[ i ] < vlmax ) ? source[ b[ i ] ] : 0 )
+            else
+                VECTOR_LOOP( d[ i ] = ( scalar < vlmax ) ? source[ scalar ] : 0 )
+            break;
+        }
+        case 0x0e:
+        {
+            VECTOR_SOURCE_COPY();
+            if ( vv )                                                                // vrgatherei16
+            {
+                const uint16_t * index = (const uint16_t *) vregs[ rs1 ];
+                VECTOR_LOOP( d[ i ] = ( index[ i ] < vlmax ) ? source[ index[ i ] ] : 0 )
+            }
+            else                                                                     // vslideup
+            {
+                uint64_t start = get_max( vstart, scalar );
+                for ( uint64_t i = start; i < vl; i++ )
+                    if ( vm || vector_mask_bit( vregs[ 0 ], i ) )
+                        d[ i ] = source[ i - scalar ];
+            }
+            break;
+        }
+        case 0x0f:                                                                   // vslidedown
+        {
+            VECTOR_SOURCE_COPY();
+            VECTOR_LOOP( d[ i ] = ( scalar < ( vlmax - i ) ) ? source[ i + scalar ] : 0 )
+            break;
+        }
+        case 0x10:                                                                   // vadc
+        case 0x12:                                                                   // vsbc
+        {
+            if ( vm )
+                unhandled();
+            for ( uint64_t i = vstart; i < vl; i++ )
+            {
+                T A = a[ i ];
+                T B = vv ? b[ i ] : x;
+                T carry = vector_mask_bit( vregs[ 0 ], i ) ? 1 : 0;
+                d[ i ] = ( 0x10 == funct6 ) ? (T) ( A + B + carry ) : (T) ( A - B - carry );
+            }
+            break;
+        }
+        case 0x11:                                                                   // vmadc
+        case 0x13:                                                                   // vmsbc
+        {
+            uint8_t m[ vlenb ];
+            memcpy( m, vregs[ rd ], vlenb );
+            for ( uint64_t i = vstart; i < vl; i++ )
+            {
+                T A = a[ i ];
+                T B = vv ? b[ i ] : x;
+                bool carry = !vm && vector_mask_bit( vregs[ 0 ], i );
+                bool out;
+                if ( 0x11 == funct6 )
+                {
+                    T r = (T) ( A + B );
+                    out = ( r < A ) || ( carry && ( (T) ( r + 1 ) == 0 ) );
+                }
+                else
+                    out = ( A < B ) || ( carry && ( A == B ) );
+                vector_set_mask_bit( m, i, out );
+            }
+            memcpy( vregs[ rd ], m, vlenb );
+            break;
+        }
+        case 0x17:
+        {
+            if ( vm )                                                                // vmv.v
+            {
+                if ( vv )
+                    VECTOR_LOOP( d[ i ] = b[ i ] )
+                else
+                    VECTOR_LOOP( d[ i ] = x )
+            }
+            else                                                                     // vmerge
+            {
+                for ( uint64_t i = vstart; i < vl; i++ )
+                    d[ i ] = vector_mask_bit( vregs[ 0 ], i ) ? ( vv ? b[ i ] : x ) : a[ i ];
+            }
+            break;
+        }
+        case 0x18: VECTOR_COMPARE( R = ( A == B ) ); break;                           // vmseq
+        case 0x19: VECTOR_COMPARE( R = ( A != B ) ); break;                           // vmsne
+        case 0x1a: VECTOR_COMPARE( R = ( A < B ) ); break;                            // vmsltu
+        case 0x1b: VECTOR_COMPARE( R = ( (S) A < (S) B ) ); break;                    // vmslt
+        case 0x1c: VECTOR_COMPARE( R = ( A <= B ) ); break;                           // vmsleu
+        case 0x1d: VECTOR_COMPARE( R = ( (S) A <= (S) B ) ); break;                   // vmsle
+        case 0x1e: VECTOR_COMPARE( R = ( A > B ) ); break;                            // vmsgtu
+        case 0x1f: VECTOR_COMPARE( R = ( (S) A > (S) B ) ); break;                    // vmsgt
+        case 0x20: VECTOR_BODY( R = (T) ( A + B ); if ( R < A ) { R = (T) ~0; vxsat = 1; } ); break; // vsaddu
+        case 0x21:                                                                   // vsadd
+            VECTOR_BODY( R = (T) ( A + B ); if ( ( ( (S) A < 0 ) == ( (S) B < 0 ) ) && ( ( (S) R < 0 ) != ( (S) A < 0 ) ) ) { R = ( (S) A < 0 ) ? smin : smax; vxsat = 1; } );
+            break;
+        case 0x22: VECTOR_BODY( if ( A < B ) { R = 0; vxsat = 1; } else R = (T) ( A - B ); ); break; // vssubu
+        case 0x23:                                                                   // vssub
+            VECTOR_BODY( R = (T) ( A - B ); if ( ( ( (S) A < 0 ) != ( (S) B < 0 ) ) && ( ( (S) R < 0 ) != ( (S) A < 0 ) ) ) { R = ( (S) A < 0 ) ? smin : smax; vxsat = 1; } );
+            break;
+        case 0x25: VECTOR_OP( A << ( B & ( bits - 1 ) ) ); break;                    // vsll
+        case 0x27:                                                                   // vsmul. the .vi form is vmv<nr>r.v
+        {
+            // ( A * B ) >> ( bits - 1 ) rounded per vxrm. only smin * smin overflows
+
+            if ( 3 == funct3 )
+                unhandled();
+            if ( 8 == sizeof( T ) )
+                VECTOR_BODY( int64_t high; uint64_t low = (uint64_t) CMultiply128::mul_s64_s64( (int64_t) A, (int64_t) B, & high );
+                             if ( smin == A && smin == B ) { R = smax; vxsat = 1; }
+                             else R = (T) ( ( ( (uint64_t) high << 1 ) | ( low >> 63 ) ) + vector_round_increment( low, 63, vxrm ) ) )
+            else
+                VECTOR_BODY( int64_t p = (int64_t) (S) A * (int64_t) (S) B;
+                             int64_t r = ( p >> ( bits - 1 ) ) + (int64_t) vector_round_increment( (uint64_t) p, bits - 1, vxrm );
+                             if ( r > (int64_t) (S) smax ) { R = smax; vxsat = 1; } else R = (T) r )
+            break;
+        }
+        case 0x28: VECTOR_OP( A >> ( B & ( bits - 1 ) ) ); break;                    // vsrl
+        case 0x29: VECTOR_OP( (S) A >> ( B & ( bits - 1 ) ) ); break;               // vsra
+        case 0x2a:                                                                   // vssrl
+            VECTOR_BODY( uint64_t shift = B & ( bits - 1 ); R = (T) ( ( A >> shift ) + vector_round_increment( A, shift, vxrm ) ) );
+            break;
+        case 0x2b:                                                                   // vssra
+            VECTOR_BODY( uint64_t shift = B & ( bits - 1 ); R = (T) ( ( (S) A >> shift ) + (S) vector_round_increment( (uint64_t) (int64_t) (S) A, shift, vxrm ) ) );
+            break;
+        case 0x2c:                                                                   // vnsrl
+        case 0x2d:                                                                   // vnsra
+        case 0x2e:                                                                   // vnclipu
+        case 0x2f:                                                                   // vnclip
+        {
+            if ( sizeof( W ) == sizeof( T ) )
+                unhandled();
+            const W * aw = (const W *) vregs[ rs2 ];
+            for ( uint64_t i = vstart; i < vl; i++ )
+            {
+                if ( !vm && !vector_mask_bit( vregs[ 0 ], i ) )
+                    continue;
+                W A = aw[ i ];
+                uint64_t shift = ( vv ? b[ i ] : x ) & ( 2 * bits - 1 );
+                if ( 0x2c == funct6 )
+                    d[ i ] = (T) ( A >> shift );
+                else if ( 0x2d == funct6 )
+                    d[ i ] = (T) ( (SW) A >> shift );
+                else if ( 0x2e == funct6 )
+                {
+                    W r = (W) ( ( A >> shift ) + vector_round_increment( A, shift, vxrm ) );
+                    if ( r > (W) (T) ~0 )
+                    {
+                        r = (T) ~0;
+                        vxsat = 1;
+                    }
+                    d[ i ] = (T) r;
+                }
+                else
+                {
+                    SW r = (SW) ( ( (SW) A >> shift ) + (SW) vector_round_increment( (uint64_t) (int64_t) (SW) A, shift, vxrm ) );
+                    if ( r > (SW) (S) smax )
+                    {
+                        r = (S) smax;
+                        vxsat = 1;
+                    }
+                    else if ( r < (SW) (S) smin )
+                    {
+                        r = (S) smin;
+                        vxsat = 1;
+                    }
+                    d[ i ] = (T) r;
+                }
             }
-            case 0x12:
+            break;
+        }
+        case 0x30:                                                                   // vwredsumu
+        case 0x31:                                                                   // vwredsum
+        {
+            if ( !vv || sizeof( W ) == sizeof( T ) )
+                unhandled();
+            W sum = * (const W *) vregs[ rs1 ];
+            if ( 0x30 == funct6 )
+                VECTOR_LOOP( sum += (W) a[ i ] )
+            else
+                VECTOR_LOOP( sum += (W) (SW) (S) a[ i ] )
+            if ( vl > vstart )
+                * (W *) vregs[ rd ] = sum;
+            break;
+        }
+        default:
+            unhandled();
+    }
+} //vector_opi
+
+template < typename T > void RiscV::vector_opm( uint64_t funct6, bool vm )
+{
+    typedef typename std::make_signed< T >::type S;
+    typedef typename vector_wider< T >::type W;
+    typedef typename std::make_signed< W >::type SW;
+    const uint64_t bits = 8 * sizeof( T );
+    const uint64_t vlmax = vector_vlmax( vtype );
+    const T smin = (T) ( (T) 1 << ( bits - 1 ) );
+
+    T * d = (T *) vregs[ rd ];
+    const T * a = (const T *) vregs[ rs2 ];
+    const T * b = (const T *) vregs[ rs1 ];
+    bool vv = ( 2 == funct3 );
+    T x = (T) regs[ rs1 ];
+
+    bool scalar_result = ( funct6 <= 0x07 || 0x10 == funct6 ); // reductions and moves to and from element 0
+    bool unary = ( 0x12 == funct6 || 0x14 == funct6 );         // vs1 selects the operation
+    if ( !scalar_result )
+    {
+        if ( !( 0x14 == funct6 && rs1 <= 3 ) )
+            vector_check_group( rd, vlmax * ( ( funct6 >= 0x30 ) ? sizeof( W ) : sizeof( T ) ) );
+        if ( !unary )
+            vector_check_group( rs2, vlmax * ( ( funct6 >= 0x34 && funct6 <= 0x37 ) ? sizeof( W ) : sizeof( T ) ) );
+        if ( vv && !unary && 0x17 != funct6 )
+            vector_check_group( rs1, vlmax * sizeof( T ) );
+    }
+
+    switch ( funct6 )
+    {
+        case 0x00:                                                                   // vredsum
+        case 0x01:                                                                   // vredand
+        case 0x02:                                                                   // vredor
+        case 0x03:                                                                   // vredxor
+        case 0x04:                                                                   // vredminu
+        case 0x05:                                                                   // vredmin
+        case 0x06:                                                                   // vredmaxu
+        case 0x07:                                                                   // vredmax
+        {
+            if ( !vv )
+                unhandled();
+            T r = b[ 0 ];
+            switch ( funct6 )
+            {
+                case 0x00: VECTOR_LOOP( r = (T) ( r + a[ i ] ) ); break;
+                case 0x01: VECTOR_LOOP( r &= a[ i ] ); break;
+                case 0x02: VECTOR_LOOP( r |= a[ i ] ); break;
+                case 0x03: VECTOR_LOOP( r ^= a[ i ] ); break;
+                case 0x04: VECTOR_LOOP( r = get_min( r, a[ i ] ) ); break;
+                case 0x05: VECTOR_LOOP( r = (T) get_min( (S) r, (S) a[ i ] ) ); break;
+                case 0x06: VECTOR_LOOP( r = get_max( r, a[ i ] ) ); break;
+                default: VECTOR_LOOP( r = (T) get_max( (S) r, (S) a[ i ] ) ); break;
+            }
+            if ( vl > vstart )
+                d[ 0 ] = r;
+            break;
+        }
+        case 0x08:                                                                   // vaaddu
+            VECTOR_BODY( T s = (T) ( A + B ); T top = ( s < A ) ? 1 : 0; R = (T) ( ( ( s >> 1 ) | ( top << ( bits - 1 ) ) ) + vector_round_increment( s, 1, vxrm ) ) );
+            break;
+        case 0x09:                                                                   // vaadd
+            VECTOR_BODY( T s = (T) ( A + B ); T top = ( ( (S) A < 0 ) == ( (S) B < 0 ) ) ? ( (S) A < 0 ) : ( (S) s < 0 ); R = (T) ( ( ( s >> 1 ) | ( top << ( bits - 1 ) ) ) + vector_round_increment( s, 1, vxrm ) ) );
+            break;
+        case 0x0a:                                                                   // vasubu
+            VECTOR_BODY( T s = (T) ( A - B ); T top = ( A < B ) ? 1 : 0; R = (T) ( ( ( s >> 1 ) | ( top << ( bits - 1 ) ) ) + vector_round_increment( s, 1, vxrm ) ) );
+            break;
+        case 0x0b:                                                                   // vasub
+            VECTOR_BODY( T s = (T) ( A - B ); T top = ( ( (S) A < 0 ) != ( (S) B < 0 ) ) ? ( (S) A < 0 ) : ( (S) s < 0 ); R = (T) ( ( ( s >> 1 ) | ( top << ( bits - 1 ) ) ) + vector_round_increment( s, 1, vxrm ) ) );
+            break;
+        case 0x0e:                                                                   // vslide1up
+        {
+            if ( vv )
+                unhandled();
+            VECTOR_SOURCE_COPY();
+            VECTOR_LOOP( d[ i ] = ( 0 == i ) ? x : source[ i - 1 ] )
+            break;
+        }
+        case 0x0f:                                                                   // vslide1down
+        {
+            if ( vv )
+                unhandled();
+            VECTOR_SOURCE_COPY();
+            VECTOR_LOOP( d[ i ] = ( i == ( vl - 1 ) ) ? x : source[ i + 1 ] )
+            break;
+        }
+        case 0x10:
+        {
+            if ( !vv )                                                               // vmv.s.x
             {
-                assert_type( RType );
-                decode_R();
-    
-                uint32_t rs3 = ( ( funct7 >> 2 ) & 0x1f );
-                uint32_t fmt = ( funct7 & 3 );
-    
-                if ( 0 == fmt )
-                    fregs[ rd ].f = (float) do_fadd( -1.0 * do_fmul( fregs[ rs1 ].f, fregs[ rs2 ].f ), fregs[ rs3 ].f ); // fnmsub.s frd, frs1, frs2, frs3
-                else if ( 1 == fmt )
-                    fregs[ rd ].d = do_fadd( -1.0 * do_fmul( fregs[ rs1 ].d, fregs[ rs2 ].d ), fregs[ rs3 ].d ); // fnmsub.d frd, frs1, frs2, frs3
-                else
-                    unhandled();
-                break;
+                if ( vl > vstart )
+                    d[ 0 ] = x;
             }
-            case 0x13:
+            else if ( 0 == rs1 )                                                     // vmv.x.s
             {
-                assert_type( RType );
-                decode_R();
-    
-                uint32_t rs3 = ( ( funct7 >> 2 ) & 0x1f );
-                uint32_t fmt = ( funct7 & 3 );
-    
-                if ( 0 == fmt )
-                    fregs[ rd ].f = (float) do_fsub( -1.0 * do_fmul( fregs[ rs1 ].f, fregs[ rs2 ].f ), fregs[ rs3 ].f ); // fnmadd.s frd, frs1, frs2, frs3
-                else if ( 1 == fmt )
-                    fregs[ rd ].d = do_fsub( -1.0 * do_fmul( fregs[ rs1 ].d, fregs[ rs2 ].d ), fregs[ rs3 ].d ); // fnmadd.d frd, frs1, frs2, frs3
-                else
-                    unhandled();
-                break;
+                if ( 0 != rd )
+                    regs[ rd ] = (uint64_t) (int64_t) (S) a[ 0 ];
             }
-            case 0x14:
+            else if ( 0x10 == rs1 || 0x11 == rs1 )                                   // vcpop.m and vfirst.m
             {
-                assert_type( RType );
-                decode_R();
-    
-                if ( 0 == funct7 )
-                    fregs[ rd ].f = (float) do_fadd( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fadd.s frd, frs1, frs2
-                else if ( 1 == funct7 )
-                    fregs[ rd ].d = do_fadd( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fadd.d frd, frs1, frs2
-                else if ( 4 == funct7 )
-                    fregs[ rd ].f = (float) do_fsub( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fsub.s frd, frs1, frs2
-                else if ( 5 == funct7 )
-                    fregs[ rd ].d = do_fsub( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fsub.d frd, frs1, frs2
-                else if ( 8 == funct7 )
-                    fregs[ rd ].f = (float) do_fmul( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fmul.s frd, frs1, frs2
-                else if ( 9 == funct7 )
-                    fregs[ rd ].d = do_fmul( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fmul.d frd, frs1, frs2
-                else if ( 0xc == funct7 )
-                    fregs[ rd ].f = (float) do_fdiv( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fdiv.s frd, frs1, frs2
-                else if ( 0xd == funct7 )
-                    fregs[ rd ].d = do_fdiv( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fdiv.d frd, frs1, frs2
-                else if ( 0x10 == funct7 )
-                {
-                    if ( 0 == funct3 ) // put rs1's absolute value in rd and use rs2's sign bit
-                        fregs[ rd ].f = set_float_sign( fregs[ rs1 ].f, signbit( fregs[ rs2 ].f ) ); // fsgnj.s rd, rs1, rs2
-                    else if ( 1 == funct3 ) // put rs1's absolute value in rd and use opposite of rs2's sign bit
-                        fregs[ rd ].f = set_float_sign( fregs[ rs1 ].f, !signbit( fregs[ rs2 ].f ) ); // fsgnjn.s rd, rs1, rs2
-                    else if ( 2 == funct3 ) // put rs1's absolute value in rd and use the xor of the two sign bits
-                    {
-                        bool result_negative = ( signbit( fregs[ rs1 ].f ) ^ signbit( fregs[ rs2 ].f ) );
-                        fregs[ rd ].f = set_float_sign( fregs[ rs1 ].f, result_negative ); // fsgnjnx.s rd, rs1, rs2
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x11 == funct7 )
+                uint64_t count = 0;
+                int64_t first = -1;
+                for ( uint64_t i = vstart; i < vl; i++ )
                 {
-                    if ( 0 == funct3 ) // put rs1's absolute value in rd and use rs2's sign bit
-                        fregs[ rd ].d = set_double_sign( fregs[ rs1 ].d, signbit( fregs[ rs2 ].d ) ); // fsgnj.d rd, rs1, rs2
-                    else if ( 1 == funct3 ) // put rs1's absolute value in rd and use opposite of rs2's sign bit
-                        fregs[ rd ].d = set_double_sign( fregs[ rs1 ].d, !signbit( fregs[ rs2 ].d ) ); // fsgnjn.d rd, rs1, rs2
-                    else if ( 2 == funct3 ) // put rs1's absolute value in rd and use the xor of the two sign bits
+                    if ( ( vm || vector_mask_bit( vregs[ 0 ], i ) ) && vector_mask_bit( vregs[ rs2 ], i ) )
                     {
-                        bool result_negative = ( signbit( fregs[ rs1 ].d ) ^ signbit( fregs[ rs2 ].d ) );
-                        fregs[ rd ].d = set_double_sign( fregs[ rs1 ].d, result_negative ); // fsgnjnx.d rd, rs1, rs2
+                        if ( -1 == first )
+                            first = (int64_t) i;
+                        count++;
                     }
-                    else
-                        unhandled();
-                }
-                else if ( 0x14 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        fregs[ rd ].f = (float) do_fmin( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fmin.s rd, rs1, rs2
-                    else if ( 1 == funct3 )
-                        fregs[ rd ].f = (float) do_fmax( fregs[ rs1 ].f, fregs[ rs2 ].f ); // fmax.s rd, rs1, rs2
-                    else
-                        unhandled();
-                }
-                else if ( 0x15 == funct7 )
-                {
-                    if ( 0 == funct3 )
-                        fregs[ rd ].d = do_fmin( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fmin.d rd, rs1, rs2
-                    else if ( 1 == funct3 )
-                        fregs[ rd ].d = do_fmax( fregs[ rs1 ].d, fregs[ rs2 ].d ); // fmax.d rd, rs1, rs2
-                    else
-                        unhandled();
                 }
-                else if ( 0x20 == funct7 )
-                {
-                    if ( 1 == rs2 )
-                        fregs[ rd ].f = (float) fregs[ rs1 ].d; // fcvt.s.d rd, rs1
-                    else
-                        unhandled();
-                }                
-                else if ( 0x21 == funct7 )
-                {
-                    if ( 0 == rs2 )
-                        fregs[ rd ].d = fregs[ rs1 ].f; // fcvt.d.s rd, rs1
-                    else
-                        unhandled();
-                }     
-                else if ( 0x2c == funct7 )
-                {
-                    if ( 0 == rs2 )
-                    {
-                        fregs[ rd ].f = sqrtf( fregs[ rs1 ].f ); // fsqrt.s frd, frs1
-                        if ( isnan( fregs[ rd ].f ) )
-                            fregs[ rd ].f = (float) MY_NAN; // RISC-V hardware sets positive NAN while some C implementations set -NAN
-                    }
+                if ( 0 != rd )
+                    regs[ rd ] = ( 0x10 == rs1 ) ? count : (uint64_t) first;
+            }
+            else
+                unhandled();
+            break;
+        }
+        case 0x12:                                                                   // vzext and vsext
+        {
+            if ( !vv || rs1 < 2 || rs1 > 7 )
+                unhandled();
+            uint64_t source_bytes = sizeof( T ) >> ( 3 - ( ( rs1 - 2 ) / 2 ) ); // vf8, vf4, vf2
+            if ( 0 == source_bytes )
+                unhandled();
+            vector_check_group( rs2, vlmax * source_bytes );
+            bool sign = ( 0 != ( rs1 & 1 ) );
+            uint8_t source[ 8 * vlenb ];
+            memcpy( source, vregs[ rs2 ], vlmax * source_bytes );
+            if ( 1 == source_bytes )
+                vector_extend< T, uint8_t >( d, source, sign, vm, vregs[ 0 ], vstart, vl );
+            else if ( 2 == source_bytes )
+                vector_extend< T, uint16_t >( d, source, sign, vm, vregs[ 0 ], vstart, vl );
+            else
+                vector_extend< T, uint32_t >( d, source, sign, vm, vregs[ 0 ], vstart, vl );
+            break;
+        }
+        case 0x14:
+        {
+            if ( !vv )
+                unhandled();
+            if ( rs1 <= 3 )                                                          // vmsbf, vmsof, and vmsif
+            {
+                if ( 0 == rs1 )
+                    unhandled();
+                uint8_t m[ vlenb ];
+                memcpy( m, vregs[ rd ], vlenb );
+                bool found = false;
+                for ( uint64_t i = vstart; i < vl; i++ )
+                {
+                    if ( !vm && !vector_mask_bit( vregs[ 0 ], i ) )
+                        continue;
+                    bool set = vector_mask_bit( vregs[ rs2 ], i );
+                    if ( 1 == rs1 )
+                        vector_set_mask_bit( m, i, !found && !set );
+                    else if ( 2 == rs1 )
+                        vector_set_mask_bit( m, i, !found && set );
                     else
-                        unhandled();
+                        vector_set_mask_bit( m, i, !found );
+                    found = found || set;
                 }
-                else if ( 0x2d == funct7 )
-                {
-                    if ( 0 == rs2 )
-                    {
-                        fregs[ rd ].d = sqrt( fregs[ rs1 ].d ); // fsqrt.d rd, rs1
-                        if ( isnan( fregs[ rd ].d ) )
-                            fregs[ rd ].d = MY_NAN; // RISC-V hardware sets positive NAN while some C implementations set -NAN
-                    }
-                    else
-                        unhandled();
+                memcpy( vregs[ rd ], m, vlenb );
+            }
+            else if ( 0x10 == rs1 )                                                  // viota
+            {
+                uint8_t source[ vlenb ];
+                memcpy( source, vregs[ rs2 ], vlenb );
+                T count = 0;
+                for ( uint64_t i = vstart; i < vl; i++ )
+                {
+                    if ( !vm && !vector_mask_bit( vregs[ 0 ], i ) )
+                        continue;
+                    d[ i ] = count;
+                    if ( vector_mask_bit( source, i ) )
+                        count++;
                 }
-                else if ( 0x50 == funct7 )
-                {
-                    if ( funct3 > 2 )
-                        unhandled();
-                    if ( 0 == rd )
-                        break;
+            }
+            else if ( 0x11 == rs1 )                                                  // vid
+                VECTOR_LOOP( d[ i ] = (T) i )
+            else
+                unhandled();
+            break;
+        }
+        case 0x17:                                                                   // vcompress
+        {
+            if ( !vv )
+                unhandled();
+            VECTOR_SOURCE_COPY();
+            uint8_t selected[ vlenb ];
+            memcpy( selected, vregs[ rs1 ], vlenb );
+            uint64_t j = 0;
+            for ( uint64_t i = vstart; i < vl; i++ )
+                if ( vector_mask_bit( selected, i ) )
+                    d[ j++ ] = source[ i ];
+            break;
+        }
+        case 0x20: VECTOR_OP( ( 0 == B ) ? (T) ~0 : A / B ); break;                   // vdivu
+        case 0x21: VECTOR_OP( ( 0 == B ) ? (T) ~0 : ( smin == A && (T) ~0 == B ) ? A : (T) ( (S) A / (S) B ) ); break; // vdiv
+        case 0x22: VECTOR_OP( ( 0 == B ) ? A : A % B ); break;                        // vremu
+        case 0x23: VECTOR_OP( ( 0 == B ) ? A : ( smin == A && (T) ~0 == B ) ? 0 : (T) ( (S) A % (S) B ) ); break; // vrem
+        case 0x24:                                                                   // vmulhu
+        {
+            if ( 8 == sizeof( T ) )
+                VECTOR_BODY( uint64_t high; CMultiply128::mul_u64_u64( A, B, & high ); R = (T) high )
+            else
+                VECTOR_OP( ( (uint64_t) A * (uint64_t) B ) >> bits );
+            break;
+        }
+        case 0x25: VECTOR_OP( A * B ); break;                                         // vmul
+        case 0x26:                                                                   // vmulhsu. signed vs2 * unsigned vs1
+        {
+            if ( 8 == sizeof( T ) )
+                VECTOR_BODY( uint64_t high; CMultiply128::mul_u64_u64( A, B, & high ); R = (T) ( high - ( ( (S) A < 0 ) ? B : 0 ) ) )
+            else
+                VECTOR_OP( (uint64_t) ( (int64_t) (S) A * (int64_t) (uint64_t) B ) >> bits );
+            break;
+        }
+        case 0x27:                                                                   // vmulh
+        {
+            if ( 8 == sizeof( T ) )
+                VECTOR_BODY( int64_t high; CMultiply128::mul_s64_s64( (int64_t) A, (int64_t) B, & high ); R = (T) high )
+            else
+                VECTOR_OP( (uint64_t) ( (int64_t) (S) A * (int64_t) (S) B ) >> bits );
+            break;
+        }
+        case 0x29: VECTOR_OP( B * d[ i ] + A ); break;                                // vmadd
+        case 0x2b: VECTOR_OP( A - B * d[ i ] ); break;                                // vnmsub
+        case 0x2d: VECTOR_OP( B * A + d[ i ] ); break;                                // vmacc
+        case 0x2f: VECTOR_OP( d[ i ] - B * A ); break;                                // vnmsac
+        case 0x30: VECTOR_WIDE_BODY( false, false, false, R = WA + WB ); break;      // vwaddu
+        case 0x31: VECTOR_WIDE_BODY( false, true, true, R = WA + WB ); break;        // vwadd
+        case 0x32: VECTOR_WIDE_BODY( false, false, false, R = WA - WB ); break;      // vwsubu
+        case 0x33: VECTOR_WIDE_BODY( false, true, true, R = WA - WB ); break;        // vwsub
+        case 0x34: VECTOR_WIDE_BODY( true, false, false, R = WA + WB ); break;       // vwaddu.w
+        case 0x35: VECTOR_WIDE_BODY( true, true, true, R = WA + WB ); break;         // vwadd.w
+        case 0x36: VECTOR_WIDE_BODY( true, false, false, R = WA - WB ); break;       // vwsubu.w
+        case 0x37: VECTOR_WIDE_BODY( true, true, true, R = WA - WB ); break;         // vwsub.w
+        case 0x38: VECTOR_WIDE_BODY( false, false, false, R = WA * WB ); break;      // vwmulu
+        case 0x3a: VECTOR_WIDE_BODY( false, true, false, R = WA * WB ); break;       // vwmulsu. signed vs2 * unsigned vs1
+        case 0x3b: VECTOR_WIDE_BODY( false, true, true, R = WA * WB ); break;        // vwmul
+        case 0x3c: VECTOR_WIDE_BODY( false, false, false, R = dw[ i ] + WA * WB ); break; // vwmaccu
+        case 0x3d: VECTOR_WIDE_BODY( false, true, true, R = dw[ i ] + WA * WB ); break; // vwmacc
+        case 0x3e:                                                                   // vwmaccus. unsigned scalar * signed vs2
+        {
+            if ( vv )
+                unhandled();
+            VECTOR_WIDE_BODY( false, true, false, R = dw[ i ] + WA * WB );
+            break;
+        }
+        case 0x3f: VECTOR_WIDE_BODY( false, false, true, R = dw[ i ] + WA * WB ); break; // vwmaccsu. signed vs1 * unsigned vs2
+        default:
+            unhandled();
+    }
+} //vector_opm
+
+template < typename F, typename T > void RiscV::vector_opf( uint64_t funct6, bool vm )
+{
+    // F is float or double and T is the unsigned integer type of the same width
+
+    typedef typename std::make_signed< T >::type S;
+    typedef typename vector_wider< T >::type W;
+    typedef typename std::make_signed< W >::type SW;
+    typedef typename std::conditional< 4 == sizeof( F ), double, F >::type WF;
+    const uint64_t vlmax = vector_vlmax( vtype );
+    const T sign_bit = (T) 1 << ( 8 * sizeof( T ) - 1 );
+
+    F * d = (F *) vregs[ rd ];
+    const F * a = (const F *) vregs[ rs2 ];
+    const F * b = (const F *) vregs[ rs1 ];
+    T * di = (T *) vregs[ rd ];
+    const T * ai = (const T *) vregs[ rs2 ];
+    const T * bi = (const T *) vregs[ rs1 ];
+    WF * dw = (WF *) vregs[ rd ];
+    const WF * aw = (const WF *) vregs[ rs2 ];
+    bool vv = ( 1 == funct3 );
+    F x;
+    memcpy( & x, & fregs[ rs1 ], sizeof( x ) );
+    T xi;
+    memcpy( & xi, & x, sizeof( xi ) );
+
+    bool scalar_result = ( ( funct6 <= 0x07 && ( funct6 & 1 ) ) || 0x10 == funct6 || 0x31 == funct6 || 0x33 == funct6 );
+    bool mask_result = ( funct6 >= 0x18 && funct6 <= 0x1f );
+    bool wide_result = ( funct6 >= 0x30 ) || ( 0x12 == funct6 && rs1 >= 8 && rs1 <= 0xf );
+    bool wide_source = ( 0x34 == funct6 || 0x36 == funct6 ) || ( 0x12 == funct6 && rs1 >= 0x10 );
+    bool widening = ( wide_result || wide_source || ( funct6 >= 0x30 ) );
+    if ( widening && ( sizeof( W ) == sizeof( T ) ) )
+        unhandled();
+    if ( !scalar_result )
+    {
+        if ( !mask_result )
+            vector_check_group( rd, vlmax * ( wide_result ? sizeof( W ) : sizeof( T ) ) );
+        vector_check_group( rs2, vlmax * ( wide_source ? sizeof( W ) : sizeof( T ) ) );
+        if ( vv && 0x12 != funct6 && 0x13 != funct6 )
+            vector_check_group( rs1, vlmax * sizeof( T ) );
+    }
+
+    #define VECTOR_FP_OP( expr ) \
+    { \
+        if ( vv ) \
+            VECTOR_LOOP( F A = a[ i ]; F B = b[ i ]; d[ i ] = vector_canonical( (F) ( expr ) ) ) \
+        else \
+            VECTOR_LOOP( F A = a[ i ]; F B = x; d[ i ] = vector_canonical( (F) ( expr ) ) ) \
+    }
+
+    #define VECTOR_FP_BITS( expr ) \
+    { \
+        if ( vv ) \
+            VECTOR_LOOP( T A = ai[ i ]; T B = bi[ i ]; di[ i ] = (T) ( expr ) ) \
+        else \
+            VECTOR_LOOP( T A = ai[ i ]; T B = xi; di[ i ] = (T) ( expr ) ) \
+    }
+
+    #define VECTOR_FP_COMPARE( expr ) \
+    { \
+        uint8_t m[ vlenb ]; \
+        memcpy( m, vregs[ rd ], vlenb ); \
+        if ( vv ) \
+            VECTOR_LOOP( F A = a[ i ]; F B = b[ i ]; vector_set_mask_bit( m, i, ( expr ) ) ) \
+        else \
+            VECTOR_LOOP( F A = a[ i ]; F B = x; vector_set_mask_bit( m, i, ( expr ) ) ) \
+        memcpy( vregs[ rd ], m, vlenb ); \
+    }
+
+    #define VECTOR_FP_WIDE( wide_a, expr ) \
+    { \
+        if ( vv ) \
+            VECTOR_LOOP( WF A = ( wide_a ) ? aw[ i ] : (WF) a[ i ]; WF B = (WF) b[ i ]; dw[ i ] = vector_canonical( (WF) ( expr ) ) ) \
+        else \
+            VECTOR_LOOP( WF A = ( wide_a ) ? aw[ i ] : (WF) a[ i ]; WF B = (WF) x; dw[ i ] = vector_canonical( (WF) ( expr ) ) ) \
+    }
+
+    switch ( funct6 )
+    {
+        case 0x00: VECTOR_FP_OP( A + B ); break;                                     // vfadd
+        case 0x01:                                                                   // vfredusum
+        case 0x03:                                                                   // vfredosum
+        case 0x05:                                                                   // vfredmin
+        case 0x07:                                                                   // vfredmax
+        {
+            if ( !vv )
+                unhandled();
+            F r = b[ 0 ];
+            if ( 0x05 == funct6 )
+                VECTOR_LOOP( r = vector_fmin( r, a[ i ] ) )
+            else if ( 0x07 == funct6 )
+                VECTOR_LOOP( r = vector_fmax( r, a[ i ] ) )
+            else
+                VECTOR_LOOP( r += a[ i ] )
+            if ( vl > vstart )
+                d[ 0 ] = vector_canonical( r );
+            break;
+        }
+        case 0x02: VECTOR_FP_OP( A - B ); break;                                     // vfsub
+        case 0x04: VECTOR_FP_OP( vector_fmin( A, B ) ); break;                       // vfmin
+        case 0x06: VECTOR_FP_OP( vector_fmax( A, B ) ); break;                       // vfmax
+        case 0x08: VECTOR_FP_BITS( ( A & ~sign_bit ) | ( B & sign_bit ) ); break;    // vfsgnj
+        case 0x09: VECTOR_FP_BITS( ( A & ~sign_bit ) | ( ~B & sign_bit ) ); break;   // vfsgnjn
+        case 0x0a: VECTOR_FP_BITS( A ^ ( B & sign_bit ) ); break;                    // vfsgnjx
+        case 0x0e:                                                                   // vfslide1up
+        {
+            if ( vv )
+                unhandled();
+            VECTOR_SOURCE_COPY();
+            VECTOR_LOOP( di[ i ] = ( 0 == i ) ? xi : source[ i - 1 ] )
+            break;
+        }
+        case 0x0f:                                                                   // vfslide1down
+        {
+            if ( vv )
+                unhandled();
+            VECTOR_SOURCE_COPY();
+            VECTOR_LOOP( di[ i ] = ( i == ( vl - 1 ) ) ? xi : source[ i + 1 ] )
+            break;
+        }
+        case 0x10:
+        {
+            if ( vv && 0 == rs1 )                                                    // vfmv.f.s
+                memcpy( & fregs[ rd ], & a[ 0 ], sizeof( F ) );
+            else if ( !vv && 0 == rs2 )                                              // vfmv.s.f
+            {
+                if ( vl > vstart )
+                    d[ 0 ] = x;
+            }
+            else
+                unhandled();
+            break;
+        }
+        case 0x12:                                                                   // conversions
+        {
+            if ( !vv )
+                unhandled();
+            W * dwi = (W *) vregs[ rd ];
+            const W * awi = (const W *) vregs[ rs2 ];
+            switch ( rs1 )
+            {
+                case 0x00: VECTOR_LOOP( di[ i ] = round_int_from_double< T >( a[ i ], rm_RNE ) ); break; // vfcvt.xu.f.v
+                case 0x01: VECTOR_LOOP( di[ i ] = (T) round_int_from_double< S >( a[ i ], rm_RNE ) ); break; // vfcvt.x.f.v
+                case 0x02: VECTOR_LOOP( d[ i ] = (F) ai[ i ] ); break;                      // vfcvt.f.xu.v
+                case 0x03: VECTOR_LOOP( d[ i ] = (F) (S) ai[ i ] ); break;                  // vfcvt.f.x.v
+                case 0x06: VECTOR_LOOP( di[ i ] = round_int_from_double< T >( a[ i ], rm_RTZ ) ); break; // vfcvt.rtz.xu.f.v
+                case 0x07: VECTOR_LOOP( di[ i ] = (T) round_int_from_double< S >( a[ i ], rm_RTZ ) ); break; // vfcvt.rtz.x.f.v
+                case 0x08: VECTOR_LOOP( dwi[ i ] = round_int_from_double< W >( a[ i ], rm_RNE ) ); break; // vfwcvt.xu.f.v
+                case 0x09: VECTOR_LOOP( dwi[ i ] = (W) round_int_from_double< SW >( a[ i ], rm_RNE ) ); break; // vfwcvt.x.f.v
+                case 0x0a: VECTOR_LOOP( dw[ i ] = (WF) ai[ i ] ); break;                    // vfwcvt.f.xu.v
+                case 0x0b: VECTOR_LOOP( dw[ i ] = (WF) (S) ai[ i ] ); break;                // vfwcvt.f.x.v
+                case 0x0c: VECTOR_LOOP( dw[ i ] = vector_canonical( (WF) a[ i ] ) ); break; // vfwcvt.f.f.v
+                case 0x0e: VECTOR_LOOP( dwi[ i ] = round_int_from_double< W >( a[ i ], rm_RTZ ) ); break; // vfwcvt.rtz.xu.f.v
+                case 0x0f: VECTOR_LOOP( dwi[ i ] = (W) round_int_from_double< SW >( a[ i ], rm_RTZ ) ); break; // vfwcvt.rtz.x.f.v
+                case 0x10: VECTOR_LOOP( di[ i ] = round_int_from_double< T >( aw[ i ], rm_RNE ) ); break; // vfncvt.xu.f.w
+                case 0x11: VECTOR_LOOP( di[ i ] = (T) round_int_from_double< S >( aw[ i ], rm_RNE ) ); break; // vfncvt.x.f.w
+                case 0x12: VECTOR_LOOP( d[ i ] = (F) awi[ i ] ); break;                     // vfncvt.f.xu.w
+                case 0x13: VECTOR_LOOP( d[ i ] = (F) (SW) awi[ i ] ); break;                // vfncvt.f.x.w
+                case 0x14:                                                                  // vfncvt.f.f.w
+                case 0x15: VECTOR_LOOP( d[ i ] = vector_canonical( (F) aw[ i ] ) ); break;  // vfncvt.rod.f.f.w. rounds to nearest instead
+                case 0x16: VECTOR_LOOP( di[ i ] = round_int_from_double< T >( aw[ i ], rm_RTZ ) ); break; // vfncvt.rtz.xu.f.w
+                case 0x17: VECTOR_LOOP( di[ i ] = (T) round_int_from_double< S >( aw[ i ], rm_RTZ ) ); break; // vfncvt.rtz.x.f.w
+                default: unhandled();
+            }
+            break;
+        }
+        case 0x13:
+        {
+            if ( !vv )
+                unhandled();
+            if ( 0 == rs1 )                                                          // vfsqrt
+                VECTOR_LOOP( d[ i ] = vector_canonical( (F) sqrt( a[ i ] ) ) )
+            else if ( 4 == rs1 )                                                     // vfrsqrt7
+                VECTOR_LOOP( di[ i ] = vector_frsqrt7( ai[ i ] ) )
+            else if ( 5 == rs1 )                                                     // vfrec7
+                VECTOR_LOOP( di[ i ] = vector_frec7( ai[ i ] ) )
+            else if ( 0x10 == rs1 )                                                  // vfclass
+                VECTOR_LOOP( di[ i ] = vector_fclass( a[ i ], ai[ i ] ) )
+            else
+                unhandled();
+            break;
+        }
+        case 0x17:
+        {
+            if ( vv )
+                unhandled();
+            if ( vm )                                                                // vfmv.v.f
+                VECTOR_LOOP( d[ i ] = x )
+            else                                                                     // vfmerge
+            {
+                for ( uint64_t i = vstart; i < vl; i++ )
+                    d[ i ] = vector_mask_bit( vregs[ 0 ], i ) ? x : a[ i ];
+            }
+            break;
+        }
+        case 0x18: VECTOR_FP_COMPARE( A == B ); break;                               // vmfeq
+        case 0x19: VECTOR_FP_COMPARE( A <= B ); break;                               // vmfle
+        case 0x1b: VECTOR_FP_COMPARE( A < B ); break;                                // vmflt
+        case 0x1c: VECTOR_FP_COMPARE( A != B ); break;                               // vmfne
+        case 0x1d: VECTOR_FP_COMPARE( A > B ); break;                                // vmfgt
+        case 0x1f: VECTOR_FP_COMPARE( A >= B ); break;                               // vmfge
+        case 0x20: VECTOR_FP_OP( A / B ); break;                                     // vfdiv
+        case 0x21: VECTOR_FP_OP( B / A ); break;                                     // vfrdiv
+        case 0x24: VECTOR_FP_OP( A * B ); break;                                     // vfmul
+        case 0x27: VECTOR_FP_OP( B - A ); break;                                     // vfrsub
+        case 0x28: VECTOR_FP_OP( fma( B, d[ i ], A ) ); break;                       // vfmadd
+        case 0x29: VECTOR_FP_OP( fma( -B, d[ i ], -A ) ); break;                     // vfnmadd
+        case 0x2a: VECTOR_FP_OP( fma( B, d[ i ], -A ) ); break;                      // vfmsub
+        case 0x2b: VECTOR_FP_OP( fma( -B, d[ i ], A ) ); break;                      // vfnmsub
+        case 0x2c: VECTOR_FP_OP( fma( B, A, d[ i ] ) ); break;                       // vfmacc
+        case 0x2d: VECTOR_FP_OP( fma( -B, A, -d[ i ] ) ); break;                     // vfnmacc
+        case 0x2e: VECTOR_FP_OP( fma( B, A, -d[ i ] ) ); break;                      // vfmsac
+        case 0x2f: VECTOR_FP_OP( fma( -B, A, d[ i ] ) ); break;                      // vfnmsac
+        case 0x30: VECTOR_FP_WIDE( false, A + B ); break;                            // vfwadd
+        case 0x31:                                                                   // vfwredusum
+        case 0x33:                                                                   // vfwredosum
+        {
+            if ( !vv )
+                unhandled();
+            WF sum = * (const WF *) vregs[ rs1 ];
+            VECTOR_LOOP( sum += (WF) a[ i ] )
+            if ( vl > vstart )
+                dw[ 0 ] = vector_canonical( sum );
+            break;
+        }
+        case 0x32: VECTOR_FP_WIDE( false, A - B ); break;                            // vfwsub
+        case 0x34: VECTOR_FP_WIDE( true, A + B ); break;                             // vfwadd.w
+        case 0x36: VECTOR_FP_WIDE( true, A - B ); break;                             // vfwsub.w
+        case 0x38: VECTOR_FP_WIDE( false, A * B ); break;                            // vfwmul
+        case 0x3c: VECTOR_FP_WIDE( false, fma( B, A, dw[ i ] ) ); break;             // vfwmacc
+        case 0x3d: VECTOR_FP_WIDE( false, fma( -B, A, -dw[ i ] ) ); break;           // vfwnmacc
+        case 0x3e: VECTOR_FP_WIDE( false, fma( B, A, -dw[ i ] ) ); break;            // vfwmsac
+        case 0x3f: VECTOR_FP_WIDE( false, fma( -B, A, dw[ i ] ) ); break;            // vfwnmsac
+        default:
+            unhandled();
+    }
+
+    #undef VECTOR_FP_OP
+    #undef VECTOR_FP_BITS
+    #undef VECTOR_FP_COMPARE
+    #undef VECTOR_FP_WIDE
+} //vector_opf
+
+void RiscV::vector_convert_16( uint64_t funct6, bool vm )
+{
+    // with sew 16 only the conversions between 16-bit integers and single precision are supported. half precision isn't
+
+    const uint64_t vlmax = vector_vlmax( vtype );
+    if ( 1 != funct3 || 0x12 != funct6 )
+        unhandled();
+
+    vector_check_group( rd, vlmax * ( ( rs1 < 0x10 ) ? 4 : 2 ) );
+    vector_check_group( rs2, vlmax * ( ( rs1 < 0x10 ) ? 2 : 4 ) );
+    float * dw = (float *) vregs[ rd ];
+    uint16_t * d = (uint16_t *) vregs[ rd ];
+    const uint16_t * a = (const uint16_t *) vregs[ rs2 ];
+    const float * aw = (const float *) vregs[ rs2 ];
+
+    switch ( rs1 )
+    {
+        case 0x0a: VECTOR_LOOP( dw[ i ] = (float) a[ i ] ); break;                                        // vfwcvt.f.xu.v
+        case 0x0b: VECTOR_LOOP( dw[ i ] = (float) (int16_t) a[ i ] ); break;                              // vfwcvt.f.x.v
+        case 0x10: VECTOR_LOOP( d[ i ] = round_int_from_double< uint16_t >( aw[ i ], rm_RNE ) ); break;  // vfncvt.xu.f.w
+        case 0x11: VECTOR_LOOP( d[ i ] = (uint16_t) round_int_from_double< int16_t >( aw[ i ], rm_RNE ) ); break; // vfncvt.x.f.w
+        case 0x16: VECTOR_LOOP( d[ i ] = round_int_from_double< uint16_t >( aw[ i ], rm_RTZ ) ); break;  // vfncvt.rtz.xu.f.w
+        case 0x17: VECTOR_LOOP( d[ i ] = (uint16_t) round_int_from_double< int16_t >( aw[ i ], rm_RTZ ) ); break; // vfncvt.rtz.x.f.w
+        default: unhandled();
+    }
+} //vector_convert_16
+
+#undef VECTOR_LOOP
+#undef VECTOR_BODY
+#undef VECTOR_OP
+#undef VECTOR_COMPARE
+#undef VECTOR_WIDE_BODY
+#undef VECTOR_SOURCE_COPY
+
+void RiscV::vector_mask_logical( uint64_t funct6 )
+{
+    // vmand.mm and friends work on the first vl bits regardless of sew and ignore vm
+
+    uint8_t r[ vlenb ];
+    const uint8_t * a = vregs[ rs2 ];
+    const uint8_t * b = vregs[ rs1 ];
+
+    switch ( funct6 )
+    {
+        case 0x18: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ( a[ i ] & ~b[ i ] ); break;    // vmandn
+        case 0x19: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ( a[ i ] & b[ i ] ); break;     // vmand
+        case 0x1a: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ( a[ i ] | b[ i ] ); break;     // vmor
+        case 0x1b: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ( a[ i ] ^ b[ i ] ); break;     // vmxor
+        case 0x1c: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ( a[ i ] | ~b[ i ] ); break;    // vmorn
+        case 0x1d: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ~( a[ i ] & b[ i ] ); break;    // vmnand
+        case 0x1e: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ~( a[ i ] | b[ i ] ); break;    // vmnor
+        default: for ( size_t i = 0; i < vlenb; i++ ) r[ i ] = (uint8_t) ~( a[ i ] ^ b[ i ] ); break;     // vmxnor
+    }
+
+    for ( uint64_t i = vstart; i < vl; i++ )
+        vector_set_mask_bit( vregs[ rd ], i, vector_mask_bit( r, i ) );
+} //vector_mask_logical
+
+bool RiscV::access_vector_csr( uint64_t csr, uint64_t & value, bool write )
+{
+    // returns false if csr isn't a vector csr. otherwise value is replaced with the prior contents of the csr
+
+    uint64_t prior;
+    if ( 0x8 == csr )
+        prior = vstart;
+    else if ( 0x9 == csr )
+        prior = vxsat;
+    else if ( 0xa == csr )
+        prior = vxrm;
+    else if ( 0xf == csr ) // vcsr
+        prior = ( vxrm << 1 ) | vxsat;
+    else if ( 0xc20 == csr )
+        prior = vl;
+    else if ( 0xc21 == csr )
+        prior = vtype;
+    else if ( 0xc22 == csr )
+        prior = vlenb;
+    else
+        return false;
+
+    if ( write )
+    {
+        if ( 0x8 == csr )
+            vstart = value;
+        else if ( 0x9 == csr )
+            vxsat = value & 1;
+        else if ( 0xa == csr )
+            vxrm = value & 3;
+        else if ( 0xf == csr )
+        {
+            vxsat = value & 1;
+            vxrm = ( value >> 1 ) & 3;
+        }
+        else
+            unhandled(); // vl, vtype, and vlenb are read-only
+    }
+
+    value = prior;
+    return true;
+} //access_vector_csr
+
+void RiscV::execute_vector()
+{
+    // OP-V arithmetic and configuration plus the vector forms of LOAD-FP and STORE-FP
+
+    opcode_type = ( 0x1f & ( op >> 2 ) );
+    funct3 = ( op >> 12 ) & 7;
+    rd = ( op >> 7 ) & 0x1f;
+    rs1 = ( op >> 15 ) & 0x1f;
+    rs2 = ( op >> 20 ) & 0x1f;
+
+    if ( 0x15 != opcode_type )
+    {
+        vector_memory( 9 == opcode_type );
+        vstart = 0;
+        return;
+    }
+
+    if ( 7 == funct3 ) // vsetvli, vsetivli, and vsetvl
+    {
+        uint64_t avl, new_vtype;
+        if ( 0 == ( op >> 31 ) )
+        {
+            avl = regs[ rs1 ];
+            new_vtype = ( op >> 20 ) & 0x7ff;
+        }
+        else if ( 3 == ( op >> 30 ) )
+        {
+            avl = rs1;
+            new_vtype = ( op >> 20 ) & 0x3ff;
+        }
+        else if ( 0x40 == ( op >> 25 ) )
+        {
+            avl = regs[ rs1 ];
+            new_vtype = regs[ rs2 ];
+        }
+        else
+        {
+            unhandled();
+            return;
+        }
+
+        if ( 3 != ( op >> 30 ) && 0 == rs1 )
+            avl = ( 0 == rd ) ? vl : ~ (uint64_t) 0; // keep vl or use vlmax
+        vector_set_type( avl, new_vtype );
+        if ( 0 != rd )
+            regs[ rd ] = vl;
+        return;
+    }
+
+    if ( 0 != ( vtype >> 63 ) ) // vill
+        unhandled();
+
+    uint64_t funct6 = op >> 26;
+    bool vm = ( 0 != ( ( op >> 25 ) & 1 ) );
+
+    if ( 2 == funct3 && funct6 >= 0x18 && funct6 <= 0x1f )
+        vector_mask_logical( funct6 );
+    else if ( 3 == funct3 && 0x27 == funct6 ) // vmv<nr>r.v copies whole registers regardless of vtype and vl
+    {
+        uint64_t nr = rs1 + 1;
+        if ( ( 0 != ( nr & ( nr - 1 ) ) ) || nr > 8 || ( 0 != ( rd & ( nr - 1 ) ) ) || ( 0 != ( rs2 & ( nr - 1 ) ) ) )
+            unhandled();
+        memmove( vregs[ rd ], vregs[ rs2 ], nr * vlenb );
+    }
+    else if ( 0 == funct3 || 3 == funct3 || 4 == funct3 ) // OPIVV, OPIVI, OPIVX
+    {
+        switch ( vector_sew_bytes( vtype ) )
+        {
+            case 1: vector_opi< uint8_t >( funct6, vm ); break;
+            case 2: vector_opi< uint16_t >( funct6, vm ); break;
+            case 4: vector_opi< uint32_t >( funct6, vm ); break;
+            default: vector_opi< uint64_t >( funct6, vm ); break;
+        }
+    }
+    else if ( 2 == funct3 || 6 == funct3 ) // OPMVV, OPMVX
+    {
+        switch ( vector_sew_bytes( vtype ) )
+        {
+            case 1: vector_opm< uint8_t >( funct6, vm ); break;
+            case 2: vector_opm< uint16_t >( funct6, vm ); break;
+            case 4: vector_opm< uint32_t >( funct6, vm ); break;
+            default: vector_opm< uint64_t >( funct6, vm ); break;
+        }
+    }
+    else // OPFVV, OPFVF. half precision isn't supported
+    {
+        switch ( vector_sew_bytes( vtype ) )
+        {
+            case 2: vector_convert_16( funct6, vm ); break;
+            case 4: vector_opf< float, uint32_t >( funct6, vm ); break;
+            case 8: vector_opf< double, uint64_t >( funct6, vm ); break;
+            default: unhandled();
+        }
+    }
+
+    vstart = 0;
+} //execute_vector
+
+void RiscV::check_invariants() // only called by run_features< feature_checks >
+{
+    if ( 0 != regs[ 0 ] )
+        emulator_hard_termination( *this, "zero register isn't 0:", regs[ zero ] );
+    if ( 0 != stack_size ) // harts for threads created by clone don't know the extent of their stacks
+    {
+        if ( regs[ sp ] <= ( stack_top - stack_size ) )
+            emulator_hard_termination( *this, "stack pointer is below stack memory:", regs[ sp ] );
+        if ( regs[ sp ] > stack_top )
+            emulator_hard_termination( *this, "stack pointer is above the top of its starting point:", regs[ sp ] );
+    }
+    if ( pc < base )
+        emulator_hard_termination( *this, "pc is lower than memory:", pc );
+    if ( pc >= ( base + mem_size - stack_size ) )
+        emulator_hard_termination( *this, "pc is higher than it should be:", pc );
+    if ( 0 != ( regs[ sp ] & 0xf ) ) // by convention, risc-v stacks are 16-byte aligned
+        emulator_hard_termination( *this, "the stack pointer isn't 16-byte aligned:", regs[ sp ] );
+    //memset( &op, 0xff, offsetof( RiscV, past_decoded_data ) - offsetof( RiscV, op ) ); // to help debug broken decoding
+} //check_invariants
+
+void RiscV::trace_instruction( const RiscVDecoded & d )
+{
+    op = d.op;
+    opcode_type = ( 0x1f & ( op >> 2 ) );
+    trace_state();
+} //trace_instruction
+
+// blocks are entered at the top of the block loop where the hart's state is checked and cycles are counted.
+// Instructions within a block just advance to the next decoded instruction.
+// Branches and jal follow the block's chained successors, finding them by pc just the first time.
+// jalr and h_general instructions look up the next block by pc; execute_general may flush all blocks.
+
+#define FOLLOW_CHAIN( i ) \
+{ \
+    RiscVBlock * n = b->next[ i ]; \
+    if ( 0 == n ) \
+    { \
+        uint64_t generation = block_generation; \
+        n = find_block( pc ); \
+        if ( generation == block_generation ) \
+            b->next[ i ] = n; \
+    } \
+    b = n; \
+    goto enter_block; \
+}
+
+#define LOOKUP_BLOCK() { b = find_block( pc ); goto enter_block; }
+
+// jalr blocks use next[ 1 ] as an inline cache of the most recent target.
+
+#define FOLLOW_INDIRECT() \
+{ \
+    RiscVBlock * n = b->next[ 1 ]; \
+    if ( ( 0 == n ) || ( pc != n->pc ) ) \
+    { \
+        uint64_t generation = block_generation; \
+        n = find_block( pc ); \
+        if ( generation == block_generation ) \
+            b->next[ 1 ] = n; \
+    } \
+    b = n; \
+    goto enter_block; \
+}
+
+// calls (jal and jalr with rd = ra) push the calling block on the return stack. A call block's next[ 0 ] is the
+// block at its return address, so a ret to the expected address follows that chain without a lookup.
+
+#define PUSH_RETURN( return_address ) \
+{ \
+    RiscVReturn & r = return_stack[ ( return_stack_top++ ) & ( return_stack_entries - 1 ) ]; \
+    r.pc = ( return_address ); \
+    r.caller = b; \
+}
+
+#define RETURN_TO_CALLER() \
+{ \
+    RiscVReturn & r = return_stack[ ( --return_stack_top ) & ( return_stack_entries - 1 ) ]; \
+    if ( ( pc == r.pc ) && ( 0 != r.caller ) ) \
+    { \
+        b = r.caller; \
+        FOLLOW_CHAIN( 0 ); \
+    } \
+}
+
+#define CHECK_INVARIANTS() { if ( features & feature_checks ) check_invariants(); }
+#define CAN_TRACE ( 0 != ( features & feature_trace ) )
+
+#if USE_THREADED_DISPATCH
+    #define HANDLER( h ) label_##h
+    #define DISPATCH() goto * labels[ d->handler ]
+    #define NEXT_INSTRUCTION { d++; pc = d->pc; CHECK_INVARIANTS(); DISPATCH(); }
+    #define NEXT_FUSED { d += 2; pc = d->pc; CHECK_INVARIANTS(); DISPATCH(); }
+#else
+    #define HANDLER( h ) case h
+    #define NEXT_INSTRUCTION { d++; pc = d->pc; CHECK_INVARIANTS(); continue; }
+    #define NEXT_FUSED { d += 2; pc = d->pc; CHECK_INVARIANTS(); continue; }
+#endif
+
+// the comparison result is in regs[ d->rd ] and the next instruction is beqz or bnez of it
+
+#define FUSED_BRANCH \
+{ \
+    fused_counts[ fused_compare_branch ]++; \
+    bool nonzero = ( 0 != regs[ d->rd ] ); \
+    d++; \
+    pc = d->pc; \
+    if ( nonzero == ( h_bne == d->handler ) ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } \
+    pc += d->size; \
+    FOLLOW_CHAIN( 0 ); \
+}
+
+// run() is instantiated for each combination of features so the common case has no per-instruction
+// cost for tracing or invariant checks and no per-block cost for the instruction budget.
+
+uint64_t RiscV::run( uint32_t features )
+{
+    switch ( features & ( feature_trace | feature_checks | feature_budget ) )
+    {
+        case 0: return run_features< 0 >();
+        case 1: return run_features< 1 >();
+        case 2: return run_features< 2 >();
+        case 3: return run_features< 3 >();
+        case 4: return run_features< 4 >();
+        case 5: return run_features< 5 >();
+        case 6: return run_features< 6 >();
+        default: return run_features< 7 >();
+    }
+} //run
 
-                    if ( 0 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].f <= fregs[ rs2 ].f ); // fle.s rd, frs1, frs2
-                    else if ( 1 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].f < fregs[ rs2 ].f ); // flt.s rd, frs1, frs2
-                    else // if ( 2 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].f == fregs[ rs2 ].f ); // feq.s rd, frs1, frs2
-                }
-                else if ( 0x51 == funct7 )
-                {
-                    if ( funct3 > 2 )
-                        unhandled();
-                    if ( 0 == rd )
-                        break;
+uint64_t RiscV::run()
+{
+#ifdef NDEBUG
+    return run( feature_trace );
+#else
+    return run( feature_trace | feature_checks );
+#endif
+} //run
 
-                    if ( 0 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].d <= fregs[ rs2 ].d ); // fle.d rd, frs1, frs2
-                    else if ( 1 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].d < fregs[ rs2 ].d ); // flt.d rd, frs1, frs2
-                    else if ( 2 == funct3 )
-                        regs[ rd ] = ( fregs[ rs1 ].d == fregs[ rs2 ].d ); // feq.d rd, frs1, frs2
-                }            
-                else if ( 0x60 == funct7 )
-                {
-                    if ( rs2 > 3 )
-                        unhandled();
-                    if ( 0 == rd )
-                        break;
+template < uint32_t features > uint64_t RiscV::run_features()
+{
+    uint64_t cycles = 0;
+    RiscVBlock * b = find_block( pc );
+    RiscVDecoded * d;
+    bool tracing = false;
 
-                    if ( 0 == rs2 )
-                        regs[ rd ] = round_int_from_double<int32_t>( fregs[ rs1 ].f, funct3 ); // fcvt.w.s rd, frs1
-                    else if ( 1 == rs2 )
-                        regs[ rd ] = round_int_from_double<uint32_t>( fregs[ rs1 ].f, funct3 ); // fcvt.wu.s rd, frs1
-                    else if ( 2 == rs2 )
-                        regs[ rd ] = round_int_from_double<int64_t>( fregs[ rs1 ].f, funct3 ); // fcvt.l.s rd, frs1
-                    else // if ( 3 == rs2 )
-                        regs[ rd ] = round_int_from_double<uint64_t>( fregs[ rs1 ].f, funct3 ); // fcvt.lu.s rd, frs1
-                }
-                else if ( 0x61 == funct7 )
-                {
-                    if ( rs2 > 3 )
-                        unhandled();
-                    if ( 0 == rd )
-                        break;
+#if USE_THREADED_DISPATCH
 
-                    if ( 0 == rs2 )
-                        regs[ rd ] = round_int_from_double<int32_t>( fregs[ rs1 ].d, funct3 ); // fcvt.w.d rd, frs1
-                    else if ( 1 == rs2 )
-                        regs[ rd ] = round_int_from_double<uint32_t>( fregs[ rs1 ].d, funct3 ); // fcvt.wu.d rd, frs1
-                    else if ( 2 == rs2 )
-                        regs[ rd ] = round_int_from_double<int64_t>( fregs[ rs1 ].d, funct3 ); // fcvt.l.d rd, frs1
-                    else // if ( 3 == rs2 )
-                        regs[ rd ] = round_int_from_double<uint64_t>( fregs[ rs1 ].d, funct3 ); // fcvt.lu.d rd, frs1
-                }
-                else if ( 0x68 == funct7 )
-                {
-                    if ( 0 == rs2 )
-                        fregs[ rd ].f = (float) (int32_t) ( 0xffffffff & regs[ rs1 ] ); // fcvt.s.w frd, rs1   -- converts i32 to float
-                    else if ( 1 == rs2 )
-                        fregs[ rd ].f = (float) (uint32_t) ( 0xffffffff & regs[ rs1 ] ); // fcvt.s.wu frd, rs1   -- converts ui32 to float
-                    else if ( 2 == rs2 )
-                        fregs[ rd ].f = (float) (int64_t) regs[ rs1 ]; // fcvt.s.l frd, rs1   -- converts i64 to float
-                    else if ( 3 == rs2 )
-                        fregs[ rd ].f = (float) regs[ rs1 ]; // fcvt.s.lu frd, rs1   -- converts ui64 to float
-                    else
-                        unhandled();
-                }
-                else if ( 0x69 == funct7 )
-                {
-                    if ( 0 == rs2 ) // fcvt.d.w rd, rs1   -- converts i32 to double
-                        fregs[ rd ].d = (double) (int32_t) regs[ rs1 ];
-                    else if ( 1 == rs2 ) // fcvt.d.wu rd, rs1   -- converts ui32 to double
-                        fregs[ rd ].d = (double) (uint32_t) regs[ rs1 ];
-                    else if ( 2 == rs2 ) // fcvt.d.l rd, rs1   -- converts i64 to double
-                        fregs[ rd ].d = (double) (int64_t) regs[ rs1 ];
-                    else if ( 3 == rs2 ) // fcvt.d.lu rd, rs1   -- converts ui64 to double
-                        fregs[ rd ].d = (double) (uint64_t) regs[ rs1 ];
-                    else
-                        unhandled();
-                }
-                else if ( 0x70 == funct7 )
-                {
-                    if ( 0 == rs2 )
-                    {
-                        if ( 0 == funct3 ) // fmv.x.w rd, frs1
-                        {
-                            int32_t val;
-                            memcpy( & val, & fregs[ rs1 ].f, 4 );
-                            if ( 0 != rd )
-                                regs[ rd ] = val;
-                        }
-                        else if ( 1 == funct3 ) // fclass.s
-                        {
-                            // rd bit Meaning
-                            // 0 rs1 is - infinity
-                            // 1 rs1 is a negative normal number.
-                            // 2 rs1 is a negative subnormal number.
-                            // 3 rs1 is -0
-                            // 4 rs1 is +0
-                            // 5 rs1 is a positive subnormal number.
-                            // 6 rs1 is a positive normal number.
-                            // 7 rs1 is + infinity
-                            // 8 rs1 is a signaling NaN.
-                            // 9 rs1 is a quiet NaN
-    
-                            uint64_t result = 0;
-                            float f = fregs[ rs1 ].f;
-                            if ( isnan( f ) )
-                            {
-                                #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
-                                if ( issignaling( f ) )
-                                    result = 0x100;
-                                else
-                                #endif
-                                    result = 0x200;
-                            }
-                            #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
-                            else if ( issubnormal( f ) )
-                            {
-                                if ( f >= 0.0 )
-                                    result = 0x20;
-                                else
-                                    result = 4;
-                            }
-                            #endif
-                            else if ( !isfinite( f ) )
-                            {
-                                if ( f >= 0.0 )
-                                    result = 0x80;
-                                else
-                                    result = 1;
-                            }
-                            else
-                            {
-                                if ( f >= 0.0 )
-                                    result = 0x40;
-                                else
-                                    result = 2;
-                            }
-                            if ( 0 != rd )
-                                regs[ rd ] = result;
-                        }
-                        else
-                            unhandled();
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x71 == funct7 )
-                {
-                    if ( 0 == rs2 )
-                    {
-                        if ( 0 == funct3 ) // fmv.x.d rd, frs1
-                        {
-                            if ( 0 != rd )
-                                memcpy( & regs[ rd ], & fregs[ rs1 ].d, 8 );
-                        }
-                        else if ( 1 == funct3 ) // fclass.d
-                        {
-                            uint64_t result = 0;
-                            double d = fregs[ rs1 ].d;
-                            if ( isnan( d ) )
-                            {
-                                #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
-                                if ( issignaling( d ) )
-                                    result = 0x100;
-                                else
-                                #endif
-                                    result = 0x200;
-                            }
-                            #if !defined(_MSC_VER) && !defined(OLDGCC) && !defined(__APPLE__) && !defined(__mc68000__) && !defined(sparc)
-                            else if ( issubnormal( d ) )
-                            {
-                                if ( d >= 0.0 )
-                                    result = 0x20;
-                                else
-                                    result = 4;
-                            }
-                            #endif
-                            else if ( !isfinite( d ) )
-                            {
-                                if ( d >= 0.0 )
-                                    result = 0x80;
-                                else
-                                    result = 1;
-                            }
-                            else
-                            {
-                                if ( d >= 0.0 )
-                                    result = 0x40;
-                                else
-                                    result = 2;
-                            }
-                            if ( 0 != rd )
-                                regs[ rd ] = result;
-                        }
-                        else
-                            unhandled();
-                    }
-                    else
-                        unhandled();
-                }            
-                else if ( 0x78 == funct7 )
-                {
-                    if ( 0 == rs2 && 0 == funct3 )
-                    {
-                        uint32_t val = 0xffffffff & regs[ rs1 ];
-                        memcpy( & fregs[ rd ].f, & val, 4 ); // fmv.w.x frd, rs1    rs1 is probably r0
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 0x79 == funct7 )
-                {
-                    if ( 0 == rs2 && 0 == funct3 )
-                        memcpy( & fregs[ rd ].d, & regs[ rs1 ], 8 ); // fmv.d.x frd, rs1    rs1 is probably r0
-                    else
-                        unhandled();
-                }
-                else
-                    unhandled();
-                break;
+    // must be in the same order as riscv_handler
+
+    static const void * handler_labels[] =
+    {
+        && label_h_general, && label_h_nop,
+        && label_h_lb, && label_h_lh, && label_h_lw, && label_h_ld, && label_h_lbu, && label_h_lhu, && label_h_lwu,
+        && label_h_flw, && label_h_fld,
+        && label_h_addi, && label_h_slli, && label_h_slti, && label_h_sltiu, && label_h_xori, && label_h_srli, && label_h_ori, && label_h_andi, && label_h_srai,
+        && label_h_auipc, && label_h_lui,
+        && label_h_addiw, && label_h_slliw, && label_h_srliw, && label_h_sraiw,
+        && label_h_sb, && label_h_sh, && label_h_sw, && label_h_sd,
+        && label_h_fsw, && label_h_fsd,
+        && label_h_add, && label_h_sll, && label_h_slt, && label_h_sltu, && label_h_xor, && label_h_srl, && label_h_or, && label_h_and,
+        && label_h_mul, && label_h_mulh, && label_h_mulhsu, && label_h_mulhu, && label_h_div, && label_h_divu, && label_h_rem, && label_h_remu,
+        && label_h_sub, && label_h_sra,
+        && label_h_addw, && label_h_sllw, && label_h_srlw, && label_h_subw, && label_h_sraw,
+        && label_h_mulw, && label_h_divw, && label_h_divuw, && label_h_remw, && label_h_remuw,
+        && label_h_fmadd_s, && label_h_fmadd_d, && label_h_fmsub_s, && label_h_fmsub_d, && label_h_fnmsub_s, && label_h_fnmsub_d, && label_h_fnmadd_s, && label_h_fnmadd_d,
+        && label_h_fadd_s, && label_h_fadd_d, && label_h_fsub_s, && label_h_fsub_d, && label_h_fmul_s, && label_h_fmul_d, && label_h_fdiv_s, && label_h_fdiv_d,
+        && label_h_fsgnj_s, && label_h_fsgnjn_s, && label_h_fsgnjx_s, && label_h_fsgnj_d, && label_h_fsgnjn_d, && label_h_fsgnjx_d,
+        && label_h_fmin_s, && label_h_fmax_s, && label_h_fmin_d, && label_h_fmax_d,
+        && label_h_fcvt_s_d, && label_h_fcvt_d_s, && label_h_fsqrt_s, && label_h_fsqrt_d,
+        && label_h_fle_s, && label_h_flt_s, && label_h_feq_s, && label_h_fle_d, && label_h_flt_d, && label_h_feq_d,
+        && label_h_fcvt_w_s, && label_h_fcvt_wu_s, && label_h_fcvt_l_s, && label_h_fcvt_lu_s, && label_h_fcvt_w_d, && label_h_fcvt_wu_d, && label_h_fcvt_l_d, && label_h_fcvt_lu_d,
+        && label_h_fcvt_s_w, && label_h_fcvt_s_wu, && label_h_fcvt_s_l, && label_h_fcvt_s_lu, && label_h_fcvt_d_w, && label_h_fcvt_d_wu, && label_h_fcvt_d_l, && label_h_fcvt_d_lu,
+        && label_h_fmv_x_w, && label_h_fmv_x_d, && label_h_fmv_w_x, && label_h_fmv_d_x,
+        && label_h_sh1add, && label_h_sh2add, && label_h_sh3add, && label_h_add_uw, && label_h_sh1add_uw, && label_h_sh2add_uw, && label_h_sh3add_uw,
+        && label_h_andn, && label_h_orn, && label_h_xnor, && label_h_min, && label_h_minu, && label_h_max, && label_h_maxu, && label_h_rol, && label_h_ror, && label_h_rolw, && label_h_rorw,
+        && label_h_bclr, && label_h_bset, && label_h_binv, && label_h_bext, && label_h_czero_eqz, && label_h_czero_nez,
+        && label_h_clz, && label_h_ctz, && label_h_cpop, && label_h_clzw, && label_h_ctzw, && label_h_cpopw, && label_h_sext_b, && label_h_sext_h, && label_h_zext_h, && label_h_rev8, && label_h_orc_b,
+        && label_h_slli_uw, && label_h_rori, && label_h_roriw, && label_h_bclri, && label_h_bseti, && label_h_binvi, && label_h_bexti,
+        && label_h_vector,
+        && label_h_beq, && label_h_bne, && label_h_blt, && label_h_bge, && label_h_bltu, && label_h_bgeu,
+        && label_h_jalr, && label_h_jal, && label_h_block_end,
+        && label_h_lui_addi, && label_h_lui_addiw, && label_h_auipc_jalr, && label_h_auipc_ld, && label_h_slli_srli,
+        && label_h_slt_branch, && label_h_sltu_branch, && label_h_slti_branch, && label_h_sltiu_branch,
+    };
+
+    static_assert( ( sizeof( handler_labels ) / sizeof( handler_labels[ 0 ] ) ) == h_count, "handler_labels must have an entry for each riscv_handler" );
+
+    // when tracing, every instruction goes through label_trace first. Rows match handler_labels
+
+    static const void * trace_labels[] =
+    {
+        && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_h_block_end,
+        && label_trace, && label_trace, && label_trace, && label_trace, && label_trace,
+        && label_trace, && label_trace, && label_trace, && label_trace,
+    };
+
+    static_assert( ( sizeof( trace_labels ) / sizeof( trace_labels[ 0 ] ) ) == h_count, "trace_labels must have an entry for each riscv_handler" );
+
+    const void * const * labels = handler_labels;
+#endif
+
+enter_block:
+    if ( 0 != state.load( std::memory_order_relaxed ) )
+    {
+        uint32_t s = state;
+        if ( s & stateEndEmulation )
+        {
+            state &= ~stateEndEmulation;
+            goto all_done;
+        }
+
+        if ( s & stateFlushInstructionCache ) // another hart wrote code
+        {
+            state &= ~stateFlushInstructionCache;
+            flush_instruction_cache();
+            b = find_block( pc );
+        }
+
+        tracing = CAN_TRACE && ( s & stateTraceInstructions ) && tracer.IsEnabled();
+    }
+    else
+        tracing = false;
+
+    if ( ( features & feature_budget ) && ( cycles >= instruction_budget ) )
+    {
+        tracer.Trace( "instruction budget of %llu is exhausted\n", instruction_budget );
+        goto all_done;
+    }
+
+    cycles += b->count;
+    d = b->ops;
+
+#if USE_JIT
+    if ( !tracing )
+    {
+        if ( 0 != b->jit_code )
+        {
+            uint64_t successor = ( (jit_function) b->jit_code )( regs, membase );
+            d += b->jit_ops;
+
+            if ( jit_partial != successor ) // the branch at the end of the block was translated too
+            {
+                if ( ( h_jal == d->handler ) && ( ra == d->rd ) )
+                    PUSH_RETURN( d->pc + d->size );
+                pc = d->pc + ( successor ? d->imm : d->size );
+                FOLLOW_CHAIN( successor );
             }
-            case 0x18:
+        }
+        else if ( jit_threshold == ++b->executions )
+            jit_block( *b );
+    }
+#endif
+
+    pc = d->pc;
+    CHECK_INVARIANTS();
+
+#if USE_THREADED_DISPATCH
+    if ( CAN_TRACE )
+        labels = tracing ? trace_labels : handler_labels;
+    DISPATCH();
+
+label_trace:
+    trace_instruction( *d );
+    goto * handler_labels[ d->unfused ];
+
+    {
+#else
+    for ( ;; )
+    {
+        if ( CAN_TRACE && tracing && ( h_block_end != d->handler ) )
+            trace_instruction( *d );
+
+        switch( ( CAN_TRACE && tracing ) ? d->unfused : d->handler )
+        {
+#endif
+        HANDLER( h_nop ): NEXT_INSTRUCTION;
+        HANDLER( h_lb ): regs[ d->rd ] = (int8_t) getui8( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION; // sign extend
+        HANDLER( h_lh ): regs[ d->rd ] = (int16_t) getui16( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION; // sign extend
+        HANDLER( h_lw ): regs[ d->rd ] = (int32_t) getui32( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION; // sign extend
+        HANDLER( h_ld ): regs[ d->rd ] = getui64( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_lbu ): regs[ d->rd ] = getui8( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_lhu ): regs[ d->rd ] = getui16( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_lwu ): regs[ d->rd ] = getui32( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_flw ): fregs[ d->rd ].f = getfloat( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fld ): fregs[ d->rd ].d = getdouble( regs[ d->rs1 ] + d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_addi ): regs[ d->rd ] = d->imm + regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_slli ): regs[ d->rd ] = regs[ d->rs1 ] << d->imm; NEXT_INSTRUCTION;
+        HANDLER( h_slti ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] < d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_sltiu ): regs[ d->rd ] = ( regs[ d->rs1 ] < (uint64_t) d->imm ); NEXT_INSTRUCTION; // treat the sign-extended immediate as unsigned
+        HANDLER( h_xori ): regs[ d->rd ] = d->imm ^ regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_srli ): regs[ d->rd ] = ( regs[ d->rs1 ] >> d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_ori ): regs[ d->rd ] = d->imm | regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_andi ): regs[ d->rd ] = d->imm & regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_srai ):
+        {
+            // The old g++ for RISC-V doesn't sign extend on right shifts for signed integers.
+            // The new g++ does for amd64 code gen. work around this.
+
+            uint64_t result = regs[ d->rs1 ] >> d->imm;
+            regs[ d->rd ] = sign_extend( result, 63 - d->imm );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_auipc ): regs[ d->rd ] = pc + d->imm; NEXT_INSTRUCTION;
+        HANDLER( h_lui ): regs[ d->rd ] = d->imm; NEXT_INSTRUCTION;
+        HANDLER( h_addiw ): regs[ d->rd ] = (int32_t) ( (uint32_t) regs[ d->rs1 ] + (uint32_t) d->imm ); NEXT_INSTRUCTION; // sign-extend both imm and rd
+        HANDLER( h_slliw ):
+        {
+            uint32_t result = (uint32_t) regs[ d->rs1 ] << d->imm;
+            regs[ d->rd ] = (int32_t) result;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_srliw ): regs[ d->rd ] = ( ( 0xffffffff & regs[ d->rs1 ] ) >> d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_sraiw ):
+        {
+            // the old g++ compiler that targets RISC-V doesn't sign-extend right shifts on signed numbers.
+            // manually sign extend the result.
+
+            uint32_t t = regs[ d->rs1 ] & 0xffffffff;
+            regs[ d->rd ] = sign_extend( t >> d->imm, 31 - d->imm );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_sb ): setui8( regs[ d->rs1 ] + d->imm, (uint8_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sh ): setui16( regs[ d->rs1 ] + d->imm, (uint16_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sw ): setui32( regs[ d->rs1 ] + d->imm, (uint32_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sd ): setui64( regs[ d->rs1 ] + d->imm, regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_fsw ): setfloat( regs[ d->rs1 ] + d->imm, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fsd ): setdouble( regs[ d->rs1 ] + d->imm, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_add ): regs[ d->rd ] = regs[ d->rs1 ] + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sll ): regs[ d->rd ] = ( regs[ d->rs1 ] << ( regs[ d->rs2 ] & 0x3f ) ); NEXT_INSTRUCTION; // the spec says 5 bits. Gnu fp code assumes 6
+        HANDLER( h_slt ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] < (int64_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sltu ): regs[ d->rd ] = ( regs[ d->rs1 ] < regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_xor ): regs[ d->rd ] = ( regs[ d->rs1 ] ^ regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_srl ): regs[ d->rd ] = ( regs[ d->rs1 ] >> ( regs[ d->rs2 ] & 0x3f ) ); NEXT_INSTRUCTION; // the spec says 5 bits. Gnu fp code assumes 6
+        HANDLER( h_or ): regs[ d->rd ] = regs[ d->rs1 ] | regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_and ): regs[ d->rd ] = regs[ d->rs1 ] & regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_mul ): regs[ d->rd ] = regs[ d->rs1 ] * regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_mulh ): // signed * signed
+        {
+            int64_t high;
+            CMultiply128::mul_s64_s64( regs[ d->rs1 ], regs[ d->rs2 ], &high );
+            regs[ d->rd ] = high;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_mulhsu ): // signed rs1 * unsigned rs2
+        {
+            int64_t reg1 = regs[ d->rs1 ];
+            bool negative = ( reg1 < 0 );
+            uint64_t high;
+            CMultiply128::mul_u64_u64( regs[ d->rs1 ], regs[ d->rs2 ], &high );
+            int64_t result = (int64_t) high;
+            if ( negative )
+                result = -result;
+            regs[ d->rd ] = result;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_mulhu ): // unsigned * unsigned
+        {
+            uint64_t high;
+            CMultiply128::mul_u64_u64( regs[ d->rs1 ], regs[ d->rs2 ], &high );
+            regs[ d->rd ] = high;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_div ): regs[ d->rd ] = ( 0 == regs[ d->rs2 ] ) ? 0 : (int64_t) regs[ d->rs1 ] / (int64_t) regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_divu ): regs[ d->rd ] = ( 0 == regs[ d->rs2 ] ) ? 0 : regs[ d->rs1 ] / regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_rem ): regs[ d->rd ] = ( 0 == regs[ d->rs2 ] ) ? 0 : (int64_t) regs[ d->rs1 ] % (int64_t) regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_remu ): regs[ d->rd ] = ( 0 == regs[ d->rs2 ] ) ? 0 : regs[ d->rs1 ] % regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sub ): regs[ d->rd ] = regs[ d->rs1 ] - regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sra ):
+        {
+            uint64_t shift = ( 0x3f & regs[ d->rs2 ] );
+            uint64_t result = regs[ d->rs1 ] >> shift;
+            regs[ d->rd ] = sign_extend( result, 63 - shift );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_addw ): regs[ d->rd ] = (int32_t) ( (uint32_t) regs[ d->rs1 ] + (uint32_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sllw ):
+        {
+            uint32_t result = (uint32_t) regs[ d->rs1 ] << ( 0x1f & regs[ d->rs2 ] );
+            regs[ d->rd ] = (int32_t) result;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_srlw ): regs[ d->rd ] = ( 0xffffffff & regs[ d->rs1 ] ) >> ( 0x1f & regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_subw ): regs[ d->rd ] = (int32_t) ( (uint32_t) regs[ d->rs1 ] - (uint32_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sraw ):
+        {
+            uint64_t shift = ( 0x1f & regs[ d->rs2 ] );
+            uint64_t result = ( 0xffffffff & regs[ d->rs1 ] ) >> shift;
+            regs[ d->rd ] = sign_extend( result, 31 - shift );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_mulw ): regs[ d->rd ] = (int32_t) ( (uint32_t) regs[ d->rs1 ] * (uint32_t) regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_divw ):
+        {
+            int32_t val1 = (int32_t) regs[ d->rs1 ];
+            int32_t val2 = (int32_t) regs[ d->rs2 ];
+            regs[ d->rd ] = ( 0 == val2 ) ? 0 : val1 / val2;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_divuw ):
+        {
+            uint32_t val1 = (uint32_t) regs[ d->rs1 ];
+            uint32_t val2 = (uint32_t) regs[ d->rs2 ];
+            regs[ d->rd ] = ( 0 == val2 ) ? 0 : val1 / val2;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_remw ):
+        {
+            int32_t val1 = (int32_t) regs[ d->rs1 ];
+            int32_t val2 = (int32_t) regs[ d->rs2 ];
+            regs[ d->rd ] = ( 0 == val2 ) ? 0 : ( val1 % val2 );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_remuw ):
+        {
+            uint32_t val1 = (uint32_t) regs[ d->rs1 ];
+            uint32_t val2 = (uint32_t) regs[ d->rs2 ];
+            regs[ d->rd ] = ( 0 == val2 ) ? 0 : ( val1 % val2 );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_fmadd_s ): fregs[ d->rd ].f = (float) do_fadd( do_fmul( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ), fregs[ d->rs3 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fmadd_d ): fregs[ d->rd ].d = do_fadd( do_fmul( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ), fregs[ d->rs3 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fmsub_s ): fregs[ d->rd ].f = (float) do_fsub( do_fmul( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ), fregs[ d->rs3 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fmsub_d ): fregs[ d->rd ].d = do_fsub( do_fmul( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ), fregs[ d->rs3 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fnmsub_s ): fregs[ d->rd ].f = (float) do_fadd( -1.0 * do_fmul( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ), fregs[ d->rs3 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fnmsub_d ): fregs[ d->rd ].d = do_fadd( -1.0 * do_fmul( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ), fregs[ d->rs3 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fnmadd_s ): fregs[ d->rd ].f = (float) do_fsub( -1.0 * do_fmul( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ), fregs[ d->rs3 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fnmadd_d ): fregs[ d->rd ].d = do_fsub( -1.0 * do_fmul( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ), fregs[ d->rs3 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fadd_s ): fregs[ d->rd ].f = (float) do_fadd( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fadd_d ): fregs[ d->rd ].d = do_fadd( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fsub_s ): fregs[ d->rd ].f = (float) do_fsub( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fsub_d ): fregs[ d->rd ].d = do_fsub( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fmul_s ): fregs[ d->rd ].f = (float) do_fmul( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fmul_d ): fregs[ d->rd ].d = do_fmul( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fdiv_s ): fregs[ d->rd ].f = (float) do_fdiv( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fdiv_d ): fregs[ d->rd ].d = do_fdiv( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnj_s ): fregs[ d->rd ].f = set_float_sign( fregs[ d->rs1 ].f, signbit( fregs[ d->rs2 ].f ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnjn_s ): fregs[ d->rd ].f = set_float_sign( fregs[ d->rs1 ].f, !signbit( fregs[ d->rs2 ].f ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnjx_s ): fregs[ d->rd ].f = set_float_sign( fregs[ d->rs1 ].f, signbit( fregs[ d->rs1 ].f ) ^ signbit( fregs[ d->rs2 ].f ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnj_d ): fregs[ d->rd ].d = set_double_sign( fregs[ d->rs1 ].d, signbit( fregs[ d->rs2 ].d ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnjn_d ): fregs[ d->rd ].d = set_double_sign( fregs[ d->rs1 ].d, !signbit( fregs[ d->rs2 ].d ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fsgnjx_d ): fregs[ d->rd ].d = set_double_sign( fregs[ d->rs1 ].d, signbit( fregs[ d->rs1 ].d ) ^ signbit( fregs[ d->rs2 ].d ) ); NEXT_INSTRUCTION;
+        HANDLER( h_fmin_s ): fregs[ d->rd ].f = (float) do_fmin( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fmax_s ): fregs[ d->rd ].f = (float) do_fmax( fregs[ d->rs1 ].f, fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fmin_d ): fregs[ d->rd ].d = do_fmin( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fmax_d ): fregs[ d->rd ].d = do_fmax( fregs[ d->rs1 ].d, fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_s_d ): fregs[ d->rd ].f = (float) fregs[ d->rs1 ].d; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_d_s ): fregs[ d->rd ].d = fregs[ d->rs1 ].f; NEXT_INSTRUCTION;
+        HANDLER( h_fsqrt_s ):
+        {
+            fregs[ d->rd ].f = sqrtf( fregs[ d->rs1 ].f );
+            if ( isnan( fregs[ d->rd ].f ) )
+                fregs[ d->rd ].f = canonical_nan< float >(); // RISC-V hardware sets positive NAN while some C implementations set -NAN
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_fsqrt_d ):
+        {
+            fregs[ d->rd ].d = sqrt( fregs[ d->rs1 ].d );
+            if ( isnan( fregs[ d->rd ].d ) )
+                fregs[ d->rd ].d = canonical_nan< double >(); // RISC-V hardware sets positive NAN while some C implementations set -NAN
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_fle_s ): regs[ d->rd ] = ( fregs[ d->rs1 ].f <= fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_flt_s ): regs[ d->rd ] = ( fregs[ d->rs1 ].f < fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_feq_s ): regs[ d->rd ] = ( fregs[ d->rs1 ].f == fregs[ d->rs2 ].f ); NEXT_INSTRUCTION;
+        HANDLER( h_fle_d ): regs[ d->rd ] = ( fregs[ d->rs1 ].d <= fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_flt_d ): regs[ d->rd ] = ( fregs[ d->rs1 ].d < fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_feq_d ): regs[ d->rd ] = ( fregs[ d->rs1 ].d == fregs[ d->rs2 ].d ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_w_s ): regs[ d->rd ] = round_int_from_double<int32_t>( fregs[ d->rs1 ].f, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_wu_s ): regs[ d->rd ] = round_int_from_double<uint32_t>( fregs[ d->rs1 ].f, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_l_s ): regs[ d->rd ] = round_int_from_double<int64_t>( fregs[ d->rs1 ].f, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_lu_s ): regs[ d->rd ] = round_int_from_double<uint64_t>( fregs[ d->rs1 ].f, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_w_d ): regs[ d->rd ] = round_int_from_double<int32_t>( fregs[ d->rs1 ].d, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_wu_d ): regs[ d->rd ] = round_int_from_double<uint32_t>( fregs[ d->rs1 ].d, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_l_d ): regs[ d->rd ] = round_int_from_double<int64_t>( fregs[ d->rs1 ].d, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_lu_d ): regs[ d->rd ] = round_int_from_double<uint64_t>( fregs[ d->rs1 ].d, d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_s_w ): fregs[ d->rd ].f = (float) (int32_t) ( 0xffffffff & regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_s_wu ): fregs[ d->rd ].f = (float) (uint32_t) ( 0xffffffff & regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_s_l ): fregs[ d->rd ].f = (float) (int64_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_s_lu ): fregs[ d->rd ].f = (float) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_d_w ): fregs[ d->rd ].d = (double) (int32_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_d_wu ): fregs[ d->rd ].d = (double) (uint32_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_d_l ): fregs[ d->rd ].d = (double) (int64_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fcvt_d_lu ): fregs[ d->rd ].d = (double) (uint64_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_fmv_x_w ):
+        {
+            int32_t val;
+            memcpy( & val, & fregs[ d->rs1 ].f, 4 );
+            regs[ d->rd ] = val;
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_fmv_x_d ): memcpy( & regs[ d->rd ], & fregs[ d->rs1 ].d, 8 ); NEXT_INSTRUCTION;
+        HANDLER( h_fmv_w_x ):
+        {
+            uint32_t val = 0xffffffff & regs[ d->rs1 ];
+            memcpy( & fregs[ d->rd ].f, & val, 4 );
+            NEXT_INSTRUCTION;
+        }
+        HANDLER( h_fmv_d_x ): memcpy( & fregs[ d->rd ].d, & regs[ d->rs1 ], 8 ); NEXT_INSTRUCTION;
+        HANDLER( h_sh1add ): regs[ d->rd ] = ( regs[ d->rs1 ] << 1 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sh2add ): regs[ d->rd ] = ( regs[ d->rs1 ] << 2 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sh3add ): regs[ d->rd ] = ( regs[ d->rs1 ] << 3 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_add_uw ): regs[ d->rd ] = ( 0xffffffff & regs[ d->rs1 ] ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sh1add_uw ): regs[ d->rd ] = ( ( 0xffffffff & regs[ d->rs1 ] ) << 1 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sh2add_uw ): regs[ d->rd ] = ( ( 0xffffffff & regs[ d->rs1 ] ) << 2 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sh3add_uw ): regs[ d->rd ] = ( ( 0xffffffff & regs[ d->rs1 ] ) << 3 ) + regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_andn ): regs[ d->rd ] = regs[ d->rs1 ] & ~regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_orn ): regs[ d->rd ] = regs[ d->rs1 ] | ~regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_xnor ): regs[ d->rd ] = ~( regs[ d->rs1 ] ^ regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_min ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] < (int64_t) regs[ d->rs2 ] ) ? regs[ d->rs1 ] : regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_minu ): regs[ d->rd ] = ( regs[ d->rs1 ] < regs[ d->rs2 ] ) ? regs[ d->rs1 ] : regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_max ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] > (int64_t) regs[ d->rs2 ] ) ? regs[ d->rs1 ] : regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_maxu ): regs[ d->rd ] = ( regs[ d->rs1 ] > regs[ d->rs2 ] ) ? regs[ d->rs1 ] : regs[ d->rs2 ]; NEXT_INSTRUCTION;
+        HANDLER( h_rol ): regs[ d->rd ] = bit_rol( regs[ d->rs1 ], regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_ror ): regs[ d->rd ] = bit_ror( regs[ d->rs1 ], regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_rolw ): regs[ d->rd ] = (int32_t) bit_rolw( (uint32_t) regs[ d->rs1 ], regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_rorw ): regs[ d->rd ] = (int32_t) bit_rorw( (uint32_t) regs[ d->rs1 ], regs[ d->rs2 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_bclr ): regs[ d->rd ] = regs[ d->rs1 ] & ~( 1ull << ( 0x3f & regs[ d->rs2 ] ) ); NEXT_INSTRUCTION;
+        HANDLER( h_bset ): regs[ d->rd ] = regs[ d->rs1 ] | ( 1ull << ( 0x3f & regs[ d->rs2 ] ) ); NEXT_INSTRUCTION;
+        HANDLER( h_binv ): regs[ d->rd ] = regs[ d->rs1 ] ^ ( 1ull << ( 0x3f & regs[ d->rs2 ] ) ); NEXT_INSTRUCTION;
+        HANDLER( h_bext ): regs[ d->rd ] = 1 & ( regs[ d->rs1 ] >> ( 0x3f & regs[ d->rs2 ] ) ); NEXT_INSTRUCTION;
+        HANDLER( h_czero_eqz ): regs[ d->rd ] = ( 0 == regs[ d->rs2 ] ) ? 0 : regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_czero_nez ): regs[ d->rd ] = ( 0 != regs[ d->rs2 ] ) ? 0 : regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_clz ): regs[ d->rd ] = bit_clz( regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_ctz ): regs[ d->rd ] = bit_ctz( regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_cpop ): regs[ d->rd ] = bit_cpop( regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_clzw ): regs[ d->rd ] = bit_clz( ( regs[ d->rs1 ] << 32 ) | 0x80000000 ); NEXT_INSTRUCTION; // the extra bit stops the count at 32
+        HANDLER( h_ctzw ): regs[ d->rd ] = bit_ctz( regs[ d->rs1 ] | 0x100000000 ); NEXT_INSTRUCTION; // the extra bit stops the count at 32
+        HANDLER( h_cpopw ): regs[ d->rd ] = bit_cpop( 0xffffffff & regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_sext_b ): regs[ d->rd ] = (int8_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_sext_h ): regs[ d->rd ] = (int16_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_zext_h ): regs[ d->rd ] = (uint16_t) regs[ d->rs1 ]; NEXT_INSTRUCTION;
+        HANDLER( h_rev8 ): regs[ d->rd ] = bit_bswap( regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_orc_b ): regs[ d->rd ] = bit_orc_b( regs[ d->rs1 ] ); NEXT_INSTRUCTION;
+        HANDLER( h_slli_uw ): regs[ d->rd ] = ( 0xffffffff & regs[ d->rs1 ] ) << d->imm; NEXT_INSTRUCTION;
+        HANDLER( h_rori ): regs[ d->rd ] = bit_ror( regs[ d->rs1 ], d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_roriw ): regs[ d->rd ] = (int32_t) bit_rorw( (uint32_t) regs[ d->rs1 ], d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_bclri ): regs[ d->rd ] = regs[ d->rs1 ] & ~( 1ull << d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_bseti ): regs[ d->rd ] = regs[ d->rs1 ] | ( 1ull << d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_binvi ): regs[ d->rd ] = regs[ d->rs1 ] ^ ( 1ull << d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_bexti ): regs[ d->rd ] = 1 & ( regs[ d->rs1 ] >> d->imm ); NEXT_INSTRUCTION;
+        HANDLER( h_vector ): op = d->op; execute_vector(); NEXT_INSTRUCTION;
+        HANDLER( h_beq ): if ( regs[ d->rs1 ] == regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_bne ): if ( regs[ d->rs1 ] != regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_blt ): if ( (int64_t) regs[ d->rs1 ] < (int64_t) regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_bge ): if ( (int64_t) regs[ d->rs1 ] >= (int64_t) regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_bltu ): if ( regs[ d->rs1 ] < regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_bgeu ): if ( regs[ d->rs1 ] >= regs[ d->rs2 ] ) { pc += d->imm; FOLLOW_CHAIN( 1 ); } pc += d->size; FOLLOW_CHAIN( 0 );
+        HANDLER( h_jalr ):
+        {
+            uint64_t temp = ( regs[ d->rs1 ] + d->imm );
+            if ( 0 != d->rd )
             {
-                assert_type( BType );
-                decode_B();
-                bool branch = false;
-    
-                if ( 0 == funct3 )  // beq rs1, rs2, bimm
-                    branch = ( regs[ rs1 ] == regs[ rs2 ] );
-                else if ( 1 == funct3 )  // bne rs1, rs2, bimm
-                    branch = ( regs[ rs1 ] != regs[ rs2 ] );
-                else if ( 4 == funct3 )  // blt rs1, rs2, bimm
-                    branch = ( (int64_t) regs[ rs1 ] < (int64_t) regs[ rs2 ] );
-                else if ( 5 == funct3 ) // bge rs1, rs2, b_imm
-                    branch = ( (int64_t) regs[ rs1 ] >= (int64_t) regs[ rs2 ] );
-                else if ( 6 == funct3 )  // bltu rs1, rs2, bimm
-                    branch = ( regs[ rs1 ] < regs[ rs2 ] );
-                else if ( 7 == funct3 )  // bgeu rs1, rs2, bimm
-                    branch = ( regs[ rs1 ] >= regs[ rs2 ] );
-                else
-                    unhandled();
-    
-                if ( branch )
-                    pcnext = pc + b_imm;
-                break;
+                regs[ d->rd ] = pc + d->size;
+                if ( ra == d->rd )
+                    PUSH_RETURN( pc + d->size );
             }
-            case 0x19:
+            else if ( ra == d->rs1 ) // ret
             {
-                assert_type( IType );
-                decode_I();
-    
-                if ( 0 == funct3 )
-                {
-                    uint64_t temp = ( regs[ rs1 ] + i_imm ); // jalr (rs1) + i_imm
-                    if ( 0 != rd )
-                        regs[ rd ] = pcnext;
-                    pcnext = temp;
-                }
-                else
-                    unhandled();
-                break;
+                pc = temp;
+                RETURN_TO_CALLER();
             }
-            case 0x1b: 
+            pc = temp;
+            FOLLOW_INDIRECT();
+        }
+        HANDLER( h_jal ):
+        {
+            if ( 0 != d->rd )
             {
-                assert_type( JType );
-                decode_J();
-    
-                if ( 0 != rd )
-                    regs[ rd ] = pcnext;
-    
-                int64_t offset = j_imm_u;
-                pcnext = pc + offset; // jal offset
-                break;
+                regs[ d->rd ] = pc + d->size;
+                if ( ra == d->rd )
+                    PUSH_RETURN( pc + d->size );
             }
-            case 0x1c:
+            pc += d->imm;
+            FOLLOW_CHAIN( 1 );
+        }
+        HANDLER( h_block_end ): FOLLOW_CHAIN( 0 ); // pc is already set to the next instruction
+        HANDLER( h_lui_addi ):
+        {
+            fused_counts[ fused_lui_addi ]++;
+            regs[ d->rd ] = d->imm;
+            regs[ d[ 1 ].rd ] = d->imm + d[ 1 ].imm;
+            NEXT_FUSED;
+        }
+        HANDLER( h_lui_addiw ):
+        {
+            fused_counts[ fused_lui_addi ]++;
+            regs[ d->rd ] = d->imm;
+            regs[ d[ 1 ].rd ] = (int32_t) ( (uint32_t) d->imm + (uint32_t) d[ 1 ].imm );
+            NEXT_FUSED;
+        }
+        HANDLER( h_auipc_jalr ): // the target is pc-relative so it can be chained like jal
+        {
+            fused_counts[ fused_auipc_jalr ]++;
+            regs[ d->rd ] = pc + d->imm;
+            pc = pc + d->imm + d[ 1 ].imm;
+            d++;
+            if ( 0 != d->rd )
             {
-                assert_type( IType );
-                decode_I();
-                uint64_t csr = i_imm_u;
-
-                // funct3
-                //    000  system (ecall / ebreak)
-                //    001  csrrw write csr
-                //    010  csrrs read csr
-                //    011  csrrc clear bits in csr
-                //    101  csrrwi write csr immediate
-                //    110  csrrsi set bits in csr immediate
-                //    111  csrrci clear bits in csr immediate
-
-                if ( 0 == funct3 ) // system
-                {
-                    if ( 0x73 == op )
-                        emulator_invoke_svc( *this ); // ecall. don't route through mtvec as a simplification
-                    else if ( 0x100073 == op )
-                    {
-                        // ebreak.  Ignore for now
-                    }
-                    else
-                        unhandled();
-                }
-                else if ( 1 == funct3 ) // csrrw. csr write
-                {
-                    if ( 0x1 == csr )
-                        regs[ rd ] = 0; // csrrw   rd, fflags, rs1.  read fp exception flags. 0 means all clear
-                    else if ( 0x2 == csr )
-                        regs[ rd ] = 0; // csrrw   rd, frm, rs1.  read rounding mode. 0 means nearest
-                    else if ( 0xc00 == csr ) // csrrw rd, cycle, rs1
-                    {
-                        if ( 0 != rd )
-                            regs[ rd ] = 1000 * clock(); // fake microseconds
-                    }
-                    else
-                    {
-                        tracer.Trace( "attempt to read csr %x\n", csr );
-                        unhandled();
-                    }
-                }
-                else if ( 2 == funct3 ) // csrrs. csr read
-                {
-                    if ( 0 == rd )
-                        break;
-
-                    if ( 0x1 == csr )
-                        regs[ rd ] = 0; // csrrs   rd, fflags, rs1.  read fp exception flags. 0 means all clear
-                    else if ( 0x2 == csr )
-                        regs[ rd ] = 0; // csrrs   rd, frm, rs1.  read rounding mode. 0 means nearest
-                    else if ( 0xb00 == csr ) // csrrs rd, mcycle, rs1. rdmcycle
-                        regs[ rd ] = cycles;
-                    else if ( 0xb02 == csr ) // csrrs rd, minstret, rs1. rdminstret
-                        regs[ rd ] = cycles; // assumes one cycle per instruction
-                    else if ( 0xc00 == csr ) // csrrs rd, cycle, rs1. rdcycle
-                        regs[ rd ] = cycles;
-                    else if ( 0xc01 == csr ) // csrrs rd, time, rs1. rdtime
-                    {
-                        system_clock::duration d = system_clock::now().time_since_epoch();
-                        regs[ rd ] = duration_cast<nanoseconds>( d ).count();
-                    }
-                    else if ( 0xc02 == csr ) // csrrs rd, instret, rs1. rdinstret
-                        regs[ rd ] = cycles; // assumes one cycle per instruction
-                    else if ( 0xf11 == csr ) // mvendorid vendor
-                        regs[ rd ] = 0xbeabad00bee;
-                    else if ( 0xf12 == csr ) // marchid architecture
-                        regs[ rd ] = 0xbeabad00bee;
-                    else if ( 0xf13 == csr ) // mimpid implementation
-                        regs[ rd ] = 0xbeabad00bee;
-                    else if ( 0xf14 == csr ) // mhardid
-                        regs[ rd ] = 0; // only one hart is supported and one must have id 0
-                    else
-                    {
-                        tracer.Trace( "attempt to read csr %x\n", csr );
-                        unhandled();
-                    }
-                }
-                else if ( 6 == funct3 ) // csrrsi. set bits in csr immediate
-                {
-                    if ( 1 == csr )
-                    {
-                        // csrrsi rd, fflags, rs1 --- set fp csr flags like rounding mode (ignore). also, return the flags
-
-                        if ( 0 != rd )
-                            regs[ rd ] = 0;
-                    }
-                    else
-                    {
-                        tracer.Trace( "attempt to set bits in csr %x\n", csr );
-                        unhandled();
-                    }
-                }
-                else
-                    unhandled();
-                break;
+                regs[ d->rd ] = d->pc + d->size;
+                if ( ra == d->rd )
+                    PUSH_RETURN( d->pc + d->size );
             }
-            default:
-                unhandled();
-        } // switch( opcode_type )
-
-        pc = pcnext;
-    } // for
+            FOLLOW_CHAIN( 1 );
+        }
+        HANDLER( h_auipc_ld ):
+        {
+            fused_counts[ fused_auipc_ld ]++;
+            regs[ d->rd ] = pc + d->imm;
+            regs[ d[ 1 ].rd ] = getui64( pc + d->imm + d[ 1 ].imm );
+            NEXT_FUSED;
+        }
+        HANDLER( h_slli_srli ):
+        {
+            fused_counts[ fused_slli_srli ]++;
+            regs[ d->rd ] = regs[ d->rs1 ] << d->imm;
+            regs[ d[ 1 ].rd ] = regs[ d->rd ] >> d[ 1 ].imm;
+            NEXT_FUSED;
+        }
+        HANDLER( h_slt_branch ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] < (int64_t) regs[ d->rs2 ] ); FUSED_BRANCH;
+        HANDLER( h_sltu_branch ): regs[ d->rd ] = ( regs[ d->rs1 ] < regs[ d->rs2 ] ); FUSED_BRANCH;
+        HANDLER( h_slti_branch ): regs[ d->rd ] = ( (int64_t) regs[ d->rs1 ] < d->imm ); FUSED_BRANCH;
+        HANDLER( h_sltiu_branch ): regs[ d->rd ] = ( regs[ d->rs1 ] < (uint64_t) d->imm ); FUSED_BRANCH;
+        HANDLER( h_general ):
+        {
+            uint64_t pcnext = pc + d->size;
+            op = d->op;
+            opcode_type = ( 0x1f & ( op >> 2 ) );
+            execute_general( pcnext, cycles );
+            pc = pcnext;
+            LOOKUP_BLOCK();
+        }
+#if !USE_THREADED_DISPATCH
+        } // switch( d->handler )
+#endif
+    }
 
+all_done:
     return cycles;
-} //run
+} //run_features
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <djl_os.hxx>
+#include <djl_vmem.hxx>
+#include <atomic>
 
 #ifdef _MSC_VER
 
@@ -21,6 +23,43 @@ extern void emulator_invoke_svc( RiscV & cpu );
 extern const char * emulator_symbol_lookup( uint64_t address, uint64_t & offset );             // returns the best guess for a symbol name and offset for the address
 extern void emulator_hard_termination( RiscV & cpu, const char *pcerr, uint64_t error_value ); // show an error and exit
 
+// an instruction decoded once and cached so it doesn't have to be decoded each time it's executed
+
+struct RiscVDecoded
+{
+    uint64_t pc;                    // vm address of the instruction
+    int64_t imm;                    // sign-extended immediate, shift amount, or rounding mode
+    uint32_t op;                    // the instruction, uncompressed if it was rvc
+    uint8_t handler;                // which code in run() executes the instruction
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    uint8_t rs3;
+    uint8_t size;                   // 2 for rvc compressed instructions, 4 otherwise
+    uint8_t unfused;                // handler if not fused with the next instruction. used when tracing and translating
+    uint8_t reserved[ 5 ];
+};
+
+// a basic block: straight-line decoded instructions ending with a branch, jump, or system instruction
+
+struct RiscVBlock
+{
+    uint64_t pc;                    // vm address of the first instruction
+    RiscVDecoded * ops;             // the instructions, in the block arena
+    RiscVBlock * next[ 2 ];         // successor blocks for fall through and branch taken. 0 until first used
+    uint64_t count;                 // count of instructions in the block
+    void * jit_code;                // host code for the first jit_ops instructions or 0 if not translated
+    uint32_t jit_ops;
+    uint32_t executions;            // how often the block has run, to find hot blocks to translate
+    uint32_t jit_bytes;             // size of jit_code
+};
+
+struct RiscVReturn
+{
+    uint64_t pc;                    // return address pushed by a call
+    RiscVBlock * caller;            // block that made the call; its next[ 0 ] is the block at pc
+};
+
 struct RiscV
 {
     static const size_t zero = 0;
@@ -90,13 +129,25 @@ struct RiscV
     static const size_t ft11 = 31;
 
     bool trace_instructions( bool trace );                // enable/disable tracing each instruction
-    void end_emulation( void );                           // make the emulator return at the start of the next instruction
-    uint64_t run( void );
+    bool tracing_instructions( void );                    // the trace_instructions setting of this hart
+    void end_emulation( void );                           // make the emulator return at the start of the next block. any thread
+    void request_flush_instruction_cache( void );         // flush at the start of the next block. any thread
+    static const uint32_t feature_trace = 1;              // instructions can be traced if tracing is enabled
+    static const uint32_t feature_checks = 2;             // check invariants after each instruction
+    static const uint32_t feature_budget = 4;             // stop after about instruction_budget instructions
+    uint64_t run( uint32_t features );                    // run with the specialization for these features
+    uint64_t run( void );                                 // run with tracing and, in debug builds, checks
+    void flush_instruction_cache( void );                 // call when code in memory changes: fence.i, riscv_flush_icache
     static bool generate_rvc_table( const char * path );  // generate a 64k x 32-bit rvc lookup table
+    static const char * fused_form_name( size_t form );   // name of a form of fused instruction pairs for fused_counts
+    static const uint64_t isa_letters = 0x20112f;          // 1 << ( letter - 'A' ) for A, B, C, D, F, I, M, and V. as in misa and AT_HWCAP. B is Zba + Zbb + Zbs
+    static uint64_t hash_bytes( const void * p, size_t len, uint64_t h = 0xcbf29ce484222325 ); // pass h to continue a hash
+    size_t load_translation_cache( const char * path, uint64_t image_hash ); // prebuild blocks saved by a prior run. returns count
+    bool save_translation_cache( const char * path, uint64_t image_hash );   // save blocks and translations for later runs
 
-    RiscV( vector<uint8_t> & memory, uint64_t base_address, uint64_t start, uint64_t stack_commit, uint64_t top_of_stack )
+    RiscV( CVirtualMemory & memory, uint64_t base_address, uint64_t start, uint64_t stack_commit, uint64_t top_of_stack )
     {
-        memset( this, 0, sizeof( *this ) );
+        memset( (void *) this, 0, sizeof( *this ) );
         pc = start;
         stack_size = stack_commit;                 // remember how much of the top of RAM is allocated to the stack
         stack_top = top_of_stack;                  // where the stack started
@@ -106,8 +157,28 @@ struct RiscV
         mem_size = memory.size();
         beyond = mem + memory.size();              // addresses beyond and later are illegal
         membase = mem - base;                      // real pointer to the start of the app's memory (prior to offset)
+        blocks = new RiscVBlock[ max_blocks ];
+        block_ops = new RiscVDecoded[ max_block_ops ];
+        block_hash = new RiscVBlock * [ block_hash_entries ];
+        new ( &state ) std::atomic<uint32_t>( 0 );
+        reservation_address = ~(uint64_t) 0;
+        vtype = (uint64_t) 1 << 63;                // vill until the app runs vsetvli
+        csr_misa = ( (uint64_t) 2 << 62 ) | isa_letters | ( 1 << ( 'U' - 'A' ) ); // rv64 with user mode
+        flush_instruction_cache();
     } //RiscV
 
+    ~RiscV()
+    {
+        delete [] blocks;
+        delete [] block_ops;
+        delete [] block_hash;
+        free_jit();
+        unmap_translation_cache();
+    } //~RiscV
+
+    RiscV( const RiscV & ) = delete;               // the block arrays and jit arena are owned, so copies would free them twice
+    RiscV & operator = ( const RiscV & ) = delete;
+
     const char * reg_name( uint64_t reg );
     const char * freg_name( uint64_t reg );
 
@@ -119,6 +190,15 @@ struct RiscV
 
     uint64_t regs[ 32 ]; // x0 through x31
     floating fregs[ 32 ]; // f0 through f31
+
+    static const uint64_t vlenb = 64;         // bytes per vector register. VLEN is 512 bits
+    uint8_t vregs[ 32 ][ vlenb ];             // v0 through v31. elements are stored little-endian
+    uint64_t vl;                              // vector length set by vsetvli
+    uint64_t vtype;                           // sew, lmul, tail and mask policies. bit 63 is vill
+    uint64_t vstart;                          // always 0 between instructions since vector instructions aren't interrupted
+    uint64_t vxrm;                            // fixed-point rounding mode
+    uint64_t vxsat;                           // fixed-point saturation flag
+
     uint64_t pc;
     uint64_t csr_mstatus;
     uint64_t csr_sstatus;
@@ -145,6 +225,11 @@ struct RiscV
     uint64_t csr_pmpaddr0;
     uint64_t csr_pmpcfg0;
 
+    uint64_t instruction_budget;    // with feature_budget, run returns at the first block boundary past this many instructions
+
+    static const size_t fused_forms = 5;
+    uint64_t fused_counts[ fused_forms ]; // how often each form of fused instruction pair was executed
+
     uint8_t * mem;
     uint8_t * beyond;
     uint64_t base;
@@ -226,6 +311,32 @@ struct RiscV
 
   private:
 
+    std::atomic<uint32_t> state;    // stateXXX bits checked at the start of each block
+    uint64_t reservation_address;   // set by lr and cleared by sc. ~0 when there is no reservation
+    uint64_t reservation_value;     // the value lr loaded, which must still be in memory for sc to succeed
+    uint64_t reservation_version;   // the version of the reserved line when lr ran
+
+    static const size_t max_blocks = 16384;
+    static const size_t max_block_ops = 65536;
+    static const size_t max_block_length = 64;          // instructions, not counting the block_end op
+    static const size_t block_hash_entries = 16384;     // direct-mapped by pc. must be a power of 2
+    static const size_t return_stack_entries = 64;      // circular, so deep recursion just loses the oldest. power of 2
+    RiscVBlock * blocks;            // all blocks built since the last flush
+    RiscVDecoded * block_ops;       // arena for the decoded instructions in blocks
+    RiscVBlock ** block_hash;       // lookup of blocks by pc
+    size_t block_count;             // blocks in use
+    size_t block_op_count;          // block_ops in use
+    uint64_t block_generation;      // incremented each time the blocks are flushed
+    uint8_t * jit_arena;            // executable memory for translated blocks. allocated on first use
+    size_t jit_arena_used;
+    bool jit_unavailable;           // true if executable memory can't be allocated
+    RiscVReturn return_stack[ return_stack_entries ];
+    uint32_t return_stack_top;      // wraps
+    void * cache_file;              // read-only mapping of the translation cache file or 0
+    size_t cache_file_size;
+    size_t cache_blocks_loaded;     // blocks and translations loaded from the file. used to decide if it's worth saving
+    size_t cache_jit_loaded;
+
     uint64_t op;
     uint64_t opcode_type;
     uint64_t funct3;
@@ -250,22 +361,32 @@ struct RiscV
 
     void unhandled( void );
 
-    static uint32_t uncompress_rvc( uint16_t x );
-
-    __inline_perf uint64_t decode()
-    {
-        op = getui32( pc );
-        uint64_t pc_next = pc + 4;
-
-        if ( 3 != ( op & 0x3 ) )
-        {
-            op = uncompress_rvc( (uint16_t) ( op & 0xffff ) );
-            pc_next -= 2;
-        }
-
-        opcode_type = ( 0x1f & ( op >> 2 ) );
-        return pc_next;
-    } //decode
+    static uint32_t uncompress_rvc( uint16_t x, bool trace = false );
+
+    void predecode( RiscVDecoded & d, uint64_t address );
+    void execute_general( uint64_t & pcnext, uint64_t cycles );
+    bool trace_bitmanip( void );
+    void execute_vector( void );
+    void trace_vector( const char * kind );
+    bool access_vector_csr( uint64_t csr, uint64_t & value, bool write );
+    void vector_set_type( uint64_t avl, uint64_t new_vtype );
+    void vector_check_group( uint64_t reg, uint64_t bytes );
+    void vector_memory( bool store );
+    template < typename T > void vector_memory_eew( bool store );
+    template < typename T > void vector_opi( uint64_t funct6, bool vm );
+    template < typename T > void vector_opm( uint64_t funct6, bool vm );
+    template < typename F, typename T > void vector_opf( uint64_t funct6, bool vm );
+    void vector_mask_logical( uint64_t funct6 );
+    void vector_convert_16( uint64_t funct6, bool vm );
+    void check_invariants( void );
+    template < uint32_t features > uint64_t run_features( void );
+    void trace_instruction( const RiscVDecoded & d );
+    RiscVBlock * build_block( uint64_t address );
+    RiscVBlock * find_block( uint64_t address );
+    void jit_block( RiscVBlock & b );
+    void free_jit( void );
+    uint64_t block_code_hash( const RiscVBlock & b );
+    void unmap_translation_cache( void );
 
     // when inlined, the compiler uses btc for bits. when non-inlined it does the slow thing
     // bits is the 0-based high bit that will be extended to the left.
@@ -4,6 +4,8 @@ use std::sync::atomic::
     AtomicU8, AtomicU16, AtomicU32, AtomicU64,
     AtomicBool, Ordering, // Mutex, MutexGuard, RWLockReadGuard, RWLockWriteGuard,
 };
+use std::sync::{ Arc, Mutex };
+use std::thread;
 
 fn test_signed64( v: &mut AtomicI64 )
 {
@@ -313,6 +315,57 @@ fn test_bool( v: &mut AtomicBool )
     }
 } //test_bool
 
+// many threads update the same values at once. amo instructions, lr/sc loops, and futex-based locks must all agree.
+
+fn test_threads()
+{
+    const THREADS: u64 = 8;
+    const LOOPS: u64 = 20000;
+
+    let sum = Arc::new( AtomicU64::new( 0 ) );
+    let cas_sum = Arc::new( AtomicU64::new( 0 ) );
+    let max = Arc::new( AtomicI32::new( i32::MIN ) );
+    let small = Arc::new( AtomicU16::new( 0 ) );
+    let locked = Arc::new( Mutex::new( 0u64 ) );
+    let mut handles = Vec::new();
+
+    for t in 0..THREADS
+    {
+        let ( sum, cas_sum, max, small, locked ) = ( sum.clone(), cas_sum.clone(), max.clone(), small.clone(), locked.clone() );
+        handles.push( thread::spawn( move ||
+        {
+            for i in 0..LOOPS
+            {
+                sum.fetch_add( i, Ordering::Relaxed );
+
+                let mut old = cas_sum.load( Ordering::Relaxed );
+                loop
+                {
+                    match cas_sum.compare_exchange_weak( old, old + t + 1, Ordering::AcqRel, Ordering::Relaxed )
+                    {
+                        Ok(_) => break, Err( x ) => old = x,
+                    }
+                }
+
+                max.fetch_max( ( t * LOOPS + i ) as i32, Ordering::SeqCst );
+                small.fetch_add( 1, Ordering::SeqCst ); // 16-bit atomics are lr/sc loops on a masked word
+                *locked.lock().unwrap() += 2;
+            }
+        } ) );
+    }
+
+    for h in handles
+    {
+        h.join().unwrap();
+    }
+
+    assert_eq!( sum.load( Ordering::SeqCst ), THREADS * LOOPS * ( LOOPS - 1 ) / 2 );
+    assert_eq!( cas_sum.load( Ordering::SeqCst ), LOOPS * THREADS * ( THREADS + 1 ) / 2 );
+    assert_eq!( max.load( Ordering::SeqCst ), ( THREADS * LOOPS - 1 ) as i32 );
+    assert_eq!( small.load( Ordering::SeqCst ), ( ( THREADS * LOOPS ) & 0xffff ) as u16 );
+    assert_eq!( *locked.lock().unwrap(), THREADS * LOOPS * 2 );
+} //test_threads
+
 fn main()
 {
     println!( "testing atomic operations" );
@@ -353,5 +406,8 @@ fn main()
     let mut val_bool: AtomicBool = AtomicBool::new( false );
     test_bool( &mut val_bool );
 
+    println!( "threads" );
+    test_threads();
+
     println!( "exiting atomic testing with great success" );
 } //main
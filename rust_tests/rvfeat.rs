@@ -57,5 +57,16 @@ use std::arch::is_riscv_feature_detected;
 fn main()
 {
     println!( "testing risc-v features" );
+
+    println!( "  m:      {}", is_riscv_feature_detected!( "m" ) );
+    println!( "  a:      {}", is_riscv_feature_detected!( "a" ) );
+    println!( "  f:      {}", is_riscv_feature_detected!( "f" ) );
+    println!( "  d:      {}", is_riscv_feature_detected!( "d" ) );
+    println!( "  c:      {}", is_riscv_feature_detected!( "c" ) );
+    println!( "  v:      {}", is_riscv_feature_detected!( "v" ) );
+    println!( "  zba:    {}", is_riscv_feature_detected!( "zba" ) );
+    println!( "  zbb:    {}", is_riscv_feature_detected!( "zbb" ) );
+    println!( "  zbs:    {}", is_riscv_feature_detected!( "zbs" ) );
+    println!( "  zicond: {}", is_riscv_feature_detected!( "zicond" ) );
 } //main
 
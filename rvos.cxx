@@ -134,6 +134,28 @@ using namespace std::chrono;
 #elif defined( RVOS )
 
     #include "riscv.hxx"
+    #include <thread>
+    #include <mutex>
+    #include <future>
+    #include <algorithm>
+    #include <string>
+    #include <stdexcept>
+    #include "librvos.h"
+
+    #ifdef __linux__
+        #define USE_HOST_FUTEX // guest futex words live in memory, so the host kernel can wait and wake on them
+        #include <linux/futex.h>
+        #include <asm/unistd.h>
+        #include <signal.h>
+        #include <pthread.h>
+        #include <climits>
+    #endif
+
+    #if defined( __linux__ ) || defined( __APPLE__ )
+        #define USE_GUARD_PAGES // references to the guard pages around guest memory fault, and a handler reports them
+        #include <signal.h>
+        #include <setjmp.h>
+    #endif
 
     #define CPUClass RiscV
     #define ELF_MACHINE_ISA 0xf3
@@ -265,31 +287,14 @@ using namespace std::chrono;
 #define CONCATENATE(e1, e2) e1 ## e2
 #define PREFIX_L(s) CONCATENATE(L, s)
 
+// state shared by every vm in the process: the log, the host console, and options that apply to the console.
+// Everything that belongs to one vm is in VMContext below.
+
 CDJLTrace tracer;
 ConsoleConfiguration g_consoleConfig;
-bool g_compressed_rvc = false;                 // is the app compressed risc-v?
 const REG_TYPE g_arg_data_commit = 1024;       // storage spot for command-line arguments and environment variables
-REG_TYPE g_stack_commit = 128 * 1024;          // RAM to allocate for the fixed stack. the top of this has argv data
-
-REG_TYPE g_brk_commit = 40 * 1024 * 1024;      // RAM to reserve if the app calls brk to allocate space. 40 meg default
-REG_TYPE g_mmap_commit = 40 * 1024 * 1024;     // RAM to reserve if the app calls mmap to allocate space. 40 meg default
-
-bool g_terminate = false;                      // has the app asked to shut down?
-int g_exit_code = 0;                           // exit code of the app in the vm
-vector<uint8_t> memory;                        // RAM for the vm
-REG_TYPE g_base_address = 0;                   // vm address of start of memory
-REG_TYPE g_execution_address = 0;              // where the program counter starts
-REG_TYPE g_brk_offset = 0;                     // offset of brk, initially g_end_of_data
-REG_TYPE g_mmap_offset = 0;                    // offset of where mmap allocations start
-REG_TYPE g_highwater_brk = 0;                  // highest brk seen during app; peak dynamically-allocated RAM
-REG_TYPE g_end_of_data = 0;                    // official end of the loaded app
-REG_TYPE g_bottom_of_stack = 0;                // just beyond where brk might move
-REG_TYPE g_top_of_stack = 0;                   // argc, argv, penv, aux records sit above this
-CMMap g_mmap;                                  // for mmap and munmap system calls
 bool g_addCRBeforeLF = true;                   // on Windows, a command-line argument can make this false so the emulated app acts like Linux
 bool g_addTimeZoneToEnv = true;                // on Windows, a command-line argument to control if the TZ is added to the environment
-char * g_penvironment = 0;                     // 0 or initial environment variables from the command-line
-char g_acLoadedApp[ EMULATOR_MAX_PATH ];       // path of the app being emulated
 struct local_kernel_termios g_termios;         // current state of stdin/stdout/stderr for those not redirected
 
 // fake descriptors.
@@ -845,8 +850,128 @@ struct ElfSectionHeader32
 
 #pragma pack(pop)
 
+#ifdef RVOS
+
+// Each guest thread created with clone( CLONE_THREAD ) runs as its own hart on its own host thread. All harts of a vm
+// share its memory and the rest of its state, so system calls that can't block are serialized by svc_mutex.
+
+struct GuestThread
+{
+    CPUClass * cpu = 0;
+    thread host_thread;
+    uint64_t tid = 0;                        // host thread id; gettid in the guest
+    uint64_t clear_child_tid = 0;            // set_tid_address and CLONE_CHILD_CLEARTID: zeroed when the thread exits
+    uint64_t robust_list = 0;                // set_robust_list: the thread's robust futexes are released when it exits
+    uint64_t instructions = 0;               // executed by the hart, for -p
+    bool exited = false;                     // the thread called exit but other threads are still running
+    atomic<bool> blocked { false };          // in a system call that may not return without a wake or signal
+    atomic<bool> finished { false };         // run() returned
+#ifdef USE_HOST_FUTEX
+    pthread_t host_handle;                   // for interrupting blocked system calls with a signal
+#endif
+#if defined( USE_GUARD_PAGES ) && defined( RVOS_LIBRARY )
+    sigjmp_buf * fault_jump = 0;             // where a fault on guest memory ends the hart's run, ending just the vm
+    char fault_message[ 128 ] = {};          // what the fault handler found, formatted without allocating
+    bool in_syscall = false;                 // rvos is handling a system call for the hart and may hold locks
+    const char * syscall_fault = 0;          // what the system call's guest memory reference faulted on, if anything
+    uint64_t syscall_fault_address = 0;
+#endif
+    promise<uint64_t> tid_ready;             // the new host thread sends its tid to the cloning thread
+    promise<void> go;                        // then waits for the cloning thread to store the tid in guest memory
+};
+
+#endif //RVOS
+
+#if ( defined( RVOS ) || defined( ARMOS ) || defined( X64OS ) ) && ( defined( __linux__ ) || defined( __APPLE__ ) )
+    #define LAZY_GUEST_SPACE // 64-bit guests on hosts that reserve memory without committing it
+#endif
+
+// The default brk and mmap space. Where reservations cost only address space on a 64-bit host, they're big enough
+// that the heaps grow on demand and apps don't need -h or -m.
+
+static REG_TYPE default_guest_space()
+{
+#ifdef LAZY_GUEST_SPACE
+    if ( sizeof( void * ) >= 8 )
+        return (REG_TYPE) ( (uint64_t) 4 << 30 );
+#endif
+    return 40 * 1024 * 1024;
+} //default_guest_space
+
+// Everything that belongs to one guest. A host can run many vms at once on different threads, each with its own
+// VMContext. g_vm points at the vm whose guest the calling host thread runs; threads created by a guest share its vm.
+
+struct VMContext
+{
+    bool compressed_rvc = false;                  // is the app compressed risc-v?
+    REG_TYPE stack_commit = 128 * 1024;           // RAM to allocate for the fixed stack. the top of this has argv data
+    REG_TYPE brk_commit = default_guest_space();  // RAM to reserve if the app calls brk to allocate space
+    REG_TYPE mmap_commit = default_guest_space(); // RAM to reserve if the app calls mmap to allocate space
+    uint64_t address_space_limit = ~(uint64_t) 0; // RLIMIT_AS for the image, brk heap, stack, and mmap allocations
+    uint64_t address_space_max = ~(uint64_t) 0;   // the hard limit, set with -r. The app can lower but not raise it
+    bool identity_map = false;                    // try to put guest memory at host address == guest address
+    bool huge_pages = false;                      // back the heap, stack, and mmap space with transparent huge pages
+    bool sparse = false;                          // reserve a terabyte of guest address space for brk and mmap
+    size_t huge_pages_advised = 0;                // bytes of RAM that may be backed by huge pages
+
+    bool terminate = false;                       // has the app asked to shut down?
+    int exit_code = 0;                            // exit code of the app in the vm
+    CVirtualMemory memory;                        // RAM for the vm. pages cost nothing until the app touches them
+    REG_TYPE base_address = 0;                    // vm address of start of memory
+    REG_TYPE execution_address = 0;               // where the program counter starts
+    REG_TYPE brk_offset = 0;                      // offset of brk, initially end_of_data
+    REG_TYPE mmap_offset = 0;                     // offset of where mmap allocations start
+    REG_TYPE highwater_brk = 0;                   // highest brk seen during app; peak dynamically-allocated RAM
+    REG_TYPE end_of_data = 0;                     // official end of the loaded app
+    REG_TYPE bottom_of_stack = 0;                 // lowest byte the stack can use. just beyond where brk might move and stack_guard
+    REG_TYPE stack_guard = 0;                     // inaccessible bytes just below bottom_of_stack so overflows fault
+    REG_TYPE top_of_stack = 0;                    // argc, argv, penv, aux records sit above this
+    bool hash_image = false;                      // compute image_hash while loading. Only -c needs it
+    uint64_t image_hash = 0;                      // hash of the elf's loaded segments. Keys the translation cache
+    CMMap mmap_allocator;                         // for mmap and munmap system calls
+    char * penvironment = 0;                      // 0 or initial environment variables from the command-line
+    char acLoadedApp[ EMULATOR_MAX_PATH ] = {};   // path of the app being emulated
+    char acTranslationCache[ EMULATOR_MAX_PATH ] = {}; // -c file for the app, loaded at start and saved at exit
+    high_resolution_clock::time_point tAppStart;
+    struct linux_user_desc user_desc = {};
+
+    vector<char> string_table;                    // strings in the elf image
+    vector<ElfSymbol64> symbols;                  // symbols in the elf image
+    vector<ElfSymbol32> symbols32;                // symbols in the elf image
+
+#ifdef _WIN32
+    HANDLE hFindFirst = INVALID_HANDLE_VALUE;     // for enumerating directories. Only one can be active at once.
+    char acFindFirstPattern[ EMULATOR_MAX_PATH ] = {};
+#else
+    DIR * FindFirst = 0;
+    REG_TYPE FindFirstDescriptor = (REG_TYPE) -1;
+#endif
+
+#ifdef RVOS
+    mutex svc_mutex;                              // serializes system calls
+    mutex threads_mutex;                          // protects threads and live_threads
+    GuestThread main_thread;                      // the thread that runs the elf's entry point
+    vector<GuestThread *> threads;                // threads created by clone. They're deleted when the main thread joins them
+    size_t live_threads = 1;                      // threads that haven't exited, including the main thread
+    uint32_t run_features = 0;                    // passed to run() for each hart
+    atomic<bool> stopping { false };              // exit_group or the budget ended all harts
+    rvos_syscall_hook syscall_hook = 0;           // librvos: called before emulating each system call
+    void * syscall_hook_context = 0;
+    string error;                                 // librvos: why the vm failed
+#endif
+#ifdef USE_GUARD_PAGES
+    size_t host_page_size = CVirtualMemory::page_size(); // for guard_page_handler, which can't call sysconf
+#endif
+};
+
+static thread_local VMContext * g_vm = 0;
+
 static void usage( char const * perror = 0 )
 {
+#ifdef RVOS_LIBRARY
+    throw runtime_error( perror ? perror : "invalid arguments" ); // the host app's vm fails, not the host app
+#endif
+
     g_consoleConfig.RestoreConsole( false );
 
     if ( 0 != perror )
@@ -855,19 +980,35 @@ static void usage( char const * perror = 0 )
     printf( "usage: %s <%s arguments> <executable> <app arguments>\n", APP_NAME, APP_NAME );
     printf( "  arguments:     -e     environment. semicolon-separated list of name=value pairs\n" );
 #ifdef RVOS
+    printf( "                 -a     put guest memory at the same host addresses if they're free\n" );
+    printf( "                 -b:X   stop the app after about X million instructions\n" );
+    printf( "                 -c:X   cache decoded and translated code in directory X across runs. -c uses $XDG_CACHE_HOME/rvos or ~/.cache/rvos\n" );
     printf( "                 -g     (internal) generate rcvtable.txt then exit\n" );
 #endif
     printf( "                 -h:X   # of meg for the heap (brk space). 0..1024 are valid. default is 40\n" );
+#ifdef LAZY_GUEST_SPACE
+    printf( "                        on 64-bit hosts 0..1048576 are valid, and the default is 4096 (256 gig with -x)\n" );
+#endif
     printf( "                 -i     if -t is set, also enables instruction tracing with symbols\n" );
 #ifdef _WIN32
     printf( "                 -l     don't let Windows translate LF (10) to CR (13) / LF (10)\n" );
 #endif
     printf( "                 -m:X   # of meg for mmap space. 0..1024 are valid. default is 40.\n" );
+#ifdef LAZY_GUEST_SPACE
+    printf( "                        on 64-bit hosts 0..1048576 are valid, and the default is 4096 (768 gig with -x)\n" );
+#endif
     printf( "                 -n     just show information about the elf executable; don't actually run it\n" );
     printf( "                 -p     shows performance information at app exit\n" );
+    printf( "                 -r:X   limit the app's address space (RLIMIT_AS) to X meg: image, heap, stack, and mmap\n" );
     printf( "                 -s:X   # of KB for stack space. 1..1024 are valid. default is 128.\n" );
     printf( "                 -t     enable debug tracing to %s\n", LOGFILE_NAME );
+#ifdef __linux__
+    printf( "                 -u     use 2 MB transparent huge pages for the heap, stack, and mmap space\n" );
+#endif
     printf( "                 -v     used with -e shows verbose information (e.g. symbols)\n" );
+#ifdef LAZY_GUEST_SPACE
+    printf( "                 -x     sparse address space: 256 gig heap and 768 gig mmap space, used as the app touches it\n" );
+#endif
 #ifdef _WIN32
     printf( "                 -z     on Windows, don't add time zone to environment at startup\n" );
 #endif
@@ -1343,8 +1484,6 @@ static const char * get_clockid( clockid_t clockid )
     return "unknown";
 } //get_clockid
 
-high_resolution_clock::time_point g_tAppStart;
-
 static int msc_clock_gettime( clockid_t clockid, struct timespec_syscall * tv )
 {
     tracer.Trace( "  msc_clock_gettime, clockid %d == %s\n", clockid, get_clockid( clockid ) );
@@ -1359,7 +1498,7 @@ static int msc_clock_gettime( clockid_t clockid, struct timespec_syscall * tv )
               CLOCK_PROCESS_CPUTIME_ID == clockid || CLOCK_THREAD_CPUTIME_ID == clockid )
     {
         high_resolution_clock::time_point tNow = high_resolution_clock::now();
-        diff = duration_cast<std::chrono::nanoseconds>( tNow - g_tAppStart ).count();
+        diff = duration_cast<std::chrono::nanoseconds>( tNow - g_vm->tAppStart ).count();
     }
 
     tv->tv_sec = diff / 1000000000ULL;
@@ -1908,7 +2047,9 @@ static const SysCall syscalls[] =
     { "SYS_clone", SYS_clone },
     { "SYS_mmap", SYS_mmap },
     { "SYS_mprotect", SYS_mprotect },
+    { "SYS_msync", SYS_msync },
     { "SYS_madvise", SYS_madvise },
+    { "SYS_riscv_hwprobe", SYS_riscv_hwprobe },
     { "SYS_riscv_flush_icache", SYS_riscv_flush_icache },
     { "SYS_wait4", SYS_wait4 },
     { "SYS_prlimit64", SYS_prlimit64 },
@@ -2112,6 +2253,7 @@ static const SyscalltoRV X64ToRiscV[] = // per https://gpages.juszkiewicz.com.pl
     { 21, emulator_sys_access },
     { 22, emulator_sys_pipe },
     { 25, SYS_mremap },
+    { 26, SYS_msync },
     { 35, SYS_nanosleep },
     { 39, SYS_getpid },
     { 57, emulator_sys_fork },
@@ -2222,6 +2364,7 @@ static const SyscalltoRV X32ToRiscV[] = // per https://gpages.juszkiewicz.com.pl
     { 140, emulator_sys__llseek },
     { 141, emulator_sys_getdents },
     { 142, emulator_sys__newselect },
+    { 144, SYS_msync },
     { 146, SYS_writev },
     { 148, SYS_fdatasync },
     { 162, SYS_nanosleep },
@@ -2297,6 +2440,7 @@ static const StoRV SparcToRiscV[] = // per https://gpages.juszkiewicz.com.pl/sys
     { 43, SYS_times },
     { 54, SYS_ioctl },
     { 58, emulator_sys_readlink },
+    { 65, SYS_msync },
     { 71, SYS_mmap },
     { 73, SYS_munmap },
     { 92, SYS_fcntl },
@@ -2374,8 +2518,6 @@ void send_character( uint8_t c )
     printf( "%c", c );
 } //send_character
 
-static struct linux_user_desc g_user_desc;
-
 #ifdef __mc68000__
 extern "C" long syscall( long number, ... );
 #endif
@@ -2422,20 +2564,531 @@ bool Win32RenameFile( const char * oldname, const char * newname )
 } //Win32RenameFile
 #endif
 
+#ifdef RVOS
+
+static thread_local GuestThread * g_current_thread = 0;
+
+static uint64_t host_thread_id()
+{
+#if defined( _WIN32 )
+    return GetCurrentThreadId();
+#elif defined( __APPLE__ )
+    uint64_t id = 0;
+    pthread_threadid_np( 0, &id );
+    return id;
+#else
+    return (uint64_t) gettid();
+#endif
+} //host_thread_id
+
+static void wake_futex( CPUClass & cpu, uint64_t address )
+{
+#ifdef USE_HOST_FUTEX
+    syscall( __NR_futex, cpu.getmem( address ), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, INT_MAX, 0, 0, 0 );
+#endif
+} //wake_futex
+
+// is_address_valid() doesn't know about the stack's guard page, and a write there faults while threads_mutex is held
+
+static bool is_thread_address_valid( CPUClass & cpu, uint64_t address )
+{
+    uint64_t offset = address - g_vm->base_address;
+    if ( offset >= ( g_vm->bottom_of_stack - g_vm->stack_guard ) && offset < g_vm->bottom_of_stack )
+        return false;
+    return cpu.is_address_valid( address );
+} //is_thread_address_valid
+
+static void release_robust_futexes( CPUClass & cpu, GuestThread * t )
+{
+    // struct robust_list_head { struct robust_list * list; long futex_offset; struct robust_list * list_op_pending; }
+    // Futexes in the list held by the thread get FUTEX_OWNER_DIED so the next locker recovers them.
+
+    if ( 0 == t->robust_list || !is_thread_address_valid( cpu, t->robust_list ) )
+        return;
+
+    uint64_t head = t->robust_list;
+    int64_t futex_offset = (int64_t) cpu.getui64( head + 8 );
+    uint64_t pending = cpu.getui64( head + 16 );
+    uint64_t entry = cpu.getui64( head );
+    uint64_t limit = 2048; // the kernel's ROBUST_LIST_LIMIT, in case the list is circular or corrupt
+
+    while ( entry != head && 0 != entry && 0 != limit-- )
+    {
+        uint64_t next = is_thread_address_valid( cpu, entry ) ? cpu.getui64( entry ) : 0;
+        uint64_t word = ( entry & ~(uint64_t) 1 ) + futex_offset;
+        if ( is_thread_address_valid( cpu, word ) && ( t->tid == ( cpu.getui32( word ) & 0x3fffffff ) ) )
+        {
+            cpu.setui32( word, ( cpu.getui32( word ) & 0x80000000 ) | 0x40000000 ); // keep FUTEX_WAITERS, set FUTEX_OWNER_DIED
+            wake_futex( cpu, word );
+        }
+        if ( entry == pending )
+            pending = 0;
+        entry = next;
+    }
+
+    if ( 0 != pending )
+    {
+        uint64_t word = ( pending & ~(uint64_t) 1 ) + futex_offset;
+        if ( is_thread_address_valid( cpu, word ) && ( t->tid == ( cpu.getui32( word ) & 0x3fffffff ) ) )
+        {
+            cpu.setui32( word, ( cpu.getui32( word ) & 0x80000000 ) | 0x40000000 );
+            wake_futex( cpu, word );
+        }
+    }
+} //release_robust_futexes
+
+// A hart blocked in a host system call won't see end_emulation. Once the app is stopping, interrupt those calls with
+// SIGUSR2 (its handler does nothing and doesn't restart system calls) until every other hart has returned from run.
+
+static void stop_blocked_harts()
+{
+#ifdef USE_HOST_FUTEX
+    for ( ;; )
+    {
+        bool waiting = false;
+        {
+            lock_guard<mutex> lock( g_vm->threads_mutex );
+            for ( size_t i = 0; i <= g_vm->threads.size(); i++ )
+            {
+                GuestThread * t = ( i == g_vm->threads.size() ) ? &g_vm->main_thread : g_vm->threads[ i ];
+                if ( t == g_current_thread || 0 == t->cpu || t->finished )
+                    continue;
+
+                waiting = true;
+                t->cpu->end_emulation();
+                if ( t->blocked )
+                    pthread_kill( t->host_handle, SIGUSR2 );
+            }
+        }
+
+        if ( !waiting )
+            break;
+        sleep_ms( 1 );
+    }
+#endif
+} //stop_blocked_harts
+
+#ifdef USE_HOST_FUTEX
+static void interrupt_handler( int signal ) {}
+#endif
+
+#ifdef USE_GUARD_PAGES
+
+// The fault handler can only use async-signal-safe calls, so it formats messages itself rather than with printf
+
+static char * append_string( char * p, const char * pend, const char * str )
+{
+    while ( *str && p < pend )
+        *p++ = *str++;
+    return p;
+} //append_string
+
+static char * append_hex( char * p, const char * pend, uint64_t value )
+{
+    char digits[ 16 ];
+    size_t count = 0;
+    do
+    {
+        digits[ count++ ] = "0123456789abcdef"[ value & 0xf ];
+        value >>= 4;
+    } while ( 0 != value );
+
+    while ( count && p < pend )
+        *p++ = digits[ --count ];
+    return p;
+} //append_hex
+
+#ifdef RVOS_LIBRARY
+static struct sigaction g_prior_segv, g_prior_bus; // the host app's handlers, for faults that aren't on guest memory
+#endif
+
+// A guest reference to a guard page or a store to a read-only file mapping faults in the host. Report it like a
+// debug build's bounds checks do: the CLI prints and exits, and library builds end just the vm. Other faults are
+// rvos bugs or belong to the host app, so they get the default action or the app's handler.
+
+static void guard_page_handler( int signal, siginfo_t * info, void * context )
+{
+    VMContext * vm = g_vm;
+    GuestThread * t = g_current_thread;
+    if ( 0 != vm && 0 != t && 0 != t->cpu && vm->memory.guards_contain( info->si_addr ) )
+    {
+        uint64_t address = (uint64_t) ( (uint8_t *) info->si_addr - t->cpu->membase );
+        uint64_t offset = address - vm->base_address;
+        bool in_buffer = ( (uint8_t *) info->si_addr >= vm->memory.data() && (uint8_t *) info->si_addr < vm->memory.data() + vm->memory.size() );
+        const char * what = "memory reference outside the app's memory (guard page):";
+        if ( offset >= ( vm->bottom_of_stack - vm->stack_guard ) && offset < vm->bottom_of_stack )
+            what = "stack overflow into the guard page at:";
+        else if ( in_buffer ) // the rest of the buffer is accessible except file mappings without PROT_WRITE
+            what = "write to read-only memory (a file mapped without PROT_WRITE) at:";
+
+#ifdef RVOS_LIBRARY
+        if ( t->in_syscall )
+        {
+            // rvos touched the memory for a system call and may hold svc_mutex or threads_mutex, so jumping out would
+            // leave them locked. Put a scratch page under the fault so the call finishes, and emulator_invoke_svc
+            // ends the vm once it returns. The vm is done, so it doesn't matter what the page replaced.
+
+            if ( 0 == t->syscall_fault )
+            {
+                t->syscall_fault = what;
+                t->syscall_fault_address = address;
+            }
+
+            void * page = (void *) ( (uintptr_t) info->si_addr & ~(uintptr_t) ( vm->host_page_size - 1 ) );
+            if ( MAP_FAILED != mmap( page, vm->host_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0 ) )
+                return;
+        }
+
+        if ( 0 != t->fault_jump )
+        {
+            char * p = t->fault_message;
+            const char * pend = p + sizeof( t->fault_message ) - 1;
+            p = append_string( p, pend, what );
+            p = append_string( p, pend, " " );
+            p = append_hex( p, pend, address );
+            p = append_string( p, pend, " at pc " );
+            p = append_hex( p, pend, t->cpu->pc );
+            *p = 0;
+            siglongjmp( * t->fault_jump, 1 );
+        }
+#else
+        char ac[ 300 ];
+        char * p = ac;
+        const char * pend = ac + sizeof( ac );
+        p = append_string( p, pend, "hard termination!!!\n" APP_NAME " (" );
+        p = append_string( p, pend, target_platform() );
+        p = append_string( p, pend, ") fatal error: " );
+        p = append_string( p, pend, what );
+        p = append_string( p, pend, " " );
+        p = append_hex( p, pend, address );
+        p = append_string( p, pend, "\npc: " );
+        p = append_hex( p, pend, t->cpu->pc );
+        p = append_string( p, pend, "\naddress space " );
+        p = append_hex( p, pend, vm->base_address );
+        p = append_string( p, pend, " to " );
+        p = append_hex( p, pend, vm->base_address + vm->memory.size() );
+        p = append_string( p, pend, "\n" );
+        ssize_t written = write( 1, ac, p - ac );
+        (void) written;
+        _exit( 1 );
+#endif
+    }
+
+#ifdef RVOS_LIBRARY
+    const struct sigaction & prior = ( SIGBUS == signal ) ? g_prior_bus : g_prior_segv;
+    if ( ( prior.sa_flags & SA_SIGINFO ) && 0 != prior.sa_sigaction )
+    {
+        prior.sa_sigaction( signal, info, context );
+        return;
+    }
+    if ( SIG_DFL != prior.sa_handler && SIG_IGN != prior.sa_handler )
+    {
+        prior.sa_handler( signal );
+        return;
+    }
+#endif
+
+    struct sigaction sa = {};
+    sa.sa_handler = SIG_DFL;
+    sigaction( signal, &sa, 0 ); // returning re-runs the faulting instruction, which now gets the default action
+} //guard_page_handler
+
+static void install_guard_page_handler()
+{
+    struct sigaction sa_guard = {};
+    sa_guard.sa_sigaction = guard_page_handler;
+    sa_guard.sa_flags = SA_SIGINFO;
+#ifdef RVOS_LIBRARY
+    sigaction( SIGSEGV, &sa_guard, &g_prior_segv );
+    sigaction( SIGBUS, &sa_guard, &g_prior_bus );
+#else
+    sigaction( SIGSEGV, &sa_guard, 0 );
+    sigaction( SIGBUS, &sa_guard, 0 );
+#endif
+} //install_guard_page_handler
+
+#endif //USE_GUARD_PAGES
+
+// marks the calling thread blocked for the duration of a system call that can block
+
+struct BlockingSyscall
+{
+    GuestThread * t;
+    BlockingSyscall( bool can_block ) : t( can_block ? g_current_thread : 0 ) { if ( t ) t->blocked = true; }
+    ~BlockingSyscall() { if ( t ) t->blocked = false; }
+};
+
+static void end_guest_threads()
+{
+    lock_guard<mutex> lock( g_vm->threads_mutex );
+    g_vm->stopping = true;
+    if ( 0 != g_vm->main_thread.cpu )
+        g_vm->main_thread.cpu->end_emulation();
+    for ( size_t i = 0; i < g_vm->threads.size(); i++ )
+        g_vm->threads[ i ]->cpu->end_emulation();
+} //end_guest_threads
+
+#ifdef RVOS_LIBRARY
+
+static void end_vm_with_error( const char * perror )
+{
+    {
+        lock_guard<mutex> lock( g_vm->threads_mutex );
+        if ( g_vm->error.empty() )
+            g_vm->error = perror;
+    }
+    g_vm->exit_code = 1;
+    g_vm->terminate = true;
+    end_guest_threads();
+} //end_vm_with_error
+
+// A fatal error on any hart ends the vm, not the host app. That's an exception or, with guard pages, a fault that
+// guard_page_handler turns into a siglongjmp back here since it can't throw.
+
+static uint64_t run_library_hart( GuestThread & t, uint32_t features )
+{
+#ifdef USE_GUARD_PAGES
+    sigjmp_buf fault_jump;
+    if ( 0 != sigsetjmp( fault_jump, 1 ) )
+    {
+        t.fault_jump = 0;
+        end_vm_with_error( t.fault_message );
+        return 0;
+    }
+    t.fault_jump = &fault_jump;
+#endif
+
+    uint64_t instructions = 0;
+    try
+    {
+        instructions = t.cpu->run( features );
+    }
+    catch ( exception & e )
+    {
+#ifdef USE_GUARD_PAGES
+        t.fault_jump = 0;
+        t.in_syscall = false;
+#endif
+        end_vm_with_error( e.what() );
+    }
+
+#ifdef USE_GUARD_PAGES
+    t.fault_jump = 0;
+#endif
+    return instructions;
+} //run_library_hart
+
+#endif //RVOS_LIBRARY
+
+// returns the new thread's tid. The new hart starts after the ecall with the caller's registers and a0 = 0
+
+static uint64_t start_guest_thread( CPUClass & cpu, uint64_t flags, uint64_t stack, uint64_t ptid, uint64_t ctid, uint64_t tls )
+{
+    const uint64_t clone_settls = 0x80000, clone_parent_settid = 0x100000, clone_child_cleartid = 0x200000, clone_child_settid = 0x1000000;
+
+    GuestThread * t = new GuestThread();
+    t->cpu = new CPUClass( g_vm->memory, g_vm->base_address, cpu.pc + 4, 0, stack ? stack : ACCESS_REG( RiscV::sp ) ); // 0 stack size: unchecked
+    memcpy( t->cpu->regs, cpu.regs, sizeof( cpu.regs ) );
+    memcpy( t->cpu->fregs, cpu.fregs, sizeof( cpu.fregs ) );
+    t->cpu->regs[ RiscV::a0 ] = 0;
+    if ( 0 != stack )
+        t->cpu->regs[ RiscV::sp ] = stack;
+    if ( flags & clone_settls )
+        t->cpu->regs[ RiscV::tp ] = tls;
+    if ( flags & clone_child_cleartid )
+        t->clear_child_tid = ctid;
+    t->cpu->instruction_budget = cpu.instruction_budget;
+    bool tracing = cpu.tracing_instructions();
+    VMContext * vm = g_vm;
+
+    {
+        lock_guard<mutex> lock( g_vm->threads_mutex );
+        g_vm->threads.push_back( t );
+        g_vm->live_threads++;
+    }
+
+    future<uint64_t> tid_future = t->tid_ready.get_future();
+    t->host_thread = thread( [ t, tracing, vm ]()
+    {
+        g_vm = vm;
+        g_current_thread = t;
+#ifdef USE_HOST_FUTEX
+        t->host_handle = pthread_self();
+#endif
+        t->tid_ready.set_value( host_thread_id() );
+        t->go.get_future().wait();
+        t->cpu->trace_instructions( tracing );
+#ifdef RVOS_LIBRARY
+        t->instructions = run_library_hart( *t, g_vm->run_features );
+#else
+        t->instructions = t->cpu->run( g_vm->run_features );
+#endif
+        t->finished = true;
+        tracer.Trace( "  hart for thread %llu returned after %llu instructions\n", t->tid, t->instructions );
+        if ( g_vm->stopping )
+            stop_blocked_harts();
+    } );
+
+    t->tid = tid_future.get();
+    if ( flags & clone_parent_settid )
+        cpu.setui32( ptid, (uint32_t) t->tid );
+    if ( flags & clone_child_settid )
+        cpu.setui32( ctid, (uint32_t) t->tid );
+    tracer.Trace( "  started thread %llu, pc %llx, stack %llx, tls %llx\n", t->tid, t->cpu->pc, stack, tls );
+    t->go.set_value();
+    return t->tid;
+} //start_guest_thread
+
+// returns true if the calling thread ended and others are still running. false if it's the last thread
+
+static bool exit_guest_thread( CPUClass & cpu )
+{
+    GuestThread * t = g_current_thread;
+    lock_guard<mutex> lock( g_vm->threads_mutex );
+    if ( 1 == g_vm->live_threads )
+        return false;
+
+    g_vm->live_threads--;
+    t->exited = true;
+    release_robust_futexes( cpu, t );
+    if ( 0 != t->clear_child_tid && is_thread_address_valid( cpu, t->clear_child_tid ) )
+    {
+        cpu.setui32( t->clear_child_tid, 0 ); // pthread_join waits on this
+        wake_futex( cpu, t->clear_child_tid );
+    }
+    cpu.end_emulation();
+    tracer.Trace( "  thread %llu exited, %zd threads remain\n", t->tid, g_vm->live_threads );
+    return true;
+} //exit_guest_thread
+
+static void flush_guest_threads()
+{
+    lock_guard<mutex> lock( g_vm->threads_mutex );
+    if ( 0 != g_vm->main_thread.cpu )
+        g_vm->main_thread.cpu->request_flush_instruction_cache();
+    for ( size_t i = 0; i < g_vm->threads.size(); i++ )
+        g_vm->threads[ i ]->cpu->request_flush_instruction_cache();
+} //flush_guest_threads
+
+// called by main once its hart returns. Returns the count of instructions executed by the other harts
+
+static uint64_t join_guest_threads()
+{
+    uint64_t instructions = 0;
+
+    for ( ;; )
+    {
+        GuestThread * t = 0;
+        {
+            lock_guard<mutex> lock( g_vm->threads_mutex );
+            if ( g_vm->threads.empty() )
+                break;
+            t = g_vm->threads.back();
+        }
+
+        t->host_thread.join(); // can't hold the lock; the thread may be creating threads or exiting
+
+        {
+            lock_guard<mutex> lock( g_vm->threads_mutex );
+            g_vm->threads.erase( find( g_vm->threads.begin(), g_vm->threads.end(), t ) );
+        }
+
+        instructions += t->instructions;
+        delete t->cpu;
+        delete t;
+    }
+
+    return instructions;
+} //join_guest_threads
+
+static bool syscall_can_block( REG_TYPE id )
+{
+    return ( SYS_futex == id || SYS_nanosleep == id || SYS_clock_nanosleep == id || SYS_read == id || SYS_wait4 == id ||
+             SYS_pselect6 == id || SYS_ppoll_time32 == id || SYS_sched_yield == id );
+} //syscall_can_block
+
+#endif //RVOS
+
+// bytes of address space the app uses as RLIMIT_AS counts it: the image and brk heap, the stack, and mmap allocations
+
+static uint64_t address_space_in_use()
+{
+    return (uint64_t) g_vm->brk_offset + g_vm->stack_commit + g_vm->mmap_allocator.bytes_in_use();
+} //address_space_in_use
+
+static bool address_space_available( uint64_t more )
+{
+    uint64_t in_use = address_space_in_use();
+    if ( more <= g_vm->address_space_limit && in_use <= ( g_vm->address_space_limit - more ) )
+        return true;
+
+    tracer.Trace( "  RLIMIT_AS %llu reached. %llu bytes in use, %llu more requested\n", g_vm->address_space_limit, in_use, more );
+    return false;
+} //address_space_available
+
+// like pread: read up to len bytes at offset without moving the file pointer. Bytes past the end of the file are untouched
+
+static bool read_file_at( int descriptor, uint8_t * p, size_t len, uint64_t offset )
+{
+    while ( len > 0 )
+    {
+#ifdef _WIN32
+        __int64 original = _lseeki64( descriptor, 0, SEEK_CUR );
+        if ( original < 0 || _lseeki64( descriptor, (__int64) offset, SEEK_SET ) < 0 )
+            return false;
+        int r = _read( descriptor, p, (unsigned int) get_min( len, (size_t) 0x40000000 ) );
+        _lseeki64( descriptor, original, SEEK_SET );
+#else
+        ssize_t r = pread( descriptor, p, len, (off_t) offset );
+#endif
+        if ( r < 0 )
+            return false;
+        if ( 0 == r )
+            break;
+
+        p += r;
+        len -= r;
+        offset += r;
+    }
+
+    return true;
+} //read_file_at
+
+// Fill len bytes of guest memory at address for an mmap of the file at file_offset. Pages come straight from the file
+// where the host's page size allows; otherwise private mappings are read in. Bytes past the end of the file are 0.
+
+static bool map_guest_file( uint64_t address, int fd, uint64_t file_offset, uint64_t len, uint64_t file_size, bool shared, bool writable )
+{
+    if ( file_size <= file_offset )
+        return true;
+
+    size_t mem_offset = (size_t) ( address - g_vm->base_address );
+    size_t file_len = (size_t) get_min( len, file_size - file_offset );
+    size_t map_len = round_up( file_len, CVirtualMemory::page_size() ); // the last page is partly past the end of the file
+
+    errno = ENODEV;
+    if ( map_len <= len && g_vm->memory.map_file( mem_offset, fd, file_offset, map_len, shared, writable ) )
+    {
+        tracer.Trace( "  mapped %zu bytes of the file at offset %llu, shared %d\n", map_len, file_offset, shared );
+        return true;
+    }
+
+    if ( shared && writable ) // writes must reach the file, so a copy won't do
+        return false;
+
+    tracer.Trace( "  reading %zu bytes of the file at offset %llu instead of mapping it\n", file_len, file_offset );
+    return read_file_at( fd, g_vm->memory.data() + mem_offset, file_len, file_offset );
+} //map_guest_file
+
 // this is called when the arm64 app has an svc #0 instruction or a RISC-V 64 app has an ecall instruction
 // https://thevivekpandey.github.io/posts/2017-09-25-linux-system-calls.html
 
 #pragma warning(disable: 4189) // unreferenced local variable
 
-void emulator_invoke_svc( CPUClass & cpu )
+static void invoke_svc( CPUClass & cpu )
 {
 #ifdef _WIN32
-    static HANDLE g_hFindFirst = INVALID_HANDLE_VALUE; // for enumerating directories. Only one can be active at once.
-    static char g_acFindFirstPattern[ EMULATOR_MAX_PATH ];
     char acPath[ EMULATOR_MAX_PATH ];
-#else
-    static DIR * g_FindFirst = 0;
-    static REG_TYPE g_FindFirstDescriptor = -1;
 #endif
 
     REG_TYPE syscall_id = ACCESS_REG( REG_SYSCALL );
@@ -2482,6 +3135,27 @@ void emulator_invoke_svc( CPUClass & cpu )
                       ACCESS_REG( REG_ARG4 ), ACCESS_REG( REG_ARG5 ) );
 #endif
 
+#ifdef RVOS
+    if ( 0 != g_vm->syscall_hook )
+    {
+        uint64_t args[ 6 ] = { ACCESS_REG( REG_ARG0 ), ACCESS_REG( REG_ARG1 ), ACCESS_REG( REG_ARG2 ),
+                               ACCESS_REG( REG_ARG3 ), ACCESS_REG( REG_ARG4 ), ACCESS_REG( REG_ARG5 ) };
+        int64_t result = 0;
+        if ( g_vm->syscall_hook( g_vm->syscall_hook_context, syscall_id, args, &result ) )
+        {
+            tracer.Trace( "  syscall handled by the host app, returning %lld\n", result );
+            ACCESS_REG( REG_RESULT ) = (REG_TYPE) result;
+            return;
+        }
+    }
+
+    unique_lock<mutex> svc_lock( g_vm->svc_mutex, defer_lock ); // other harts can make system calls while this one blocks
+    bool can_block = syscall_can_block( syscall_id );
+    BlockingSyscall blocking( can_block );
+    if ( !can_block )
+        svc_lock.lock();
+#endif
+
     switch ( syscall_id )
     {
         case emulator_sys_exit: // exit
@@ -2489,10 +3163,16 @@ void emulator_invoke_svc( CPUClass & cpu )
         case SYS_exit_group:
         case SYS_tgkill:
         {
-            g_terminate = true;
+#ifdef RVOS
+            if ( SYS_exit == syscall_id && exit_guest_thread( cpu ) )
+                break; // just this thread exits. a0 is left alone; the hart never returns from the ecall
+
+            end_guest_threads();
+#endif
+            g_vm->terminate = true;
             cpu.end_emulation();
-            g_exit_code = (int) ACCESS_REG( REG_ARG0 );
-            tracer.Trace( "  emulated app exit code %d\n", g_exit_code );
+            g_vm->exit_code = (int) ACCESS_REG( REG_ARG0 );
+            tracer.Trace( "  emulated app exit code %d\n", g_vm->exit_code );
             update_result_errno( cpu, 0 );
             break;
         }
@@ -2504,8 +3184,8 @@ void emulator_invoke_svc( CPUClass & cpu )
             tracer.Trace( "  x86 ugetrlimit resource %u\n", resource );
             if ( 3 == resource ) // RLIMIT_STACK
             {
-                prlimit->rlim_cur = g_stack_commit;
-                prlimit->rlim_max = g_stack_commit;
+                prlimit->rlim_cur = g_vm->stack_commit;
+                prlimit->rlim_max = g_vm->stack_commit;
                 tracer.Trace( "ugetrlimit stack cur=%08x max=%08x\n", prlimit->rlim_cur, prlimit->rlim_max );
             }
             else
@@ -2530,7 +3210,7 @@ void emulator_invoke_svc( CPUClass & cpu )
                 cpu.reg_gs() = pud->base_addr;
             }
             pud->swap_endianness();
-            memcpy( & g_user_desc, pud, sizeof( *pud ) );
+            memcpy( & g_vm->user_desc, pud, sizeof( *pud ) );
 
             update_result_errno( cpu, 0 );
             break;
@@ -2539,7 +3219,7 @@ void emulator_invoke_svc( CPUClass & cpu )
         case emulator_sys_get_thread_area:
         {
             struct linux_user_desc * pud = (linux_user_desc *) cpu.getmem( ACCESS_REG( REG_ARG0 ) );
-            memcpy( pud, & g_user_desc, sizeof( *pud ) );
+            memcpy( pud, & g_vm->user_desc, sizeof( *pud ) );
             update_result_errno( cpu, 0 );
             break;
         }
@@ -2904,6 +3584,20 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             prlimit->rlim_cur = ~decltype( prlimit->rlim_cur )( 0 );
             prlimit->rlim_max = ~decltype( prlimit->rlim_max )( 0 );
+            if ( 9 == resource ) // RLIMIT_AS. limits too big for 32-bit fields are reported as infinite
+            {
+                if ( g_vm->address_space_limit < prlimit->rlim_cur )
+                    prlimit->rlim_cur = (decltype( prlimit->rlim_cur )) g_vm->address_space_limit;
+                if ( g_vm->address_space_max < prlimit->rlim_max )
+                    prlimit->rlim_max = (decltype( prlimit->rlim_max )) g_vm->address_space_max;
+#if defined( X32OS ) || defined( SPARCOS ) || defined ( M68 )
+                prlimit->rlim_cur = swap_endian32( prlimit->rlim_cur );
+                prlimit->rlim_max = swap_endian32( prlimit->rlim_max );
+#else
+                prlimit->rlim_cur = swap_endian64( prlimit->rlim_cur );
+                prlimit->rlim_max = swap_endian64( prlimit->rlim_max );
+#endif
+            }
             update_result_errno( cpu, 0 );
             break;
         }
@@ -2971,6 +3665,12 @@ void emulator_invoke_svc( CPUClass & cpu )
         {
             char * path = (char *) cpu.getmem( ACCESS_REG( REG_ARG0 ) );
             tracer.Trace( "    path: '%s'\n", path );
+#ifdef RVOS_LIBRARY
+            // the vm shares its process with the host app, which execve would replace
+            errno = ENOSYS;
+            update_result_errno( cpu, -1 );
+            break;
+#else
             REG_TYPE * argv = (REG_TYPE *) cpu.getmem( ACCESS_REG( REG_ARG1 ) );
             REG_TYPE * envp = (REG_TYPE *) cpu.getmem( ACCESS_REG( REG_ARG2 ) );
 
@@ -3005,10 +3705,14 @@ void emulator_invoke_svc( CPUClass & cpu )
 #endif
             update_result_errno( cpu, result );
             break;
+#endif
         }
         case emulator_sys_fork:
         {
-#ifdef _WIN32
+#if defined( RVOS_LIBRARY ) // the child would be a copy of the whole host app, returning from rvos_run into its code
+            errno = ENOSYS;
+            int result = -1;
+#elif defined( _WIN32 )
             assert( false );
             // to do: write all of RAM and register values for the emulated app to disk and create new flag for the emulator to load and run one of those dumps.
             int result = -1;
@@ -3023,24 +3727,36 @@ void emulator_invoke_svc( CPUClass & cpu )
         {
             // glibc's posix_spawn()/system() use clone3 for a fast fork-then-exec
             // spawn. True CLONE_VM/CLONE_THREAD semantics (memory shared with the
-            // parent until exec/exit, real thread creation) aren't implemented -
+            // parent until exec/exit) aren't implemented for processes -
             // this behaves exactly like plain fork(): a real, independent
             // (copy-on-write) host child process. That's indistinguishable from
             // clone3's usual semantics for the spawn+exec pattern glibc actually
             // uses it for, since the child only runs a little setup code before
-            // calling execve() or _exit(). Guest code that relies on genuine
-            // shared memory across clone3 (e.g. real thread creation) isn't
-            // supported - such a child never runs under the emulator at all.
+            // calling execve() or _exit(). CLONE_THREAD creates a guest thread
+            // that runs on its own hart and host thread, sharing memory.
             uint64_t * pflags = (uint64_t *) cpu.getmem( ACCESS_REG( REG_ARG0 ) ); // struct clone_args starts with __u64 flags
             tracer.Trace( "  syscall command SYS_clone3, flags %#llx\n", pflags ? *pflags : 0 );
 
-#ifdef _WIN32
-            assert( false );
-            int result = -1;
-#else
-            int result = fork();
-            tracer.Trace( "  result of clone3-as-fork: %#x\n", result );
-#endif
+#ifdef RVOS
+            if ( pflags && ( pflags[ 0 ] & 0x10000 ) ) // CLONE_THREAD
+            {
+                // struct clone_args { flags, pidfd, child_tid, parent_tid, exit_signal, stack, stack_size, tls, ... }
+                uint64_t stack = pflags[ 5 ] ? pflags[ 5 ] + pflags[ 6 ] : 0;
+                update_result_errno( cpu, start_guest_thread( cpu, pflags[ 0 ], stack, pflags[ 3 ], pflags[ 2 ], pflags[ 7 ] ) );
+                break;
+            }
+#endif
+
+#if defined( RVOS_LIBRARY ) // as with fork, the child would be a copy of the host app
+            errno = ENOSYS;
+            int result = -1;
+#elif defined( _WIN32 )
+            assert( false );
+            int result = -1;
+#else
+            int result = fork();
+            tracer.Trace( "  result of clone3-as-fork: %#x\n", result );
+#endif
             update_result_errno( cpu, result );
             break;
         }
@@ -3207,16 +3923,16 @@ void emulator_invoke_svc( CPUClass & cpu )
             DWORD attr = GetFileAttributesA( acPath );
             if ( ( INVALID_FILE_ATTRIBUTES != attr ) && ( attr & FILE_ATTRIBUTE_DIRECTORY ) )
             {
-                if ( INVALID_HANDLE_VALUE != g_hFindFirst )
+                if ( INVALID_HANDLE_VALUE != g_vm->hFindFirst )
                 {
-                    FindClose( g_hFindFirst );
-                    g_hFindFirst = INVALID_HANDLE_VALUE;
+                    FindClose( g_vm->hFindFirst );
+                    g_vm->hFindFirst = INVALID_HANDLE_VALUE;
                 }
-                strcpy( g_acFindFirstPattern, acPath );
-                size_t len = strlen( g_acFindFirstPattern );
-                if ( '\\' != g_acFindFirstPattern[ len - 1 ] )
-                    strcat( g_acFindFirstPattern, "\\" );
-                strcat( g_acFindFirstPattern, "*.*" );
+                strcpy( g_vm->acFindFirstPattern, acPath );
+                size_t len = strlen( g_vm->acFindFirstPattern );
+                if ( '\\' != g_vm->acFindFirstPattern[ len - 1 ] )
+                    strcat( g_vm->acFindFirstPattern, "\\" );
+                strcat( g_vm->acFindFirstPattern, "*.*" );
                 descriptor = findFirstDescriptor;
             }
             else
@@ -3257,11 +3973,11 @@ void emulator_invoke_svc( CPUClass & cpu )
 #ifdef _WIN32
                 if ( findFirstDescriptor == descriptor )
                 {
-                    if ( INVALID_HANDLE_VALUE != g_hFindFirst )
+                    if ( INVALID_HANDLE_VALUE != g_vm->hFindFirst )
                     {
-                        FindClose( g_hFindFirst );
-                        g_hFindFirst = INVALID_HANDLE_VALUE;
-                        g_acFindFirstPattern[ 0 ] = 0;
+                        FindClose( g_vm->hFindFirst );
+                        g_vm->hFindFirst = INVALID_HANDLE_VALUE;
+                        g_vm->acFindFirstPattern[ 0 ] = 0;
                     }
                     update_result_errno( cpu, 0 );
                     break;
@@ -3273,14 +3989,14 @@ void emulator_invoke_svc( CPUClass & cpu )
                 }
                 else
 #else
-                if ( g_FindFirstDescriptor == descriptor )
+                if ( g_vm->FindFirstDescriptor == descriptor )
                 {
-                    if ( 0 != g_FindFirst )
+                    if ( 0 != g_vm->FindFirst )
                     {
-                        closedir( g_FindFirst );
-                        g_FindFirst = 0;
+                        closedir( g_vm->FindFirst );
+                        g_vm->FindFirst = 0;
                     }
-                    g_FindFirstDescriptor = -1;
+                    g_vm->FindFirstDescriptor = -1;
                     update_result_errno( cpu, 0 );
                     break;
                 }
@@ -3301,9 +4017,9 @@ void emulator_invoke_svc( CPUClass & cpu )
             memset( pentries, 0, count );
 
 #ifdef _WIN32
-            if ( ( findFirstDescriptor != descriptor ) || ( 0 == g_acFindFirstPattern[ 0 ] ) )
+            if ( ( findFirstDescriptor != descriptor ) || ( 0 == g_vm->acFindFirstPattern[ 0 ] ) )
             {
-                tracer.Trace( "  getdents on unexpected descriptor or FindFirst (%p) not open\n", g_hFindFirst );
+                tracer.Trace( "  getdents on unexpected descriptor or FindFirst (%p) not open\n", g_vm->hFindFirst );
                 errno = EBADF;
                 update_result_errno( cpu, -1 );
                 break;
@@ -3311,13 +4027,13 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             WIN32_FIND_DATAA fd = {0};
 
-            if ( INVALID_HANDLE_VALUE == g_hFindFirst )
+            if ( INVALID_HANDLE_VALUE == g_vm->hFindFirst )
             {
-                tracer.Trace( "findfirstfilea call, pattern '%s'\n", g_acFindFirstPattern );
-                g_hFindFirst = FindFirstFileA( g_acFindFirstPattern, &fd );
-                if ( INVALID_HANDLE_VALUE != g_hFindFirst )
+                tracer.Trace( "findfirstfilea call, pattern '%s'\n", g_vm->acFindFirstPattern );
+                g_vm->hFindFirst = FindFirstFileA( g_vm->acFindFirstPattern, &fd );
+                if ( INVALID_HANDLE_VALUE != g_vm->hFindFirst )
                 {
-                    tracer.Trace( "  successfully opened FindFirst for pattern '%s'\n", g_acFindFirstPattern );
+                    tracer.Trace( "  successfully opened FindFirst for pattern '%s'\n", g_vm->acFindFirstPattern );
 
                     size_t len = strlen( fd.cFileName );
                     if ( ( count < sizeof( struct linux_dirent_syscall ) ) || ( len > ( count - sizeof( struct linux_dirent_syscall ) ) ) )
@@ -3357,7 +4073,7 @@ void emulator_invoke_svc( CPUClass & cpu )
             {
                 // find next here
 
-                BOOL found = FindNextFileA( g_hFindFirst, &fd );
+                BOOL found = FindNextFileA( g_vm->hFindFirst, &fd );
                 if ( found )
                 {
                     size_t len = strlen( fd.cFileName );
@@ -3391,35 +4107,35 @@ void emulator_invoke_svc( CPUClass & cpu )
                 else
                 {
                     tracer.Trace( "  out of next files\n" );
-                    FindClose( g_hFindFirst );
-                    g_hFindFirst = INVALID_HANDLE_VALUE;
-                    g_acFindFirstPattern[ 0 ] = 0;
+                    FindClose( g_vm->hFindFirst );
+                    g_vm->hFindFirst = INVALID_HANDLE_VALUE;
+                    g_vm->acFindFirstPattern[ 0 ] = 0;
                     result = 0; // nothing left
                 }
             }
 #else
-            tracer.Trace( "  g_FindFirstDescriptor: %d, g_FindFirst: %p\n", g_FindFirstDescriptor, g_FindFirst );
+            tracer.Trace( "  g_FindFirstDescriptor: %d, g_FindFirst: %p\n", g_vm->FindFirstDescriptor, g_vm->FindFirst );
 
-            if ( g_FindFirstDescriptor != descriptor )
+            if ( g_vm->FindFirstDescriptor != descriptor )
             {
-                if ( 0 != g_FindFirst )
+                if ( 0 != g_vm->FindFirst )
                 {
-                    closedir( g_FindFirst );
-                    g_FindFirst = 0;
+                    closedir( g_vm->FindFirst );
+                    g_vm->FindFirst = 0;
                 }
-                g_FindFirstDescriptor = descriptor;
-                g_FindFirst = fdopendir( descriptor );
+                g_vm->FindFirstDescriptor = descriptor;
+                g_vm->FindFirst = fdopendir( descriptor );
             }
 
-            if ( 0 == g_FindFirst )
+            if ( 0 == g_vm->FindFirst )
             {
                 errno = EBADF;
-                g_FindFirstDescriptor = -1;
+                g_vm->FindFirstDescriptor = -1;
                 update_result_errno( cpu, -1 );
                 break;
             }
 
-            struct dirent * pent = readdir( g_FindFirst );
+            struct dirent * pent = readdir( g_vm->FindFirst );
             if ( 0 != pent )
             {
                 tracer.Trace( "  readdir returned '%s'\n", pent->d_name );
@@ -3473,9 +4189,9 @@ void emulator_invoke_svc( CPUClass & cpu )
             }
 
 #ifdef _WIN32
-            if ( ( findFirstDescriptor != descriptor ) || ( 0 == g_acFindFirstPattern[ 0 ] ) )
+            if ( ( findFirstDescriptor != descriptor ) || ( 0 == g_vm->acFindFirstPattern[ 0 ] ) )
             {
-                tracer.Trace( "  getdents on unexpected descriptor or FindFirst (%p) not open\n", g_hFindFirst );
+                tracer.Trace( "  getdents on unexpected descriptor or FindFirst (%p) not open\n", g_vm->hFindFirst );
                 errno = EBADF;
                 update_result_errno( cpu, -1 );
                 break;
@@ -3483,13 +4199,13 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             WIN32_FIND_DATAA fd = {0};
 
-            if ( INVALID_HANDLE_VALUE == g_hFindFirst )
+            if ( INVALID_HANDLE_VALUE == g_vm->hFindFirst )
             {
-                tracer.Trace( "findfirstfilea call, pattern '%s'\n", g_acFindFirstPattern );
-                g_hFindFirst = FindFirstFileA( g_acFindFirstPattern, &fd );
-                if ( INVALID_HANDLE_VALUE != g_hFindFirst )
+                tracer.Trace( "findfirstfilea call, pattern '%s'\n", g_vm->acFindFirstPattern );
+                g_vm->hFindFirst = FindFirstFileA( g_vm->acFindFirstPattern, &fd );
+                if ( INVALID_HANDLE_VALUE != g_vm->hFindFirst )
                 {
-                    tracer.Trace( "  successfully opened FindFirst for pattern '%s'\n", g_acFindFirstPattern );
+                    tracer.Trace( "  successfully opened FindFirst for pattern '%s'\n", g_vm->acFindFirstPattern );
 
                     size_t len = strlen( fd.cFileName );
                     if ( ( count < sizeof( struct linux_dirent64_syscall ) ) || ( len > ( count - sizeof( struct linux_dirent64_syscall ) ) ) )
@@ -3529,7 +4245,7 @@ void emulator_invoke_svc( CPUClass & cpu )
             {
                 // find next here
 
-                BOOL found = FindNextFileA( g_hFindFirst, &fd );
+                BOOL found = FindNextFileA( g_vm->hFindFirst, &fd );
                 if ( found )
                 {
                     size_t len = strlen( fd.cFileName );
@@ -3561,36 +4277,36 @@ void emulator_invoke_svc( CPUClass & cpu )
                 else
                 {
                     tracer.Trace( "  out of next files\n" );
-                    FindClose( g_hFindFirst );
-                    g_hFindFirst = INVALID_HANDLE_VALUE;
-                    g_acFindFirstPattern[ 0 ] = 0;
+                    FindClose( g_vm->hFindFirst );
+                    g_vm->hFindFirst = INVALID_HANDLE_VALUE;
+                    g_vm->acFindFirstPattern[ 0 ] = 0;
                     result = 0; // nothing left
                 }
             }
 #else
-            tracer.Trace( "  g_FindFirstDescriptor: %d, g_FindFirst: %p, descriptor: %p\n", g_FindFirstDescriptor, g_FindFirst, descriptor );
+            tracer.Trace( "  g_FindFirstDescriptor: %d, g_FindFirst: %p, descriptor: %p\n", g_vm->FindFirstDescriptor, g_vm->FindFirst, descriptor );
 
-            if ( g_FindFirstDescriptor != descriptor )
+            if ( g_vm->FindFirstDescriptor != descriptor )
             {
-                if ( 0 != g_FindFirst )
+                if ( 0 != g_vm->FindFirst )
                 {
-                    closedir( g_FindFirst );
-                    g_FindFirst = 0;
+                    closedir( g_vm->FindFirst );
+                    g_vm->FindFirst = 0;
                 }
-                g_FindFirstDescriptor = descriptor;
-                g_FindFirst = fdopendir( descriptor );
+                g_vm->FindFirstDescriptor = descriptor;
+                g_vm->FindFirst = fdopendir( descriptor );
             }
 
-            if ( 0 == g_FindFirst )
+            if ( 0 == g_vm->FindFirst )
             {
                 tracer.Trace( "  no g_FindFirst\n" );
                 errno = EBADF;
-                g_FindFirstDescriptor = -1;
+                g_vm->FindFirstDescriptor = -1;
                 update_result_errno( cpu, -1 );
                 break;
             }
 
-            struct dirent * pent = readdir( g_FindFirst );
+            struct dirent * pent = readdir( g_vm->FindFirst );
             if ( 0 != pent )
             {
                 tracer.Trace( "  readdir returned '%s'\n", pent->d_name );
@@ -3628,20 +4344,30 @@ void emulator_invoke_svc( CPUClass & cpu )
         }
         case SYS_brk:
         {
-            REG_TYPE original = g_brk_offset;
+            REG_TYPE original = g_vm->brk_offset;
             REG_TYPE ask = ACCESS_REG( REG_ARG0 );
             if ( 0 == ask )
-                ACCESS_REG( REG_RESULT ) = cpu.get_vm_address( g_brk_offset );
+                ACCESS_REG( REG_RESULT ) = cpu.get_vm_address( g_vm->brk_offset );
             else
             {
-                REG_TYPE ask_offset = ask - g_base_address;
-                tracer.Trace( "  ask_offset %llx, g_end_of_data %llx, bottom_of_stack %llx\n", (uint64_t) ask_offset, (uint64_t) g_end_of_data, (uint64_t) g_bottom_of_stack );
+                REG_TYPE ask_offset = ask - g_vm->base_address;
+                tracer.Trace( "  ask_offset %llx, end_of_data %llx, bottom_of_stack %llx\n", (uint64_t) ask_offset, (uint64_t) g_vm->end_of_data, (uint64_t) g_vm->bottom_of_stack );
 
-                if ( ask_offset >= g_end_of_data && ask_offset < g_bottom_of_stack )
+                if ( ask_offset >= g_vm->end_of_data && ask_offset < ( g_vm->bottom_of_stack - g_vm->stack_guard ) &&
+                     ( ask_offset <= g_vm->brk_offset || address_space_available( ask_offset - g_vm->brk_offset ) ) )
                 {
-                    g_brk_offset = cpu.getoffset( ask );
-                    if ( g_brk_offset > g_highwater_brk )
-                        g_highwater_brk = g_brk_offset;
+                    REG_TYPE new_brk = cpu.getoffset( ask );
+                    if ( new_brk < g_vm->brk_offset ) // give whole pages the app no longer uses back to the host
+                    {
+                        REG_TYPE keep = round_up( new_brk, (REG_TYPE) 4096 );
+                        REG_TYPE past = round_up( g_vm->brk_offset, (REG_TYPE) 4096 );
+                        if ( past > keep )
+                            g_vm->memory.discard( (size_t) keep, (size_t) ( past - keep ) );
+                    }
+
+                    g_vm->brk_offset = new_brk;
+                    if ( g_vm->brk_offset > g_vm->highwater_brk )
+                        g_vm->highwater_brk = g_vm->brk_offset;
 #if defined( X64OS ) || defined( X32OS ) // as far as I can tell x32 and x64 are the only platforms that requires the ask to be in the result on return
                     ACCESS_REG( REG_RESULT ) = ask;
 #endif
@@ -3649,12 +4375,12 @@ void emulator_invoke_svc( CPUClass & cpu )
                 else
                 {
                     tracer.Trace( "  allocation request was too large, failing it by returning current brk\n" );
-                    ACCESS_REG( REG_RESULT ) = cpu.get_vm_address( g_brk_offset );
+                    ACCESS_REG( REG_RESULT ) = cpu.get_vm_address( g_vm->brk_offset );
                 }
             }
 
             tracer.Trace( "  SYS_brk. ask %llx, current brk %llx, new brk %llx, result in return register %llx\n",
-                          (uint64_t) ask, (uint64_t) original, (uint64_t) g_brk_offset, (uint64_t) ACCESS_REG( REG_RESULT ) );
+                          (uint64_t) ask, (uint64_t) original, (uint64_t) g_vm->brk_offset, (uint64_t) ACCESS_REG( REG_RESULT ) );
             break;
         }
         case SYS_munmap:
@@ -3663,7 +4389,7 @@ void emulator_invoke_svc( CPUClass & cpu )
             REG_TYPE length = ACCESS_REG( REG_ARG1 );
             length = round_up( length, (REG_TYPE) 4096 );
 
-            bool ok = g_mmap.free( address, length );
+            bool ok = g_vm->mmap_allocator.free( address, length );
             if ( ok )
                 update_result_errno( cpu, 0 );
             else
@@ -3691,7 +4417,23 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             // flags: MREMAP_MAYMOVE = 1, MREMAP_FIXED = 2, MREMAP_DONTUNMAP = 3. Ignore them all
 
-            SIGNED_REG_TYPE result = (SIGNED_REG_TYPE) g_mmap.resize( address, old_length, new_length, ( 1 == flags ) );
+            if ( new_length > old_length && address >= g_vm->base_address &&
+                 g_vm->memory.is_file_mapped( (size_t) ( address - g_vm->base_address ), (size_t) old_length ) )
+            {
+                tracer.Trace( "  mremap can't grow mappings of files\n" );
+                errno = ENOMEM;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            if ( new_length > old_length && !address_space_available( new_length - old_length ) )
+            {
+                errno = ENOMEM;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            SIGNED_REG_TYPE result = (SIGNED_REG_TYPE) g_vm->mmap_allocator.resize( address, old_length, new_length, ( 1 == flags ) );
             if ( 0 != result )
                 update_result_errno( cpu, result );
             else
@@ -3702,9 +4444,40 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             break;
         }
+        case SYS_msync:
+        {
+            REG_TYPE address = ACCESS_REG( REG_ARG0 );
+            REG_TYPE length = ACCESS_REG( REG_ARG1 );
+            int flags = (int) ACCESS_REG( REG_ARG2 );
+            tracer.Trace( "  SYS_msync. address %llx, length %llx, flags %#x\n", (uint64_t) address, (uint64_t) length, flags );
+
+            if ( 0 != ( address & 0xfff ) || address < g_vm->base_address )
+            {
+                errno = EINVAL;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            // 1 == MS_ASYNC, 2 == MS_INVALIDATE (nothing to do with one copy of the pages), 4 == MS_SYNC
+            bool ok = g_vm->memory.sync( (size_t) ( address - g_vm->base_address ), (size_t) length, 0 != ( 4 & flags ) );
+            update_result_errno( cpu, ok ? 0 : -1 );
+            break;
+        }
         case SYS_clone:
         {
-            // can't create a new process or thread with this emulator
+#ifdef RVOS
+            // riscv argument order: flags, stack, parent_tid, child_tid, tls
+
+            uint64_t flags = ACCESS_REG( REG_ARG0 );
+            tracer.Trace( "  syscall command SYS_clone, flags %#llx\n", flags );
+            if ( flags & 0x10000 ) // CLONE_THREAD
+            {
+                update_result_errno( cpu, start_guest_thread( cpu, flags, ACCESS_REG( REG_ARG1 ), ACCESS_REG( REG_ARG2 ),
+                                                              ACCESS_REG( REG_ARG3 ), ACCESS_REG( REG_ARG4 ) ) );
+                break;
+            }
+#endif
+            // can't create a new process with this emulator except via clone3/fork
 
             errno = EACCES;
             update_result_errno( cpu, -1 );
@@ -3781,22 +4554,57 @@ void emulator_invoke_svc( CPUClass & cpu )
                 length = round_up( length, (size_t) 4096 );
             }
 
-            // addr_hint is ignored. If MAP_FIXED is specified, it'll fail below.
+            // addr_hint is used if that range is free. MAP_FIXED ranges must be within the mmap region. Files are mapped
+            // private or shared at 4k-aligned offsets; pages past the end of the file read as 0.
 
             if ( 0 == ( length & 0xfff ) )
             {
                 // 2 == MAP_PRIVATE, 0x20 == MAP_ANONYMOUS, 0x10 = MAP_FIXED
                 bool fixed = ( 0 != ( 0x10 & flags ) );
 
-                if ( 0x22 == ( 0x22 & flags ) )
+                // MAP_FIXED over allocated pages doesn't use more address space
+
+                if ( !address_space_available( fixed ? g_vm->mmap_allocator.free_bytes_in( addr_hint, length ) : length ) )
+                    tracer.Trace( "  mmap would exceed RLIMIT_AS\n" );
+                else if ( 0x22 == ( 0x22 & flags ) )
                 {
-                    SIGNED_REG_TYPE result = (SIGNED_REG_TYPE) g_mmap.allocate( addr_hint, length, fixed );
+                    SIGNED_REG_TYPE result = (SIGNED_REG_TYPE) g_vm->mmap_allocator.allocate( addr_hint, length, fixed );
                     if ( 0 != result )
                     {
                         update_result_errno( cpu, result );
                         break;
                     }
                 }
+                else if ( 0 == ( 0x20 & flags ) && ( 1 == ( 3 & flags ) || 2 == ( 3 & flags ) ) ) // a file. 1 == MAP_SHARED
+                {
+                    bool shared = ( 1 == ( 3 & flags ) );
+                    bool writable = ( 0 != ( 2 & prot ) ); // PROT_WRITE
+                    struct stat st;
+
+                    if ( 0 != ( offset & 0xfff ) )
+                        errno = EINVAL;
+                    else if ( 0 == fstat( fd, &st ) ) // sets errno to EBADF for bad descriptors
+                    {
+                        uint64_t result = g_vm->mmap_allocator.allocate( addr_hint, length, fixed );
+                        if ( 0 == result )
+                            errno = ENOMEM;
+                        else if ( map_guest_file( result, fd, offset, length, (uint64_t) st.st_size, shared, writable ) )
+                        {
+                            update_result_errno( cpu, (SIGNED_REG_TYPE) result );
+                            break;
+                        }
+                        else
+                        {
+                            int err = errno;
+                            g_vm->mmap_allocator.free( result, length );
+                            errno = err;
+                        }
+                    }
+
+                    tracer.Trace( "  file mmap failed, errno %d\n", errno );
+                    update_result_errno( cpu, -1 );
+                    break;
+                }
                 else
                     tracer.Trace( "  error: mmap flags %#x aren't supported\n", flags );
             }
@@ -3853,16 +4661,16 @@ void emulator_invoke_svc( CPUClass & cpu )
             DWORD attr = GetFileAttributesA( acPath );
             if ( ( INVALID_FILE_ATTRIBUTES != attr ) && ( attr & FILE_ATTRIBUTE_DIRECTORY ) )
             {
-                if ( INVALID_HANDLE_VALUE != g_hFindFirst )
+                if ( INVALID_HANDLE_VALUE != g_vm->hFindFirst )
                 {
-                    FindClose( g_hFindFirst );
-                    g_hFindFirst = INVALID_HANDLE_VALUE;
+                    FindClose( g_vm->hFindFirst );
+                    g_vm->hFindFirst = INVALID_HANDLE_VALUE;
                 }
-                strcpy( g_acFindFirstPattern, acPath );
-                size_t len = strlen( g_acFindFirstPattern );
-                if ( '\\' != g_acFindFirstPattern[ len - 1 ] )
-                    strcat( g_acFindFirstPattern, "\\" );
-                strcat( g_acFindFirstPattern, "*.*" );
+                strcpy( g_vm->acFindFirstPattern, acPath );
+                size_t len = strlen( g_vm->acFindFirstPattern );
+                if ( '\\' != g_vm->acFindFirstPattern[ len - 1 ] )
+                    strcat( g_vm->acFindFirstPattern, "\\" );
+                strcat( g_vm->acFindFirstPattern, "*.*" );
                 descriptor = findFirstDescriptor;
             }
             else
@@ -4090,7 +4898,10 @@ void emulator_invoke_svc( CPUClass & cpu )
         {
             const char * path = (const char *) cpu.getmem( ACCESS_REG( REG_ARG0 ) );
             tracer.Trace( "  syscall command SYS_chdir path %s\n", path );
-#ifdef _WIN32
+#if defined( RVOS_LIBRARY ) // the working directory belongs to the host app and every vm in it
+            errno = EPERM;
+            int result = -1;
+#elif defined( _WIN32 )
             int result = _chdir( path );
 #else
             int result = chdir( path );
@@ -4361,6 +5172,58 @@ void emulator_invoke_svc( CPUClass & cpu )
 
             tracer.Trace( "  futex all paddr %p (%d), futex_op %d, val %d\n", paddr, ( 0 == paddr ) ? -666 : *paddr, futex_op, value );
 
+#ifdef USE_HOST_FUTEX
+            // Only harts in this process share the words, so the private flag is always used. FUTEX_CLOCK_REALTIME passes through.
+
+            int op = (int) ACCESS_REG( REG_ARG1 ) | FUTEX_PRIVATE_FLAG;
+            int cmd = op & FUTEX_CMD_MASK;
+            void * uaddr2 = 0;
+            struct timespec timeout;
+            void * timeout_or_val2 = 0; // a timeout for waits and a count for requeues
+
+            if ( FUTEX_REQUEUE == cmd || FUTEX_CMP_REQUEUE == cmd || FUTEX_WAKE_OP == cmd )
+            {
+                if ( !cpu.is_address_valid( ACCESS_REG( REG_ARG4 ) ) )
+                {
+                    errno = EFAULT;
+                    update_result_errno( cpu, -1 );
+                    break;
+                }
+
+                uaddr2 = cpu.getmem( ACCESS_REG( REG_ARG4 ) );
+                timeout_or_val2 = (void *) (uintptr_t) (uint32_t) ACCESS_REG( REG_ARG3 );
+            }
+            else if ( FUTEX_WAIT == cmd || FUTEX_WAIT_BITSET == cmd || FUTEX_LOCK_PI == cmd )
+            {
+                if ( 0 != ACCESS_REG( REG_ARG3 ) ) // relative for FUTEX_WAIT and absolute for the others
+                {
+                    if ( !cpu.is_address_valid( ACCESS_REG( REG_ARG3 ) ) )
+                    {
+                        errno = EFAULT;
+                        update_result_errno( cpu, -1 );
+                        break;
+                    }
+
+                    const struct timespec_syscall * pts = (const struct timespec_syscall *) cpu.getmem( ACCESS_REG( REG_ARG3 ) );
+                    timeout.tv_sec = (time_t) swap_endian64( pts->tv_sec );
+                    timeout.tv_nsec = (long) swap_endian64( pts->tv_nsec );
+                    timeout_or_val2 = &timeout;
+                }
+            }
+            else if ( FUTEX_WAKE != cmd && FUTEX_WAKE_BITSET != cmd && FUTEX_UNLOCK_PI != cmd && FUTEX_TRYLOCK_PI != cmd )
+            {
+                tracer.Trace( "  futex command %d isn't supported\n", cmd );
+                errno = ENOSYS;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            // guest tids are host tids, so the PI commands work on the words as-is
+
+            long result = syscall( __NR_futex, paddr, op, value, timeout_or_val2, uaddr2, (uint32_t) ACCESS_REG( REG_ARG5 ) );
+            tracer.Trace( "  host futex result %ld, errno %d\n", result, ( -1 == result ) ? errno : 0 );
+            update_result_errno( cpu, result );
+#else
             if ( 0 == futex_op ) // FUTEX_WAIT
             {
                 if ( *paddr != value )
@@ -4372,6 +5235,7 @@ void emulator_invoke_svc( CPUClass & cpu )
                 ACCESS_REG( REG_RESULT ) = 0;
             else
                 ACCESS_REG( REG_RESULT ) = (REG_TYPE) -1; // fail this until/unless there is a real-world use
+#endif //USE_HOST_FUTEX
             break;
         }
 #if !defined( M68 ) && !defined( __mc68000__ )// lots of 64/32 interop issues with this
@@ -4597,7 +5461,11 @@ void emulator_invoke_svc( CPUClass & cpu )
         }
         case SYS_gettid:
         {
+#ifdef RVOS
+            ACCESS_REG( REG_RESULT ) = g_current_thread ? g_current_thread->tid : 1;
+#else
             ACCESS_REG( REG_RESULT ) = 1;
+#endif
             break;
         }
         case emulator_sys_rename:
@@ -5392,9 +6260,61 @@ void emulator_invoke_svc( CPUClass & cpu )
             update_result_errno( cpu, -1 );
             break;
         }
+        case SYS_riscv_hwprobe :
+        {
+#ifdef RVOS
+            // riscv_hwprobe( struct riscv_hwprobe * pairs, size_t pair_count, size_t cpusetsize, cpu_set_t * cpus, unsigned int flags )
+            // each pair is an int64_t key and a uint64_t value. All cpus are the same, so the cpu set is ignored.
+
+            uint64_t pairs = ACCESS_REG( REG_ARG0 );
+            uint64_t pair_count = ACCESS_REG( REG_ARG1 );
+            uint64_t flags = ACCESS_REG( REG_ARG4 );
+            tracer.Trace( "  riscv_hwprobe pairs %llx, count %llu, flags %llx\n", pairs, pair_count, flags );
+
+            if ( 0 != flags )
+            {
+                errno = EINVAL;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            for ( uint64_t i = 0; i < pair_count; i++ )
+            {
+                int64_t * pkey = (int64_t *) cpu.getmem( pairs + i * 16 );
+                uint64_t * pvalue = (uint64_t *) cpu.getmem( pairs + i * 16 + 8 );
+
+                if ( 3 == *pkey )      // RISCV_HWPROBE_KEY_BASE_BEHAVIOR
+                    *pvalue = 1;       // RISCV_HWPROBE_BASE_BEHAVIOR_IMA
+                else if ( 4 == *pkey ) // RISCV_HWPROBE_KEY_IMA_EXT_0: FD(0), C(1), V(2), Zba(3), Zbb(4), Zbs(5), Zicond(35)
+                    *pvalue = 0x3f | ( (uint64_t) 1 << 35 );
+                else if ( 5 == *pkey ) // RISCV_HWPROBE_KEY_CPUPERF_0
+                    *pvalue = 3;       // RISCV_HWPROBE_MISALIGNED_FAST
+                else if ( *pkey >= 0 && *pkey <= 2 ) // mvendorid, marchid, mimpid
+                    *pvalue = 0;
+                else
+                {
+                    *pkey = -1;        // the kernel's response to keys it doesn't recognize
+                    *pvalue = 0;
+                }
+                tracer.Trace( "    key %lld, value %llx\n", *pkey, *pvalue );
+            }
+
+            ACCESS_REG( REG_RESULT ) = 0;
+#else
+            errno = ENOSYS;
+            update_result_errno( cpu, -1 );
+#endif
+            break;
+        }
         case SYS_riscv_flush_icache :
         {
+#ifdef RVOS
+            cpu.flush_instruction_cache(); // the app wrote code to memory, so decoded instructions may be stale
+            if ( 0 == ( ACCESS_REG( REG_ARG2 ) & 1 ) ) // SYS_RISCV_FLUSH_ICACHE_LOCAL isn't set, so flush all harts
+                flush_guest_threads();
+#else
             assert( false ); // no arm64 equivalent
+#endif
             ACCESS_REG( REG_RESULT ) = 0;
             break;
         }
@@ -5464,9 +6384,9 @@ void emulator_invoke_svc( CPUClass & cpu )
             {
                 char acResolved[ EMULATOR_MAX_PATH ];
 #if defined( _WIN32 )
-                if ( 0 != windows_realpath( g_acLoadedApp, acResolved ) )
+                if ( 0 != windows_realpath( g_vm->acLoadedApp, acResolved ) )
 #else
-                if ( 0 != realpath( g_acLoadedApp, acResolved ) )
+                if ( 0 != realpath( g_vm->acLoadedApp, acResolved ) )
 #endif
                 {
                     int len = (int) strlen( acResolved );
@@ -5662,6 +6582,14 @@ void emulator_invoke_svc( CPUClass & cpu )
         }
         case SYS_set_tid_address:
         {
+#ifdef RVOS
+            if ( g_current_thread )
+            {
+                g_current_thread->clear_child_tid = ACCESS_REG( REG_ARG0 );
+                update_result_errno( cpu, g_current_thread->tid );
+                break;
+            }
+#endif
             update_result_errno( cpu, 1 );
             break;
         }
@@ -5671,10 +6599,83 @@ void emulator_invoke_svc( CPUClass & cpu )
             break;
         }
         case SYS_set_robust_list:
+        {
+#ifdef RVOS
+            if ( 24 != ACCESS_REG( REG_ARG1 ) ) // sizeof( struct robust_list_head )
+            {
+                errno = EINVAL;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            if ( g_current_thread )
+                g_current_thread->robust_list = ACCESS_REG( REG_ARG0 );
+#endif
+            update_result_errno( cpu, 0 );
+            break;
+        }
         case SYS_prlimit64:
+        {
+            // pid (0 or the app's; there are no other processes), resource, new limit, old limit. Only RLIMIT_AS
+            // is enforced. Other resources report infinite limits like getrlimit and ignore new values
+
+            int resource = (int) ACCESS_REG( REG_ARG1 );
+            REG_TYPE new_address = ACCESS_REG( REG_ARG2 );
+            REG_TYPE old_address = ACCESS_REG( REG_ARG3 );
+            tracer.Trace( "  syscall command SYS_prlimit64 resource %d, new %llx, old %llx\n", resource, (uint64_t) new_address, (uint64_t) old_address );
+
+            bool is_as = ( 9 == resource ); // RLIMIT_AS
+            uint64_t cur = is_as ? g_vm->address_space_limit : ~(uint64_t) 0;
+            uint64_t max = is_as ? g_vm->address_space_max : ~(uint64_t) 0;
+
+            if ( 0 != new_address && is_as )
+            {
+                struct rlimit_syscall64 * pnew = (struct rlimit_syscall64 *) cpu.getmem( new_address );
+                uint64_t new_cur = swap_endian64( pnew->rlim_cur );
+                uint64_t new_max = swap_endian64( pnew->rlim_max );
+
+                if ( new_cur > new_max || new_max > g_vm->address_space_max ) // only root can raise a hard limit
+                {
+                    errno = ( new_cur > new_max ) ? EINVAL : EPERM;
+                    update_result_errno( cpu, -1 );
+                    break;
+                }
+
+                g_vm->address_space_limit = new_cur;
+                g_vm->address_space_max = new_max;
+                tracer.Trace( "  RLIMIT_AS is now %llu, max %llu\n", new_cur, new_max );
+            }
+
+            if ( 0 != old_address )
+            {
+                struct rlimit_syscall64 * pold = (struct rlimit_syscall64 *) cpu.getmem( old_address );
+                pold->rlim_cur = swap_endian64( cur );
+                pold->rlim_max = swap_endian64( max );
+            }
+
+            update_result_errno( cpu, 0 );
+            break;
+        }
         case SYS_mprotect:
-            // ignore for now
+        {
+            REG_TYPE address = ACCESS_REG( REG_ARG0 );
+            REG_TYPE length = ACCESS_REG( REG_ARG1 );
+            int prot = (int) ACCESS_REG( REG_ARG2 );
+            tracer.Trace( "  SYS_mprotect. address %llx, length %llx, prot %#x\n", (uint64_t) address, (uint64_t) length, prot );
+
+            if ( 0 != ( address & 0xfff ) || address < g_vm->base_address )
+            {
+                errno = EINVAL;
+                update_result_errno( cpu, -1 );
+                break;
+            }
+
+            // guest memory stays readable and writable except for shared file mappings, which follow PROT_WRITE (2) so
+            // the file only changes when the app allows it. Other protection changes are ignored
+            bool ok = g_vm->memory.protect_files( (size_t) ( address - g_vm->base_address ), (size_t) length, 0 != ( 2 & prot ) );
+            update_result_errno( cpu, ok ? 0 : -1 );
             break;
+        }
         case SYS_faccessat:
         {
             const char * pathname = (const char *) cpu.getmem( ACCESS_REG( REG_ARG1 ) );
@@ -5709,6 +6710,23 @@ void emulator_invoke_svc( CPUClass & cpu )
             //ACCESS_REG( REG_RESULT ] = -1;
         }
     }
+} //invoke_svc
+
+void emulator_invoke_svc( CPUClass & cpu )
+{
+#if defined( RVOS_LIBRARY ) && defined( USE_GUARD_PAGES )
+    // a guard page fault during the call can't siglongjmp past its locks. guard_page_handler records it instead,
+    // and the vm ends here once the locks are released: run_library_hart catches the exception
+
+    GuestThread * t = g_current_thread;
+    t->in_syscall = true;
+    invoke_svc( cpu );
+    t->in_syscall = false;
+    if ( 0 != t->syscall_fault )
+        emulator_hard_termination( cpu, t->syscall_fault, t->syscall_fault_address );
+#else
+    invoke_svc( cpu );
+#endif
 } //emulator_invoke_svc
 
 #ifdef SPARCOS
@@ -5795,10 +6813,10 @@ void emulator_invoke_68k_trap15( m68000 & cpu )
     {
         case 0: // exit
         {
-            g_terminate = true;
+            g_vm->terminate = true;
             cpu.end_emulation();
-            g_exit_code = (int) ACCESS_REG( 0 );
-            tracer.Trace( "  emulated app exit code %d\n", g_exit_code );
+            g_vm->exit_code = (int) ACCESS_REG( 0 );
+            tracer.Trace( "  emulated app exit code %d\n", g_vm->exit_code );
             break;
         }
         case 1: // putch
@@ -5930,10 +6948,10 @@ void emulator_invoke_68k_trap10( m68000 & cpu, uint16_t op )
         }
         case macos_trapa_exittoshell:
         {
-            g_terminate = true;
+            g_vm->terminate = true;
             cpu.end_emulation();
-            g_exit_code = (int) ACCESS_REG( REG_ARG0 );
-            tracer.Trace( "  emulated app exit code %d\n", g_exit_code );
+            g_vm->exit_code = (int) ACCESS_REG( REG_ARG0 );
+            tracer.Trace( "  emulated app exit code %d\n", g_vm->exit_code );
             break;
         }
         default:
@@ -5977,6 +6995,13 @@ static const char * sparc_register_names[ 32 ] =
 
 void emulator_hard_termination( CPUClass & cpu, const char *pcerr, uint64_t error_value )
 {
+#ifdef RVOS_LIBRARY
+    char acError[ 200 ];
+    snprintf( acError, sizeof( acError ), "%s %0llx at pc %llx", pcerr, (unsigned long long) error_value, (unsigned long long) REG_PROGRAM_COUNTER );
+    tracer.Trace( "%s (%s) fatal error: %s\n", APP_NAME, target_platform(), acError );
+    throw runtime_error( acError ); // caught by rvos_run or the guest thread, which end the vm
+#endif
+
     g_consoleConfig.RestoreConsole( false );
 
     printf( "hard termination!!!\n" );
@@ -6004,8 +7029,8 @@ void emulator_hard_termination( CPUClass & cpu, const char *pcerr, uint64_t erro
         printf( "pc: %llx\n", (uint64_t) REG_PROGRAM_COUNTER );
     }
 
-    tracer.Trace( "address space %llx to %llx\n", (uint64_t) g_base_address, (uint64_t) g_base_address + memory.size() );
-    printf( "address space %llx to %llx\n", (uint64_t) g_base_address, (uint64_t) g_base_address + memory.size() );
+    tracer.Trace( "address space %llx to %llx\n", (uint64_t) g_vm->base_address, (uint64_t) g_vm->base_address + g_vm->memory.size() );
+    printf( "address space %llx to %llx\n", (uint64_t) g_vm->base_address, (uint64_t) g_vm->base_address + g_vm->memory.size() );
 
     tracer.Trace( "  " );
     printf( "  " );
@@ -6391,10 +7416,6 @@ static int symbol_find_compare( const void * a, const void * b )
 
 #endif // M68 || SPARCOS || X32OS
 
-vector<char> g_string_table;      // strings in the elf image
-vector<ElfSymbol64> g_symbols;    // symbols in the elf image
-vector<ElfSymbol32> g_symbols32;  // symbols in the elf image
-
 // returns the best guess for a symbol name for the address
 
 #if defined( M68 ) || defined( SPARCOS ) || defined( X32OS )
@@ -6411,12 +7432,12 @@ const char * emulator_symbol_lookup( uint64_t address, uint64_t & offset )
 
 const char * emulator_symbol_lookup( uint32_t address, uint32_t & offset )
 {
-    if ( address < g_base_address || address > ( g_base_address + memory.size() ) )
+    if ( address < g_vm->base_address || address > ( g_vm->base_address + g_vm->memory.size() ) )
         return "";
 
     // if no elf symbols, try CP/M symbols
 
-    if ( 0 == g_symbols32.size() )
+    if ( 0 == g_vm->symbols32.size() )
     {
 #ifdef M68
         if ( 0 != g_cpmSymbols.size() )
@@ -6435,18 +7456,18 @@ const char * emulator_symbol_lookup( uint32_t address, uint32_t & offset )
         return "";
     }
 
-    if ( 0 == g_symbols32.size() )
+    if ( 0 == g_vm->symbols32.size() )
         return "";
 
     ElfSymbol32 key = {0};
     key.value = address;
 
-    ElfSymbol32 * psym = (ElfSymbol32 *) my_bsearch( &key, g_symbols32.data(), g_symbols32.size(), sizeof( key ), symbol_find_compare32 );
+    ElfSymbol32 * psym = (ElfSymbol32 *) my_bsearch( &key, g_vm->symbols32.data(), g_vm->symbols32.size(), sizeof( key ), symbol_find_compare32 );
 
     if ( 0 != psym )
     {
         offset = address - psym->value;
-        return & g_string_table[ psym->name ];
+        return & g_vm->string_table[ psym->name ];
     }
 
     offset = 0;
@@ -6469,18 +7490,18 @@ static int symbol_compare32( const void * a, const void * b )
 
 const char * emulator_symbol_lookup( uint64_t address, uint64_t & offset )
 {
-    if ( address < g_base_address || address > ( g_base_address + memory.size() ) || ( 0 == g_symbols.size() ) )
+    if ( address < g_vm->base_address || address > ( g_vm->base_address + g_vm->memory.size() ) || ( 0 == g_vm->symbols.size() ) )
         return "";
 
     ElfSymbol64 key = {0};
     key.value = address;
 
-    ElfSymbol64 * psym = (ElfSymbol64 *) my_bsearch( &key, g_symbols.data(), g_symbols.size(), sizeof( key ), symbol_find_compare );
+    ElfSymbol64 * psym = (ElfSymbol64 *) my_bsearch( &key, g_vm->symbols.data(), g_vm->symbols.size(), sizeof( key ), symbol_find_compare );
 
     if ( 0 != psym )
     {
         offset = address - psym->value;
-        return & g_string_table[ psym->name ];
+        return & g_vm->string_table[ psym->name ];
     }
 
     offset = 0;
@@ -6782,7 +7803,7 @@ struct FCBCPM68K // file control block for cp/m
 
     void Trace( bool justArg = false ) // justArg is the first 16 bytes at app startup
     {
-        tracer.Trace( "  FCB at address %04x:\n", (uint32_t) ( (uint8_t * ) this - memory.data() ) );
+        tracer.Trace( "  FCB at address %04x:\n", (uint32_t) ( (uint8_t * ) this - g_vm->memory.data() ) );
         tracer.Trace( "    drive:    %#x == %c\n", dr, ( 0 == dr ) ? 'A' : 'A' + dr - 1 );
         tracer.Trace( "    filename: '%c%c%c%c%c%c%c%c'\n", 0x7f & f[0], 0x7f & f[1], 0x7f & f[2], 0x7f & f[3],
                                                             0x7f & f[4], 0x7f & f[5], 0x7f & f[6], 0x7f & f[7] );
@@ -6997,7 +8018,7 @@ bool handle_relocations_cpm( FILE * fp, HeaderCPM68K & head, uint32_t text_base,
 {
     if ( 0 == head.relocation_flag ) // 0 means they exist
     {
-        uint16_t * pimage = (uint16_t *) ( memory.data() + text_base );
+        uint16_t * pimage = (uint16_t *) ( g_vm->memory.data() + text_base );
         uint32_t relocation_words = ( head.cb_text + head.cb_data ) / 2;
         vector<uint16_t> relocations;
         relocations.resize( relocation_words );
@@ -7105,10 +8126,10 @@ bool load59_cpm68k( FILE *fp, uint32_t lowestAddress, uint32_t highestAddress, u
     uint32_t image_size = head.cb_text + head.cb_data + head.cb_bss;
     basePage = lowestAddress;
     stackPointer = highestAddress & 0xfffffffe; // make sure it's 2-byte aligned
-    BasePageCPM * pbasepage = (BasePageCPM *) ( memory.data() + basePage );
+    BasePageCPM * pbasepage = (BasePageCPM *) ( g_vm->memory.data() + basePage );
 
     fseek( fp, (long) sizeof( head ), SEEK_SET );
-    read = fread( memory.data() + text_base, head.cb_text + head.cb_data, 1, fp );
+    read = fread( g_vm->memory.data() + text_base, head.cb_text + head.cb_data, 1, fp );
     if ( 1 != read )
     {
         printf( "can't read text and data segments of cp/m 68k image file\n" );
@@ -7152,10 +8173,10 @@ bool load59_cpm68k( FILE *fp, uint32_t lowestAddress, uint32_t highestAddress, u
     tracer.Trace( "  <code from the .68k file>\n" );
     tracer.Trace( "  initial pc execution_addess + start of code         %x\n", text_base );
     tracer.Trace( "  start of base page:                                 %x\n", basePage );
-    tracer.Trace( "  start of the address space:                         %x\n", g_base_address );
+    tracer.Trace( "  start of the address space:                         %x\n", g_vm->base_address );
 
     tracer.Trace( "first 512 bytes starting at base page:\n" );
-    tracer.TraceBinaryData( memory.data() + basePage, 512, 8 );
+    tracer.TraceBinaryData( g_vm->memory.data() + basePage, 512, 8 );
 
     return true;
 } //load59_cpm68k
@@ -7168,7 +8189,7 @@ bool load_cpm68k( const char * acApp, const char * acAppArgs )
     ConsoleConfiguration::ConvertRedirectedLFToCR( true );
 
     // if this is being called from the bdos chain call, reset global data structures.
-    memory.resize( 0 );
+    g_vm->memory.resize( 0 );
     g_cpmSymbols.resize( 0 );
 
     FILE * fp = fopen( acApp, "rb" );
@@ -7213,25 +8234,24 @@ bool load_cpm68k( const char * acApp, const char * acAppArgs )
         memory_size &= ~3;
     }
 
-    g_end_of_data = memory_size - 0x100;
-    g_brk_offset = g_end_of_data;
-    g_highwater_brk = g_end_of_data;
-    memory_size += g_brk_commit;
+    g_vm->end_of_data = memory_size - 0x100;
+    g_vm->brk_offset = g_vm->end_of_data;
+    g_vm->highwater_brk = g_vm->end_of_data;
+    memory_size += g_vm->brk_commit;
 
-    g_bottom_of_stack = memory_size;
-    memory_size += g_stack_commit;
+    g_vm->bottom_of_stack = memory_size;
+    memory_size += g_vm->stack_commit;
 
-    memory.resize( memory_size );
-    memset( memory.data(), 0, memory.size() );
+    g_vm->memory.resize( memory_size ); // zero-filled as pages are first touched
 
     // put the supervisor stack pointer in the first 4 bytes of RAM.
-    * (uint32_t *) memory.data() = swap_endian32( 1024 ); // arbitrary, but above the vector table and below the typical cp/m 68k base page (where f83 loads)
+    * (uint32_t *) g_vm->memory.data() = swap_endian32( 1024 ); // arbitrary, but above the vector table and below the typical cp/m 68k base page (where f83 loads)
 
-    g_base_address = 0;
+    g_vm->base_address = 0;
     uint32_t base_page = text_base - 0x100; // where the base page (256 bytes) resides
-    BasePageCPM * pbasepage = (BasePageCPM *) ( memory.data() + base_page );
-    g_execution_address = text_base;
-    g_top_of_stack = (REG_TYPE) g_bottom_of_stack + g_stack_commit;
+    BasePageCPM * pbasepage = (BasePageCPM *) ( g_vm->memory.data() + base_page );
+    g_vm->execution_address = text_base;
+    g_vm->top_of_stack = (REG_TYPE) g_vm->bottom_of_stack + g_vm->stack_commit;
     pbasepage->reserved[ 1 ] = 0x22; // move.l d0, d1.  return code. at at offset 0x26 in the base page (not a cp/m standard)
     pbasepage->reserved[ 2 ] = 0x00;
     pbasepage->reserved[ 3 ] = 0x70; // moveq #93, d0   linux exit function
@@ -7240,16 +8260,16 @@ bool load_cpm68k( const char * acApp, const char * acAppArgs )
     pbasepage->reserved[ 6 ] = 0x40;
 
     // per the cp/m 68k spec there must be two 32-bit values at the top of the stack for base address and return location at app completion
-    g_top_of_stack -= 8;
-    uint32_t * preturn_address = (uint32_t *) & memory[ g_top_of_stack ];
-    uint32_t * pbase_page_address = (uint32_t *) & memory[ g_top_of_stack + 4 ];
+    g_vm->top_of_stack -= 8;
+    uint32_t * preturn_address = (uint32_t *) & g_vm->memory[ g_vm->top_of_stack ];
+    uint32_t * pbase_page_address = (uint32_t *) & g_vm->memory[ g_vm->top_of_stack + 4 ];
     *preturn_address = swap_endian32( base_page + 0x26 );
     *pbase_page_address = swap_endian32( base_page );
-    tracer.Trace( "memory at top of stack address %#x:\n", g_top_of_stack );
-    tracer.TraceBinaryData( & memory[ g_top_of_stack ], 8, 4 );
+    tracer.Trace( "memory at top of stack address %#x:\n", g_vm->top_of_stack );
+    tracer.TraceBinaryData( & g_vm->memory[ g_vm->top_of_stack ], 8, 4 );
 
     fseek( fp, (long) sizeof( head ), SEEK_SET );
-    read = fread( memory.data() + text_base, head.cb_text + head.cb_data, 1, fp );
+    read = fread( g_vm->memory.data() + text_base, head.cb_text + head.cb_data, 1, fp );
     if ( 1 != read )
     {
         printf( "can't read text and data segments of cp/m 68k image file: %s\n", acApp );
@@ -7341,16 +8361,16 @@ bool load_cpm68k( const char * acApp, const char * acAppArgs )
     // malloc / brk in the C runtime for DR C use some of these values
 
     pbasepage->lowest_tpa = 0;
-    pbasepage->highest_tpa = swap_endian32( g_base_address + memory_size - 1 );
+    pbasepage->highest_tpa = swap_endian32( g_vm->base_address + memory_size - 1 );
     pbasepage->start_text = swap_endian32( text_base );
     pbasepage->cb_text = swap_endian32( head.cb_text );
     pbasepage->start_data = swap_endian32( text_base + head.cb_text );
     pbasepage->cb_data = swap_endian32( head.cb_data );
     pbasepage->start_bss = swap_endian32( text_base + head.cb_text + head.cb_data );
     pbasepage->cb_bss = swap_endian32( head.cb_bss );
-    pbasepage->cb_after_bss = swap_endian32( g_brk_commit );
+    pbasepage->cb_after_bss = swap_endian32( g_vm->brk_commit );
 
-    g_DMA = memory.data() + text_base - 0x80; // midway through the base page
+    g_DMA = g_vm->memory.data() + text_base - 0x80; // midway through the base page
     uint32_t data_base = text_base; // + head.cb_text; with 0x601a all bases belong to text_base
     uint32_t bss_base = text_base; // data_base + head.cb_data;
 
@@ -7363,30 +8383,30 @@ bool load_cpm68k( const char * acApp, const char * acAppArgs )
     pbasepage->Trace();
 
     tracer.Trace( "memory map from highest to lowest addresses:\n" );
-    tracer.Trace( "  first byte beyond allocated memory:                 %x\n", g_base_address + memory_size );
-    tracer.Trace( "  actual top of stack:                                %x\n", g_top_of_stack + 8 );
-    tracer.Trace( "  initial stack pointer g_top_of_stack:               %x\n", g_top_of_stack );
-    REG_TYPE stack_bytes = g_stack_commit;
+    tracer.Trace( "  first byte beyond allocated memory:                 %x\n", g_vm->base_address + memory_size );
+    tracer.Trace( "  actual top of stack:                                %x\n", g_vm->top_of_stack + 8 );
+    tracer.Trace( "  initial stack pointer top_of_stack:                 %x\n", g_vm->top_of_stack );
+    REG_TYPE stack_bytes = g_vm->stack_commit;
     tracer.Trace( "  <stack>                                             (%d == %x bytes)\n", stack_bytes, stack_bytes );
-    tracer.Trace( "  last byte stack can use (g_bottom_of_stack):        %x\n", g_base_address + g_bottom_of_stack );
-    tracer.Trace( "  <unallocated space between brk and the stack>       (%d == %llx bytes)\n", g_brk_commit, g_brk_commit );
-    tracer.Trace( "  end_of_bss / current brk:                           %x\n", g_base_address + g_end_of_data );
+    tracer.Trace( "  last byte stack can use (bottom_of_stack):          %x\n", g_vm->base_address + g_vm->bottom_of_stack );
+    tracer.Trace( "  <unallocated space between brk and the stack>       (%d == %llx bytes)\n", g_vm->brk_commit, g_vm->brk_commit );
+    tracer.Trace( "  end_of_bss / current brk:                           %x\n", g_vm->base_address + g_vm->end_of_data );
     tracer.Trace( "  <uninitialized bss data>\n" );
-    tracer.Trace( "  start of bss segment:                               %x\n", g_execution_address + head.cb_text + head.cb_data );
+    tracer.Trace( "  start of bss segment:                               %x\n", g_vm->execution_address + head.cb_text + head.cb_data );
     tracer.Trace( "  <initialized data from the .68k file>\n" );
-    tracer.Trace( "  start of data segment:                              %x\n", g_execution_address + head.cb_text );
+    tracer.Trace( "  start of data segment:                              %x\n", g_vm->execution_address + head.cb_text );
     tracer.Trace( "  <code from the .68k file>\n" );
-    tracer.Trace( "  initial pc execution_addess + start of code         %x\n", g_execution_address );
-    tracer.Trace( "  default DMA address:                                %x\n", (uint32_t) ( g_DMA - memory.data() ) );
+    tracer.Trace( "  initial pc execution_addess + start of code         %x\n", g_vm->execution_address );
+    tracer.Trace( "  default DMA address:                                %x\n", (uint32_t) ( g_DMA - g_vm->memory.data() ) );
     tracer.Trace( "  start of base page:                                 %x\n", base_page );
-    tracer.Trace( "  start of the address space:                         %x\n", g_base_address );
+    tracer.Trace( "  start of the address space:                         %x\n", g_vm->base_address );
 
-    tracer.Trace( "vm memory first byte beyond:     %p\n", memory.data() + memory_size );
-    tracer.Trace( "vm memory start:                 %p\n", memory.data() );
+    tracer.Trace( "vm memory first byte beyond:     %p\n", g_vm->memory.data() + memory_size );
+    tracer.Trace( "vm memory start:                 %p\n", g_vm->memory.data() );
     tracer.Trace( "memory_size:                     %#x == %d\n", memory_size, memory_size );
 
     tracer.Trace( "first 512 bytes starting at base page:\n" );
-    tracer.TraceBinaryData( memory.data() + base_page, 512, 8 );
+    tracer.TraceBinaryData( g_vm->memory.data() + base_page, 512, 8 );
 
     return true;
 } //load_cpm68k
@@ -7806,10 +8826,10 @@ void emulator_invoke_68k_trap3( m68000 & cpu ) // bios
         case 0: // cold boot
         case 1: // warm boot
         {
-            g_terminate = true;
+            g_vm->terminate = true;
             cpu.end_emulation();
-            g_exit_code = (int) ACCESS_REG( REG_ARG0 ); // not part of the cp/m 68k spec but it seems handy
-            tracer.Trace( "  emulated app exit code %d\n", g_exit_code );
+            g_vm->exit_code = (int) ACCESS_REG( REG_ARG0 ); // not part of the cp/m 68k spec but it seems handy
+            tracer.Trace( "  emulated app exit code %d\n", g_vm->exit_code );
             break;
         }
         case 2: // console status (check for console character ready)
@@ -7900,10 +8920,10 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
     {
         case 0: // system reset; exit the app
         {
-            g_terminate = true;
+            g_vm->terminate = true;
             cpu.end_emulation();
-            g_exit_code = (int) ACCESS_REG( REG_ARG0 ); // not part of the cp/m 68k spec but it seems handy
-            tracer.Trace( "  emulated app exit code %d\n", g_exit_code );
+            g_vm->exit_code = (int) ACCESS_REG( REG_ARG0 ); // not part of the cp/m 68k spec but it seems handy
+            tracer.Trace( "  emulated app exit code %d\n", g_vm->exit_code );
             break;
         }
         case 1: // console input. echo input to console
@@ -7999,8 +9019,8 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
                 {
                     tracer.Trace( "  bdos read console buffer read a ^c at the first position, so it's terminating the app\n" );
                     cpu.end_emulation();
-                    g_terminate = true;
-                    g_exit_code = 1;
+                    g_vm->terminate = true;
+                    g_vm->exit_code = 1;
                     break;
                 }
 
@@ -8310,7 +9330,7 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
 
                     uint32_t file_size = portable_filelen( fp );
                     uint32_t curr = pfcb->GetSequentialOffset();
-                    uint16_t dmaOffset = (uint16_t) ( g_DMA - memory.data() );
+                    uint16_t dmaOffset = (uint16_t) ( g_DMA - g_vm->memory.data() );
                     tracer.Trace( "  file size: %#x = %u, current %#x = %u, dma %#x = %u\n",
                                   file_size, file_size, curr, curr, dmaOffset, dmaOffset );
 
@@ -8363,7 +9383,7 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
                 {
                     uint32_t file_size = portable_filelen( fp );
                     uint32_t curr = pfcb->GetSequentialOffset();
-                    uint16_t dmaOffset = (uint16_t) ( g_DMA - memory.data() );
+                    uint16_t dmaOffset = (uint16_t) ( g_DMA - g_vm->memory.data() );
                     tracer.Trace( "  writing at offset %#x = %u, file size is %#x = %u, dma %#x = %u\n",
                                   curr, curr, file_size, file_size, dmaOffset, dmaOffset );
                     fseek( fp, curr, SEEK_SET );
@@ -8458,7 +9478,7 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
         case 26: // set the dma address (128 byte buffer for doing I/O)
         {
             tracer.Trace( "  updating DMA address; D %u = %#x\n", ACCESS_REG( REG_ARG0 ), ACCESS_REG( REG_ARG0 ) );
-            g_DMA = memory.data() + ACCESS_REG( REG_ARG0 );
+            g_DMA = g_vm->memory.data() + ACCESS_REG( REG_ARG0 );
             break;
         }
         case 29: // get read-only vector: return bitmap of read-only drives
@@ -8627,7 +9647,7 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
             if ( load_cpm68k( acApp, acAppArgs ) )
             {
                 tracer.Trace( "loaded chained app successfully\n" );
-                cpu.reset( memory, g_base_address, g_execution_address, g_stack_commit, g_top_of_stack );
+                cpu.reset( g_vm->memory, g_vm->base_address, g_vm->execution_address, g_vm->stack_commit, g_vm->top_of_stack );
             }
             else
             {
@@ -8736,11 +9756,11 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
             // otherwise, set the current code to the value in DE (mapped to 68k registers)
 
             if ( 0xffff == ACCESS_REG( REG_ARG0 ) )
-                ACCESS_REG( REG_RESULT ) = g_exit_code;
+                ACCESS_REG( REG_RESULT ) = g_vm->exit_code;
             else
             {
-                g_exit_code = ACCESS_REG( REG_ARG0 ) >> 16;
-                tracer.Trace( "  app exit code set to %u\n", g_exit_code );
+                g_vm->exit_code = ACCESS_REG( REG_ARG0 ) >> 16;
+                tracer.Trace( "  app exit code set to %u\n", g_vm->exit_code );
             }
             break;
         }
@@ -8755,10 +9775,10 @@ void emulator_invoke_68k_trap2( m68000 & cpu ) // bdos
 
 #endif // M68
 
-char * resolve_execfn_path( const char * pimage )
-{
-    static char resolved[ EMULATOR_MAX_PATH + 1 ] = {0};
+// resolved must have room for EMULATOR_MAX_PATH + 1 chars
 
+char * resolve_execfn_path( const char * pimage, char * resolved )
+{
     #ifdef _WIN32
         if ( !windows_realpath( pimage, resolved ) )
             strcpy( resolved, pimage );
@@ -8770,13 +9790,52 @@ char * resolve_execfn_path( const char * pimage )
     return resolved;
 } //resolve_execfn_path
 
+// elf images are read from a file for the rvos command line or from a host buffer for librvos. read() is like fread
+
+class ElfImageReader
+{
+    private:
+        FILE * fp;
+        const uint8_t * image;
+        size_t image_len;
+        size_t position;
+
+    public:
+        ElfImageReader( FILE * f ) : fp( f ), image( 0 ), image_len( 0 ), position( 0 ) {}
+        ElfImageReader( const void * p, size_t len ) : fp( 0 ), image( (const uint8_t *) p ), image_len( len ), position( 0 ) {}
+
+        void seek( uint64_t offset )
+        {
+            if ( fp )
+                fseek( fp, (long) offset, SEEK_SET );
+            else
+                position = (size_t) get_min( offset, (uint64_t) image_len );
+        } //seek
+
+        int descriptor() { return fp ? fileno( fp ) : -1; } // -1 if the image isn't a file that can be mapped
+
+        size_t read( void * p, size_t size, size_t count )
+        {
+            if ( fp )
+                return fread( p, size, count, fp );
+
+            if ( 0 == size )
+                return 0;
+
+            size_t items = get_min( count, ( image_len - position ) / size );
+            memcpy( p, image + position, items * size );
+            position += items * size;
+            return items;
+        } //read
+};
+
 #if defined( M68 ) || defined( SPARCOS ) || defined( X32OS )
 
-static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv, int in_argc )
+static bool load_image32( ElfImageReader & image, const char * pimage, char * const * in_argv, int in_argc )
 {
     ElfHeader32 ehead = {0};
-    fseek( fp, (long) 0, SEEK_SET );
-    size_t read = fread( &ehead, 1, sizeof ehead, fp );
+    image.seek( 0 );
+    size_t read = image.read( &ehead, 1, sizeof ehead );
 
     if ( 0x464c457f != ehead.magic && 0x7f454c46 != ehead.magic )
         usage( "elf image file's magic header is invalid" );
@@ -8813,7 +9872,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     tracer.Trace( "  section offset: %u == %x\n", ehead.section_header_table, ehead.section_header_table );
     tracer.Trace( "  section with section names: %u == %x\n", ehead.section_with_section_names, ehead.section_with_section_names );
     tracer.Trace( "  flags: %x\n", ehead.flags );
-    g_execution_address = ehead.entry_point;
+    g_vm->execution_address = ehead.entry_point;
 
     // determine how much RAM to allocate
 
@@ -8825,8 +9884,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         tracer.Trace( "program header %u at offset %u\n", ph, (unsigned int) o );
 
         ElfProgramHeader32 head = {0};
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), 1, fp );
+        image.seek( o );
+        read = image.read( &head, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), 1 );
         if ( 1 != read )
             usage( "can't read program header" );
 
@@ -8853,18 +9912,18 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         if ( just_past > memory_size )
             memory_size = just_past;
 
-        if ( ( 0 != head.physical_address ) && ( ( 0 == g_base_address ) || g_base_address > head.physical_address ) )
-            g_base_address = head.physical_address;
+        if ( ( 0 != head.physical_address ) && ( ( 0 == g_vm->base_address ) || g_vm->base_address > head.physical_address ) )
+            g_vm->base_address = head.physical_address;
     }
 
     // if it won't waste much RAM, start the address space at 0 so low addresses can be used for things like trap vectors
 
-    REG_TYPE elf_base_address = g_base_address;
+    REG_TYPE elf_base_address = g_vm->base_address;
 
-    if ( g_base_address < 0x20000 ) // sparc v8 binaries load by default at 0x10000 using stock tools
-        g_base_address = 0;
+    if ( g_vm->base_address < 0x20000 ) // sparc v8 binaries load by default at 0x10000 using stock tools
+        g_vm->base_address = 0;
 
-    memory_size -= g_base_address;
+    memory_size -= g_vm->base_address;
     tracer.Trace( "memory_size of content to load from elf file: %x\n", memory_size );
 
     // first load the string table(s)
@@ -8875,8 +9934,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         size_t o = ehead.section_header_table + ( sh * ehead.section_header_table_size );
         ElfSectionHeader32 head = {0};
 
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ), fp );
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ) );
         if ( 0 == read )
             usage( "can't read section header" );
 
@@ -8886,8 +9945,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
             if ( sh == ehead.section_with_section_names )
             {
                 section_names_string_table.resize( head.size );
-                fseek( fp, (long) head.offset, SEEK_SET );
-                read = fread( section_names_string_table.data(), head.size, 1, fp );
+                image.seek( head.offset );
+                read = image.read( section_names_string_table.data(), head.size, 1 );
                 if ( 1 != read )
                     usage( "can't read string table\n" );
 
@@ -8896,14 +9955,14 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
             }
             else
             {
-                g_string_table.resize( head.size );
-                fseek( fp, (long) head.offset, SEEK_SET );
-                read = fread( g_string_table.data(), head.size, 1, fp );
+                g_vm->string_table.resize( head.size );
+                image.seek( head.offset );
+                read = image.read( g_vm->string_table.data(), head.size, 1 );
                 if ( 1 != read )
                     usage( "can't read string table\n" );
 
                 tracer.Trace( "main string table:\n" );
-                tracer.TraceBinaryData( (uint8_t *) g_string_table.data(), (uint32_t) head.size, 4 );
+                tracer.TraceBinaryData( (uint8_t *) g_vm->string_table.data(), (uint32_t) head.size, 4 );
             }
         }
     }
@@ -8919,8 +9978,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
         ElfSectionHeader32 head = {0};
 
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ), fp );
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ) );
         if ( 0 == read )
             usage( "can't read section header" );
 
@@ -8945,9 +10004,9 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
         if ( 2 == head.type )
         {
-            g_symbols32.resize( head.size / sizeof( ElfSymbol32 ) );
-            fseek( fp, (long) head.offset, SEEK_SET );
-            read = fread( g_symbols32.data(), 1, head.size, fp );
+            g_vm->symbols32.resize( head.size / sizeof( ElfSymbol32 ) );
+            image.seek( head.offset );
+            read = image.read( g_vm->symbols32.data(), 1, head.size );
             if ( 0 == read )
                 usage( "can't read symbol table" );
         }
@@ -8955,74 +10014,74 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
     // void out the entries that don't have symbol names or have mangled names that start with $
 
-    for ( size_t se = 0; se < g_symbols32.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols32.size(); se++ )
     {
-        g_symbols32[se].swap_endianness();
+        g_vm->symbols32[se].swap_endianness();
 
-        if ( ( 0 == g_symbols32[se].name ) || ( '$' == g_string_table[ g_symbols32[se].name ] ) )
-            g_symbols32[se].value = 0;
+        if ( ( 0 == g_vm->symbols32[se].name ) || ( '$' == g_vm->string_table[ g_vm->symbols32[se].name ] ) )
+            g_vm->symbols32[se].value = 0;
     }
 
     // use known my_qsort so traces are consistent across platforms because qsort implementations for duplicate values differ
 
-    tracer.Trace( "sorting symbol entries. size %zu\n", g_symbols32.size() );
-    my_qsort( g_symbols32.data(), g_symbols32.size(), sizeof( ElfSymbol32 ), symbol_compare32 );
+    tracer.Trace( "sorting symbol entries. size %zu\n", g_vm->symbols32.size() );
+    my_qsort( g_vm->symbols32.data(), g_vm->symbols32.size(), sizeof( ElfSymbol32 ), symbol_compare32 );
 
     // remove symbols that don't look like they have a valid addresses (rust binaries have tens of thousands of these)
 
     size_t to_erase = 0;
-    for ( size_t se = 0; se < g_symbols32.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols32.size(); se++ )
     {
-        if ( g_symbols32[ se ].value < elf_base_address )
+        if ( g_vm->symbols32[ se ].value < elf_base_address )
             to_erase++;
         else
             break;
     }
 
     if ( to_erase > 0 )
-        g_symbols32.erase( g_symbols32.begin(), g_symbols32.begin() + to_erase );
+        g_vm->symbols32.erase( g_vm->symbols32.begin(), g_vm->symbols32.begin() + to_erase );
 
     // set the size of each symbol if it's not already set
 
-    for ( size_t se = 0; se < g_symbols32.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols32.size(); se++ )
     {
-        if ( 0 == g_symbols32[se].size )
+        if ( 0 == g_vm->symbols32[se].size )
         {
-            if ( se < ( g_symbols32.size() - 1 ) )
+            if ( se < ( g_vm->symbols32.size() - 1 ) )
             {
                 // Free Pascal writes all symbols in lower and uppercase with the same value/address
                 size_t next = se + 1;
-                while ( ( next < ( g_symbols32.size() - 1 ) ) && ( g_symbols32[ next ].value == g_symbols32[ se ].value ) )
+                while ( ( next < ( g_vm->symbols32.size() - 1 ) ) && ( g_vm->symbols32[ next ].value == g_vm->symbols32[ se ].value ) )
                     next++;
-                g_symbols32[se].size = g_symbols32[ next ].value - g_symbols32[ se ].value;
+                g_vm->symbols32[se].size = g_vm->symbols32[ next ].value - g_vm->symbols32[ se ].value;
             }
             else
-                g_symbols32[se].size = g_base_address + memory_size - g_symbols32[ se ].value;
+                g_vm->symbols32[se].size = g_vm->base_address + memory_size - g_vm->symbols32[ se ].value;
         }
     }
 
-    tracer.Trace( "elf image has %u usable symbols:\n", (unsigned) g_symbols32.size() );
+    tracer.Trace( "elf image has %u usable symbols:\n", (unsigned) g_vm->symbols32.size() );
     tracer.Trace( "     address      size  name\n" );
 
-    for ( size_t se = 0; se < g_symbols32.size(); se++ )
-        tracer.Trace( "    %8x  %8x  %s\n", g_symbols32[ se ].value, g_symbols32[ se ].size, & g_string_table[ g_symbols32[ se ].name ] );
+    for ( size_t se = 0; se < g_vm->symbols32.size(); se++ )
+        tracer.Trace( "    %8x  %8x  %s\n", g_vm->symbols32[ se ].value, g_vm->symbols32[ se ].size, & g_vm->string_table[ g_vm->symbols32[ se ].name ] );
 
     // memory map from high to low addresses:
     //     <end of allocated memory>
     //     (memory for mmap fulfillment)
-    //     g_mmap_offset
-    //     (wasted space so g_mmap_offset is 4k-aligned)
+    //     mmap_offset
+    //     (wasted space so mmap_offset is 4k-aligned)
     //     arg_data_offset -- actual arg and env, etc. values pointed to by Linux start data
     //     Linux start data on the stack (see details below)
-    //     g_top_of_stack
-    //     g_bottom_of_stack
+    //     top_of_stack
+    //     bottom_of_stack
     //     (unallocated space between brk and the bottom of the stack)
-    //     g_brk_offset with uninitialized RAM (just after arg_data_offset initially)
-    //     g_end_of_data
+    //     brk_offset with uninitialized RAM (just after arg_data_offset initially)
+    //     end_of_data
     //     uninitalized data bss (size read from the .elf file)
     //     initialized data (size & data read from the .elf file)
     //     code (read from the .elf file)
-    //     g_base_address (offset read from the .elf file).
+    //     base_address (offset read from the .elf file).
 
     if ( memory_size & 0xf )
     {
@@ -9030,26 +10089,25 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         memory_size &= ~0xf;
     }
 
-    g_end_of_data = memory_size;
-    g_brk_offset = memory_size;
-    g_highwater_brk = memory_size;
-    memory_size += g_brk_commit;
+    g_vm->end_of_data = memory_size;
+    g_vm->brk_offset = memory_size;
+    g_vm->highwater_brk = memory_size;
+    memory_size += g_vm->brk_commit;
 
-    g_bottom_of_stack = memory_size;
-    memory_size += g_stack_commit;
+    g_vm->bottom_of_stack = memory_size;
+    memory_size += g_vm->stack_commit;
     REG_TYPE top_of_aux = memory_size;
 
     REG_TYPE arg_data_offset = memory_size;
     memory_size += g_arg_data_commit;
 
     memory_size = round_up( memory_size, (REG_TYPE) 4096 ); // mmap should hand out 4k-aligned pages
-    g_mmap_offset = memory_size;
-    memory_size += g_mmap_commit;
+    g_vm->mmap_offset = memory_size;
+    memory_size += g_vm->mmap_commit;
 
-    memory.resize( memory_size );
-    memset( memory.data(), 0, memory_size );
+    g_vm->memory.resize( memory_size ); // zero-filled as pages are first touched
 
-    g_mmap.initialize( g_base_address + g_mmap_offset, g_mmap_commit, memory.data() - g_base_address );
+    g_vm->mmap_allocator.initialize( g_vm->base_address + g_vm->mmap_offset, g_vm->mmap_commit, g_vm->memory, g_vm->base_address );
 
     // load the program into RAM
 
@@ -9059,8 +10117,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     {
         size_t o = ehead.program_header_table + ( ph * ehead.program_header_table_size );
         ElfProgramHeader32 head = {0};
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), fp );
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ) );
         head.swap_endianness();
 
         // head.type 1 == load. Other entries will overlap and even have physical addresses, but they are redundant
@@ -9070,8 +10128,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
             if ( 0 != head.virtual_address && 0 == head.physical_address ) // Watcom produces ELF files where the physical address is 0
                 head.physical_address = head.virtual_address;
 
-            fseek( fp, (long) head.offset_in_image, SEEK_SET );
-            read = fread( memory.data() + head.physical_address - g_base_address, 1, head.file_size, fp );
+            image.seek( head.offset_in_image );
+            read = image.read( g_vm->memory.data() + head.physical_address - g_vm->base_address, 1, head.file_size );
             if ( 0 == read )
                 usage( "can't read image" );
 
@@ -9079,14 +10137,14 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
             tracer.Trace( "  read type %s: %x bytes into physical address %x - %x then uninitialized to %x \n", head.show_type(), head.file_size,
                           head.physical_address, head.physical_address + head.file_size - 1, head.physical_address + head.memory_size - 1 );
-            tracer.TraceBinaryData( memory.data() + head.physical_address - g_base_address, get_min( (uint32_t) head.file_size, (uint32_t) 128 ), 4 );
+            tracer.TraceBinaryData( g_vm->memory.data() + head.physical_address - g_vm->base_address, get_min( (uint32_t) head.file_size, (uint32_t) 128 ), 4 );
         }
     }
 
     // if the base address is 0 we need a supervisor stack configured at address 0.
 
-    if ( 0 == g_base_address )
-        * (uint32_t *) memory.data() = swap_endian32( elf_base_address ); // arbitrary, but probably safe here between the vector table and app
+    if ( 0 == g_vm->base_address )
+        * (uint32_t *) g_vm->memory.data() = swap_endian32( elf_base_address ); // arbitrary, but probably safe here between the vector table and app
 
     // write the command-line arguments into the vm memory in a place where _start can find them.
     // there's an array of pointers to the args followed by the arg strings at offset arg_data_offset.
@@ -9097,7 +10155,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
     const uint32_t max_args = 40;
     REG_TYPE aargs[ max_args ]; // vm pointers to each argument
-    char * buffer_args = (char *) ( memory.data() + arg_data_offset );
+    char * buffer_args = (char *) ( g_vm->memory.data() + arg_data_offset );
     char * pargs = buffer_args;
     REG_TYPE app_argc = 0;
 
@@ -9106,8 +10164,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     {
         REG_TYPE offset = (REG_TYPE) ( pargs - buffer_args );
         tracer.Trace( "offset %x\n", offset );
-        aargs[ app_argc ] = swap_endian32( offset + g_base_address + arg_data_offset );
-        tracer.Trace( "  argument %d is '%s', at vm address %llx\n", app_argc, pargs, (uint64_t) offset + g_base_address + arg_data_offset );
+        aargs[ app_argc ] = swap_endian32( offset + g_vm->base_address + arg_data_offset );
+        tracer.Trace( "  argument %d is '%s', at vm address %llx\n", app_argc, pargs, (uint64_t) offset + g_vm->base_address + arg_data_offset );
         app_argc++;
         pargs += strlen( pargs ) + 1;
     }
@@ -9118,8 +10176,8 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
 
         REG_TYPE offset = (REG_TYPE) ( pargs - buffer_args );
         tracer.Trace( "offset %x\n", offset );
-        aargs[ app_argc ] = swap_endian32( offset + g_base_address + arg_data_offset );
-        tracer.Trace( "  argument %d is '%s', at vm address %llx\n", app_argc, pargs, (uint64_t) offset + g_base_address + arg_data_offset );
+        aargs[ app_argc ] = swap_endian32( offset + g_vm->base_address + arg_data_offset );
+        tracer.Trace( "  argument %d is '%s', at vm address %llx\n", app_argc, pargs, (uint64_t) offset + g_vm->base_address + arg_data_offset );
 
         app_argc++;
         pargs += strlen( pargs ) + 1;
@@ -9135,13 +10193,13 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     strcat( penv_data, APP_NAME );
     char * penv_cur = penv_data + 1 + strlen( penv_data );
     REG_TYPE app_env_count = 0;
-    aenv[ app_env_count++ ] = (REG_TYPE) ( penv_data - (char *) memory.data() ) + g_base_address;
+    aenv[ app_env_count++ ] = (REG_TYPE) ( penv_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     tracer.Trace( "env_os_address %x\n", aenv[ 0 ] );
 
-    if ( g_penvironment ) // semicolon-separated list of name=value pairs. names like PATH can have colon-separated values
+    if ( g_vm->penvironment ) // semicolon-separated list of name=value pairs. names like PATH can have colon-separated values
     {
-        tracer.Trace( "environment variable argument: '%s'\n", g_penvironment );
-        char * pfrom = g_penvironment;
+        tracer.Trace( "environment variable argument: '%s'\n", g_vm->penvironment );
+        char * pfrom = g_vm->penvironment;
         while ( *pfrom )
         {
             tracer.Trace( "remaining env: %s\n", pfrom );
@@ -9152,7 +10210,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
                 usage( "environment variable is malformed; no equal sign" );
             strcpy( penv_cur, pfrom );
             size_t len = strlen( penv_cur );
-            aenv[ app_env_count++ ] =  (REG_TYPE) ( penv_cur - (char *) memory.data() ) + g_base_address;
+            aenv[ app_env_count++ ] =  (REG_TYPE) ( penv_cur - (char *) g_vm->memory.data() ) + g_vm->base_address;
             penv_cur += len + 1;
             pfrom += len + ( psc ? 1 : 0 );
         }
@@ -9179,7 +10237,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
             if ( 0 != acName[ 0 ] )
             {
                 char * ptz_data = penv_cur;
-                aenv[ app_env_count++ ] = (REG_TYPE) ( ptz_data - (char *) memory.data() ) + g_base_address;
+                aenv[ app_env_count++ ] = (REG_TYPE) ( ptz_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
                 tracer.Trace( "env_tz_address %x\n", aenv[ app_env_count - 1 ] );
                 strcpy( ptz_data, "TZ=" );
 
@@ -9205,22 +10263,23 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     }
 #endif //_WIN32
 
-    char * execfn_string = resolve_execfn_path( pimage );
+    char acExecfn[ EMULATOR_MAX_PATH + 1 ];
+    char * execfn_string = resolve_execfn_path( pimage, acExecfn );
     backslash_to_slash( execfn_string );
     char * pexecfn_data = penv_cur;
     strcpy( pexecfn_data, execfn_string );
-    REG_TYPE aexecfn = (REG_TYPE) ( pexecfn_data - (char *) memory.data() ) + g_base_address;
+    REG_TYPE aexecfn = (REG_TYPE) ( pexecfn_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     penv_cur += strlen( pexecfn_data ) + 1;
     tracer.Trace( "execfn_string '%s', vm address %x\n", pexecfn_data, aexecfn );
 
     char * p_at_platform_data = penv_cur;
     strcpy( p_at_platform_data, AT_PLATFORM_VALUE );
-    REG_TYPE p_at_platform = (REG_TYPE) ( p_at_platform_data - (char *) memory.data() ) + g_base_address;
+    REG_TYPE p_at_platform = (REG_TYPE) ( p_at_platform_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     penv_cur += strlen( p_at_platform_data ) + 1;
     tracer.Trace( "at_platform '%s', vm address %x\n", p_at_platform_data, p_at_platform );
 
     tracer.Trace( "args_len %d, penv_data %p\n", args_len, penv_data );
-    tracer.TraceBinaryData( (uint8_t *) ( memory.data() + arg_data_offset ), g_arg_data_commit + 0x20, 4 ); // +20 to inspect for bugs
+    tracer.TraceBinaryData( (uint8_t *) ( g_vm->memory.data() + arg_data_offset ), g_arg_data_commit + 0x20, 4 ); // +20 to inspect for bugs
 
     // put the Linux startup info at the top of the stack. this consists of (from high to low):
     //   two 8-byte random numbers used for stack and pointer guards
@@ -9235,7 +10294,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     //   argc  <<<==== sp should point here when the entrypoint (likely _start) is invoked
 
     tracer.Trace( "top of aux: %x\n", top_of_aux );
-    REG_TYPE * pstack = (REG_TYPE *) ( memory.data() + top_of_aux );
+    REG_TYPE * pstack = (REG_TYPE *) ( g_vm->memory.data() + top_of_aux );
 
     pstack--;
     *pstack = (REG_TYPE) 0x01020304; // use fixed values for consistent traces across runs
@@ -9247,7 +10306,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
     *pstack = (REG_TYPE) 0x05060708;
     tracer.Trace( "random data for AT_RANDOM: " );
     tracer.TraceBinaryData( (uint8_t *) pstack, 16, 4 );
-    REG_TYPE prandom = g_base_address + top_of_aux - 16; // point to the 16 bytes we just put on the stack for AT_RANDOM for 32 and 64 bit machines.
+    REG_TYPE prandom = g_vm->base_address + top_of_aux - 16; // point to the 16 bytes we just put on the stack for AT_RANDOM for 32 and 64 bit machines.
 
     // ensure that after all of this the stack is 16-byte aligned
 
@@ -9255,7 +10314,7 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         pstack--;
 
     pstack -= ( 11 * sizeof( AuxProcessStart32 ) ); // for 10 aux records
-    REG_TYPE aux_data_offset = (REG_TYPE) ( (uint8_t *) pstack - memory.data() );
+    REG_TYPE aux_data_offset = (REG_TYPE) ( (uint8_t *) pstack - g_vm->memory.data() );
     AuxProcessStart32 * paux = (AuxProcessStart32 *) pstack;
     size_t irec = 0;
     paux[irec].a_type = 25; // AT_RANDOM
@@ -9316,50 +10375,50 @@ static bool load_image32( FILE * fp, const char * pimage, char * const * in_argv
         *pstack = aargs[ iarg ];
     }
 
-    REG_TYPE first_argv_at = (REG_TYPE) ( ( (uint8_t *) pstack - memory.data() ) + g_base_address );
+    REG_TYPE first_argv_at = (REG_TYPE) ( ( (uint8_t *) pstack - g_vm->memory.data() ) + g_vm->base_address );
     tracer.Trace( "first argv value (app name) is at %lx\n", first_argv_at );
     pstack--;
     *pstack = swap_endian32( app_argc );
 
-    g_top_of_stack = (REG_TYPE) ( ( (uint8_t *) pstack - memory.data() ) + g_base_address );
+    g_vm->top_of_stack = (REG_TYPE) ( ( (uint8_t *) pstack - g_vm->memory.data() ) + g_vm->base_address );
 #ifdef SPARCOS
     // linux on sparc v8 reserves one register frame of space between argc and the actual top of the stack for the trap handler
-    g_top_of_stack -= 64;
+    g_vm->top_of_stack -= 64;
 #endif
 
-    REG_TYPE aux_data_size = top_of_aux - (REG_TYPE) ( (uint8_t *) pstack - memory.data() );
+    REG_TYPE aux_data_size = top_of_aux - (REG_TYPE) ( (uint8_t *) pstack - g_vm->memory.data() );
     tracer.Trace( "stack at start (beginning with argc) -- %u bytes at address %p:\n", aux_data_size, pstack );
     tracer.TraceBinaryData( (uint8_t *) pstack, (uint32_t) aux_data_size, 2 );
 
     tracer.Trace( "memory map from highest to lowest addresses:\n" );
-    tracer.Trace( "  first byte beyond allocated memory:                 %lx\n", g_base_address + memory_size );
-    tracer.Trace( "  <mmap arena>                                        (%ld = %lx bytes)\n", g_mmap_commit, g_mmap_commit );
-    tracer.Trace( "  mmap start adddress:                                %lx\n", g_base_address + g_mmap_offset );
+    tracer.Trace( "  first byte beyond allocated memory:                 %lx\n", g_vm->base_address + memory_size );
+    tracer.Trace( "  <mmap arena>                                        (%ld = %lx bytes)\n", g_vm->mmap_commit, g_vm->mmap_commit );
+    tracer.Trace( "  mmap start adddress:                                %lx\n", g_vm->base_address + g_vm->mmap_offset );
     tracer.Trace( "  <filler to align to 4k-page for mmap allocations>\n" );
 
     tracer.Trace( "  <argv data, pointed to by argv array below>         (%ld == %lx bytes)\n", g_arg_data_commit, g_arg_data_commit );
-    tracer.Trace( "  start of argv data:                                 %lx\n", g_base_address + arg_data_offset );
+    tracer.Trace( "  start of argv data:                                 %lx\n", g_vm->base_address + arg_data_offset );
 
-    tracer.Trace( "  start of aux data:                                  %lx\n", g_base_address + aux_data_offset );
+    tracer.Trace( "  start of aux data:                                  %lx\n", g_vm->base_address + aux_data_offset );
     tracer.Trace( "  <random, alignment, aux recs, env, argv>            (%ld == %lx bytes)\n", aux_data_size, aux_data_size );
-    tracer.Trace( "  initial stack pointer g_top_of_stack:               %lx\n", g_top_of_stack );
-    REG_TYPE stack_bytes = g_stack_commit - aux_data_size;
+    tracer.Trace( "  initial stack pointer top_of_stack:                 %lx\n", g_vm->top_of_stack );
+    REG_TYPE stack_bytes = g_vm->stack_commit - aux_data_size;
     tracer.Trace( "  <stack>                                             (%ld == %lx bytes)\n", stack_bytes, stack_bytes );
-    tracer.Trace( "  last byte stack can use (g_bottom_of_stack):        %lx\n", g_base_address + g_bottom_of_stack );
-    tracer.Trace( "  <unallocated space between brk and the stack>       (%ld == %lx bytes)\n", g_brk_commit, g_brk_commit );
-    tracer.Trace( "  end_of_data / current brk:                          %lx\n", g_base_address + g_end_of_data );
-    REG_TYPE uninitialized_bytes = g_end_of_data - first_uninitialized_data;
+    tracer.Trace( "  last byte stack can use (bottom_of_stack):          %lx\n", g_vm->base_address + g_vm->bottom_of_stack );
+    tracer.Trace( "  <unallocated space between brk and the stack>       (%ld == %lx bytes)\n", g_vm->brk_commit, g_vm->brk_commit );
+    tracer.Trace( "  end_of_data / current brk:                          %lx\n", g_vm->base_address + g_vm->end_of_data );
+    REG_TYPE uninitialized_bytes = g_vm->end_of_data - first_uninitialized_data;
     tracer.Trace( "  <uninitialized data per the .elf file>              (%ld == %lx bytes)\n", uninitialized_bytes, uninitialized_bytes );
     tracer.Trace( "  first byte of uninitialized data:                   %lx\n", first_uninitialized_data );
     tracer.Trace( "  <initialized data from the .elf file>\n" );
     tracer.Trace( "  <code from the .elf file>\n" );
-    tracer.Trace( "  initial pc execution_addess:                        %lx\n", g_execution_address );
+    tracer.Trace( "  initial pc execution_addess:                        %lx\n", g_vm->execution_address );
     tracer.Trace( "  <code per the .elf file>\n" );
     tracer.Trace( "  start of the address space per the .elf file:       %lx\n", elf_base_address );
-    tracer.Trace( "  start of the address space actual:                  %lx\n", g_base_address );
+    tracer.Trace( "  start of the address space actual:                  %lx\n", g_vm->base_address );
 
-    tracer.Trace( "vm memory first byte beyond:     %p\n", memory.data() + memory_size );
-    tracer.Trace( "vm memory start:                 %p\n", memory.data() );
+    tracer.Trace( "vm memory first byte beyond:     %p\n", g_vm->memory.data() + memory_size );
+    tracer.Trace( "vm memory start:                 %p\n", g_vm->memory.data() );
     tracer.Trace( "memory_size:                     %lx == %ld\n", memory_size, memory_size );
 
     return true;
@@ -9407,14 +10466,14 @@ static bool load_68000_hex( const char * pimage )
                 ac[ 3 ] = acLine[ 7 ];
                 ac[ 4 ] = 0;
                 uint32_t address = strtoul( ac, 0, 16 );
-                memory.resize( address + length );
+                g_vm->memory.resize( address + length );
                 for ( uint32_t i = 0; i < length; i++ )
                 {
                     ac[ 0 ] = acLine[ 8 + i * 2 ];
                     ac[ 1 ] = acLine[ 8 + i * 2 + 1 ];
                     ac[ 2 ] = 0;
                     uint8_t v = (uint8_t) strtoul( ac, 0, 16 );
-                    memory[ address + i ] = v;
+                    g_vm->memory[ address + i ] = v;
                 }
             }
             else if ( '9' == acLine[1] )
@@ -9424,14 +10483,14 @@ static bool load_68000_hex( const char * pimage )
                 ac[ 2 ] = acLine[ 6 ];
                 ac[ 3 ] = acLine[ 7 ];
                 ac[ 4 ] = 0;
-                g_execution_address = strtoul( ac, 0, 16 );
+                g_vm->execution_address = strtoul( ac, 0, 16 );
             }
             else
                 usage( "motorola hex input file format variation not supported" );
         }
     } while ( !feof( fp ) );
 
-    REG_TYPE memory_size = (REG_TYPE) memory.size();
+    REG_TYPE memory_size = (REG_TYPE) g_vm->memory.size();
 
     if ( memory_size & 0xf )
     {
@@ -9439,44 +10498,44 @@ static bool load_68000_hex( const char * pimage )
         memory_size &= ~0xf;
     }
 
-    g_end_of_data = memory_size;
-    g_brk_offset = memory_size;
-    g_highwater_brk = memory_size;
-    memory_size += g_brk_commit;
+    g_vm->end_of_data = memory_size;
+    g_vm->brk_offset = memory_size;
+    g_vm->highwater_brk = memory_size;
+    memory_size += g_vm->brk_commit;
 
-    g_bottom_of_stack = memory_size;
-    memory_size += g_stack_commit;
+    g_vm->bottom_of_stack = memory_size;
+    memory_size += g_vm->stack_commit;
 
     memory_size = round_up( memory_size, (REG_TYPE) 4096 ); // mmap should hand out 4k-aligned pages
-    g_mmap_offset = memory_size;
-    memory_size += g_mmap_commit;
+    g_vm->mmap_offset = memory_size;
+    memory_size += g_vm->mmap_commit;
 
-    memory.resize( memory_size );
-    memset( memory.data() + g_brk_offset, 0, memory_size - g_brk_offset );
+    g_vm->memory.resize( memory_size );
+    memset( g_vm->memory.data() + g_vm->brk_offset, 0, memory_size - g_vm->brk_offset );
 
-    g_base_address = 0;
-    g_mmap.initialize( g_base_address + g_mmap_offset, g_mmap_commit, memory.data() - g_base_address );
+    g_vm->base_address = 0;
+    g_vm->mmap_allocator.initialize( g_vm->base_address + g_vm->mmap_offset, g_vm->mmap_commit, g_vm->memory, g_vm->base_address );
 
-    g_top_of_stack = (REG_TYPE) memory.size();
+    g_vm->top_of_stack = (REG_TYPE) g_vm->memory.size();
 
     tracer.Trace( "memory map from highest to lowest addresses:\n" );
-    tracer.Trace( "  first byte beyond allocated memory:                 %x\n", g_base_address + memory_size );
-    tracer.Trace( "  <mmap arena>                                        (%d = %x bytes)\n", g_mmap_commit, g_mmap_commit );
-    tracer.Trace( "  mmap start adddress:                                %x\n", g_base_address + g_mmap_offset );
+    tracer.Trace( "  first byte beyond allocated memory:                 %x\n", g_vm->base_address + memory_size );
+    tracer.Trace( "  <mmap arena>                                        (%d = %x bytes)\n", g_vm->mmap_commit, g_vm->mmap_commit );
+    tracer.Trace( "  mmap start adddress:                                %x\n", g_vm->base_address + g_vm->mmap_offset );
     tracer.Trace( "  <align to 4k-page for mmap allocations>\n" );
-    tracer.Trace( "  initial stack pointer g_top_of_stack:               %x\n", g_top_of_stack );
-    REG_TYPE stack_bytes = g_stack_commit;
+    tracer.Trace( "  initial stack pointer top_of_stack:                 %x\n", g_vm->top_of_stack );
+    REG_TYPE stack_bytes = g_vm->stack_commit;
     tracer.Trace( "  <stack>                                             (%d == %x bytes)\n", stack_bytes, stack_bytes );
-    tracer.Trace( "  last byte stack can use (g_bottom_of_stack):        %x\n", g_base_address + g_bottom_of_stack );
-    tracer.Trace( "  <unallocated space between brk and the stack>       (%d == %llx bytes)\n", g_brk_commit, g_brk_commit );
-    tracer.Trace( "  end_of_data / current brk:                          %x\n", g_base_address + g_end_of_data );
+    tracer.Trace( "  last byte stack can use (bottom_of_stack):          %x\n", g_vm->base_address + g_vm->bottom_of_stack );
+    tracer.Trace( "  <unallocated space between brk and the stack>       (%d == %llx bytes)\n", g_vm->brk_commit, g_vm->brk_commit );
+    tracer.Trace( "  end_of_data / current brk:                          %x\n", g_vm->base_address + g_vm->end_of_data );
     tracer.Trace( "  <code + data from the .hex file>\n" );
-    tracer.Trace( "  initial pc execution_addess:                        %x\n", g_execution_address );
+    tracer.Trace( "  initial pc execution_addess:                        %x\n", g_vm->execution_address );
     tracer.Trace( "  <code per the .hex file>\n" );
-    tracer.Trace( "  start of the address space:                         %x\n", g_base_address );
+    tracer.Trace( "  start of the address space:                         %x\n", g_vm->base_address );
 
-    tracer.Trace( "vm memory first byte beyond:     %p\n", memory.data() + memory_size );
-    tracer.Trace( "vm memory start:                 %p\n", memory.data() );
+    tracer.Trace( "vm memory first byte beyond:     %p\n", g_vm->memory.data() + memory_size );
+    tracer.Trace( "vm memory start:                 %p\n", g_vm->memory.data() );
     tracer.Trace( "memory_size:                     %#x == %d\n", memory_size, memory_size );
 
     return true;
@@ -9486,49 +10545,48 @@ static bool load_68000_hex( const char * pimage )
 
 #endif // defined( M68 ) || defined( SPARCOS ) || defined( X32OS )
 
-static bool load_image( const char * pimage, char * const * app_argv, int app_argc )
-{
-    tracer.Trace( "loading image %s\n", pimage );
-
-    strcpy( g_acLoadedApp, pimage );
+// Map the whole pages of a segment straight from the elf file so they're shared with other processes until written.
+// Partial pages at either end are read so file bytes outside the segment don't appear in the vm (e.g. in .bss).
+// Returns false if nothing was mapped, and the caller reads the segment instead.
 
-    // A legacy flat, space-joined app_args string is still needed by callees that expect a single
-    // command-line string (CP/M's command tail, and the 64-bit ELF path below). Individual arguments
-    // that themselves contain spaces can't survive that join, so the ELF (argv-array) path further
-    // below uses app_argv/app_argc directly instead, preserving each argument's exact boundaries.
+// Pages the app hasn't written stay backed by the file. Like a native executable, the file must not be rewritten in
+// place while the app runs: those pages would change under it and decoded and translated blocks would be stale.
+// Replacing it (a new file renamed over it, or the old one deleted first) is safe.
 
-    static char acAppArgs[ 1024 ] = {0};
-    acAppArgs[ 0 ] = 0;
-    for ( int i = 0; i < app_argc; i++ )
-    {
-        if ( strlen( acAppArgs ) + 3 + strlen( app_argv[ i ] ) >= _countof( acAppArgs ) )
-            break;
+static bool map_segment( ElfImageReader & image, uint64_t mem_offset, uint64_t file_offset, uint64_t len )
+{
+    uint64_t page = CVirtualMemory::page_size();
+    if ( image.descriptor() < 0 || ( mem_offset % page ) != ( file_offset % page ) )
+        return false;
 
-        if ( 0 != acAppArgs[0] )
-            strcat( acAppArgs, " " );
+    uint64_t first = round_up( mem_offset, page );
+    uint64_t beyond = ( mem_offset + len ) & ~( page - 1 );
+    if ( beyond <= first )
+        return false;
 
-        strcat( acAppArgs, app_argv[ i ] );
-    }
+    if ( !g_vm->memory.map_file( (size_t) first, image.descriptor(), file_offset + ( first - mem_offset ), (size_t) ( beyond - first ) ) )
+        return false;
 
-#ifdef M68
-    if ( ends_with( pimage, ".hex" ) ) // Motorola 68000 hex file special-case
-        return load_68000_hex( pimage ); // app args are lost with hex files
+    tracer.Trace( "  mapped %llx bytes of the segment from file offset %llx\n", beyond - first, file_offset + ( first - mem_offset ) );
 
-    if ( ends_with( pimage, ".68k" ) || ends_with( pimage, ".rel" ) ) // Digital Research CP/M 68K executable file
-        return load_cpm68k( pimage, acAppArgs );
-#endif
+    size_t head_len = (size_t) ( first - mem_offset );
+    size_t tail_len = (size_t) ( mem_offset + len - beyond );
+    image.seek( file_offset );
+    if ( head_len != image.read( g_vm->memory.data() + mem_offset, 1, head_len ) )
+        usage( "can't read image" );
+    image.seek( file_offset + ( beyond - mem_offset ) );
+    if ( tail_len != image.read( g_vm->memory.data() + beyond, 1, tail_len ) )
+        usage( "can't read image" );
 
-    FILE * fp = fopen( pimage, "rb" );
-    if ( !fp )
-    {
-        printf( "can't open elf image file: %s\n", pimage );
-        usage();
-    }
+    return true;
+} //map_segment
 
-    CFile file( fp );
+// pimage is argv[ 0 ] for the app and where execfn points. it needn't be a file that exists
 
+static bool load_elf_image( ElfImageReader & image, const char * pimage, char * const * app_argv, int app_argc )
+{
     ElfHeader64 ehead = {0};
-    size_t read = fread( &ehead, sizeof ehead, 1, fp );
+    size_t read = image.read( &ehead, sizeof ehead, 1 );
     if ( 1 != read )
         usage( "elf image file is invalid" );
 
@@ -9537,7 +10595,7 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
 #if defined( M68 ) || defined( SPARCOS ) || defined( X32OS )
     if ( 1 == ehead.bit_width )
-        return load_image32( fp, pimage, app_argv, app_argc );
+        return load_image32( image, pimage, app_argv, app_argc );
     else
         usage( "elf image isn't 32-bit" );
 #endif
@@ -9573,8 +10631,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     tracer.Trace( "  section offset: %llu == %llx\n", ehead.section_header_table, ehead.section_header_table );
     tracer.Trace( "  section with section names: %u == %x\n", ehead.section_with_section_names, ehead.section_with_section_names );
     tracer.Trace( "  flags: %x\n", ehead.flags );
-    g_execution_address = (REG_TYPE) ehead.entry_point;
-    g_compressed_rvc = 0 != ( ehead.flags & 1 ); // 2-byte compressed RVC instructions, not 4-byte default risc-v instructions
+    g_vm->execution_address = (REG_TYPE) ehead.entry_point;
+    g_vm->compressed_rvc = 0 != ( ehead.flags & 1 ); // 2-byte compressed RVC instructions, not 4-byte default risc-v instructions
 
     // determine how much RAM to allocate
 
@@ -9586,8 +10644,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
         tracer.Trace( "program header %u at offset %u\n", ph, (unsigned) o );
 
         ElfProgramHeader64 head = {0};
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), 1, fp );
+        image.seek( o );
+        read = image.read( &head, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), 1 );
         if ( 1 != read )
             usage( "can't read program header" );
 
@@ -9603,6 +10661,9 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
         if ( 2 == head.type )
         {
+#ifdef RVOS_LIBRARY
+            throw runtime_error( "dynamic linking is not supported by this emulator. link your app with -static" );
+#endif
             printf( "dynamic linking is not supported by this emulator. link your app with -static\n" );
             exit( 1 );
         }
@@ -9611,14 +10672,14 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
         if ( just_past > memory_size )
             memory_size = just_past;
 
-        if ( ( 0 != head.physical_address ) && ( ( 0 == g_base_address ) || g_base_address > head.physical_address ) )
-            g_base_address = (REG_TYPE) head.physical_address;
+        if ( ( 0 != head.physical_address ) && ( ( 0 == g_vm->base_address ) || g_vm->base_address > head.physical_address ) )
+            g_vm->base_address = (REG_TYPE) head.physical_address;
     }
 
-    if ( 0 == g_base_address )
+    if ( 0 == g_vm->base_address )
         usage( "base address of elf image is invalid; physical address required" );
 
-    memory_size -= g_base_address;
+    memory_size -= g_vm->base_address;
     tracer.Trace( "memory_size of content to load from elf file: %llx\n", memory_size );
 
     // first load the string table
@@ -9629,8 +10690,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
         size_t o = ehead.section_header_table + ( sh * ehead.section_header_table_size );
         ElfSectionHeader64 head = {0};
 
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ), fp );
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ) );
         if ( 0 == read )
             usage( "can't read section header" );
 
@@ -9640,8 +10701,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
             if ( sh == ehead.section_with_section_names )
             {
                 section_names_string_table.resize( head.size );
-                fseek( fp, (long) head.offset, SEEK_SET );
-                read = fread( section_names_string_table.data(), head.size, 1, fp );
+                image.seek( head.offset );
+                read = image.read( section_names_string_table.data(), head.size, 1 );
                 if ( 1 != read )
                     usage( "can't read string table\n" );
 
@@ -9650,14 +10711,14 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
             }
             else
             {
-                g_string_table.resize( head.size );
-                fseek( fp, (long) head.offset, SEEK_SET );
-                read = fread( g_string_table.data(), head.size, 1, fp );
+                g_vm->string_table.resize( head.size );
+                image.seek( head.offset );
+                read = image.read( g_vm->string_table.data(), head.size, 1 );
                 if ( 1 != read )
                     usage( "can't read string table\n" );
 
                 tracer.Trace( "main string table:\n" );
-                tracer.TraceBinaryData( (uint8_t *) g_string_table.data(), (uint32_t) head.size, 4 );
+                tracer.TraceBinaryData( (uint8_t *) g_vm->string_table.data(), (uint32_t) head.size, 4 );
             }
         }
     }
@@ -9671,8 +10732,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
         ElfSectionHeader64 head = {0};
 
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ), fp );
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.section_header_table_size ) );
         if ( 0 == read )
             usage( "can't read section header" );
 
@@ -9693,9 +10754,9 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
         if ( 2 == head.type )
         {
-            g_symbols.resize( head.size / sizeof( ElfSymbol64 ) );
-            fseek( fp, (long) head.offset, SEEK_SET );
-            read = fread( g_symbols.data(), 1, head.size, fp );
+            g_vm->symbols.resize( head.size / sizeof( ElfSymbol64 ) );
+            image.seek( head.offset );
+            read = image.read( g_vm->symbols.data(), 1, head.size );
             if ( 0 == read )
                 usage( "can't read symbol table" );
         }
@@ -9703,73 +10764,75 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
     // void out the entries that don't have symbol names or have mangled names that start with $
 
-    for ( size_t se = 0; se < g_symbols.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols.size(); se++ )
     {
-        g_symbols[se].swap_endianness();
+        g_vm->symbols[se].swap_endianness();
 
-        if ( ( 0 == g_symbols[se].name ) || ( '$' == g_string_table[ g_symbols[se].name ] ) )
-            g_symbols[se].value = 0;
+        if ( ( 0 == g_vm->symbols[se].name ) || ( '$' == g_vm->string_table[ g_vm->symbols[se].name ] ) )
+            g_vm->symbols[se].value = 0;
     }
 
     // use known qsort so traces are consistent across platforms because qsort implementations for ties differ
 
-    my_qsort( g_symbols.data(), g_symbols.size(), sizeof( ElfSymbol64 ), symbol_compare );
+    my_qsort( g_vm->symbols.data(), g_vm->symbols.size(), sizeof( ElfSymbol64 ), symbol_compare );
 
     // remove symbols that don't look like they have a valid addresses (rust binaries have tens of thousands of these)
 
     size_t to_erase = 0;
-    for ( size_t se = 0; se < g_symbols.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols.size(); se++ )
     {
-        if ( g_symbols[ se ].value < g_base_address )
+        if ( g_vm->symbols[ se ].value < g_vm->base_address )
             to_erase++;
         else
             break;
     }
 
     if ( to_erase > 0 )
-        g_symbols.erase( g_symbols.begin(), g_symbols.begin() + to_erase );
+        g_vm->symbols.erase( g_vm->symbols.begin(), g_vm->symbols.begin() + to_erase );
 
     // set the size of each symbol if it's not already set
 
-    for ( size_t se = 0; se < g_symbols.size(); se++ )
+    for ( size_t se = 0; se < g_vm->symbols.size(); se++ )
     {
-        if ( 0 == g_symbols[se].size )
+        if ( 0 == g_vm->symbols[se].size )
         {
-            if ( se < ( g_symbols.size() - 1 ) )
+            if ( se < ( g_vm->symbols.size() - 1 ) )
             {
                 // Free Pascal writes all symbols in lower and uppercase with the same value/address
                 size_t next = se + 1;
-                while ( ( next < ( g_symbols.size() - 1 ) ) && ( g_symbols[ next ].value == g_symbols[ se ].value ) )
+                while ( ( next < ( g_vm->symbols.size() - 1 ) ) && ( g_vm->symbols[ next ].value == g_vm->symbols[ se ].value ) )
                     next++;
-                g_symbols[se].size = g_symbols[ next ].value - g_symbols[ se ].value;
+                g_vm->symbols[se].size = g_vm->symbols[ next ].value - g_vm->symbols[ se ].value;
             }
             else
-                g_symbols[se].size = g_base_address + memory_size - g_symbols[ se ].value;
+                g_vm->symbols[se].size = g_vm->base_address + memory_size - g_vm->symbols[ se ].value;
         }
     }
 
-    tracer.Trace( "elf image has %u usable symbols:\n", (unsigned) g_symbols.size() );
+    tracer.Trace( "elf image has %u usable symbols:\n", (unsigned) g_vm->symbols.size() );
     tracer.Trace( "             address              size  name\n" );
 
-    for ( size_t se = 0; se < g_symbols.size(); se++ )
-        tracer.Trace( "    %16llx  %16llx  %s\n", g_symbols[ se ].value, g_symbols[ se ].size, & g_string_table[ g_symbols[ se ].name ] );
+    for ( size_t se = 0; se < g_vm->symbols.size(); se++ )
+        tracer.Trace( "    %16llx  %16llx  %s\n", g_vm->symbols[ se ].value, g_vm->symbols[ se ].size, & g_vm->string_table[ g_vm->symbols[ se ].name ] );
 
     // memory map from high to low addresses:
     //     <end of allocated memory>
     //     (memory for mmap fulfillment)
-    //     g_mmap_offset
-    //     (wasted space so g_mmap_offset is 4k-aligned)
+    //     mmap_offset
+    //     (wasted space so mmap_offset is 4k-aligned)
     //     Linux start data on the stack (see details below)
-    //     g_top_of_stack
-    //     g_bottom_of_stack
+    //     top_of_stack
+    //     bottom_of_stack
+    //     (inaccessible stack_guard pages, so a stack overflow faults)
     //     (unallocated space between brk and the bottom of the stack)
-    //     g_brk_offset with uninitialized RAM (just after arg_data_offset initially)
-    //     g_end_of_data
+    //     brk_offset with uninitialized RAM (just after arg_data_offset initially)
+    //     end_of_data
     //     arg_data_offset
     //     uninitalized data bss (size read from the .elf file)
     //     initialized data (size & data read from the .elf file)
     //     code (read from the .elf file)
-    //     g_base_address (offset read from the .elf file).
+    //     base_address (offset read from the .elf file).
+    //     (inaccessible guard region covering addresses below base_address, including 0)
 
     // stacks by convention on arm64 and risc-v are 16-byte aligned. make sure to start aligned
 
@@ -9781,50 +10844,121 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
     uint64_t arg_data_offset = memory_size;
     memory_size += g_arg_data_commit;
-    g_end_of_data = memory_size;
-    g_brk_offset = memory_size;
-    g_highwater_brk = memory_size;
-    memory_size += g_brk_commit;
+    g_vm->end_of_data = memory_size;
+    g_vm->brk_offset = memory_size;
+    g_vm->highwater_brk = memory_size;
 
-    g_bottom_of_stack = memory_size;
-    memory_size += g_stack_commit;
+    // The default brk and mmap spaces can be gigabytes that cost nothing until touched. Hosts that account for
+    // reservations anyway (vm.overcommit_memory=2 or a low ulimit -v) refuse them, so retry with the old 40 meg defaults
 
-    uint64_t top_of_aux = memory_size;
-    memory_size = round_up( memory_size, (REG_TYPE) 4096 ); // mmap should hand out 4k-aligned pages
-    g_mmap_offset = memory_size;
-    memory_size += g_mmap_commit;
+    REG_TYPE page = (REG_TYPE) CVirtualMemory::page_size();
+    const REG_TYPE fallback_space = 40 * 1024 * 1024;
+    const uint64_t data_size = memory_size;
+    uint64_t stack_guard_offset = 0, top_of_aux = 0;
 
-    memory.resize( memory_size );
-    memset( memory.data(), 0, memory_size );
+    for ( ;; )
+    {
+        memory_size = data_size + g_vm->brk_commit;
+        memory_size = round_up( memory_size, page );
+        stack_guard_offset = memory_size;
+        g_vm->stack_guard = get_max( (REG_TYPE) 65536, page );
+        memory_size += g_vm->stack_guard;
 
-    g_mmap.initialize( g_base_address + g_mmap_offset, g_mmap_commit, memory.data() - g_base_address );
+        g_vm->bottom_of_stack = memory_size;
+        memory_size += g_vm->stack_commit;
 
-    // load the program into RAM
+        top_of_aux = memory_size;
+        memory_size = round_up( memory_size, (REG_TYPE) 4096 ); // mmap should hand out 4k-aligned pages
+        g_vm->mmap_offset = memory_size;
+        memory_size += g_vm->mmap_commit;
 
-    uint64_t first_uninitialized_data = 0;
+        // guard regions make wild references near the app's memory fault, and the fault handler reports them like a debug
+        // build's bounds checks. The low guard covers every address below base_address, including null pointers
 
-    for ( uint16_t ph = 0; ph < ehead.program_header_table_entries; ph++ )
-    {
-        size_t o = ehead.program_header_table + ( ph * ehead.program_header_table_size );
-        ElfProgramHeader64 head = {0};
-        fseek( fp, (long) o, SEEK_SET );
-        read = fread( &head, 1, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ), fp );
+        if ( sizeof( void * ) >= 8 )
+            g_vm->memory.set_guards( get_min( (size_t) g_vm->base_address + 0x10000, (size_t) 1 << 30 ), (size_t) 1 << 28 );
+        else
+            g_vm->memory.set_guards( 0x10000, 0x10000 );
+
+        // with identity mapping, membase is 0 and guest addresses are host pointers. fall back if the range is in use
+
+        if ( g_vm->identity_map && g_vm->memory.reserve_at( g_vm->base_address, (size_t) memory_size ) )
+            tracer.Trace( "guest memory is identity-mapped at %llx\n", (uint64_t) g_vm->base_address );
+        else
+        {
+            if ( g_vm->identity_map )
+                tracer.Trace( "can't identity-map guest memory at %llx; using any host address\n", (uint64_t) g_vm->base_address );
+            try
+            {
+                g_vm->memory.resize( memory_size ); // zero-filled as pages are first touched
+            }
+            catch ( bad_alloc & )
+            {
+                bool brk_default = ( default_guest_space() > fallback_space && default_guest_space() == g_vm->brk_commit );
+                bool mmap_default = ( default_guest_space() > fallback_space && default_guest_space() == g_vm->mmap_commit );
+                if ( !brk_default && !mmap_default )
+                    throw;
+
+                tracer.Trace( "can't reserve %llx bytes of guest memory; using %u meg brk and mmap defaults\n", (uint64_t) memory_size, (unsigned) ( fallback_space / ( 1024 * 1024 ) ) );
+                if ( brk_default )
+                    g_vm->brk_commit = fallback_space;
+                if ( mmap_default )
+                    g_vm->mmap_commit = fallback_space;
+                continue;
+            }
+        }
+
+        break;
+    }
+
+    if ( g_vm->memory.protect( (size_t) stack_guard_offset, (size_t) g_vm->stack_guard ) )
+        tracer.Trace( "stack guard at %llx, %llx bytes\n", g_vm->base_address + stack_guard_offset, (uint64_t) g_vm->stack_guard );
+
+    if ( g_vm->huge_pages ) // everything past the image and argv data
+        g_vm->huge_pages_advised = g_vm->memory.advise_huge_pages( (size_t) g_vm->end_of_data, (size_t) ( memory_size - g_vm->end_of_data ) );
+
+    g_vm->mmap_allocator.initialize( g_vm->base_address + g_vm->mmap_offset, g_vm->mmap_commit, g_vm->memory, g_vm->base_address );
+
+    // load the program into RAM
+
+    uint64_t first_uninitialized_data = 0;
+#ifdef RVOS
+    g_vm->image_hash = CPUClass::hash_bytes( & ehead.entry_point, sizeof( ehead.entry_point ) );
+#endif
+
+    for ( uint16_t ph = 0; ph < ehead.program_header_table_entries; ph++ )
+    {
+        size_t o = ehead.program_header_table + ( ph * ehead.program_header_table_size );
+        ElfProgramHeader64 head = {0};
+        image.seek( o );
+        read = image.read( &head, 1, get_min( sizeof( head ), (size_t) ehead.program_header_table_size ) );
         head.swap_endianness();
 
         // head.type 1 == load. Other entries will overlap and even have physical addresses, but they are redundant
 
         if ( 0 != head.file_size && 0 != head.physical_address && 1 == head.type )
         {
-            fseek( fp, (long) head.offset_in_image, SEEK_SET );
-            read = fread( memory.data() + head.physical_address - g_base_address, 1, head.file_size, fp );
-            if ( 0 == read )
-                usage( "can't read image" );
+            if ( !map_segment( image, head.physical_address - g_vm->base_address, head.offset_in_image, head.file_size ) )
+            {
+                image.seek( head.offset_in_image );
+                read = image.read( g_vm->memory.data() + head.physical_address - g_vm->base_address, 1, head.file_size );
+                if ( 0 == read )
+                    usage( "can't read image" );
+            }
 
             first_uninitialized_data = get_max( head.physical_address + head.file_size, first_uninitialized_data );
+#ifdef RVOS
+            if ( g_vm->hash_image ) // reading every byte faults in the pages map_segment just mapped
+            {
+                uint64_t segment[] = { head.physical_address, head.file_size, head.memory_size };
+                g_vm->image_hash = CPUClass::hash_bytes( segment, sizeof( segment ), g_vm->image_hash );
+                g_vm->image_hash = CPUClass::hash_bytes( g_vm->memory.data() + head.physical_address - g_vm->base_address, head.file_size, g_vm->image_hash );
+            }
+#endif
 
             tracer.Trace( "  read type %s: %llx bytes into physical address %llx - %llx then uninitialized to %llx \n", head.show_type(), head.file_size,
                           head.physical_address, head.physical_address + head.file_size - 1, head.physical_address + head.memory_size - 1 );
-            tracer.TraceBinaryData( memory.data() + head.physical_address - g_base_address, get_min( (uint32_t) head.file_size, (uint32_t) 128 ), 4 );
+            tracer.TraceBinaryData( g_vm->memory.data() + head.physical_address - g_vm->base_address, get_min( (uint32_t) head.file_size, (uint32_t) 128 ), 4 );
         }
     }
 
@@ -9836,7 +10970,7 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
 
     const uint32_t max_args = 40;
     REG_TYPE aargs[ max_args ]; // vm pointers to each arguments
-    char * buffer_args = (char *) ( memory.data() + arg_data_offset );
+    char * buffer_args = (char *) ( g_vm->memory.data() + arg_data_offset );
     char * pargs = buffer_args;
     uint64_t written_argc = 0;
 
@@ -9844,8 +10978,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     backslash_to_slash( pargs );
     {
         uint64_t offset = pargs - buffer_args;
-        aargs[ written_argc ] = offset + g_base_address + arg_data_offset;
-        tracer.Trace( "  argument %llu is '%s', at vm address %llx\n", written_argc, pargs, (uint64_t) offset + g_base_address + arg_data_offset );
+        aargs[ written_argc ] = offset + g_vm->base_address + arg_data_offset;
+        tracer.Trace( "  argument %llu is '%s', at vm address %llx\n", written_argc, pargs, (uint64_t) offset + g_vm->base_address + arg_data_offset );
         written_argc++;
         pargs += strlen( pargs ) + 1;
     }
@@ -9855,8 +10989,8 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
         strcpy( pargs, app_argv[ i ] );
 
         uint64_t offset = pargs - buffer_args;
-        aargs[ written_argc ] = offset + g_base_address + arg_data_offset;
-        tracer.Trace( "  argument %llu is '%s', at vm address %llx\n", written_argc, pargs, (uint64_t) offset + g_base_address + arg_data_offset );
+        aargs[ written_argc ] = offset + g_vm->base_address + arg_data_offset;
+        tracer.Trace( "  argument %llu is '%s', at vm address %llx\n", written_argc, pargs, (uint64_t) offset + g_vm->base_address + arg_data_offset );
 
         written_argc++;
         pargs += strlen( pargs ) + 1;
@@ -9872,13 +11006,13 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     strcat( penv_data, APP_NAME );
     char * penv_cur = penv_data + 1 + strlen( penv_data );
     REG_TYPE app_env_count = 0;
-    aenv[ app_env_count++ ] = (REG_TYPE) ( penv_data - (char *) memory.data() ) + g_base_address;
+    aenv[ app_env_count++ ] = (REG_TYPE) ( penv_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     tracer.Trace( "env_os_address %x\n", aenv[ 0 ] );
 
-    if ( g_penvironment ) // semicolon-separated list of name=value pairs. names like PATH can have colon-separated values
+    if ( g_vm->penvironment ) // semicolon-separated list of name=value pairs. names like PATH can have colon-separated values
     {
-        tracer.Trace( "environment variable argument: '%s'\n", g_penvironment );
-        char * pfrom = g_penvironment;
+        tracer.Trace( "environment variable argument: '%s'\n", g_vm->penvironment );
+        char * pfrom = g_vm->penvironment;
         while ( *pfrom )
         {
             tracer.Trace( "remaining env: %s\n", pfrom );
@@ -9889,7 +11023,7 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
                 usage( "environment variable is malformed; no equal sign" );
             strcpy( penv_cur, pfrom );
             size_t len = strlen( penv_cur );
-            aenv[ app_env_count++ ] =  (REG_TYPE) ( penv_cur - (char *) memory.data() ) + g_base_address;
+            aenv[ app_env_count++ ] =  (REG_TYPE) ( penv_cur - (char *) g_vm->memory.data() ) + g_vm->base_address;
             penv_cur += len + 1;
             pfrom += len + ( psc ? 1 : 0 );
         }
@@ -9916,7 +11050,7 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
             if ( 0 != acName[ 0 ] )
             {
                 char * ptz_data = penv_cur;
-                aenv[ app_env_count++ ] = (REG_TYPE) ( ptz_data - (char *) memory.data() ) + g_base_address;
+                aenv[ app_env_count++ ] = (REG_TYPE) ( ptz_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
                 tracer.Trace( "env_tz_address %x\n", aenv[ app_env_count - 1 ] );
                 strcpy( ptz_data, "TZ=" );
 
@@ -9942,22 +11076,23 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     }
 #endif //_WIN32
 
-    char * execfn_string = resolve_execfn_path( pimage );
+    char acExecfn[ EMULATOR_MAX_PATH + 1 ];
+    char * execfn_string = resolve_execfn_path( pimage, acExecfn );
     backslash_to_slash( execfn_string );
     char * pexecfn_data = penv_cur;
     strcpy( pexecfn_data, execfn_string );
-    REG_TYPE aexecfn = (REG_TYPE) ( pexecfn_data - (char *) memory.data() ) + g_base_address;
+    REG_TYPE aexecfn = (REG_TYPE) ( pexecfn_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     penv_cur += strlen( pexecfn_data ) + 1;
     tracer.Trace( "execfn_string '%s', vm address %x\n", pexecfn_data, aexecfn );
 
     char * p_at_platform_data = penv_cur;
     strcpy( p_at_platform_data, AT_PLATFORM_VALUE );
-    REG_TYPE p_at_platform = (REG_TYPE) ( p_at_platform_data - (char *) memory.data() ) + g_base_address;
+    REG_TYPE p_at_platform = (REG_TYPE) ( p_at_platform_data - (char *) g_vm->memory.data() ) + g_vm->base_address;
     penv_cur += strlen( p_at_platform_data ) + 1;
     tracer.Trace( "at_platform '%s', vm address %x\n", p_at_platform_data, p_at_platform );
 
     tracer.Trace( "args_len %d, penv_data %p\n", args_len, penv_data );
-    tracer.TraceBinaryData( (uint8_t *) ( memory.data() + arg_data_offset ), g_arg_data_commit + 0x20, 4 ); // +20 to inspect for bugs
+    tracer.TraceBinaryData( (uint8_t *) ( g_vm->memory.data() + arg_data_offset ), g_arg_data_commit + 0x20, 4 ); // +20 to inspect for bugs
 
     // put the Linux startup info at the top of the stack. this consists of (from high to low):
     //   two 8-byte random numbers used for stack and pointer guards
@@ -9971,13 +11106,13 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     //   1..n argv string pointers
     //   argc  <<<==== sp should point here when the entrypoint (likely _start) is invoked
 
-    uint64_t * pstack = (uint64_t *) ( memory.data() + top_of_aux );
+    uint64_t * pstack = (uint64_t *) ( g_vm->memory.data() + top_of_aux );
 
     pstack--;
     *pstack = 0x0102030405060708; // use fixed values for consistent traces across runs
     pstack--;
     *pstack = 0x0102030405060708;
-    uint64_t prandom = g_base_address + top_of_aux - 16;
+    uint64_t prandom = g_vm->base_address + top_of_aux - 16;
 
     // ensure that after all of this the stack is 16-byte aligned
 
@@ -9996,7 +11131,11 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     paux[irec].a_un.a_val = 4096;
     paux[irec++].swap_endianness();
     paux[irec].a_type = 16; // AT_HWCAP
+#ifdef RVOS
+    paux[irec].a_un.a_val = RiscV::isa_letters; // RISC-V single-letter extensions including B. Zicond is reported only by riscv_hwprobe
+#else
     paux[irec].a_un.a_val = 0xa01; // ARM64 bits for fp(0), atomics(8), cpuid(11)
+#endif
     paux[irec++].swap_endianness();
     paux[irec].a_type = 26; // AT_HWCAP2
     paux[irec].a_un.a_val = 0;
@@ -10040,44 +11179,88 @@ static bool load_image( const char * pimage, char * const * app_argv, int app_ar
     pstack--;
     *pstack = swap_endian64( written_argc );
 
-    g_top_of_stack = (uint64_t) ( ( (uint8_t *) pstack - memory.data() ) + g_base_address );
-    uint64_t aux_data_size = top_of_aux - (uint64_t) ( (uint8_t *) pstack - memory.data() );
+    g_vm->top_of_stack = (uint64_t) ( ( (uint8_t *) pstack - g_vm->memory.data() ) + g_vm->base_address );
+    uint64_t aux_data_size = top_of_aux - (uint64_t) ( (uint8_t *) pstack - g_vm->memory.data() );
     tracer.Trace( "stack at start (beginning with argc) -- %llu bytes at address %p:\n", aux_data_size, pstack );
     tracer.TraceBinaryData( (uint8_t *) pstack, (uint32_t) aux_data_size, 2 );
 
     tracer.Trace( "memory map from highest to lowest addresses:\n" );
-    tracer.Trace( "  first byte beyond allocated memory:                 %llx\n", g_base_address + memory_size );
-    tracer.Trace( "  <mmap arena>                                        (%lld = %llx bytes)\n", g_mmap_commit, g_mmap_commit );
-    tracer.Trace( "  mmap start adddress:                                %llx\n", g_base_address + g_mmap_offset );
+    tracer.Trace( "  first byte beyond allocated memory:                 %llx\n", g_vm->base_address + memory_size );
+    tracer.Trace( "  <mmap arena>                                        (%lld = %llx bytes)\n", g_vm->mmap_commit, g_vm->mmap_commit );
+    tracer.Trace( "  mmap start adddress:                                %llx\n", g_vm->base_address + g_vm->mmap_offset );
     tracer.Trace( "  <align to 4k-page for mmap allocations>\n" );
-    tracer.Trace( "  start of aux data:                                  %llx\n", g_top_of_stack + aux_data_size );
+    tracer.Trace( "  start of aux data:                                  %llx\n", g_vm->top_of_stack + aux_data_size );
     tracer.Trace( "  <random, alignment, aux recs, env, argv>            (%lld == %llx bytes)\n", aux_data_size, aux_data_size );
-    tracer.Trace( "  initial stack pointer g_top_of_stack:               %llx\n", g_top_of_stack );
-    uint64_t stack_bytes = g_stack_commit - aux_data_size;
+    tracer.Trace( "  initial stack pointer top_of_stack:                 %llx\n", g_vm->top_of_stack );
+    uint64_t stack_bytes = g_vm->stack_commit - aux_data_size;
     tracer.Trace( "  <stack>                                             (%lld == %llx bytes)\n", stack_bytes, stack_bytes );
-    tracer.Trace( "  last byte stack can use (g_bottom_of_stack):        %llx\n", g_base_address + g_bottom_of_stack );
-    tracer.Trace( "  <unallocated space between brk and the stack>       (%lld == %llx bytes)\n", g_brk_commit, g_brk_commit );
-    tracer.Trace( "  end_of_data / current brk:                          %llx\n", g_base_address + g_end_of_data );
-    uint64_t argv_bytes = g_end_of_data - arg_data_offset;
+    tracer.Trace( "  last byte stack can use (bottom_of_stack):          %llx\n", g_vm->base_address + g_vm->bottom_of_stack );
+    tracer.Trace( "  <unallocated space between brk and the stack>       (%lld == %llx bytes)\n", g_vm->brk_commit, g_vm->brk_commit );
+    tracer.Trace( "  end_of_data / current brk:                          %llx\n", g_vm->base_address + g_vm->end_of_data );
+    uint64_t argv_bytes = g_vm->end_of_data - arg_data_offset;
     tracer.Trace( "  <argv data, pointed to by argv array above>         (%lld == %llx bytes)\n", argv_bytes, argv_bytes );
-    tracer.Trace( "  start of argv data:                                 %llx\n", g_base_address + arg_data_offset );
-    uint64_t uninitialized_bytes = g_base_address + arg_data_offset - first_uninitialized_data;
+    tracer.Trace( "  start of argv data:                                 %llx\n", g_vm->base_address + arg_data_offset );
+    uint64_t uninitialized_bytes = g_vm->base_address + arg_data_offset - first_uninitialized_data;
     tracer.Trace( "  <uninitialized data per the .elf file>              (%lld == %llx bytes)\n", uninitialized_bytes, uninitialized_bytes );
     tracer.Trace( "  first byte of uninitialized data:                   %llx\n", first_uninitialized_data );
     tracer.Trace( "  <initialized data from the .elf file>\n" );
     tracer.Trace( "  <code from the .elf file>\n" );
-    tracer.Trace( "  initial pc execution_addess:                        %llx\n", g_execution_address );
+    tracer.Trace( "  initial pc execution_addess:                        %llx\n", g_vm->execution_address );
     tracer.Trace( "  <code per the .elf file>\n" );
-    tracer.Trace( "  start of the address space per the .elf file:       %llx\n", g_base_address );
+    tracer.Trace( "  start of the address space per the .elf file:       %llx\n", g_vm->base_address );
 
-    tracer.Trace( "vm memory first byte beyond:     %p\n", memory.data() + memory_size );
-    tracer.Trace( "vm memory start:                 %p\n", memory.data() );
+    tracer.Trace( "vm memory first byte beyond:     %p\n", g_vm->memory.data() + memory_size );
+    tracer.Trace( "vm memory start:                 %p\n", g_vm->memory.data() );
     tracer.Trace( "memory_size:                     %#llx == %lld\n", memory_size, memory_size );
-    tracer.Trace( "risc-v compressed instructions:  %s\n", g_compressed_rvc ? "yes" : "no" );
+    tracer.Trace( "risc-v compressed instructions:  %s\n", g_vm->compressed_rvc ? "yes" : "no" );
 
 #endif //M68
 
     return true;
+} //load_elf_image
+
+static bool load_image( const char * pimage, char * const * app_argv, int app_argc )
+{
+    tracer.Trace( "loading image %s\n", pimage );
+
+    strcpy( g_vm->acLoadedApp, pimage );
+
+    // A legacy flat, space-joined app_args string is still needed by callees that expect a single
+    // command-line string (CP/M's command tail, and the 64-bit ELF path). Individual arguments
+    // that themselves contain spaces can't survive that join, so the ELF (argv-array) path in
+    // load_elf_image uses app_argv/app_argc directly instead, preserving each argument's exact boundaries.
+
+    char acAppArgs[ 1024 ];
+    acAppArgs[ 0 ] = 0;
+    for ( int i = 0; i < app_argc; i++ )
+    {
+        if ( strlen( acAppArgs ) + 3 + strlen( app_argv[ i ] ) >= _countof( acAppArgs ) )
+            break;
+
+        if ( 0 != acAppArgs[0] )
+            strcat( acAppArgs, " " );
+
+        strcat( acAppArgs, app_argv[ i ] );
+    }
+
+#ifdef M68
+    if ( ends_with( pimage, ".hex" ) ) // Motorola 68000 hex file special-case
+        return load_68000_hex( pimage ); // app args are lost with hex files
+
+    if ( ends_with( pimage, ".68k" ) || ends_with( pimage, ".rel" ) ) // Digital Research CP/M 68K executable file
+        return load_cpm68k( pimage, acAppArgs );
+#endif
+
+    FILE * fp = fopen( pimage, "rb" );
+    if ( !fp )
+    {
+        printf( "can't open elf image file: %s\n", pimage );
+        usage();
+    }
+
+    CFile file( fp );
+    ElfImageReader image( fp );
+    return load_elf_image( image, pimage, app_argv, app_argc );
 } //load_image
 
 static void elf_info32( FILE * fp, bool verbose )
@@ -10111,7 +11294,7 @@ static void elf_info32( FILE * fp, bool verbose )
     printf( "  section offset: %u == %#x\n", ehead.section_header_table, ehead.section_header_table );
     printf( "  flags: %#x\n", ehead.flags );
 
-    g_execution_address = ehead.entry_point;
+    g_vm->execution_address = ehead.entry_point;
     REG_TYPE memory_size = 0;
 
     printf( "program headers:\n" );
@@ -10145,12 +11328,12 @@ static void elf_info32( FILE * fp, bool verbose )
 
         if ( 0 != head.physical_address )
         {
-            if ( ( 0 == g_base_address ) || ( g_base_address > head.physical_address ) )
-                g_base_address = head.physical_address;
+            if ( ( 0 == g_vm->base_address ) || ( g_vm->base_address > head.physical_address ) )
+                g_vm->base_address = head.physical_address;
         }
     }
 
-    memory_size -= g_base_address;
+    memory_size -= g_vm->base_address;
 
     // first load the string tables
 
@@ -10257,10 +11440,10 @@ static void elf_info32( FILE * fp, bool verbose )
     printf( "global info\n" );
     printf( "  flags: %#08x\n", ehead.flags );
 
-    printf( "  vm g_base_address %llx\n", (uint64_t) g_base_address );
+    printf( "  vm base_address %llx\n", (uint64_t) g_vm->base_address );
     printf( "  memory_size: %llx\n", (uint64_t) memory_size );
-    printf( "  g_stack_commit: %llx\n", (uint64_t) g_stack_commit );
-    printf( "  g_execution_address %llx\n", (uint64_t) g_execution_address );
+    printf( "  stack_commit: %llx\n", (uint64_t) g_vm->stack_commit );
+    printf( "  execution_address %llx\n", (uint64_t) g_vm->execution_address );
 } //elf_info32
 
 static void elf_info( const char * pimage, bool verbose )
@@ -10318,8 +11501,8 @@ static void elf_info( const char * pimage, bool verbose )
     printf( "  section offset: %llu == %llx\n", ehead.section_header_table, ehead.section_header_table );
     printf( "  flags: %x\n", ehead.flags );
 
-    g_execution_address = (REG_TYPE) ehead.entry_point;
-    g_compressed_rvc = 0 != ( ehead.flags & 1 ); // 2-byte compressed RVC instructions, not 4-byte default risc-v instructions
+    g_vm->execution_address = (REG_TYPE) ehead.entry_point;
+    g_vm->compressed_rvc = 0 != ( ehead.flags & 1 ); // 2-byte compressed RVC instructions, not 4-byte default risc-v instructions
     REG_TYPE memory_size = 0;
 
     printf( "program headers:\n" );
@@ -10353,12 +11536,12 @@ static void elf_info( const char * pimage, bool verbose )
 
         if ( 0 != head.physical_address )
         {
-            if ( ( 0 == g_base_address ) || ( g_base_address > head.physical_address ) )
-                g_base_address = (REG_TYPE) head.physical_address;
+            if ( ( 0 == g_vm->base_address ) || ( g_vm->base_address > head.physical_address ) )
+                g_vm->base_address = (REG_TYPE) head.physical_address;
         }
     }
 
-    memory_size -= g_base_address;
+    memory_size -= g_vm->base_address;
 
     // first load the string tables
 
@@ -10459,26 +11642,96 @@ static void elf_info( const char * pimage, bool verbose )
         }
     }
 
-    if ( 0 == g_base_address )
+    if ( 0 == g_vm->base_address )
         printf( "base address of elf image is zero; physical address required for the emulator\n" );
 
     printf( "global info\n" );
     printf( "  flags: %#08x\n", ehead.flags );
-    printf( "    contains 2-byte compressed RVC instructions: %s\n", g_compressed_rvc ? "yes" : "no" );
+    printf( "    contains 2-byte compressed RVC instructions: %s\n", g_vm->compressed_rvc ? "yes" : "no" );
     printf( "    contains 4-byte float instructions: %s\n", ( ehead.flags & 2 ) ? "yes" : "no" );
     printf( "    contains 8-byte double instructions: %s\n", ( ehead.flags & 4 ) ? "yes" : "no" );
     printf( "    RV TSO memory consistency: %s\n", ( ehead.flags & 0x10 ) ? "yes" : "no" );
     printf( "    contains non-standard extensions: %s\n", ( ehead.flags & 0xff000000 ) ? "yes" : "no" );
 
-    printf( "  vm g_base_address %llx\n", (uint64_t) g_base_address );
+    printf( "  vm base_address %llx\n", (uint64_t) g_vm->base_address );
     printf( "  memory_size: %llx\n", (uint64_t) memory_size );
-    printf( "  g_stack_commit: %llx\n", (uint64_t) g_stack_commit );
-    printf( "  g_execution_address %llx\n", (uint64_t) g_execution_address );
+    printf( "  stack_commit: %llx\n", (uint64_t) g_vm->stack_commit );
+    printf( "  execution_address %llx\n", (uint64_t) g_vm->execution_address );
 #endif
 } //elf_info
 
+#ifndef RVOS_LIBRARY
+
+#ifdef RVOS
+
+// the -c directory when none is given: $XDG_CACHE_HOME/rvos or $HOME/.cache/rvos, created if needed. Cache files hold
+// host code that gets run, so they live in a directory private to the user rather than a shared one like /tmp
+
+static bool default_translation_cache_dir( char * dir, size_t len )
+{
+#ifdef _WIN32
+    return false; // the translation cache requires mmap
+#else
+    const char * xdg = getenv( "XDG_CACHE_HOME" );
+    const char * home = getenv( "HOME" );
+    if ( 0 != xdg && '/' == xdg[ 0 ] )
+        snprintf( dir, len, "%s", xdg );
+    else if ( 0 != home && '/' == home[ 0 ] )
+        snprintf( dir, len, "%s/.cache", home );
+    else
+        return false;
+
+    mkdir( dir, 0700 ); // it usually exists already
+    size_t base_len = strlen( dir );
+    snprintf( dir + base_len, len - base_len, "/rvos" );
+    if ( 0 != mkdir( dir, 0700 ) && EEXIST != errno )
+        return false;
+
+    struct stat st;
+    if ( 0 != lstat( dir, &st ) || !S_ISDIR( st.st_mode ) || st.st_uid != geteuid() || 0 != ( st.st_mode & ( S_IWGRP | S_IWOTH ) ) )
+    {
+        tracer.Trace( "translation cache directory %s isn't a directory owned and only writable by this user\n", dir );
+        return false;
+    }
+
+    return true;
+#endif
+} //default_translation_cache_dir
+
+#endif // RVOS
+
+// the host process's resident set size now and at its peak, for -p. false if the OS can't tell
+
+static bool host_rss( uint64_t & current, uint64_t & peak )
+{
+    current = 0;
+    peak = 0;
+#if defined( __linux__ ) && !defined( __mc68000__ )
+    FILE * fp = fopen( "/proc/self/statm", "r" );
+    if ( fp )
+    {
+        unsigned long long size, resident;
+        if ( 2 == fscanf( fp, "%llu %llu", &size, &resident ) )
+            current = resident * sysconf( _SC_PAGESIZE );
+        fclose( fp );
+    }
+
+    struct rusage ru;
+    if ( 0 == getrusage( RUSAGE_SELF, &ru ) )
+        peak = (uint64_t) ru.ru_maxrss * 1024; // kilobytes on Linux
+#elif defined( __APPLE__ )
+    struct rusage ru;
+    if ( 0 == getrusage( RUSAGE_SELF, &ru ) )
+        peak = (uint64_t) ru.ru_maxrss; // bytes on macOS
+#endif
+    return ( 0 != current || 0 != peak );
+} //host_rss
+
 int main( int argc, char * argv[] )
 {
+    unique_ptr<VMContext> vm( new VMContext() ); // this process runs one vm
+    g_vm = vm.get();
+
     try
     {
         bool trace = false;
@@ -10488,9 +11741,15 @@ int main( int argc, char * argv[] )
         bool elfInfo = false;
         bool verboseElfInfo = false;
         bool generateRVCTable = false;
+        bool useTranslationCache = false;
+        uint64_t instructionBudget = 0;
+        const char * pcTranslationCacheDir = 0;
         static char * appArgv[ 40 ]; // pointers to the original argv strings, boundaries preserved (an arg may itself contain spaces)
         int appArgc = 0;
         static char acApp[1024] = {0};
+        bool heapSpecified = false;
+        bool mmapSpecified = false;
+        const REG_TYPE maxSpaceMeg = ( sizeof( REG_TYPE ) >= 8 ) ? 1024 * 1024 : 1024; // hosts without lazy reservations are checked below
 
         setlocale( LC_CTYPE, "en_US.UTF-8" );            // these are needed for printf of utf-8 to work
         setlocale( LC_COLLATE, "en_US.UTF-8" );
@@ -10512,13 +11771,31 @@ int main( int argc, char * argv[] )
                 {
                     if ( ':' != parg[2] || 0 == parg[3] )
                         usage( "the -e argument requires a value" );
-                    g_penvironment = parg + 3;
+                    g_vm->penvironment = parg + 3;
                 }
                 else if ( 't' == ca )
                     trace = true;
                 else if ( 'i' == ca )
                     traceInstructions = true;
 #ifdef RVOS
+                else if ( 'a' == ca )
+                    g_vm->identity_map = true;
+                else if ( 'b' == ca )
+                {
+                    if ( ':' != parg[2] )
+                        usage( "the -b argument requires a value" );
+
+                    instructionBudget = strtoull( parg + 3 , 0, 10 ) * 1000000;
+                    if ( 0 == instructionBudget )
+                        usage( "invalid instruction budget specified" );
+                }
+                else if ( 'c' == ca )
+                {
+                    useTranslationCache = true;
+                    g_vm->hash_image = true;
+                    if ( ':' == parg[2] && 0 != parg[3] )
+                        pcTranslationCacheDir = parg + 3;
+                }
                 else if ( 'g' == ca )
                     generateRVCTable = true;
 #endif
@@ -10528,10 +11805,11 @@ int main( int argc, char * argv[] )
                         usage( "the -h argument requires a value" );
 
                     REG_TYPE heap = (REG_TYPE) strtoull( parg + 3 , 0, 10 );
-                    if ( heap > 1024 ) // limit to a gig
+                    if ( heap > maxSpaceMeg ) // limit to a gig, or a terabyte with -x
                         usage( "invalid heap size specified" );
 
-                    g_brk_commit = heap * 1024 * 1024;
+                    g_vm->brk_commit = heap * 1024 * 1024;
+                    heapSpecified = true;
                 }
 #ifdef _WIN32
                 else if ( 'l' == ca )
@@ -10543,15 +11821,28 @@ int main( int argc, char * argv[] )
                         usage( "the -m argument requires a value" );
 
                     REG_TYPE mmap_space = (REG_TYPE) strtoull( parg + 3 , 0, 10 );
-                    if ( mmap_space > 1024 ) // limit to a gig
+                    if ( mmap_space > maxSpaceMeg ) // limit to a gig, or a terabyte with -x
                         usage( "invalid mmap size specified" );
 
-                    g_mmap_commit = mmap_space * 1024 * 1024;
+                    g_vm->mmap_commit = mmap_space * 1024 * 1024;
+                    mmapSpecified = true;
                 }
                 else if ( 'n' == ca )
                     elfInfo = true;
                 else if ( 'p' == ca )
                     showPerformance = true;
+                else if ( 'r' == ca )
+                {
+                    if ( ':' != parg[2] )
+                        usage( "the -r argument requires a value" );
+
+                    uint64_t limit = strtoull( parg + 3 , 0, 10 );
+                    if ( 0 == limit || limit > ( (uint64_t) 1 << 30 ) )
+                        usage( "invalid address space limit specified" );
+
+                    g_vm->address_space_limit = limit * 1024 * 1024;
+                    g_vm->address_space_max = g_vm->address_space_limit;
+                }
                 else if ( 's' == ca )
                 {
                     if ( ':' != parg[2] )
@@ -10561,10 +11852,18 @@ int main( int argc, char * argv[] )
                     if ( stack_space > 1024 ) // limit to a meg
                         usage( "invalid stack size specified" );
 
-                    g_stack_commit = stack_space * 1024;
+                    g_vm->stack_commit = stack_space * 1024;
                 }
+#ifdef __linux__
+                else if ( 'u' == ca )
+                    g_vm->huge_pages = true;
+#endif
                 else if ( 'v' == ca )
                     verboseElfInfo = true;
+#ifdef LAZY_GUEST_SPACE
+                else if ( 'x' == ca )
+                    g_vm->sparse = true;
+#endif
                 else if ( 'z' == ca )
                     g_addTimeZoneToEnv = false;
                 else
@@ -10579,6 +11878,22 @@ int main( int argc, char * argv[] )
             }
         }
 
+        if ( g_vm->sparse )
+        {
+            // The host only backs pages the app touches, so the reservations cost address space, not RAM. The mmap space
+            // covers the addresses the Go runtime and others pass as hints, so those are honored
+
+            if ( sizeof( void * ) < 8 )
+                usage( "-x requires a 64-bit host" );
+            if ( !heapSpecified )
+                g_vm->brk_commit = (REG_TYPE) ( (uint64_t) 256 << 30 );
+            if ( !mmapSpecified )
+                g_vm->mmap_commit = (REG_TYPE) ( (uint64_t) 768 << 30 );
+        }
+        else if ( default_guest_space() < ( 1024 * 1024 * 1024 ) && // reservations are committed up front
+                  ( g_vm->brk_commit > ( 1024 * 1024 * 1024 ) || g_vm->mmap_commit > ( 1024 * 1024 * 1024 ) ) )
+            usage( "-h and -m are limited to 1024 meg on this host" );
+
         tracer.Enable( trace, PREFIX_L( LOGFILE_NAME ), true );
         tracer.SetQuiet( true );
         tracer.Trace( "host is little endian: %d, emulated cpu is little endian: %d\n", HOST_IS_LITTLE_ENDIAN, CPU_IS_LITTLE_ENDIAN );
@@ -10652,7 +11967,7 @@ int main( int argc, char * argv[] )
         bool ok = load_image( acApp, appArgv, appArgc );
         if ( ok )
         {
-            unique_ptr<CPUClass> cpu( new CPUClass( memory, g_base_address, g_execution_address, g_stack_commit, g_top_of_stack ) );
+            unique_ptr<CPUClass> cpu( new CPUClass( g_vm->memory, g_vm->base_address, g_vm->execution_address, g_vm->stack_commit, g_vm->top_of_stack ) );
 
 #if defined( SPARCOS )
             cpu->Sparc_wim() = 2; // wim bit 1 is turned on. The OS owns management of WIM. By default on reset it's set to 0xffffffff
@@ -10663,11 +11978,77 @@ int main( int argc, char * argv[] )
             cpu->trace_instructions( traceInstructions );
             high_resolution_clock::time_point tStart = high_resolution_clock::now();
 
+#ifdef RVOS
+            size_t cachedBlocks = 0;
+            char acCacheDir[ EMULATOR_MAX_PATH ];
+            if ( useTranslationCache && 0 == pcTranslationCacheDir )
+            {
+                if ( default_translation_cache_dir( acCacheDir, sizeof( acCacheDir ) ) )
+                    pcTranslationCacheDir = acCacheDir;
+                else
+                {
+                    tracer.Trace( "no private directory for the translation cache, so it's disabled\n" );
+                    useTranslationCache = false;
+                }
+            }
+
+            if ( useTranslationCache )
+            {
+                snprintf( g_vm->acTranslationCache, sizeof( g_vm->acTranslationCache ), "%s/rvos-%016llx.cache", pcTranslationCacheDir, (unsigned long long) g_vm->image_hash );
+                cachedBlocks = cpu->load_translation_cache( g_vm->acTranslationCache, g_vm->image_hash );
+            }
+#endif
+
             #ifdef _WIN32
-                g_tAppStart = tStart;
+                g_vm->tAppStart = tStart;
             #endif
 
+#ifdef RVOS
+            // pick the run loop specialized for just the features in use
+
+            uint32_t features = 0;
+            if ( trace )
+                features |= CPUClass::feature_trace;
+    #ifndef NDEBUG
+            features |= CPUClass::feature_checks;
+    #endif
+            if ( 0 != instructionBudget )
+            {
+                features |= CPUClass::feature_budget;
+                cpu->instruction_budget = instructionBudget;
+            }
+
+            g_vm->main_thread.cpu = cpu.get();
+            g_vm->main_thread.tid = host_thread_id();
+            g_current_thread = &g_vm->main_thread;
+            g_vm->run_features = features;
+    #ifdef USE_HOST_FUTEX
+            g_vm->main_thread.host_handle = pthread_self();
+            struct sigaction sa = {};
+            sa.sa_handler = interrupt_handler; // no SA_RESTART, so blocked system calls return EINTR
+            sigaction( SIGUSR2, &sa, 0 );
+    #endif
+    #ifdef USE_GUARD_PAGES
+            install_guard_page_handler();
+    #endif
+
+            uint64_t instructions = cpu->run( features );
+
+            if ( !g_vm->terminate && ( 0 != instructionBudget ) && ( instructions >= instructionBudget ) )
+            {
+                printf( "the app was stopped after exceeding its budget of %llu instructions\n", (unsigned long long) instructionBudget );
+                g_vm->exit_code = 1;
+            }
+
+            g_vm->main_thread.finished = true;
+            if ( !g_vm->terminate && !g_vm->main_thread.exited ) // the budget ran out, so stop the other threads too
+                end_guest_threads();
+            if ( g_vm->stopping )
+                stop_blocked_harts();
+            instructions += join_guest_threads();
+#else
             uint64_t instructions = cpu->run();
+#endif
 
             char ac[ 100 ];
             if ( showPerformance )
@@ -10679,13 +12060,50 @@ int main( int argc, char * argv[] )
                 printf( "instructions:          %15s\n", CDJLTrace::RenderNumberWithCommas( instructions, ac ) );
                 if ( 0 != totalTime )
                     printf( "effective clock rate:  %15s\n", CDJLTrace::RenderNumberWithCommas( instructions / totalTime, ac ) );
-                printf( "app exit code:         %15d\n", g_exit_code );
+                printf( "app exit code:         %15d\n", g_vm->exit_code );
+                printf( "guest RAM reserved:    %15s\n", CDJLTrace::RenderNumberWithCommas( g_vm->memory.size(), ac ) );
+                if ( g_vm->identity_map )
+                    printf( "identity-mapped:       %15s\n", ( g_vm->memory.data() == (uint8_t *) (uintptr_t) g_vm->base_address ) ? "yes" : "no" );
+                size_t touched = g_vm->memory.resident_bytes();
+                if ( 0 != touched )
+                    printf( "guest RAM touched:     %15s\n", CDJLTrace::RenderNumberWithCommas( touched, ac ) );
+                size_t released = g_vm->memory.discarded_bytes();
+                if ( 0 != released )
+                    printf( "guest RAM released:    %15s\n", CDJLTrace::RenderNumberWithCommas( released, ac ) );
+                uint64_t rss, peak_rss;
+                if ( host_rss( rss, peak_rss ) )
+                {
+                    if ( 0 != rss )
+                        printf( "host RSS:              %15s\n", CDJLTrace::RenderNumberWithCommas( rss, ac ) );
+                    printf( "host peak RSS:         %15s\n", CDJLTrace::RenderNumberWithCommas( peak_rss, ac ) );
+                }
+                if ( g_vm->huge_pages )
+                {
+                    printf( "huge pages advised:    %15s\n", CDJLTrace::RenderNumberWithCommas( g_vm->huge_pages_advised, ac ) );
+                    printf( "huge pages backed:     %15s\n", CDJLTrace::RenderNumberWithCommas( g_vm->memory.huge_page_bytes(), ac ) );
+                }
+#ifdef RVOS
+                if ( useTranslationCache )
+                    printf( "cached blocks loaded:  %15s\n", CDJLTrace::RenderNumberWithCommas( cachedBlocks, ac ) );
+
+                for ( size_t f = 0; f < CPUClass::fused_forms; f++ )
+                {
+                    char acLabel[ 40 ];
+                    snprintf( acLabel, sizeof( acLabel ), "fused %s:", CPUClass::fused_form_name( f ) );
+                    printf( "%-23s%15s\n", acLabel, CDJLTrace::RenderNumberWithCommas( cpu->fused_counts[ f ], ac ) );
+                }
+#endif
             }
 
-            tracer.Trace( "highwater brk heap:  %15s\n", CDJLTrace::RenderNumberWithCommas( g_highwater_brk - g_end_of_data, ac ) );
-            g_mmap.trace_allocations();
-            tracer.Trace( "highwater mmap heap: %15s\n", CDJLTrace::RenderNumberWithCommas( g_mmap.peak_usage(), ac ) );
-            tracer.Trace( "app exit code: %d\n", g_exit_code );
+#ifdef RVOS
+            if ( useTranslationCache )
+                cpu->save_translation_cache( g_vm->acTranslationCache, g_vm->image_hash );
+#endif
+
+            tracer.Trace( "highwater brk heap:  %15s\n", CDJLTrace::RenderNumberWithCommas( g_vm->highwater_brk - g_vm->end_of_data, ac ) );
+            g_vm->mmap_allocator.trace_allocations();
+            tracer.Trace( "highwater mmap heap: %15s\n", CDJLTrace::RenderNumberWithCommas( g_vm->mmap_allocator.peak_usage(), ac ) );
+            tracer.Trace( "app exit code: %d\n", g_vm->exit_code );
         }
     }
     catch ( bad_alloc & e )
@@ -10703,5 +12121,310 @@ int main( int argc, char * argv[] )
 
     g_consoleConfig.RestoreConsole( false );
     tracer.Shutdown();
-    return g_exit_code;
+    return g_vm->exit_code;
 } //main
+
+#endif //RVOS_LIBRARY
+
+#ifdef RVOS_LIBRARY
+
+#ifndef RVOS
+    #error librvos is only for RVOS builds
+#endif
+
+// librvos entry points. See librvos.h. Each sets g_vm since the host app may call on any thread
+
+struct rvos_vm
+{
+    VMContext context;
+    unique_ptr<CPUClass> cpu;                     // the main thread's hart, created by rvos_load_elf
+    vector<string> args;                          // argv[ 1 ] onward
+    string environment;                           // semicolon-separated name=value pairs, as with -e
+    uint64_t instructions = 0;                    // run by the main thread
+};
+
+static void set_vm_error( rvos_vm * vm, const char * perror )
+{
+    lock_guard<mutex> lock( vm->context.threads_mutex );
+    if ( vm->context.error.empty() )
+        vm->context.error = perror;
+} //set_vm_error
+
+rvos_vm * rvos_create_vm( uint64_t heap_bytes, uint64_t mmap_bytes, uint64_t stack_bytes )
+{
+    rvos_vm * vm = new rvos_vm();
+
+    // page multiples keep the stack 16-byte aligned and mmap 4k-aligned
+
+    if ( 0 != heap_bytes )
+        vm->context.brk_commit = round_up( heap_bytes, (REG_TYPE) 4096 );
+    if ( 0 != mmap_bytes )
+        vm->context.mmap_commit = round_up( mmap_bytes, (REG_TYPE) 4096 );
+    if ( 0 != stack_bytes )
+        vm->context.stack_commit = round_up( stack_bytes, (REG_TYPE) 4096 );
+
+#if defined( USE_HOST_FUTEX ) || defined( USE_GUARD_PAGES )
+    static once_flag handler_installed;
+    call_once( handler_installed, []()
+    {
+#ifdef USE_HOST_FUTEX
+        struct sigaction sa = {};
+        sa.sa_handler = interrupt_handler; // no SA_RESTART, so blocked system calls return EINTR
+        sigaction( SIGUSR2, &sa, 0 );
+#endif
+#ifdef USE_GUARD_PAGES
+        install_guard_page_handler(); // faults on other memory still go to the host app's handlers
+#endif
+    } );
+#endif
+
+    return vm;
+} //rvos_create_vm
+
+void rvos_destroy_vm( rvos_vm * vm )
+{
+    if ( 0 == vm )
+        return;
+
+    g_vm = &vm->context;
+    g_current_thread = &vm->context.main_thread;
+    vm->context.main_thread.finished = true;
+    end_guest_threads();
+    stop_blocked_harts();
+    join_guest_threads();
+    g_current_thread = 0;
+    g_vm = 0;
+    delete vm;
+} //rvos_destroy_vm
+
+bool rvos_set_args( rvos_vm * vm, int argc, const char * const * argv )
+{
+    vm->args.clear();
+    for ( int i = 0; i < argc; i++ )
+        vm->args.push_back( argv[ i ] );
+    return true;
+} //rvos_set_args
+
+bool rvos_set_env( rvos_vm * vm, int envc, const char * const * envp )
+{
+    string environment;
+    for ( int i = 0; i < envc; i++ )
+    {
+        if ( !strchr( envp[ i ], '=' ) || strchr( envp[ i ], ';' ) )
+            return false;
+
+        if ( 0 != i )
+            environment += ';';
+        environment += envp[ i ];
+    }
+
+    vm->environment = environment;
+    return true;
+} //rvos_set_env
+
+bool rvos_load_elf( rvos_vm * vm, const void * image, size_t image_len, const char * name )
+{
+    if ( !vm->context.error.empty() )
+        return false;
+
+    if ( 0 != vm->cpu )
+    {
+        set_vm_error( vm, "an elf image is already loaded" );
+        return false;
+    }
+
+    // argv, the environment, and execfn must fit in the vm's g_arg_data_commit bytes and 40-entry arrays
+
+    size_t arg_bytes = 2 * ( strlen( name ) + 1 ) + vm->environment.size() + 64;
+    for ( size_t i = 0; i < vm->args.size(); i++ )
+        arg_bytes += vm->args[ i ].size() + 1;
+
+    size_t env_count = vm->environment.empty() ? 0 : 1 + count( vm->environment.begin(), vm->environment.end(), ';' );
+    if ( arg_bytes > g_arg_data_commit || vm->args.size() > 38 || env_count > 38 || strlen( name ) >= EMULATOR_MAX_PATH )
+    {
+        set_vm_error( vm, "the arguments and environment are too large" );
+        return false;
+    }
+
+    g_vm = &vm->context;
+    g_current_thread = &vm->context.main_thread;
+
+    vector<char *> argv;
+    for ( size_t i = 0; i < vm->args.size(); i++ )
+        argv.push_back( (char *) vm->args[ i ].c_str() );
+    argv.push_back( 0 );
+
+    vector<char> environment( vm->environment.begin(), vm->environment.end() ); // the loader splits it in place
+    environment.push_back( 0 );
+    if ( !vm->environment.empty() )
+        vm->context.penvironment = environment.data();
+
+    tracer.Trace( "loading image %s from a %zu byte buffer\n", name, image_len );
+    strcpy( vm->context.acLoadedApp, name );
+
+    try
+    {
+        ElfImageReader reader( image, image_len );
+        if ( !load_elf_image( reader, name, argv.data(), (int) vm->args.size() ) )
+            throw runtime_error( "the elf image can't be loaded" );
+
+        vm->context.penvironment = 0;
+        vm->cpu.reset( new CPUClass( vm->context.memory, vm->context.base_address, vm->context.execution_address,
+                                     vm->context.stack_commit, vm->context.top_of_stack ) );
+        vm->context.main_thread.cpu = vm->cpu.get();
+        vm->context.main_thread.tid = host_thread_id();
+    }
+    catch ( exception & e )
+    {
+        vm->context.penvironment = 0;
+        set_vm_error( vm, e.what() );
+        return false;
+    }
+
+    return true;
+} //rvos_load_elf
+
+void rvos_set_syscall_hook( rvos_vm * vm, rvos_syscall_hook hook, void * context )
+{
+    vm->context.syscall_hook_context = context;
+    vm->context.syscall_hook = hook;
+} //rvos_set_syscall_hook
+
+void rvos_set_memory_limit( rvos_vm * vm, uint64_t bytes )
+{
+    vm->context.address_space_limit = ( 0 == bytes ) ? ~(uint64_t) 0 : bytes;
+    vm->context.address_space_max = vm->context.address_space_limit;
+} //rvos_set_memory_limit
+
+rvos_status rvos_run( rvos_vm * vm, uint64_t max_instructions )
+{
+    if ( 0 == vm->cpu )
+    {
+        set_vm_error( vm, "no elf image is loaded" );
+        return rvos_error;
+    }
+
+    if ( vm->context.terminate )
+        return vm->context.error.empty() ? rvos_exited : rvos_error;
+
+    g_vm = &vm->context;
+    g_current_thread = &vm->context.main_thread;
+
+    uint32_t features = 0;
+#ifndef NDEBUG
+    features |= CPUClass::feature_checks;
+#endif
+    vm->context.run_features = features; // threads created by the guest run until they exit or the vm ends
+    if ( 0 != max_instructions )
+    {
+        features |= CPUClass::feature_budget;
+        vm->cpu->instruction_budget = max_instructions;
+    }
+
+#ifdef USE_HOST_FUTEX
+    vm->context.main_thread.host_handle = pthread_self();
+#endif
+    vm->context.main_thread.finished = false;
+
+    vm->instructions += run_library_hart( vm->context.main_thread, features );
+
+    vm->context.main_thread.finished = true; // so a hart ending the vm doesn't wait on this one between calls
+
+    if ( vm->context.main_thread.exited && !vm->context.terminate ) // the app's other threads are still running
+        join_guest_threads();
+
+    if ( !vm->context.terminate )
+        return rvos_budget_exhausted;
+
+    if ( vm->context.stopping )
+        stop_blocked_harts();
+    join_guest_threads();
+    return vm->context.error.empty() ? rvos_exited : rvos_error;
+} //rvos_run
+
+uint64_t rvos_instructions( rvos_vm * vm ) { return vm->instructions; }
+int rvos_exit_code( rvos_vm * vm ) { return vm->context.exit_code; }
+
+const char * rvos_error_message( rvos_vm * vm )
+{
+    lock_guard<mutex> lock( vm->context.threads_mutex );
+    return vm->context.error.c_str();
+} //rvos_error_message
+
+uint64_t rvos_get_reg( rvos_vm * vm, size_t reg )
+{
+    return ( vm->cpu && reg < 32 ) ? vm->cpu->regs[ reg ] : 0;
+} //rvos_get_reg
+
+void rvos_set_reg( rvos_vm * vm, size_t reg, uint64_t value )
+{
+    if ( vm->cpu && reg > 0 && reg < 32 ) // x0 is always 0
+        vm->cpu->regs[ reg ] = value;
+} //rvos_set_reg
+
+uint64_t rvos_get_freg( rvos_vm * vm, size_t reg )
+{
+    uint64_t value = 0;
+    if ( vm->cpu && reg < 32 )
+        memcpy( &value, &vm->cpu->fregs[ reg ], sizeof( value ) );
+    return value;
+} //rvos_get_freg
+
+void rvos_set_freg( rvos_vm * vm, size_t reg, uint64_t value )
+{
+    if ( vm->cpu && reg < 32 )
+        memcpy( &vm->cpu->fregs[ reg ], &value, sizeof( value ) );
+} //rvos_set_freg
+
+uint64_t rvos_get_pc( rvos_vm * vm ) { return vm->cpu ? vm->cpu->pc : 0; }
+
+void rvos_set_pc( rvos_vm * vm, uint64_t pc )
+{
+    if ( vm->cpu )
+        vm->cpu->pc = pc;
+} //rvos_set_pc
+
+void * rvos_memory( rvos_vm * vm, uint64_t address, size_t len )
+{
+    uint64_t base = vm->context.base_address;
+    uint64_t size = vm->context.memory.size();
+    if ( address < base || ( address - base ) > size || len > ( size - ( address - base ) ) )
+        return 0;
+
+    // the stack's guard page is inside the buffer but inaccessible, so the host would fault on it
+
+    uint64_t offset = address - base;
+    uint64_t guard_start = vm->context.bottom_of_stack - vm->context.stack_guard;
+    if ( 0 != vm->context.stack_guard && offset < vm->context.bottom_of_stack && ( offset + len ) > guard_start )
+        return 0;
+
+    return vm->context.memory.data() + ( address - base );
+} //rvos_memory
+
+bool rvos_read_memory( rvos_vm * vm, uint64_t address, void * buffer, size_t len )
+{
+    void * p = rvos_memory( vm, address, len );
+    if ( 0 == p )
+        return false;
+
+    memcpy( buffer, p, len );
+    return true;
+} //rvos_read_memory
+
+bool rvos_write_memory( rvos_vm * vm, uint64_t address, const void * buffer, size_t len )
+{
+    void * p = rvos_memory( vm, address, len );
+    if ( 0 == p || vm->context.memory.is_read_only( (size_t) ( address - vm->context.base_address ), len ) )
+        return false;
+
+    memcpy( p, buffer, len );
+    return true;
+} //rvos_write_memory
+
+void rvos_code_written( rvos_vm * vm )
+{
+    g_vm = &vm->context;
+    flush_guest_threads(); // each hart flushes its decoded blocks before it runs again
+} //rvos_code_written
+
+#endif //RVOS_LIBRARY